@@ -82,6 +82,18 @@ public class WebViewObject : MonoBehaviour
     Rect rect;
     Texture2D texture;
     byte[] textureDataBuffer;
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+    int appliedFrameFormat;
+    bool appliedMipChain;
+    bool appliedMipChainGammaCorrect;
+    byte[] eventBuffer = new byte[4096];
+    Dictionary<string, int> channelIds = new Dictionary<string, int>();
+    Dictionary<int, Callback> channelCallbacks = new Dictionary<int, Callback>();
+    Dictionary<int, Action<Cookie[]>> cookieSnapshotCallbacks = new Dictionary<int, Action<Cookie[]>>();
+    Dictionary<int, string> cookieSnapshotUrls = new Dictionary<int, string>();
+    Action<NavigationTiming> navigationTimingCallback;
+    string compositionString = "";
+#endif
     string inputString = "";
     bool hasFocus;
 #elif UNITY_IPHONE
@@ -512,6 +524,18 @@ public class WebViewObject : MonoBehaviour
     [DllImport("WebView")]
     private static extern string _CWebViewPlugin_GetMessage(IntPtr instance);
 #elif UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_SetWorkerThreadCount(int count);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_ConfigureFrameBufferPool(long memoryCap, bool largePages);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_SetTracing(bool enabled);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool _CWebViewPlugin_WriteTrace(string path);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool _CWebViewPlugin_StartRecording(string path);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_StopRecording();
     [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
     private static extern void _CWebViewPlugin_InitStatic(
         bool inEditor, bool useMetal);
@@ -545,6 +569,11 @@ public class WebViewObject : MonoBehaviour
     private static extern int _CWebViewPlugin_Progress(
         IntPtr instance);
     [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern long _CWebViewPlugin_GetParkedBytesSaved(
+        IntPtr instance);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern string _CWebViewPlugin_GetStatsJson(IntPtr instance);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
     private static extern bool _CWebViewPlugin_CanGoBack(
         IntPtr instance);
     [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
@@ -572,6 +601,10 @@ public class WebViewObject : MonoBehaviour
     [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
     private static extern void _CWebViewPlugin_Render(IntPtr instance, IntPtr textureBuffer);
     [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_SetFrameFormat(IntPtr instance, int format);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_SetMipChain(IntPtr instance, bool enabled, bool gammaCorrect);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
     private static extern void _CWebViewPlugin_AddCustomHeader(IntPtr instance, string headerKey, string headerValue);
     [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
     private static extern string _CWebViewPlugin_GetCustomHeaderValue(IntPtr instance, string headerKey);
@@ -603,6 +636,67 @@ public class WebViewObject : MonoBehaviour
     private static extern void _CWebViewPlugin_Pause(IntPtr instance);
     [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
     private static extern void _CWebViewPlugin_Resume(IntPtr instance);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_ConfigureResponseCache(IntPtr instance, long maxBytes);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool _CWebViewPlugin_AddResponseCacheRule(IntPtr instance, string pattern, int ttlSeconds);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_ClearResponseCache(IntPtr instance, bool clearRules);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_LoadBlockRules(IntPtr instance, string rules);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_LoadBlockRulesFile(IntPtr instance, string path);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern string _CWebViewPlugin_GetBlockRuleHits(IntPtr instance);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_GetEvents(IntPtr instance, byte[] buffer, int capacity);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_SubscribeChannel(IntPtr instance, string channel, int maxQueued);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_UnsubscribeChannel(IntPtr instance, string channel);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern string _CWebViewPlugin_GetChannelStats(IntPtr instance);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_GetCookieSnapshot(IntPtr instance, string url);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_SetCookies(IntPtr instance, string json);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_SetCookieJarPath(string path, bool includeSession);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_SaveCookieJar(IntPtr instance, string path, bool includeSession);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_LoadCookieJar(IntPtr instance, string path);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_SetResourceTimingCapacity(IntPtr instance, int capacity);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern string _CWebViewPlugin_GetResourceTimings(IntPtr instance);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_GetResourceTimingSummary(IntPtr instance, byte[] buffer, int capacity);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern string _CWebViewPlugin_GetResourceHostStats(IntPtr instance);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_SetLifecyclePolicy(
+        int parkAfterMs, int lowMemoryAfterMs, int suspendAfterMs, long memoryBudget);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_GetLifecycleState(IntPtr instance);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern string _CWebViewPlugin_GetLifecycleStats();
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool _CWebViewPlugin_Prerender(IntPtr instance, string url);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr _CWebViewPlugin_CommitPrerender(IntPtr instance, string url);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_CancelPrerender(IntPtr instance);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern string _CWebViewPlugin_GetPrerenderStats();
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern int _CWebViewPlugin_AddUserScript(string script);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern bool _CWebViewPlugin_RemoveUserScript(int id);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_SendText(IntPtr instance, [MarshalAs(UnmanagedType.LPWStr)] string text);
+    [DllImport("WebViewPlugin", CallingConvention = CallingConvention.Cdecl)]
+    private static extern void _CWebViewPlugin_SetComposition(IntPtr instance, [MarshalAs(UnmanagedType.LPWStr)] string text, int cursor);
 #elif UNITY_IPHONE
     [DllImport("__Internal")]
     private static extern bool _CWebViewPlugin_IsInitialized(
@@ -711,6 +805,134 @@ public class WebViewObject : MonoBehaviour
 #endif
     }
 
+    // Threads used for frame conversion, shared by all webviews (0: default,
+    // which leaves two cores to Unity). Windows only.
+    public static void SetWorkerThreadCount(int count)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        _CWebViewPlugin_SetWorkerThreadCount(count);
+#endif
+    }
+
+    // memoryCap: bytes of frame storage shared by all webviews (0: unlimited)
+    public static void ConfigureFrameBufferPool(long memoryCap, bool largePages = false)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        _CWebViewPlugin_ConfigureFrameBufferPool(memoryCap, largePages);
+#endif
+    }
+
+    // Records a Chrome trace (chrome://tracing, Perfetto) of the native
+    // pipeline; enabling it discards earlier events
+    public static void SetTracingEnabled(bool enabled)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        _CWebViewPlugin_SetTracing(enabled);
+#endif
+    }
+
+    public static bool WriteTrace(string path)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        return _CWebViewPlugin_WriteTrace(path);
+#else
+        return false;
+#endif
+    }
+
+    // Logs every call into the native plugin to path, to be replayed with
+    // webview_replay when reproducing performance problems
+    public static bool StartRecording(string path)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        return _CWebViewPlugin_StartRecording(path);
+#else
+        return false;
+#endif
+    }
+
+    public static void StopRecording()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        _CWebViewPlugin_StopRecording();
+#endif
+    }
+
+    // File SaveCookies() writes to and the first webview restores its
+    // cookies from before navigating. Session cookies are kept only when
+    // includeSessionCookies is set.
+    public static void SetCookieJarPath(string path, bool includeSessionCookies = true)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        _CWebViewPlugin_SetCookieJarPath(path, includeSessionCookies);
+#endif
+    }
+
+    // Values of LifecycleState in LifecycleManager.h; each includes the ones
+    // before it
+    public enum LifecycleState
+    {
+        Visible = 0,
+        Hidden = 1,
+        Parked = 2,     // only a packed copy of the last frame is kept
+        LowMemory = 3,  // renderer asked to keep its memory low
+        Suspended = 4,  // renderer suspended
+    }
+
+    // How long a hidden webview waits before each step (negative: only along
+    // with a later step), and a budget in bytes for the memory of all WebView2
+    // processes (0: none). While over budget the longest hidden webview is
+    // moved one step further every half second. The defaults park at once.
+    public static void SetLifecyclePolicy(int parkAfterMs = 0, int lowMemoryAfterMs = -1,
+                                          int suspendAfterMs = -1, long memoryBudget = 0)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        _CWebViewPlugin_SetLifecyclePolicy(parkAfterMs, lowMemoryAfterMs, suspendAfterMs, memoryBudget);
+#endif
+    }
+
+    // Transition counts, webviews per state and memory reclaimed as JSON
+    public static string GetLifecycleStats()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        return _CWebViewPlugin_GetLifecycleStats();
+#else
+        return null;
+#endif
+    }
+
+    // Runs script in every webview as each document is created, before the
+    // page's own scripts, from the next navigation on. Registering the same
+    // script again returns the same id; each registration needs a
+    // RemoveUserScript. Returns 0 when unsupported.
+    public static int AddUserScript(string script)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        return _CWebViewPlugin_AddUserScript(script);
+#else
+        return 0;
+#endif
+    }
+
+    public static bool RemoveUserScript(int id)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        return _CWebViewPlugin_RemoveUserScript(id);
+#else
+        return false;
+#endif
+    }
+
+    // Prerender hits, misses and the loading time they hid or wasted as JSON
+    public static string GetPrerenderStats()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        return _CWebViewPlugin_GetPrerenderStats();
+#else
+        return null;
+#endif
+    }
+
     public bool IsInitialized()
     {
 #if UNITY_WEBPLAYER || UNITY_WEBGL
@@ -1376,6 +1598,31 @@ public class WebViewObject : MonoBehaviour
 #endif
     }
 
+    // Native performance counters as JSON (Windows only), e.g. frame counts
+    // and capture, conversion, command and render latency histograms
+    public string GetStatsJson()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return null;
+        return _CWebViewPlugin_GetStatsJson(webView);
+#else
+        return null;
+#endif
+    }
+
+    // Frame memory released while hidden (Windows only; 0 while visible)
+    public long GetParkedBytesSaved()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return 0;
+        return _CWebViewPlugin_GetParkedBytesSaved(webView);
+#else
+        return 0;
+#endif
+    }
+
     public bool CanGoBack()
     {
 #if UNITY_WEBPLAYER || UNITY_WEBGL
@@ -1727,6 +1974,114 @@ public class WebViewObject : MonoBehaviour
 #endif
     }
 
+    // A cookie with its attributes, as exchanged by GetCookieSnapshot and
+    // SetCookies. expires is seconds since 1970, -1 for a session cookie;
+    // sameSite is "None", "Lax" or "Strict".
+    [Serializable]
+    public class Cookie
+    {
+        public string name;
+        public string value;
+        public string domain;
+        public string path = "/";
+        public double expires = -1;
+        public bool secure;
+        public bool httpOnly;
+        public string sameSite = "Lax";
+    }
+
+    [Serializable]
+    public class CookieList
+    {
+        public Cookie[] cookies;
+    }
+
+    // Calls callback with every cookie for url (all cookies when url is
+    // null or empty), attributes included (Windows only)
+    public void GetCookieSnapshot(string url, Action<Cookie[]> callback)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return;
+        int id = _CWebViewPlugin_GetCookieSnapshot(webView, url);
+        if (id != 0) {
+            cookieSnapshotCallbacks[id] = callback;
+            cookieSnapshotUrls[id] = url;
+        }
+#endif
+    }
+
+    // Milestones of a navigation in milliseconds after the LoadURL or
+    // LoadHTML call that started it (after navigationStarting when the page
+    // navigated itself, see fromRequest); -1 for ones not reached.
+    // firstFrame is the first captured frame that differs from the
+    // previous page.
+    [Serializable]
+    public class NavigationTiming
+    {
+        public long id;
+        public string url;
+        public bool success;
+        public int errorStatus;
+        public bool fromRequest;
+        public double navigationStarting;
+        public double contentLoading;
+        public double domContentLoaded;
+        public double navigationCompleted;
+        public double firstFrame;
+    }
+
+    // Calls callback once per navigation, when its first frame has been
+    // captured or it was superseded (Windows only)
+    public void SetNavigationTimingCallback(Action<NavigationTiming> callback)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        navigationTimingCallback = callback;
+#endif
+    }
+
+    // Adds or replaces all the cookies in one step, e.g. a login session
+    // before the first navigation (Windows only). Returns the number of
+    // cookies sent, or -1.
+    public int SetCookies(Cookie[] cookies)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero || cookies == null)
+            return -1;
+        var list = new CookieList();
+        list.cookies = cookies;
+        return _CWebViewPlugin_SetCookies(webView, JsonUtility.ToJson(list));
+#else
+        return -1;
+#endif
+    }
+
+    // Writes every cookie to path (Windows only). Returns the number of
+    // cookies written, or -1.
+    public int SaveCookieJar(string path, bool includeSessionCookies = true)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return -1;
+        return _CWebViewPlugin_SaveCookieJar(webView, path, includeSessionCookies);
+#else
+        return -1;
+#endif
+    }
+
+    // Restores the unexpired cookies saved by SaveCookieJar (Windows only).
+    // Returns the number of cookies loaded, or -1.
+    public int LoadCookieJar(string path)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return -1;
+        return _CWebViewPlugin_LoadCookieJar(webView, path);
+#else
+        return -1;
+#endif
+    }
+
     public void SetBasicAuthInfo(string userName, string password)
     {
 #if UNITY_WEBPLAYER || UNITY_WEBGL
@@ -1772,6 +2127,275 @@ public class WebViewObject : MonoBehaviour
     }
 
 
+    // In-memory cache for GET responses whose URL matches a rule (Windows
+    // only); hits are answered without a network request. maxBytes of 0
+    // turns it off.
+    public void ConfigureResponseCache(long maxBytes)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return;
+        _CWebViewPlugin_ConfigureResponseCache(webView, maxBytes);
+#endif
+    }
+
+    // pattern: regex searched in the request URL, e.g. "/api/config\\.json$"
+    public bool AddResponseCacheRule(string pattern, int ttlSeconds)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return false;
+        return _CWebViewPlugin_AddResponseCacheRule(webView, pattern, ttlSeconds);
+#else
+        return false;
+#endif
+    }
+
+    public void ClearResponseCache(bool clearRules = false)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return;
+        _CWebViewPlugin_ClearResponseCache(webView, clearRules);
+#endif
+    }
+
+    // Blocks subresource requests matching the rules (Windows only), one
+    // per line: "ads.example.com", "example.com/ads/", "/pagead/",
+    // "@@exception", or hosts-file lines. Replaces earlier rules; returns
+    // the number of rules compiled.
+    public int LoadBlockRules(string rules)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return 0;
+        return _CWebViewPlugin_LoadBlockRules(webView, rules);
+#else
+        return 0;
+#endif
+    }
+
+    // As LoadBlockRules, from a text file; -1 if it cannot be read
+    public int LoadBlockRulesFile(string path)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return -1;
+        return _CWebViewPlugin_LoadBlockRulesFile(webView, path);
+#else
+        return -1;
+#endif
+    }
+
+    // Blocked request counts per rule as JSON (Windows only)
+    public string GetBlockRuleHits()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return null;
+        return _CWebViewPlugin_GetBlockRuleHits(webView);
+#else
+        return null;
+#endif
+    }
+
+    // Calls callback with the payload of every Unity.call(channel, payload)
+    // (Windows only). Payloads arrive as posted, without URL unescaping.
+    // Messages on channels nobody subscribed to are dropped natively;
+    // maxQueued bounds the messages kept between frames, dropping the
+    // oldest (0: no limit).
+    public bool SubscribeChannel(string channel, Callback callback, int maxQueued = 0)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return false;
+        int id = _CWebViewPlugin_SubscribeChannel(webView, channel, maxQueued);
+        if (id == 0)
+            return false;
+        channelIds[channel] = id;
+        channelCallbacks[id] = callback;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    public void UnsubscribeChannel(string channel)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return;
+        _CWebViewPlugin_UnsubscribeChannel(webView, channel);
+        int id;
+        if (channelIds.TryGetValue(channel, out id)) {
+            channelIds.Remove(channel);
+            channelCallbacks.Remove(id);
+        }
+#endif
+    }
+
+    // Received and dropped message counts per channel as JSON (Windows only)
+    public string GetChannelStats()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return null;
+        return _CWebViewPlugin_GetChannelStats(webView);
+#else
+        return null;
+#endif
+    }
+
+    // Records the timings of the last capacity resource requests; 0 turns
+    // this off (Windows only)
+    public void SetResourceTimingCapacity(int capacity)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return;
+        _CWebViewPlugin_SetResourceTimingCapacity(webView, capacity);
+#endif
+    }
+
+    // The recorded requests as HAR-shaped JSON (Windows only)
+    public string GetResourceTimings()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return null;
+        return _CWebViewPlugin_GetResourceTimings(webView);
+#else
+        return null;
+#endif
+    }
+
+    // The recorded requests as compact binary records, the layout described
+    // in ResourceTimeline.h (Windows only)
+    public byte[] GetResourceTimingSummary()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return null;
+        var buffer = new byte[4096];
+        int n;
+        while ((n = _CWebViewPlugin_GetResourceTimingSummary(webView, buffer, buffer.Length)) < 0)
+            buffer = new byte[-n];
+        Array.Resize(ref buffer, n);
+        return buffer;
+#else
+        return null;
+#endif
+    }
+
+    // Request count, bytes and p50/p95/max time to response in milliseconds
+    // per host as JSON, slowest first (Windows only)
+    public string GetResourceHostStats()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return null;
+        return _CWebViewPlugin_GetResourceHostStats(webView);
+#else
+        return null;
+#endif
+    }
+
+    // Starts loading url in the background, replacing an earlier prerender,
+    // so CommitPrerender can show it already loaded. Not available for
+    // separated windows.
+    public bool Prerender(string url)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return false;
+        return _CWebViewPlugin_Prerender(webView, url);
+#else
+        return false;
+#endif
+    }
+
+    // Switches to the page prerendered from url (null: whatever was
+    // prerendered). Returns false when there is none, so the caller can
+    // LoadURL instead. Callbacks for the prerendered page's loading arrive
+    // after the switch. Channel subscriptions and other settings carry
+    // over; cookie snapshots still pending are asked for again.
+    public bool CommitPrerender(string url = null)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return false;
+        IntPtr previous = webView;
+        IntPtr next = _CWebViewPlugin_CommitPrerender(previous, url);
+        if (next == IntPtr.Zero)
+            return false;
+        // deliver what the old page already queued before its handle goes
+        DrainEvents();
+        if (webView != previous) {
+            // a callback destroyed this view meanwhile
+            _CWebViewPlugin_Destroy(next);
+            return false;
+        }
+        webView = next;
+        _CWebViewPlugin_Destroy(previous);
+        if (cookieSnapshotCallbacks.Count > 0) {
+            var callbacks = new Dictionary<int, Action<Cookie[]>>(cookieSnapshotCallbacks);
+            var urls = new Dictionary<int, string>(cookieSnapshotUrls);
+            cookieSnapshotCallbacks.Clear();
+            cookieSnapshotUrls.Clear();
+            foreach (var entry in callbacks) {
+                string snapshotUrl;
+                urls.TryGetValue(entry.Key, out snapshotUrl);
+                GetCookieSnapshot(snapshotUrl, entry.Value);
+            }
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    public void CancelPrerender()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return;
+        _CWebViewPlugin_CancelPrerender(webView);
+#endif
+    }
+
+    public LifecycleState GetLifecycleState()
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return LifecycleState.Visible;
+        return (LifecycleState)_CWebViewPlugin_GetLifecycleState(webView);
+#else
+        return LifecycleState.Visible;
+#endif
+    }
+
+    // Types text into the focused element in one step, e.g. a paste.
+    // Typed keyboard input is forwarded automatically while focused.
+    public void SendText(string text)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero || string.IsNullOrEmpty(text))
+            return;
+        _CWebViewPlugin_SendText(webView, text);
+#endif
+    }
+
+    // Shows text as the IME composition with the caret at cursor (-1: at
+    // the end); an empty text cancels it and SendText commits it.
+    public void SetComposition(string text, int cursor = -1)
+    {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        if (webView == IntPtr.Zero)
+            return;
+        _CWebViewPlugin_SetComposition(webView, text, cursor);
+#endif
+    }
+
     public void SetTextZoom(int textZoom)
     {
 #if UNITY_WEBPLAYER || UNITY_WEBGL
@@ -1880,6 +2504,106 @@ public class WebViewObject : MonoBehaviour
         }
     }
 
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+    // Values of WebViewEventKind in MessageQueue.h
+    enum EventKind
+    {
+        FromJS = 1,
+        Error = 2,
+        HttpError = 3,
+        Loaded = 4,
+        Started = 5,
+        Hooked = 6,
+        Cookies = 7,
+        NavigationError = 8,
+        CookieSnapshot = 9,
+        NavigationTiming = 10,
+    }
+
+    // Drains queued native events as binary records: a 24 byte header
+    // (kind, header size, instance id, timestamp, code, payload size)
+    // followed by the UTF-8 payload, padded to 8 bytes.
+    void DrainEvents()
+    {
+        for (;;) {
+            if (webView == IntPtr.Zero)
+                return;
+            int n = _CWebViewPlugin_GetEvents(webView, eventBuffer, eventBuffer.Length);
+            if (n < 0) {
+                eventBuffer = new byte[Mathf.NextPowerOfTwo(-n)];
+                continue;
+            }
+            if (n == 0)
+                return;
+            int offset = 0;
+            while (offset < n) {
+                int kind = BitConverter.ToUInt16(eventBuffer, offset);
+                int headerSize = BitConverter.ToUInt16(eventBuffer, offset + 2);
+                int code = BitConverter.ToInt32(eventBuffer, offset + 16);
+                int length = (int)BitConverter.ToUInt32(eventBuffer, offset + 20);
+                string payload = System.Text.Encoding.UTF8.GetString(eventBuffer, offset + headerSize, length);
+                offset += (headerSize + length + 7) & ~7;
+                DispatchEvent((EventKind)kind, code, payload);
+                if (webView == IntPtr.Zero)
+                    return;
+            }
+        }
+    }
+
+    void DispatchEvent(EventKind kind, int code, string payload)
+    {
+        switch (kind) {
+        case EventKind.FromJS:
+            if (code == 0) {
+                CallFromJS(payload);
+            } else {
+                // Unity.call(channel, payload); code is the channel id
+                Callback callback;
+                if (channelCallbacks.TryGetValue(code, out callback) && callback != null)
+                    callback(payload);
+            }
+            break;
+        case EventKind.Error:
+            CallOnError(payload);
+            break;
+        case EventKind.HttpError:
+            CallOnHttpError(code.ToString());
+            break;
+        case EventKind.Loaded:
+            CallOnLoaded(payload);
+            break;
+        case EventKind.Started:
+            CallOnStarted(payload);
+            break;
+        case EventKind.Hooked:
+            CallOnHooked(payload);
+            break;
+        case EventKind.Cookies:
+            CallOnCookies(payload);
+            break;
+        case EventKind.NavigationError:
+            CallOnError(payload + " (error: " + code + ")");
+            break;
+        case EventKind.CookieSnapshot: {
+            // code is the id returned by _CWebViewPlugin_GetCookieSnapshot
+            Action<Cookie[]> callback;
+            if (cookieSnapshotCallbacks.TryGetValue(code, out callback)) {
+                cookieSnapshotCallbacks.Remove(code);
+                cookieSnapshotUrls.Remove(code);
+                var list = JsonUtility.FromJson<CookieList>(payload);
+                if (callback != null)
+                    callback(list != null && list.cookies != null ? list.cookies : new Cookie[0]);
+            }
+            break;
+        }
+        case EventKind.NavigationTiming:
+            if (navigationTimingCallback != null)
+                navigationTimingCallback(JsonUtility.FromJson<NavigationTiming>(payload));
+            break;
+        }
+    }
+#endif
+
     void Update()
     {
         if (bg != null) {
@@ -1888,6 +2612,9 @@ public class WebViewObject : MonoBehaviour
         if (hasFocus) {
             inputString += Input.inputString;
         }
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+        DrainEvents();
+#else
         for (;;) {
             if (webView == IntPtr.Zero)
                 break;
@@ -1921,6 +2648,7 @@ public class WebViewObject : MonoBehaviour
                 break;
             }
         }
+#endif
         if (webView == IntPtr.Zero || !visibility)
             return;
         bool refreshBitmap = (Time.frameCount % bitmapRefreshCycle == 0);
@@ -1935,12 +2663,47 @@ public class WebViewObject : MonoBehaviour
         _CWebViewPlugin_Update(webView, refreshBitmap, devicePixelRatio);
 #endif
         if (refreshBitmap) {
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+            if (mipChainGammaCorrect != appliedMipChainGammaCorrect) {
+                _CWebViewPlugin_SetMipChain(webView, mipChain, mipChainGammaCorrect);
+                appliedMipChainGammaCorrect = mipChainGammaCorrect;
+            }
+            if (frameFormat != appliedFrameFormat || mipChain != appliedMipChain) {
+                _CWebViewPlugin_SetFrameFormat(webView, frameFormat);
+                _CWebViewPlugin_SetMipChain(webView, mipChain, mipChainGammaCorrect);
+                appliedFrameFormat = frameFormat;
+                appliedMipChain = mipChain;
+                if (texture != null) {
+                    Destroy(texture);
+                    texture = null;
+                }
+            }
+#endif
             {
                 var w = _CWebViewPlugin_BitmapWidth(webView);
                 var h = _CWebViewPlugin_BitmapHeight(webView);
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+                if (appliedFrameFormat != 0) {
+                    // block formats are padded to whole 4x4 blocks
+                    var bw = (w + 3) / 4;
+                    var bh = (h + 3) / 4;
+                    if (w > 0 && h > 0 && (texture == null || texture.width != bw * 4 || texture.height != bh * 4)) {
+                        texture = new Texture2D(
+                            bw * 4, bh * 4,
+                            appliedFrameFormat == 1 ? TextureFormat.DXT1 : TextureFormat.DXT5,
+                            false, true);
+                        texture.filterMode = FilterMode.Bilinear;
+                        texture.wrapMode = TextureWrapMode.Clamp;
+                        textureDataBuffer = new byte[bw * bh * (appliedFrameFormat == 1 ? 8 : 16)];
+                    }
+                    textureUV = new Rect(0, 0, (float)w / (bw * 4), (float)h / (bh * 4));
+                } else
+#endif
                 if (w > 0 && h > 0 && (texture == null || texture.width != w || texture.height != h)) {
 #if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
-                    texture = new Texture2D(w, h, TextureFormat.RGBA32, false, true);
+                    // mip chains are only produced for RGBA32 frames
+                    texture = new Texture2D(w, h, TextureFormat.RGBA32, appliedMipChain, true);
+                    textureUV = new Rect(0, 0, 1, 1);
 #else
                     bool isLinearSpace = QualitySettings.activeColorSpace == ColorSpace.Linear;
                     texture = new Texture2D(w, h, TextureFormat.RGBA32, false, !isLinearSpace);
@@ -1948,6 +2711,12 @@ public class WebViewObject : MonoBehaviour
                     texture.filterMode = FilterMode.Bilinear;
                     texture.wrapMode = TextureWrapMode.Clamp;
                     textureDataBuffer = new byte[w * h * 4];
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+                    if (appliedMipChain) {
+                        texture.filterMode = FilterMode.Trilinear;
+                        textureDataBuffer = new byte[texture.GetRawTextureData().Length];
+                    }
+#endif
                 }
             }
             if (texture != null && textureDataBuffer != null && textureDataBuffer.Length > 0) {
@@ -1955,7 +2724,12 @@ public class WebViewObject : MonoBehaviour
                 _CWebViewPlugin_Render(webView, gch.AddrOfPinnedObject());
                 gch.Free();
                 texture.LoadRawTextureData(textureDataBuffer);
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+                // the native side already filled every mip level
+                texture.Apply(false);
+#else
                 texture.Apply();
+#endif
             }
         }
     }
@@ -1974,6 +2748,14 @@ public class WebViewObject : MonoBehaviour
 
     public int bitmapRefreshCycle = 1;
     public int devicePixelRatio = 1;
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+    // 0: RGBA32, 1: DXT1 (BC1, opaque), 2: DXT5 (BC3, keeps transparency)
+    public int frameFormat = 0;
+    // build the mip chain natively (RGBA32 only) for webviews shown in 3D
+    public bool mipChain = false;
+    public bool mipChainGammaCorrect = false;
+    Rect textureUV = new Rect(0, 0, 1, 1);
+#endif
 
     void OnGUI()
     {
@@ -2009,6 +2791,19 @@ public class WebViewObject : MonoBehaviour
             }
             break;
         case EventType.Repaint:
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+            if (!string.IsNullOrEmpty(inputString)) {
+                _CWebViewPlugin_SendText(webView, inputString);
+                inputString = "";
+            }
+            {
+                var composition = hasFocus ? Input.compositionString : "";
+                if (composition != compositionString) {
+                    compositionString = composition;
+                    _CWebViewPlugin_SetComposition(webView, composition, -1);
+                }
+            }
+#else
             while (!string.IsNullOrEmpty(inputString)) {
                 var keyChars = inputString.Substring(0, 1);
                 var keyCode = (ushort)inputString[0];
@@ -2020,6 +2815,7 @@ public class WebViewObject : MonoBehaviour
                     _CWebViewPlugin_SendKeyEvent(webView, (int)p.x, (int)p.y, keyChars, keyCode, 1);
                 }
             }
+#endif
             if (texture != null) {
                 Matrix4x4 m = GUI.matrix;
                 GUI.matrix
@@ -2027,7 +2823,11 @@ public class WebViewObject : MonoBehaviour
                         new Vector3(0, Screen.height, 0),
                         Quaternion.identity,
                         new Vector3(1, -1, 1));
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
+                Graphics.DrawTexture(rect, texture, textureUV, 0, 0, 0, 0);
+#else
                 Graphics.DrawTexture(rect, texture);
+#endif
                 GUI.matrix = m;
             }
             break;
@@ -0,0 +1,723 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Microbenchmarks for the platform-neutral helpers in webview_core.
+//
+//   webview_bench [--filter=<substring>] [--min-time=<seconds>] [--format=json|csv]
+//                 [--frame=<width>x<height>:<path>]...
+//
+// Results go to stdout (JSON by default) so they can be archived and
+// compared release to release. --frame adds a raw RGBA32 capture of a real
+// page (e.g. a Render buffer dumped from the plugin) to the block
+// compression cases alongside the built-in frames.
+
+#include "BlockCompressor.h"
+#include "ChannelRouter.h"
+#include "CookieJar.h"
+#include "CookieSnapshot.h"
+#include "CustomHeaders.h"
+#include "MessageQueue.h"
+#include "PixelConvert.h"
+#include "RequestBlocker.h"
+#include "ResourceTimeline.h"
+#include "ResponseCache.h"
+#include "TextConvert.h"
+#include "UrlFilter.h"
+#include "UrlParser.h"
+#include "VirtualHostMap.h"
+#include "WorkerPool.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <cwchar>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+    double bytesPerSecond;  // 0 when not meaningful
+    double psnr;            // dB, for quality results; 0 otherwise
+};
+
+static volatile size_t s_sink;
+
+static void Consume(size_t v) { s_sink = s_sink + v; }
+
+class BenchRunner {
+public:
+    BenchRunner(std::string filter, double minSeconds)
+        : m_filter(std::move(filter)), m_minSeconds(minSeconds) {}
+
+    // Runs op in growing batches until minSeconds have elapsed. bytesPerOp
+    // is the payload one call processes, for throughput.
+    void run(const std::string& name, size_t bytesPerOp, const std::function<void()>& op) {
+        if (!m_filter.empty() && name.find(m_filter) == std::string::npos) return;
+        op();  // warm up
+        uint64_t iterations = 0;
+        uint64_t batch = 1;
+        double elapsed = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (elapsed < m_minSeconds) {
+            for (uint64_t i = 0; i < batch; i++) op();
+            iterations += batch;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (batch < (uint64_t(1) << 20)) batch *= 2;
+        }
+        double ns = elapsed * 1e9 / static_cast<double>(iterations);
+        m_results.push_back({name, iterations, ns, bytesPerOp ? bytesPerOp * 1e9 / ns : 0, 0});
+    }
+
+    // Records a quality measurement rather than a timing
+    void quality(const std::string& name, const std::function<double()>& measure) {
+        if (!m_filter.empty() && name.find(m_filter) == std::string::npos) return;
+        m_results.push_back({name, 0, 0, 0, measure()});
+    }
+
+    const std::vector<BenchResult>& results() const { return m_results; }
+
+private:
+    std::string m_filter;
+    double m_minSeconds;
+    std::vector<BenchResult> m_results;
+};
+
+static void BenchText(BenchRunner& bench) {
+    std::string ascii = "https://example.com/assets/index.html?query=value&lang=en#section-12345";
+    std::string mixed;
+    for (int i = 0; i < 32; i++) mixed += "Unity \xE3\x82\xA6\xE3\x82\xA7\xE3\x83\x96 caf\xC3\xA9 \xF0\x9F\x98\x80 ";
+    std::wstring asciiWide = Utf8ToWide(ascii.c_str());
+    std::wstring mixedWide = Utf8ToWide(mixed.c_str());
+
+    bench.run("utf8_to_wide/ascii_url", ascii.size(), [&]() {
+        Consume(Utf8ToWide(ascii.c_str()).size());
+    });
+    bench.run("utf8_to_wide/mixed_1k", mixed.size(), [&]() {
+        Consume(Utf8ToWide(mixed.c_str()).size());
+    });
+    bench.run("wide_to_utf8/ascii_url", asciiWide.size() * sizeof(wchar_t), [&]() {
+        Consume(WideToUtf8(asciiWide.c_str()).size());
+    });
+    bench.run("wide_to_utf8/mixed_1k", mixedWide.size() * sizeof(wchar_t), [&]() {
+        Consume(WideToUtf8(mixedWide.c_str()).size());
+    });
+
+    // The traffic one page load typically produces: URLs, web messages,
+    // injected script, and a cookie dump
+    const char* corpus[] = {
+        "https://www.example.com/games/lobby/index.html?session=8f14e45fceea167a5a36dedd4bea2543&lang=en",
+        "CallFromJS:{\"type\":\"score\",\"value\":12345,\"player\":\"someone\",\"ts\":1718000000}",
+        "CallFromJS:{\"type\":\"chat\",\"text\":\"\xE3\x81\x93\xE3\x82\x93\xE3\x81\xAB\xE3\x81\xA1\xE3\x81\xAF\"}",
+        "CallOnLoaded:https://www.example.com/games/lobby/index.html",
+        "window.Unity = { call: function(msg) { window.chrome.webview.postMessage(msg); } };",
+        "sid=31d4d96e407aad42; Domain=example.com; Path=/; Version=0\nlang=en; Domain=example.com; Path=/; Version=0\n",
+        "https://cdn.example.com/assets/fonts/NotoSansJP-Regular.woff2",
+        "CallFromJS:caf\xC3\xA9 \xF0\x9F\x98\x80 ok",
+    };
+    size_t corpusBytes = 0;
+    std::vector<std::wstring> corpusWide;
+    for (const char* text : corpus) {
+        corpusBytes += strlen(text);
+        corpusWide.push_back(Utf8ToWide(text));
+    }
+    bench.run("utf8_to_wide/corpus", corpusBytes, [&]() {
+        size_t total = 0;
+        for (const char* text : corpus) total += Utf8ToWide(text).size();
+        Consume(total);
+    });
+    std::wstring wideBuffer;
+    bench.run("utf8_to_wide/corpus_reused", corpusBytes, [&]() {
+        size_t total = 0;
+        for (const char* text : corpus) {
+            wideBuffer.clear();
+            AppendUtf8ToWide(wideBuffer, text, strlen(text));
+            total += wideBuffer.size();
+        }
+        Consume(total);
+    });
+    bench.run("wide_to_utf8/corpus", corpusBytes * sizeof(wchar_t), [&]() {
+        size_t total = 0;
+        for (const std::wstring& text : corpusWide) total += WideToUtf8(text.c_str()).size();
+        Consume(total);
+    });
+    std::string utf8Buffer;
+    bench.run("wide_to_utf8/corpus_reused", corpusBytes * sizeof(wchar_t), [&]() {
+        size_t total = 0;
+        for (const std::wstring& text : corpusWide) {
+            utf8Buffer.clear();
+            AppendWideToUtf8(utf8Buffer, text.data(), text.size());
+            total += utf8Buffer.size();
+        }
+        Consume(total);
+    });
+
+    std::wstring escaped = L"C:\\Users\\Player\\My%20Game\\StreamingAssets\\caf%C3%A9\\index%20page.html";
+    bench.run("percent_decode/path", escaped.size() * sizeof(wchar_t), [&]() {
+        Consume(PercentDecode(escaped).size());
+    });
+}
+
+static void BenchUrls(BenchRunner& bench) {
+    VirtualHostMap hosts;
+    std::string fileUrl = "file:///C:/Users/Player/My%20Game/StreamingAssets/web/index.html?x=1#top";
+    std::wstring navigateUrl;
+    bench.run("file_url_rewrite", 0, [&]() {
+        std::wstring folder, host;
+        bool created;
+        Consume(hosts.rewrite(fileUrl, navigateUrl, folder, host, created) ? navigateUrl.size() : 0);
+    });
+
+    std::wstring pageUrl = L"https://user@www.example.com:8443/games/lobby/index.html?session=8f14e45f&lang=en#chat";
+    bench.run("url_parse/https", pageUrl.size() * sizeof(wchar_t), [&]() {
+        WideUrlParts parts;
+        Consume(ParseUrl(pageUrl, parts) ? parts.host.size() + parts.query.size() : 0);
+    });
+    std::string escapedPath = "/C:/Users/Player/My%20Game/StreamingAssets/caf%C3%A9/index%20page.html";
+    std::string decoded;
+    bench.run("percent_decode/utf8_path", escapedPath.size(), [&]() {
+        decoded.clear();
+        AppendPercentDecoded(decoded, escapedPath);
+        Consume(decoded.size());
+    });
+
+    UrlFilter filter;
+    filter.setPatterns("^https://(www\\.)?example\\.com/", ".*", "^https://hooks\\.example\\.com/");
+    std::wstring allowed = L"https://www.example.com/path/to/page.html?id=42";
+    std::wstring denied = L"https://tracker.example.net/pixel.gif?u=123456";
+    bench.run("url_filter/allowed", 0, [&]() { Consume(filter.check(allowed)); });
+    bench.run("url_filter/denied", 0, [&]() { Consume(filter.check(denied)); });
+
+    // Request path of an enabled cache: rule match, then lookup
+    ResponseCache cache;
+    cache.setBudget(8 << 20);
+    cache.addRule("/api/(config|catalog)", 60);
+    std::string method = "GET";
+    std::string cachedUrl = "https://www.example.com/api/config?v=3";
+    std::string otherUrl = "https://www.example.com/api/other?v=3";
+    CachedResponse stored;
+    stored.status = 200;
+    stored.headers = "Content-Type: application/json";
+    stored.body = std::make_shared<const std::string>(32 * 1024, '{');
+    cache.store(method, cachedUrl, stored, 3600ull * 1000000, 0);
+    bench.run("response_cache/hit", 0, [&]() {
+        CachedResponse response;
+        bool hit = cache.ttlMicros(method, cachedUrl) && cache.lookup(method, cachedUrl, 1, response);
+        Consume(hit ? response.body->size() : 0);
+    });
+    bench.run("response_cache/uncached_url", 0, [&]() { Consume(cache.ttlMicros(method, otherUrl)); });
+}
+
+// A block list the size of the popular public ones
+static void BenchBlocking(BenchRunner& bench) {
+    std::string rules;
+    for (int i = 0; i < 50000; i++) {
+        rules += "tracker" + std::to_string(i) + ".ads" + std::to_string(i % 500) + ".net\n";
+        if (i % 10 == 0) rules += "/beacon" + std::to_string(i) + "/\n";
+        if (i % 25 == 0) rules += "cdn" + std::to_string(i) + ".example.com/ads/\n";
+    }
+    RequestBlocker blocker;
+    bench.run("block_rules/compile_57k", rules.size(), [&]() { Consume(blocker.load(rules.c_str())); });
+
+    std::string blocked = "https://eu.tracker31337.ads337.net/collect?id=42&ts=1718000000";
+    std::string pathBlocked = "https://cdn.site.com/lib/beacon4200/pixel.gif";
+    std::string passed = "https://www.example.com/games/lobby/assets/app.bundle.js?v=3";
+    bench.run("block_rules/match_blocked_host", 0, [&]() { Consume(blocker.match(blocked)); });
+    bench.run("block_rules/match_blocked_path", 0, [&]() { Consume(blocker.match(pathBlocked)); });
+    bench.run("block_rules/match_passed", 0, [&]() { Consume(blocker.match(passed)); });
+}
+
+static void BenchResources(BenchRunner& bench) {
+    ResourceTimeline timeline;
+    timeline.setCapacity(1024);
+    std::vector<std::string> urls;
+    for (int i = 0; i < 64; i++)
+        urls.push_back("https://cdn" + std::to_string(i % 8) + ".example.com/assets/chunk" +
+                       std::to_string(i) + ".js?v=3");
+    std::string method = "GET";
+    uint64_t now = 0;
+    size_t next = 0;
+    // Cost added to every request and response while timing is on
+    bench.run("resources/begin_complete", 0, [&]() {
+        const std::string& url = urls[next++ % urls.size()];
+        timeline.begin(method, url, RESOURCE_CONTEXT_SCRIPT, now);
+        timeline.complete(method, url, 200, 4096, now += 1500);
+    });
+    bench.run("resources/har_json_1024", 0, [&]() { Consume(timeline.harJson().size()); });
+    bench.run("resources/host_stats_1024", 0, [&]() { Consume(timeline.hostStatsJson().size()); });
+    std::string summary;
+    bench.run("resources/summary_1024", 0, [&]() {
+        summary.clear();
+        timeline.appendSummary(summary);
+        Consume(summary.size());
+    });
+}
+
+static void BenchMessages(BenchRunner& bench) {
+    MessageQueue queue;
+    std::string message = "{\"type\":\"score\",\"value\":12345,\"player\":\"someone\"}";
+    bench.run("message_queue/push_pop_legacy", message.size(), [&]() {
+        queue.push(WebViewEvent{WEBVIEW_EVENT_FROM_JS, 0, 0, message});
+        WebViewEvent event;
+        size_t remaining;
+        queue.pop(event, remaining);
+        Consume(FormatLegacyMessage(event).size());
+    });
+    // A frame's worth of events drained as records into a reused buffer
+    std::vector<uint8_t> records(4096);
+    bench.run("message_queue/push_pop_records_x8", message.size() * 8, [&]() {
+        for (int i = 0; i < 8; i++) queue.push(WebViewEvent{WEBVIEW_EVENT_FROM_JS, 0, 0, message});
+        size_t remaining, needed;
+        Consume(queue.popRecords(records.data(), records.size(), remaining, needed));
+    });
+
+    // Unity.call(channel, payload) as WebMessageReceived sees it: dropped
+    // before conversion when unsubscribed, else converted and queued
+    ChannelRouter channels;
+    channels.subscribe("control", 0);
+    channels.subscribe("telemetry", 64);
+    std::wstring telemetry = L"\x1ftelemetry\x1f" + Utf8ToWide(message.c_str());
+    std::wstring analytics = L"\x1f" L"analytics\x1f" + Utf8ToWide(message.c_str());
+    bench.run("channel_router/drop_unsubscribed", 0, [&]() {
+        std::wstring_view channel, payload;
+        SplitChannelMessage(std::wstring_view(analytics), channel, payload);
+        Consume(channels.route(channel));
+    });
+    bench.run("channel_router/route_subscribed_x8", message.size() * 8, [&]() {
+        for (int i = 0; i < 8; i++) {
+            std::wstring_view channel, payload;
+            SplitChannelMessage(std::wstring_view(telemetry), channel, payload);
+            WebViewEvent event{WEBVIEW_EVENT_FROM_JS, 0, 0, std::string()};
+            AppendWideToUtf8(event.payload, payload.data(), payload.size());
+            channels.push(channels.route(channel), std::move(event));
+        }
+        size_t remaining, needed;
+        Consume(channels.popRecords(records.data(), records.size(), 1, remaining, needed));
+    });
+
+    CustomHeaders headers;
+    const char* names[] = {"Authorization", "X-Client-Version", "X-Session", "Accept-Language",
+                           "X-Device", "X-Build", "X-Locale", "X-Trace"};
+    for (const char* name : names) headers.set(name, "0123456789abcdef0123456789abcdef");
+    bench.run("header_injection/8_headers", 0, [&]() {
+        size_t total = 0;
+        headers.forEach([&](const wchar_t* key, const wchar_t* value) {
+            total += wcslen(key) + wcslen(value);
+        });
+        Consume(total);
+    });
+}
+
+// A login flow's worth of session cookies
+static void BenchCookies(BenchRunner& bench) {
+    std::vector<BrowserCookie> cookies;
+    for (int i = 0; i < 24; i++) {
+        BrowserCookie c;
+        c.name = "session_" + std::to_string(i);
+        c.value = "a1b2c3d4e5f60718293a4b5c6d7e8f90" + std::to_string(i * 7919);
+        c.domain = ".game.example.com";
+        c.path = "/";
+        c.expires = 1767225600 + i;
+        c.secure = true;
+        c.httpOnly = i % 2 == 0;
+        cookies.push_back(c);
+    }
+    std::string text;
+    bench.run("cookies/legacy_text_x24", 0, [&]() {
+        text.clear();
+        for (const auto& cookie : cookies) AppendLegacyCookie(text, cookie);
+        Consume(text.size());
+    });
+    bench.run("cookies/snapshot_json_x24", 0, [&]() {
+        text.clear();
+        AppendCookiesJson(text, cookies);
+        Consume(text.size());
+    });
+    std::string json;
+    AppendCookiesJson(json, cookies);
+    std::vector<BrowserCookie> parsed;
+    bench.run("cookies/parse_json_x24", json.size(), [&]() {
+        parsed.clear();
+        Consume(ParseCookiesJson(json, parsed));
+    });
+    std::string jar;
+    bench.run("cookies/jar_encode_x24", 0, [&]() {
+        jar.clear();
+        EncodeCookieJar(cookies, jar);
+        Consume(jar.size());
+    });
+    bench.run("cookies/jar_decode_x24", jar.size(), [&]() {
+        parsed.clear();
+        Consume(DecodeCookieJar(reinterpret_cast<const uint8_t*>(jar.data()), jar.size(), parsed));
+    });
+}
+
+static void BenchSwizzle(BenchRunner& bench) {
+    struct Resolution { const char* name; int width, height; };
+    const Resolution resolutions[] = {{"720p", 1280, 720}, {"1080p", 1920, 1080}, {"4k", 3840, 2160}};
+    for (const Resolution& r : resolutions) {
+        size_t pitch = static_cast<size_t>(r.width) * 4 + 64;  // staging rows are padded
+        std::vector<uint8_t> src(pitch * r.height, 0x7F);
+        std::vector<uint8_t> dst(static_cast<size_t>(r.width) * r.height * 4);
+        size_t bytes = dst.size();
+        int w = r.width;
+        int h = r.height;
+        bench.run(std::string("swizzle_bgra/") + r.name, bytes, [&]() {
+            SwizzleBGRAToRGBA(src.data(), pitch, dst.data(), w, 0, h);
+            Consume(dst[0]);
+        });
+        bench.run(std::string("swizzle_bgra_pool/") + r.name, bytes, [&]() {
+            WorkerPool::instance().parallelFor(h, 64, [&](int rowBegin, int rowEnd) {
+                SwizzleBGRAToRGBA(src.data(), pitch, dst.data(), w, rowBegin, rowEnd);
+            });
+            Consume(dst[0]);
+        });
+    }
+}
+
+struct BenchFrame {
+    std::string name;
+    int width, height;
+    std::vector<uint8_t> rgba;
+};
+
+static uint32_t NextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+static BenchFrame GradientFrame(int width, int height) {
+    BenchFrame frame{"gradient", width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4)};
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = &frame.rgba[(static_cast<size_t>(y) * width + x) * 4];
+            p[0] = static_cast<uint8_t>(x * 255 / (width - 1));
+            p[1] = static_cast<uint8_t>(y * 255 / (height - 1));
+            p[2] = static_cast<uint8_t>((x + y) * 255 / (width + height - 2));
+            p[3] = static_cast<uint8_t>(255 - y * 255 / (height - 1));
+        }
+    }
+    return frame;
+}
+
+static BenchFrame NoiseFrame(int width, int height) {
+    BenchFrame frame{"noise", width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4)};
+    uint32_t state = 12345;
+    for (uint8_t& b : frame.rgba) b = static_cast<uint8_t>(NextRandom(state));
+    return frame;
+}
+
+static void FillRect(BenchFrame& frame, int x0, int y0, int x1, int y1, const uint8_t* color) {
+    for (int y = y0 < 0 ? 0 : y0; y < y1 && y < frame.height; y++) {
+        for (int x = x0 < 0 ? 0 : x0; x < x1 && x < frame.width; x++) {
+            memcpy(&frame.rgba[(static_cast<size_t>(y) * frame.width + x) * 4], color, 4);
+        }
+    }
+}
+
+// What a rendered page looks like to the encoder: flat background, a
+// coloured header, anti-aliased runs of dark glyphs, a photo with smooth
+// detail and a translucent drop shadow for the alpha channel
+static BenchFrame PageFrame(int width, int height) {
+    BenchFrame frame{"page", width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4)};
+    const uint8_t background[4] = {250, 250, 250, 255};
+    const uint8_t header[4] = {45, 108, 223, 255};
+    const uint8_t button[4] = {255, 152, 0, 255};
+    FillRect(frame, 0, 0, width, height, background);
+    FillRect(frame, 0, 0, width, 64, header);
+    FillRect(frame, width - 180, 16, width - 40, 48, button);
+
+    // Lines of text: glyph-sized strokes with grey edge pixels
+    uint32_t state = 99;
+    for (int line = 100; line + 16 < height * 2 / 3; line += 24) {
+        int x = 40;
+        while (x < width / 2) {
+            int glyph = 5 + NextRandom(state) % 6;
+            if (NextRandom(state) % 6 == 0) {
+                x += 8;  // word gap
+                continue;
+            }
+            for (int y = line; y < line + 14; y++) {
+                for (int gx = x; gx < x + glyph; gx++) {
+                    bool edge = gx == x || gx == x + glyph - 1 || y == line || y == line + 13;
+                    bool ink = (NextRandom(state) & 3) != 0;
+                    uint8_t v = ink ? (edge ? 150 : 40) : 250;
+                    uint8_t* p = &frame.rgba[(static_cast<size_t>(y) * width + gx) * 4];
+                    p[0] = p[1] = p[2] = v;
+                }
+            }
+            x += glyph + 2;
+        }
+    }
+
+    // Photo: smooth colour field with fine texture
+    int px0 = width / 2 + 40, py0 = 100, px1 = width - 40, py1 = height * 2 / 3;
+    for (int y = py0; y < py1; y++) {
+        for (int x = px0; x < px1; x++) {
+            uint8_t* p = &frame.rgba[(static_cast<size_t>(y) * width + x) * 4];
+            double fx = (x - px0) * 0.02, fy = (y - py0) * 0.03;
+            int grain = static_cast<int>(NextRandom(state) % 17) - 8;
+            p[0] = static_cast<uint8_t>(128 + 90 * sin(fx) * cos(fy * 0.7) + grain);
+            p[1] = static_cast<uint8_t>(128 + 80 * sin(fx * 1.3 + fy) + grain);
+            p[2] = static_cast<uint8_t>(128 + 70 * cos(fx * 0.5 - fy * 1.1) + grain);
+        }
+    }
+
+    // Drop shadow under a popup panel, fading out over 24 pixels
+    int sx0 = width / 4, sy0 = height * 2 / 3 + 20, sx1 = width * 3 / 4, sy1 = height - 20;
+    for (int y = sy0 - 24; y < sy1 + 24 && y < height; y++) {
+        for (int x = sx0 - 24; x < sx1 + 24; x++) {
+            int dx = x < sx0 ? sx0 - x : x >= sx1 ? x - sx1 + 1 : 0;
+            int dy = y < sy0 ? sy0 - y : y >= sy1 ? y - sy1 + 1 : 0;
+            int d = dx > dy ? dx : dy;
+            frame.rgba[(static_cast<size_t>(y) * width + x) * 4 + 3] =
+                static_cast<uint8_t>(d == 0 ? 255 : 255 - d * 10);
+        }
+    }
+    return frame;
+}
+
+static bool LoadFrame(const char* spec, BenchFrame& frame) {
+    int width = 0, height = 0, consumed = 0;
+    if (sscanf(spec, "%dx%d:%n", &width, &height, &consumed) != 2 || !consumed || width <= 0 || height <= 0)
+        return false;
+    const char* path = spec + consumed;
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    frame.rgba.resize(static_cast<size_t>(width) * height * 4);
+    size_t read = fread(frame.rgba.data(), 1, frame.rgba.size(), f);
+    fclose(f);
+    if (read != frame.rgba.size()) return false;
+    const char* name = path;
+    for (const char* c = path; *c; c++) {
+        if (*c == '/' || *c == '\\') name = c + 1;
+    }
+    frame.name = name;
+    frame.width = width;
+    frame.height = height;
+    return true;
+}
+
+static void Unpack565(uint16_t v, int* c) {
+    int r = (v >> 11) & 0x1F;
+    int g = (v >> 5) & 0x3F;
+    int b = v & 0x1F;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+// Reference decoder, as a GPU samples the blocks (four-colour BC1 mode
+// only, which is all the encoder emits)
+static void DecodeFrame(int format, const uint8_t* data, int width, int height, std::vector<uint8_t>& rgba) {
+    rgba.assign(static_cast<size_t>(width) * height * 4, 255);
+    int bw = FrameBlocksWide(width);
+    int bh = FrameBlocksHigh(height);
+    size_t blockBytes = format == FRAME_FORMAT_BC1 ? 8 : 16;
+    for (int by = 0; by < bh; by++) {
+        for (int bx = 0; bx < bw; bx++) {
+            const uint8_t* block = data + (static_cast<size_t>(by) * bw + bx) * blockBytes;
+            int alpha[16];
+            for (int i = 0; i < 16; i++) alpha[i] = 255;
+            if (format == FRAME_FORMAT_BC3) {
+                int a[8] = {block[0], block[1]};
+                for (int i = 2; i < 8; i++) a[i] = ((8 - i) * a[0] + (i - 1) * a[1]) / 7;
+                uint64_t bits = 0;
+                for (int i = 0; i < 6; i++) bits |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+                for (int i = 0; i < 16; i++) alpha[i] = a[(bits >> (i * 3)) & 7];
+                block += 8;
+            }
+            int palette[4][3];
+            Unpack565(static_cast<uint16_t>(block[0] | (block[1] << 8)), palette[0]);
+            Unpack565(static_cast<uint16_t>(block[2] | (block[3] << 8)), palette[1]);
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+            for (int i = 0; i < 16; i++) {
+                int x = bx * 4 + i % 4;
+                int y = by * 4 + i / 4;
+                if (x >= width || y >= height) continue;
+                uint8_t* p = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+                const int* color = palette[(indices >> (i * 2)) & 3];
+                p[0] = static_cast<uint8_t>(color[0]);
+                p[1] = static_cast<uint8_t>(color[1]);
+                p[2] = static_cast<uint8_t>(color[2]);
+                p[3] = static_cast<uint8_t>(alpha[i]);
+            }
+        }
+    }
+}
+
+// Over RGB for BC1, which drops alpha, and RGBA for BC3
+static double FramePsnr(int format, const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    int channels = format == FRAME_FORMAT_BC1 ? 3 : 4;
+    double sum = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (int c = 0; c < channels; c++) {
+            double d = static_cast<double>(a[i + c]) - b[i + c];
+            sum += d * d;
+        }
+        count += channels;
+    }
+    if (sum == 0) return 99.0;
+    return 10.0 * log10(255.0 * 255.0 / (sum / count));
+}
+
+static void BenchCompression(BenchRunner& bench, const std::vector<BenchFrame>& captures) {
+    std::vector<BenchFrame> frames;
+    frames.push_back(GradientFrame(1280, 720));
+    frames.push_back(NoiseFrame(1280, 720));
+    frames.push_back(PageFrame(1280, 720));
+    frames.insert(frames.end(), captures.begin(), captures.end());
+    const struct { int format; const char* name; } formats[] = {
+        {FRAME_FORMAT_BC1, "bc1"}, {FRAME_FORMAT_BC3, "bc3"}};
+
+    for (const auto& f : formats) {
+        for (const BenchFrame& frame : frames) {
+            int format = f.format;
+            bench.quality(std::string(f.name) + "_psnr/" + frame.name, [&]() {
+                std::vector<uint8_t> blocks(FrameDataSize(format, frame.width, frame.height));
+                CompressFrame(format, frame.rgba.data(), frame.width, frame.height, blocks.data(), nullptr);
+                std::vector<uint8_t> decoded;
+                DecodeFrame(format, blocks.data(), frame.width, frame.height, decoded);
+                return FramePsnr(format, frame.rgba, decoded);
+            });
+        }
+    }
+
+    // Throughput is per byte of RGBA input
+    std::vector<BenchFrame> encoded;
+    encoded.push_back(PageFrame(1920, 1080));
+    encoded.insert(encoded.end(), captures.begin(), captures.end());
+    for (const auto& f : formats) {
+        for (const BenchFrame& frame : encoded) {
+            int format = f.format;
+            std::vector<uint8_t> blocks(FrameDataSize(format, frame.width, frame.height));
+            std::string suffix = std::string(f.name) + "/" + frame.name + "_" +
+                                 std::to_string(frame.width) + "x" + std::to_string(frame.height);
+            bench.run("compress_full/" + suffix, frame.rgba.size(), [&]() {
+                CompressFrame(format, frame.rgba.data(), frame.width, frame.height, blocks.data(), nullptr);
+                Consume(blocks[0]);
+            });
+            bench.run("compress_full_pool/" + suffix, frame.rgba.size(), [&]() {
+                CompressFrame(format, frame.rgba.data(), frame.width, frame.height, blocks.data(), nullptr,
+                              &WorkerPool::instance());
+                Consume(blocks[0]);
+            });
+
+            // A caret blinking and a counter ticking: the two frames differ
+            // in a few small regions, as between most frames of an idle page
+            BenchFrame next = frame;
+            const uint8_t ink[4] = {20, 20, 20, 255};
+            FillRect(next, 40, 100, 42, 116, ink);
+            FillRect(next, frame.width - 160, 24, frame.width - 60, 40, ink);
+            const BenchFrame* frameA = &frame;
+            const BenchFrame* frameB = &next;
+            std::vector<uint8_t> dirty;
+            CompressFrame(format, frame.rgba.data(), frame.width, frame.height, blocks.data(), nullptr);
+            bench.run("compress_dirty/" + suffix, frame.rgba.size(), [&]() {
+                size_t changed = DiffFrameBlocks(frameA->rgba.data(), frameB->rgba.data(),
+                                                 frame.width, frame.height, dirty);
+                CompressFrame(format, frameB->rgba.data(), frame.width, frame.height, blocks.data(), dirty.data());
+                std::swap(frameA, frameB);
+                Consume(changed);
+            });
+        }
+    }
+}
+
+static void PrintJson(const std::vector<BenchResult>& results) {
+    printf("{\"context\":{\"workerThreads\":%d,\"wcharBits\":%d},\"benchmarks\":[",
+           WorkerPool::instance().threadCount(), static_cast<int>(sizeof(wchar_t) * 8));
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        if (r.psnr) {
+            printf("%s\n{\"name\":\"%s\",\"psnr_db\":%.2f}", i ? "," : "", r.name.c_str(), r.psnr);
+            continue;
+        }
+        printf("%s\n{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f,\"bytes_per_second\":%.0f}",
+               i ? "," : "", r.name.c_str(), static_cast<unsigned long long>(r.iterations),
+               r.nsPerOp, r.bytesPerSecond);
+    }
+    printf("\n]}\n");
+}
+
+static void PrintCsv(const std::vector<BenchResult>& results) {
+    printf("name,iterations,ns_per_op,bytes_per_second,psnr_db\n");
+    for (const BenchResult& r : results) {
+        printf("%s,%llu,%.2f,%.0f,%.2f\n", r.name.c_str(), static_cast<unsigned long long>(r.iterations),
+               r.nsPerOp, r.bytesPerSecond, r.psnr);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string filter;
+    double minSeconds = 0.2;
+    bool csv = false;
+    std::vector<BenchFrame> captures;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else if (strncmp(argv[i], "--min-time=", 11) == 0) {
+            minSeconds = atof(argv[i] + 11);
+        } else if (strcmp(argv[i], "--format=csv") == 0) {
+            csv = true;
+        } else if (strcmp(argv[i], "--format=json") == 0) {
+            csv = false;
+        } else if (strncmp(argv[i], "--frame=", 8) == 0) {
+            BenchFrame frame;
+            if (!LoadFrame(argv[i] + 8, frame)) {
+                fprintf(stderr, "cannot read frame %s\n", argv[i] + 8);
+                return 2;
+            }
+            captures.push_back(std::move(frame));
+        } else {
+            fprintf(stderr, "usage: %s [--filter=<substring>] [--min-time=<seconds>] [--format=json|csv] "
+                            "[--frame=<width>x<height>:<path>]...\n", argv[0]);
+            return 2;
+        }
+    }
+
+    BenchRunner bench(filter, minSeconds);
+    BenchText(bench);
+    BenchUrls(bench);
+    BenchBlocking(bench);
+    BenchResources(bench);
+    BenchMessages(bench);
+    BenchCookies(bench);
+    BenchSwizzle(bench);
+    BenchCompression(bench, captures);
+    if (csv) {
+        PrintCsv(bench.results());
+    } else {
+        PrintJson(bench.results());
+    }
+    return 0;
+}
@@ -0,0 +1,630 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Replays a call log recorded with _CWebViewPlugin_StartRecording and
+// reports per-call latency percentiles, so a janky session from the field
+// becomes a repeatable performance test.
+//
+//   webview_replay <log> [--target=mock|plugin[:<dll>]] [--speed=recorded|max|<factor>]
+//                  [--format=json|csv]
+//
+// mock replays on BrowserHost over MockBrowserBackend and runs anywhere;
+// calls it has no equivalent for (input, headers, ...) are counted as
+// skipped. BrowserHost is a mock-only harness rather than the plugin's
+// pipeline, so mock latencies are not plugin latencies; the report names
+// its target. plugin loads WebViewPlugin.dll and issues the calls for real
+// (Windows only). recorded speed keeps the original gaps between calls,
+// a factor of 2 halves them, and max issues the calls back to back.
+
+#include "BrowserHost.h"
+#include "CallRecorder.h"
+#include "FrameBufferPool.h"
+#include "MipChain.h"
+#include "MockBrowserBackend.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <objbase.h>
+#endif
+
+static int64_t ArgInt(const RecordedCall& call, size_t n) {
+    return n < call.args.size() ? call.args[n].i : 0;
+}
+
+static const char* ArgStr(const RecordedCall& call, size_t n) {
+    return n < call.args.size() ? call.args[n].str() : nullptr;
+}
+
+// Largest frame any layout can produce for a view of the given size
+static size_t MaxFrameSize(int width, int height) {
+    if (width <= 0 || height <= 0) return 0;
+    return std::max(MipChainSize(width, height), FrameDataSize(FRAME_FORMAT_BC3, width, height));
+}
+
+class ReplayTarget {
+public:
+    virtual ~ReplayTarget() {}
+    // Returns false if the target has no equivalent for the call.
+    virtual bool invoke(const RecordedCall& call) = 0;
+};
+
+class MockTarget : public ReplayTarget {
+public:
+    bool invoke(const RecordedCall& call) override {
+        switch (call.call) {
+        case CALL_SETWORKERTHREADCOUNT:
+            WorkerPool::instance().setThreadCount(static_cast<int>(ArgInt(call, 0)));
+            return true;
+        case CALL_CONFIGUREFRAMEBUFFERPOOL:
+            FrameBufferPool::instance().configure(static_cast<size_t>(std::max<int64_t>(ArgInt(call, 0), 0)),
+                                                  ArgInt(call, 1) != 0);
+            return true;
+        case CALL_CLEARCOOKIE:
+        case CALL_CLEARCOOKIES:
+            // Process-wide in the plugin; the first instance's cookie manager serves
+            if (m_instances.empty()) return true;
+            if (call.call == CALL_CLEARCOOKIE) {
+                m_instances.begin()->second.host->clearCookie(ArgStr(call, 0) ? ArgStr(call, 0) : "",
+                                                              ArgStr(call, 1) ? ArgStr(call, 1) : "");
+            } else {
+                m_instances.begin()->second.host->clearAllCookies();
+            }
+            return true;
+        case CALL_INIT: {
+            Instance& inst = m_instances[call.instance];
+            inst.maxFrame = MaxFrameSize(static_cast<int>(ArgInt(call, 3)), static_cast<int>(ArgInt(call, 4)));
+            inst.host.reset(new BrowserHost(std::unique_ptr<BrowserBackend>(new MockBrowserBackend()),
+                                            static_cast<int>(ArgInt(call, 3)),
+                                            static_cast<int>(ArgInt(call, 4))));
+            return true;
+        }
+        default:
+            break;
+        }
+
+        auto it = m_instances.find(call.instance);
+        if (it == m_instances.end()) return false;
+        Instance& inst = it->second;
+        BrowserHost& host = *inst.host;
+        std::string text;
+        switch (call.call) {
+        case CALL_DESTROY:
+            m_instances.erase(it);
+            return true;
+        case CALL_SETRECT:
+            inst.maxFrame = std::max(inst.maxFrame, MaxFrameSize(static_cast<int>(ArgInt(call, 0)),
+                                                                 static_cast<int>(ArgInt(call, 1))));
+            host.setRect(static_cast<int>(ArgInt(call, 0)), static_cast<int>(ArgInt(call, 1)));
+            return true;
+        case CALL_SETVISIBILITY:
+            host.setVisibility(ArgInt(call, 0) != 0);
+            return true;
+        case CALL_SETURLPATTERN:
+            host.setURLPattern(ArgStr(call, 0), ArgStr(call, 1), ArgStr(call, 2));
+            return true;
+        case CALL_LOADURL:
+            if (ArgStr(call, 0)) host.loadURL(ArgStr(call, 0));
+            return true;
+        case CALL_LOADHTML:
+            if (ArgStr(call, 0)) host.loadHTML(ArgStr(call, 0), ArgStr(call, 1) ? ArgStr(call, 1) : "");
+            return true;
+        case CALL_EVALUATEJS:
+            if (ArgStr(call, 0)) host.evaluateJS(ArgStr(call, 0));
+            return true;
+        case CALL_PROGRESS:
+            m_sink += host.progress();
+            return true;
+        case CALL_CANGOBACK:
+            m_sink += host.canGoBack();
+            return true;
+        case CALL_CANGOFORWARD:
+            m_sink += host.canGoForward();
+            return true;
+        case CALL_GOBACK:
+            host.goBack();
+            return true;
+        case CALL_GOFORWARD:
+            host.goForward();
+            return true;
+        case CALL_RELOAD:
+            host.reload();
+            return true;
+        case CALL_UPDATE:
+            host.update(ArgInt(call, 0) != 0);
+            return true;
+        case CALL_BITMAPWIDTH:
+            m_sink += host.bitmapWidth();
+            return true;
+        case CALL_BITMAPHEIGHT:
+            m_sink += host.bitmapHeight();
+            return true;
+        case CALL_RENDER:
+            if (inst.buffer.size() < inst.maxFrame) inst.buffer.resize(inst.maxFrame);
+            if (!inst.buffer.empty()) host.render(inst.buffer.data());
+            return true;
+        case CALL_SETFRAMEFORMAT:
+            host.setFrameFormat(static_cast<int>(ArgInt(call, 0)));
+            return true;
+        case CALL_SETMIPCHAIN:
+            host.setMipChain(ArgInt(call, 0) != 0, ArgInt(call, 1) != 0);
+            return true;
+        case CALL_GETCOOKIES:
+            if (ArgStr(call, 0)) host.getCookies(ArgStr(call, 0));
+            return true;
+        case CALL_GETMESSAGE:
+            if (host.getMessage(text)) m_sink += text.size();
+            return true;
+        case CALL_GETEVENTS: {
+            size_t needed;
+            if (inst.events.size() < static_cast<size_t>(ArgInt(call, 0))) inst.events.resize(ArgInt(call, 0));
+            m_sink += host.getEvents(inst.events.data(), static_cast<size_t>(ArgInt(call, 0)), needed);
+            return true;
+        }
+        case CALL_SUBSCRIBECHANNEL:
+            m_sink += host.subscribeChannel(ArgStr(call, 0), ArgInt(call, 1) > 0 ? ArgInt(call, 1) : 0);
+            return true;
+        case CALL_UNSUBSCRIBECHANNEL:
+            host.unsubscribeChannel(ArgStr(call, 0));
+            return true;
+        case CALL_GETCHANNELSTATS:
+            m_sink += host.channelStats().size();
+            return true;
+        case CALL_GETCOOKIESNAPSHOT:
+            m_sink += host.getCookieSnapshot(ArgStr(call, 0) ? ArgStr(call, 0) : "");
+            return true;
+        case CALL_SETCOOKIES:
+            m_sink += host.setCookies(ArgStr(call, 0));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+private:
+    struct Instance {
+        std::unique_ptr<BrowserHost> host;
+        std::vector<uint8_t> buffer;
+        std::vector<uint8_t> events;
+        size_t maxFrame = 0;
+    };
+
+    std::map<uint32_t, Instance> m_instances;
+    size_t m_sink = 0;
+};
+
+#ifdef _WIN32
+static float ArgFloat(const RecordedCall& call, size_t n) {
+    return n < call.args.size() ? call.args[n].f : 0;
+}
+
+// UTF-8 string argument n as UTF-16, for the exports taking wchar_t
+static std::wstring WideArg(const RecordedCall& call, size_t n) {
+    std::wstring wide;
+    if (const char* s = ArgStr(call, n)) {
+        int count = MultiByteToWideChar(CP_UTF8, 0, s, -1, nullptr, 0);
+        wide.resize(count > 0 ? count : 1);
+        MultiByteToWideChar(CP_UTF8, 0, s, -1, &wide[0], count);
+    }
+    return wide;
+}
+
+class PluginTarget : public ReplayTarget {
+public:
+    explicit PluginTarget(const char* path) : m_module(LoadLibraryA(path)) {
+        if (!m_module) return;
+        auto initStatic = reinterpret_cast<void (*)(bool, bool)>(proc("InitStatic"));
+        if (initStatic) initStatic(false, false);
+    }
+
+    ~PluginTarget() override {
+        auto destroy = reinterpret_cast<void (*)(void*)>(proc("Destroy"));
+        for (auto& entry : m_instances) {
+            if (destroy) destroy(entry.second.handle);
+        }
+    }
+
+    bool loaded() const { return m_module != nullptr; }
+
+    bool invoke(const RecordedCall& call) override {
+        const char* name = RecordedCallName(call.call);
+        if (!name) return false;
+        FARPROC fn = proc(name);
+        if (!fn) return false;
+
+        switch (call.call) {
+        case CALL_SETWORKERTHREADCOUNT:
+            reinterpret_cast<void (*)(int)>(fn)(static_cast<int>(ArgInt(call, 0)));
+            return true;
+        case CALL_CONFIGUREFRAMEBUFFERPOOL:
+            reinterpret_cast<void (*)(long long, bool)>(fn)(ArgInt(call, 0), ArgInt(call, 1) != 0);
+            return true;
+        case CALL_CLEARCOOKIE:
+            reinterpret_cast<void (*)(const char*, const char*)>(fn)(ArgStr(call, 0), ArgStr(call, 1));
+            return true;
+        case CALL_CLEARCOOKIES:
+            reinterpret_cast<void (*)()>(fn)();
+            return true;
+        case CALL_ADDUSERSCRIPT:
+            m_sink += reinterpret_cast<int (*)(const char*)>(fn)(ArgStr(call, 0));
+            return true;
+        case CALL_REMOVEUSERSCRIPT:
+            m_sink += reinterpret_cast<bool (*)(int)>(fn)(static_cast<int>(ArgInt(call, 0)));
+            return true;
+        case CALL_SETLIFECYCLEPOLICY:
+            reinterpret_cast<void (*)(int, int, int, long long)>(fn)(
+                static_cast<int>(ArgInt(call, 0)), static_cast<int>(ArgInt(call, 1)),
+                static_cast<int>(ArgInt(call, 2)), ArgInt(call, 3));
+            return true;
+        case CALL_GETLIFECYCLESTATS:
+        case CALL_GETPRERENDERSTATS: {
+            const char* r = reinterpret_cast<const char* (*)()>(fn)();
+            if (r) {
+                m_sink += strlen(r);
+                CoTaskMemFree(const_cast<char*>(r));
+            }
+            return true;
+        }
+        case CALL_SAVECOOKIES:
+        case CALL_SETCOOKIEJARPATH:
+        case CALL_SAVECOOKIEJAR:
+            // Skipped so a replay never overwrites the recorded session's jar
+            return false;
+        case CALL_INIT: {
+            Instance& inst = m_instances[call.instance];
+            inst.maxFrame = MaxFrameSize(static_cast<int>(ArgInt(call, 3)), static_cast<int>(ArgInt(call, 4)));
+            inst.handle = reinterpret_cast<void* (*)(const char*, bool, bool, int, int, const char*, bool)>(fn)(
+                ArgStr(call, 0), ArgInt(call, 1) != 0, ArgInt(call, 2) != 0,
+                static_cast<int>(ArgInt(call, 3)), static_cast<int>(ArgInt(call, 4)),
+                ArgStr(call, 5), ArgInt(call, 6) != 0);
+            return true;
+        }
+        default:
+            break;
+        }
+
+        auto it = m_instances.find(call.instance);
+        if (it == m_instances.end()) return false;
+        Instance& inst = it->second;
+        void* h = inst.handle;
+        switch (call.call) {
+        case CALL_DESTROY:
+            reinterpret_cast<void (*)(void*)>(fn)(h);
+            m_instances.erase(it);
+            return true;
+        case CALL_SETRECT:
+            inst.maxFrame = std::max(inst.maxFrame, MaxFrameSize(static_cast<int>(ArgInt(call, 0)),
+                                                                 static_cast<int>(ArgInt(call, 1))));
+            reinterpret_cast<void (*)(void*, int, int)>(fn)(
+                h, static_cast<int>(ArgInt(call, 0)), static_cast<int>(ArgInt(call, 1)));
+            return true;
+        case CALL_SETVISIBILITY:
+        case CALL_SETINTERACTIONENABLED:
+        case CALL_SETSCROLLBARSVISIBILITY:
+        case CALL_SETALERTDIALOGENABLED:
+        case CALL_CLEARCACHE:
+        case CALL_CLEARRESPONSECACHE:
+            reinterpret_cast<void (*)(void*, bool)>(fn)(h, ArgInt(call, 0) != 0);
+            return true;
+        case CALL_SETURLPATTERN:
+            reinterpret_cast<bool (*)(void*, const char*, const char*, const char*)>(fn)(
+                h, ArgStr(call, 0), ArgStr(call, 1), ArgStr(call, 2));
+            return true;
+        case CALL_LOADURL:
+        case CALL_EVALUATEJS:
+        case CALL_GETCOOKIES:
+        case CALL_REMOVECUSTOMHEADER:
+        case CALL_UNSUBSCRIBECHANNEL:
+            reinterpret_cast<void (*)(void*, const char*)>(fn)(h, ArgStr(call, 0));
+            return true;
+        case CALL_LOADHTML:
+        case CALL_ADDCUSTOMHEADER:
+            reinterpret_cast<void (*)(void*, const char*, const char*)>(fn)(h, ArgStr(call, 0), ArgStr(call, 1));
+            return true;
+        case CALL_SETBASICAUTHINFO:
+            // Credentials are not recorded
+            reinterpret_cast<void (*)(void*, const char*, const char*)>(fn)(h, "", "");
+            return true;
+        case CALL_PROGRESS:
+        case CALL_BITMAPWIDTH:
+        case CALL_BITMAPHEIGHT:
+        case CALL_GETLIFECYCLESTATE:
+            m_sink += reinterpret_cast<int (*)(void*)>(fn)(h);
+            return true;
+        case CALL_CANGOBACK:
+        case CALL_CANGOFORWARD:
+            m_sink += reinterpret_cast<bool (*)(void*)>(fn)(h);
+            return true;
+        case CALL_GOBACK:
+        case CALL_GOFORWARD:
+        case CALL_RELOAD:
+        case CALL_CLEARCUSTOMHEADER:
+        case CALL_PAUSE:
+        case CALL_RESUME:
+        case CALL_CANCELPRERENDER:
+            reinterpret_cast<void (*)(void*)>(fn)(h);
+            return true;
+        case CALL_PRERENDER:
+            m_sink += reinterpret_cast<bool (*)(void*, const char*)>(fn)(h, ArgStr(call, 0));
+            return true;
+        case CALL_COMMITPRERENDER: {
+            // The recorded session went on with the sibling under the number
+            // logged here; a commit that only succeeds now is undone
+            void* next = reinterpret_cast<void* (*)(void*, const char*)>(fn)(h, ArgStr(call, 0));
+            if (!next) return true;
+            uint32_t number = static_cast<uint32_t>(ArgInt(call, 1));
+            if (!number) {
+                if (FARPROC destroy = proc("Destroy")) reinterpret_cast<void (*)(void*)>(destroy)(next);
+                return true;
+            }
+            Instance& adopted = m_instances[number];
+            adopted.handle = next;
+            adopted.maxFrame = inst.maxFrame;
+            return true;
+        }
+        case CALL_SENDMOUSEEVENT:
+            reinterpret_cast<void (*)(void*, int, int, float, int)>(fn)(
+                h, static_cast<int>(ArgInt(call, 0)), static_cast<int>(ArgInt(call, 1)),
+                ArgFloat(call, 2), static_cast<int>(ArgInt(call, 3)));
+            return true;
+        case CALL_SENDKEYEVENT: {
+            std::wstring chars = WideArg(call, 2);
+            reinterpret_cast<void (*)(void*, int, int, const wchar_t*, unsigned short, int)>(fn)(
+                h, static_cast<int>(ArgInt(call, 0)), static_cast<int>(ArgInt(call, 1)),
+                ArgStr(call, 2) ? chars.c_str() : nullptr,
+                static_cast<unsigned short>(ArgInt(call, 3)), static_cast<int>(ArgInt(call, 4)));
+            return true;
+        }
+        case CALL_SENDTEXT: {
+            std::wstring text = WideArg(call, 0);
+            reinterpret_cast<void (*)(void*, const wchar_t*)>(fn)(h, ArgStr(call, 0) ? text.c_str() : nullptr);
+            return true;
+        }
+        case CALL_SETCOMPOSITION: {
+            std::wstring text = WideArg(call, 0);
+            reinterpret_cast<void (*)(void*, const wchar_t*, int)>(fn)(
+                h, ArgStr(call, 0) ? text.c_str() : nullptr, static_cast<int>(ArgInt(call, 1)));
+            return true;
+        }
+        case CALL_UPDATE:
+            reinterpret_cast<void (*)(void*, bool, int)>(fn)(
+                h, ArgInt(call, 0) != 0, static_cast<int>(ArgInt(call, 1)));
+            return true;
+        case CALL_RENDER:
+            if (inst.buffer.size() < inst.maxFrame) inst.buffer.resize(inst.maxFrame);
+            if (!inst.buffer.empty()) reinterpret_cast<void (*)(void*, void*)>(fn)(h, inst.buffer.data());
+            return true;
+        case CALL_SETFRAMEFORMAT:
+        case CALL_SETRESOURCETIMINGCAPACITY:
+            reinterpret_cast<void (*)(void*, int)>(fn)(h, static_cast<int>(ArgInt(call, 0)));
+            return true;
+        case CALL_CONFIGURERESPONSECACHE:
+            reinterpret_cast<void (*)(void*, long long)>(fn)(h, ArgInt(call, 0));
+            return true;
+        case CALL_ADDRESPONSECACHERULE:
+            reinterpret_cast<bool (*)(void*, const char*, int)>(fn)(h, ArgStr(call, 0), static_cast<int>(ArgInt(call, 1)));
+            return true;
+        case CALL_SETMIPCHAIN:
+            reinterpret_cast<void (*)(void*, bool, bool)>(fn)(h, ArgInt(call, 0) != 0, ArgInt(call, 1) != 0);
+            return true;
+        case CALL_GETEVENTS:
+        case CALL_GETRESOURCETIMINGSUMMARY:
+            if (inst.events.size() < static_cast<size_t>(ArgInt(call, 0))) inst.events.resize(ArgInt(call, 0));
+            m_sink += reinterpret_cast<int (*)(void*, uint8_t*, int)>(fn)(
+                h, inst.events.data(), static_cast<int>(ArgInt(call, 0)));
+            return true;
+        case CALL_SUBSCRIBECHANNEL:
+            m_sink += reinterpret_cast<int (*)(void*, const char*, int)>(fn)(
+                h, ArgStr(call, 0), static_cast<int>(ArgInt(call, 1)));
+            return true;
+        case CALL_LOADBLOCKRULES:
+        case CALL_LOADBLOCKRULESFILE:
+        case CALL_GETCOOKIESNAPSHOT:
+        case CALL_SETCOOKIES:
+        case CALL_LOADCOOKIEJAR:
+            m_sink += reinterpret_cast<int (*)(void*, const char*)>(fn)(h, ArgStr(call, 0));
+            return true;
+        case CALL_GETCUSTOMHEADERVALUE:
+        case CALL_GETBLOCKRULEHITS:
+        case CALL_GETCHANNELSTATS:
+        case CALL_GETRESOURCETIMINGS:
+        case CALL_GETRESOURCEHOSTSTATS:
+        case CALL_GETMESSAGE: {
+            const char* r = call.call != CALL_GETCUSTOMHEADERVALUE
+                ? reinterpret_cast<const char* (*)(void*)>(fn)(h)
+                : reinterpret_cast<const char* (*)(void*, const char*)>(fn)(h, ArgStr(call, 0));
+            if (r) {
+                m_sink += strlen(r);
+                CoTaskMemFree(const_cast<char*>(r));
+            }
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+private:
+    struct Instance {
+        void* handle = nullptr;
+        std::vector<uint8_t> buffer;
+        std::vector<uint8_t> events;
+        size_t maxFrame = 0;
+    };
+
+    FARPROC proc(const char* name) {
+        if (!m_module) return nullptr;
+        auto it = m_procs.find(name);
+        if (it != m_procs.end()) return it->second;
+        FARPROC fn = GetProcAddress(m_module, (std::string("_CWebViewPlugin_") + name).c_str());
+        m_procs[name] = fn;
+        return fn;
+    }
+
+    HMODULE m_module;
+    std::map<std::string, FARPROC> m_procs;
+    std::map<uint32_t, Instance> m_instances;
+    size_t m_sink = 0;
+};
+#endif
+
+struct CallLatencies {
+    std::vector<uint64_t> nanos;
+    uint64_t skipped = 0;
+};
+
+static uint64_t Percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void PrintResults(std::map<std::string, CallLatencies>& results, const char* target,
+                         double wallSeconds, size_t calls, bool csv) {
+    if (csv) {
+        printf("call,count,skipped,p50_us,p90_us,p99_us,max_us\n");
+    } else {
+        printf("{\"target\":\"%s\",\"calls\":%zu,\"wall_seconds\":%.3f,\"latency\":[",
+               target, calls, wallSeconds);
+    }
+    bool first = true;
+    for (auto& entry : results) {
+        std::vector<uint64_t>& v = entry.second.nanos;
+        std::sort(v.begin(), v.end());
+        double p50 = Percentile(v, 0.50) / 1000.0;
+        double p90 = Percentile(v, 0.90) / 1000.0;
+        double p99 = Percentile(v, 0.99) / 1000.0;
+        double max = v.empty() ? 0 : v.back() / 1000.0;
+        if (csv) {
+            printf("%s,%zu,%llu,%.2f,%.2f,%.2f,%.2f\n", entry.first.c_str(), v.size(),
+                   static_cast<unsigned long long>(entry.second.skipped), p50, p90, p99, max);
+        } else {
+            printf("%s\n{\"call\":\"%s\",\"count\":%zu,\"skipped\":%llu,\"p50_us\":%.2f,"
+                   "\"p90_us\":%.2f,\"p99_us\":%.2f,\"max_us\":%.2f}",
+                   first ? "" : ",", entry.first.c_str(), v.size(),
+                   static_cast<unsigned long long>(entry.second.skipped), p50, p90, p99, max);
+        }
+        first = false;
+    }
+    if (!csv) printf("\n]}\n");
+}
+
+int main(int argc, char** argv) {
+    const char* logPath = nullptr;
+    std::string target = "mock";
+    double speed = 1.0;  // 0: as fast as possible
+    bool csv = false;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--target=", 9) == 0) {
+            target = argv[i] + 9;
+        } else if (strcmp(argv[i], "--speed=recorded") == 0) {
+            speed = 1.0;
+        } else if (strcmp(argv[i], "--speed=max") == 0) {
+            speed = 0;
+        } else if (strncmp(argv[i], "--speed=", 8) == 0 && atof(argv[i] + 8) > 0) {
+            speed = atof(argv[i] + 8);
+        } else if (strcmp(argv[i], "--format=csv") == 0) {
+            csv = true;
+        } else if (strcmp(argv[i], "--format=json") == 0) {
+            csv = false;
+        } else if (argv[i][0] != '-' && !logPath) {
+            logPath = argv[i];
+        } else {
+            logPath = nullptr;
+            break;
+        }
+    }
+    if (!logPath) {
+        fprintf(stderr, "usage: %s <log> [--target=mock|plugin[:<dll>]] "
+                        "[--speed=recorded|max|<factor>] [--format=json|csv]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<RecordedCall> calls;
+    if (!ReadCallLog(logPath, calls)) {
+        if (calls.empty()) {
+            fprintf(stderr, "cannot read call log %s\n", logPath);
+            return 1;
+        }
+        fprintf(stderr, "call log %s is truncated; replaying %zu calls\n", logPath, calls.size());
+    }
+
+    std::unique_ptr<ReplayTarget> replay;
+    if (target == "mock") {
+        fprintf(stderr, "target: mock (BrowserHost over MockBrowserBackend), not the plugin\n");
+        replay.reset(new MockTarget());
+    } else if (target.compare(0, 6, "plugin") == 0) {
+#ifdef _WIN32
+        std::string dll = target.size() > 7 ? target.substr(7) : "WebViewPlugin.dll";
+        auto* plugin = new PluginTarget(dll.c_str());
+        replay.reset(plugin);
+        if (!plugin->loaded()) {
+            fprintf(stderr, "cannot load %s\n", dll.c_str());
+            return 1;
+        }
+#else
+        fprintf(stderr, "the plugin target is only available on Windows\n");
+        return 1;
+#endif
+    } else {
+        fprintf(stderr, "unknown target %s\n", target.c_str());
+        return 2;
+    }
+
+    std::map<std::string, CallLatencies> results;
+    auto start = std::chrono::steady_clock::now();
+    for (const RecordedCall& call : calls) {
+        if (speed > 0) {
+            std::this_thread::sleep_until(
+                start + std::chrono::microseconds(static_cast<uint64_t>(call.micros / speed)));
+        }
+        const char* name = RecordedCallName(call.call);
+        CallLatencies& latencies = results[name ? name : "Unknown"];
+        auto before = std::chrono::steady_clock::now();
+        bool handled = replay->invoke(call);
+        auto after = std::chrono::steady_clock::now();
+        if (!handled) {
+            latencies.skipped++;
+            continue;
+        }
+        uint64_t ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count());
+        latencies.nanos.push_back(ns);
+        results["*"].nanos.push_back(ns);
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    replay.reset();
+    PrintResults(results, target == "mock" ? "mock" : "plugin", wall, calls.size(), csv);
+    return 0;
+}
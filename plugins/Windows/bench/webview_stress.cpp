@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Scaling stress test: creates, drives and destroys N instances at once on
+// BrowserHost over MockBrowserBackend, the way Unity drives the plugin, and
+// reports where throughput, latency, memory and thread count go as N grows.
+// BrowserHost is a mock-only harness, not WebViewInstance, so the numbers
+// cover the shared frame, message and navigation components under load;
+// the JSON context says "harness":"mock" and CSV runs note it on stderr.
+//
+//   webview_stress [--instances=1,10,50,100,200] [--seconds=<s>] [--drivers=<threads>]
+//                  [--fps=<frames per second>] [--rate=<commands per instance per second>]
+//                  [--size=<w>x<h>] [--frame-interval=<ms>] [--format=json|csv]
+//
+// Each driver thread plays Unity's main thread for its share of instances:
+// per frame it calls Update and Render and drains GetMessage, and in between
+// it issues EvaluateJS (and every 20th command LoadURL) at the given rate.
+// Command latency is measured end to end, from EvaluateJS to the page's
+// Unity.call message coming out of GetMessage, so it includes the wait for
+// the next frame's drain.
+
+#include "BrowserHost.h"
+#include "MipChain.h"
+#include "MockBrowserBackend.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#endif
+
+struct StressConfig {
+    double seconds = 2.0;
+    int drivers = 1;
+    int fps = 60;
+    double rate = 10.0;
+    int width = 640;
+    int height = 360;
+    int frameIntervalMillis = 16;
+};
+
+struct StressResult {
+    int instances;
+    uint64_t commands;
+    double commandsPerSecond;
+    uint64_t messages;
+    double p50Micros;
+    double p99Micros;
+    uint64_t framesRendered;
+    double createMillis;
+    double destroyMillis;
+    double peakRssMB;
+    int peakThreads;
+};
+
+static uint64_t NowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Resident set size and thread count of this process
+static void SampleProcess(size_t& rss, int& threads) {
+    rss = 0;
+    threads = 0;
+#if defined(__linux__)
+    FILE* f = fopen("/proc/self/status", "r");
+    if (!f) return;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "VmRSS:", 6) == 0) rss = static_cast<size_t>(atoll(line + 6)) * 1024;
+        else if (strncmp(line, "Threads:", 8) == 0) threads = atoi(line + 8);
+    }
+    fclose(f);
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) rss = pmc.WorkingSetSize;
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) return;
+    THREADENTRY32 entry;
+    entry.dwSize = sizeof(entry);
+    DWORD pid = GetCurrentProcessId();
+    for (BOOL ok = Thread32First(snapshot, &entry); ok; ok = Thread32Next(snapshot, &entry)) {
+        if (entry.th32OwnerProcessID == pid) threads++;
+    }
+    CloseHandle(snapshot);
+#endif
+}
+
+// Stands in for s_instances in the plugin: every create and destroy goes
+// through one lock
+static std::mutex s_registryMutex;
+static std::vector<BrowserHost*> s_registry;
+
+struct DriverInstance {
+    std::unique_ptr<BrowserHost> host;
+    std::vector<uint8_t> buffer;
+    double commandDebt = 0;
+    uint64_t lastVisit = 0;
+    uint64_t commandsIssued = 0;
+};
+
+struct DriverTotals {
+    uint64_t commands = 0;
+    uint64_t messages = 0;
+    uint64_t framesRendered = 0;
+    uint64_t createMicros = 0;
+    uint64_t driveMicros = 0;
+    uint64_t destroyMicros = 0;
+    std::vector<uint32_t> latencies;
+};
+
+static void RunDriver(const StressConfig& config, int count, std::atomic<int>& created,
+                      int total, DriverTotals& totals) {
+    MockBrowserConfig mock;
+    mock.scriptMicros = 0;
+    mock.frameIntervalMicros = static_cast<uint64_t>(config.frameIntervalMillis) * 1000;
+
+    uint64_t t0 = NowMicros();
+    std::vector<DriverInstance> instances(count);
+    for (auto& inst : instances) {
+        inst.host.reset(new BrowserHost(std::unique_ptr<BrowserBackend>(new MockBrowserBackend(mock)),
+                                        config.width, config.height));
+        inst.buffer.resize(std::max(MipChainSize(config.width, config.height),
+                                    FrameDataSize(FRAME_FORMAT_BC3, config.width, config.height)));
+        inst.host->loadURL("https://stress.example.com/");
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        s_registry.push_back(inst.host.get());
+    }
+    totals.createMicros = NowMicros() - t0;
+    // Start driving once every driver has its instances
+    created.fetch_add(count);
+    while (created.load() < total) std::this_thread::yield();
+
+    uint64_t frameMicros = 1000000 / static_cast<uint64_t>(config.fps > 0 ? config.fps : 60);
+    uint64_t start = NowMicros();
+    uint64_t end = start + static_cast<uint64_t>(config.seconds * 1e6);
+    WebViewEvent event;
+    char script[64];
+    // Like Unity, an overloaded frame loop drops frames instead of catching up
+    for (uint64_t frame = start; frame < end; ) {
+        for (auto& inst : instances) {
+            BrowserHost& host = *inst.host;
+            host.update(true);
+            host.render(inst.buffer.data());
+            while (host.getEvent(event)) {
+                totals.messages++;
+                if (event.kind == WEBVIEW_EVENT_FROM_JS && event.payload.compare(0, 2, "t:") == 0) {
+                    uint64_t sent = strtoull(event.payload.c_str() + 2, nullptr, 10);
+                    uint64_t now = NowMicros();
+                    totals.latencies.push_back(static_cast<uint32_t>(std::min<uint64_t>(now - sent, UINT32_MAX)));
+                }
+            }
+            // Commands keep their rate even when frames are dropped
+            uint64_t visit = NowMicros();
+            inst.commandDebt += config.rate * (visit - (inst.lastVisit ? inst.lastVisit : start)) / 1e6;
+            inst.lastVisit = visit;
+            while (inst.commandDebt >= 1) {
+                inst.commandDebt -= 1;
+                if (++inst.commandsIssued % 20 == 0) {
+                    host.loadURL("https://stress.example.com/");
+                } else {
+                    snprintf(script, sizeof(script), "Unity.call('t:%llu')",
+                             static_cast<unsigned long long>(NowMicros()));
+                    host.evaluateJS(script);
+                }
+                totals.commands++;
+            }
+        }
+        uint64_t now = NowMicros();
+        frame += frameMicros;
+        if (frame > now) {
+            std::this_thread::sleep_for(std::chrono::microseconds(frame - now));
+        } else {
+            frame = now;
+        }
+    }
+
+    totals.driveMicros = NowMicros() - start;
+    for (auto& inst : instances) {
+        WebViewStats stats;
+        inst.host->getStats(stats);
+        totals.framesRendered += stats.framesRendered;
+    }
+
+    t0 = NowMicros();
+    for (auto& inst : instances) {
+        {
+            std::lock_guard<std::mutex> lock(s_registryMutex);
+            s_registry.erase(std::find(s_registry.begin(), s_registry.end(), inst.host.get()));
+        }
+        inst.host.reset();
+    }
+    totals.destroyMicros = NowMicros() - t0;
+}
+
+static StressResult RunStress(const StressConfig& config, int instances) {
+    int drivers = std::max(1, std::min(config.drivers, instances));
+    std::vector<DriverTotals> totals(drivers);
+    std::vector<std::thread> threads;
+    std::atomic<int> created{0};
+    std::atomic<bool> done{false};
+
+    size_t peakRss = 0;
+    int peakThreads = 0;
+    std::thread sampler([&] {
+        while (!done.load()) {
+            size_t rss;
+            int count;
+            SampleProcess(rss, count);
+            peakRss = std::max(peakRss, rss);
+            peakThreads = std::max(peakThreads, count);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    });
+
+    for (int d = 0; d < drivers; d++) {
+        int count = instances / drivers + (d < instances % drivers ? 1 : 0);
+        threads.emplace_back(RunDriver, std::cref(config), count, std::ref(created), instances,
+                             std::ref(totals[d]));
+    }
+    for (auto& t : threads) t.join();
+    done.store(true);
+    sampler.join();
+
+    StressResult r = {};
+    r.instances = instances;
+    std::vector<uint32_t> latencies;
+    uint64_t driveMicros = 1;
+    for (const auto& t : totals) {
+        r.commands += t.commands;
+        r.messages += t.messages;
+        r.framesRendered += t.framesRendered;
+        driveMicros = std::max(driveMicros, t.driveMicros);
+        r.createMillis = std::max(r.createMillis, t.createMicros / 1000.0);
+        r.destroyMillis = std::max(r.destroyMillis, t.destroyMicros / 1000.0);
+        latencies.insert(latencies.end(), t.latencies.begin(), t.latencies.end());
+    }
+    r.commandsPerSecond = r.commands * 1e6 / driveMicros;
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty()) {
+        r.p50Micros = latencies[latencies.size() / 2];
+        r.p99Micros = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    }
+    r.peakRssMB = peakRss / (1024.0 * 1024.0);
+    r.peakThreads = peakThreads;
+    return r;
+}
+
+int main(int argc, char** argv) {
+    StressConfig config;
+    std::vector<int> counts = {1, 10, 50, 100, 200};
+    bool csv = false;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (strncmp(a, "--instances=", 12) == 0) {
+            counts.clear();
+            for (const char* p = a + 12; *p; ) {
+                int n = atoi(p);
+                if (n > 0) counts.push_back(n);
+                const char* comma = strchr(p, ',');
+                if (!comma) break;
+                p = comma + 1;
+            }
+        } else if (strncmp(a, "--seconds=", 10) == 0) {
+            config.seconds = atof(a + 10);
+        } else if (strncmp(a, "--drivers=", 10) == 0) {
+            config.drivers = atoi(a + 10);
+        } else if (strncmp(a, "--fps=", 6) == 0) {
+            config.fps = atoi(a + 6);
+        } else if (strncmp(a, "--rate=", 7) == 0) {
+            config.rate = atof(a + 7);
+        } else if (strncmp(a, "--size=", 7) == 0) {
+            sscanf(a + 7, "%dx%d", &config.width, &config.height);
+        } else if (strncmp(a, "--frame-interval=", 17) == 0) {
+            config.frameIntervalMillis = atoi(a + 17);
+        } else if (strcmp(a, "--format=csv") == 0) {
+            csv = true;
+        } else if (strcmp(a, "--format=json") == 0) {
+            csv = false;
+        } else {
+            fprintf(stderr, "usage: %s [--instances=1,10,50,100,200] [--seconds=<s>] [--drivers=<threads>]\n"
+                            "       [--fps=<n>] [--rate=<commands per instance per second>] [--size=<w>x<h>]\n"
+                            "       [--frame-interval=<ms>] [--format=json|csv]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (counts.empty() || config.seconds <= 0 || config.width <= 0 || config.height <= 0) {
+        fprintf(stderr, "nothing to run\n");
+        return 2;
+    }
+
+    fprintf(stderr, "harness: mock (BrowserHost over MockBrowserBackend), not the plugin\n");
+    if (csv) {
+        printf("instances,commands,commands_per_second,messages,p50_us,p99_us,frames_rendered,"
+               "create_ms,destroy_ms,peak_rss_mb,peak_threads\n");
+    } else {
+        printf("{\"context\":{\"harness\":\"mock\",\"seconds\":%.1f,\"drivers\":%d,\"fps\":%d,\"rate\":%.1f,\"width\":%d,"
+               "\"height\":%d,\"workerThreads\":%d},\"runs\":[",
+               config.seconds, config.drivers, config.fps, config.rate, config.width, config.height,
+               WorkerPool::instance().threadCount());
+    }
+    for (size_t i = 0; i < counts.size(); i++) {
+        StressResult r = RunStress(config, counts[i]);
+        if (csv) {
+            printf("%d,%llu,%.0f,%llu,%.0f,%.0f,%llu,%.1f,%.1f,%.1f,%d\n", r.instances,
+                   static_cast<unsigned long long>(r.commands), r.commandsPerSecond,
+                   static_cast<unsigned long long>(r.messages), r.p50Micros, r.p99Micros,
+                   static_cast<unsigned long long>(r.framesRendered), r.createMillis, r.destroyMillis, r.peakRssMB, r.peakThreads);
+        } else {
+            printf("%s\n{\"instances\":%d,\"commands\":%llu,\"commands_per_second\":%.0f,\"messages\":%llu,"
+                   "\"p50_us\":%.0f,\"p99_us\":%.0f,\"frames_rendered\":%llu,\"create_ms\":%.1f,\"destroy_ms\":%.1f,"
+                   "\"peak_rss_mb\":%.1f,\"peak_threads\":%d}",
+                   i ? "," : "", r.instances, static_cast<unsigned long long>(r.commands),
+                   r.commandsPerSecond, static_cast<unsigned long long>(r.messages),
+                   r.p50Micros, r.p99Micros, static_cast<unsigned long long>(r.framesRendered),
+                   r.createMillis, r.destroyMillis, r.peakRssMB, r.peakThreads);
+        }
+        fflush(stdout);
+    }
+    if (!csv) printf("\n]}\n");
+    return 0;
+}
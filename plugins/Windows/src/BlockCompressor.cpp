@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BlockCompressor.h"
+#include "WorkerPool.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WEBVIEW_SSE2 1
+#endif
+
+size_t FrameDataSize(int format, int width, int height) {
+    if (width <= 0 || height <= 0) return 0;
+    size_t blocks = static_cast<size_t>(FrameBlocksWide(width)) * FrameBlocksHigh(height);
+    switch (format) {
+    case FRAME_FORMAT_BC1: return blocks * 8;
+    case FRAME_FORMAT_BC3: return blocks * 16;
+    default: return static_cast<size_t>(width) * height * 4;
+    }
+}
+
+// Compares block rows [by0, by1); dirty must be zeroed for those rows.
+static size_t DiffBlockRows(const uint8_t* prev, const uint8_t* cur,
+                            int width, int height, uint8_t* dirty, int by0, int by1) {
+    int bw = FrameBlocksWide(width);
+    int fullBlocks = width / 4;
+    int tailBytes = (width % 4) * 4;
+    int yEnd = by1 * 4 < height ? by1 * 4 : height;
+    size_t count = 0;
+    for (int y = by0 * 4; y < yEnd; y++) {
+        uint8_t* rowDirty = dirty + static_cast<size_t>(y / 4) * bw;
+        const uint8_t* a = prev + static_cast<size_t>(y) * width * 4;
+        const uint8_t* b = cur + static_cast<size_t>(y) * width * 4;
+        for (int bx = 0; bx < fullBlocks; bx++) {
+            if (rowDirty[bx]) continue;
+#ifdef WEBVIEW_SSE2
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + bx * 16));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + bx * 16));
+            bool changed = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF;
+#else
+            bool changed = memcmp(a + bx * 16, b + bx * 16, 16) != 0;
+#endif
+            if (changed) {
+                rowDirty[bx] = 1;
+                count++;
+            }
+        }
+        if (tailBytes && !rowDirty[fullBlocks] &&
+            memcmp(a + fullBlocks * 16, b + fullBlocks * 16, tailBytes) != 0) {
+            rowDirty[fullBlocks] = 1;
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t DiffFrameBlocks(const uint8_t* prev, const uint8_t* cur,
+                       int width, int height, std::vector<uint8_t>& dirty,
+                       WorkerPool* pool) {
+    int bw = FrameBlocksWide(width);
+    int bh = FrameBlocksHigh(height);
+    dirty.assign(static_cast<size_t>(bw) * bh, 0);
+    if (!pool) return DiffBlockRows(prev, cur, width, height, dirty.data(), 0, bh);
+    std::atomic<size_t> count{0};
+    pool->parallelFor(bh, 16, [&](int by0, int by1) {
+        count.fetch_add(DiffBlockRows(prev, cur, width, height, dirty.data(), by0, by1),
+                        std::memory_order_relaxed);
+    });
+    return count.load();
+}
+
+// Gathers a 4x4 block into px (RGBA, row-major), replicating edge pixels for
+// blocks that straddle the right or bottom border.
+static void LoadBlock(const uint8_t* rgba, int width, int height, int bx, int by, uint8_t* px) {
+    int x0 = bx * 4;
+    int y0 = by * 4;
+    if (x0 + 4 <= width && y0 + 4 <= height) {
+        for (int r = 0; r < 4; r++) {
+            memcpy(px + r * 16, rgba + (static_cast<size_t>(y0 + r) * width + x0) * 4, 16);
+        }
+        return;
+    }
+    for (int r = 0; r < 4; r++) {
+        int y = y0 + r < height ? y0 + r : height - 1;
+        for (int c = 0; c < 4; c++) {
+            int x = x0 + c < width ? x0 + c : width - 1;
+            memcpy(px + (r * 4 + c) * 4, rgba + (static_cast<size_t>(y) * width + x) * 4, 4);
+        }
+    }
+}
+
+static void BlockMinMax(const uint8_t* px, uint8_t* mn, uint8_t* mx) {
+#ifdef WEBVIEW_SSE2
+    const __m128i* p = reinterpret_cast<const __m128i*>(px);
+    __m128i r0 = _mm_loadu_si128(p + 0);
+    __m128i r1 = _mm_loadu_si128(p + 1);
+    __m128i r2 = _mm_loadu_si128(p + 2);
+    __m128i r3 = _mm_loadu_si128(p + 3);
+    __m128i vmin = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+    __m128i vmax = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+    vmin = _mm_min_epu8(vmin, _mm_shuffle_epi32(vmin, _MM_SHUFFLE(1, 0, 3, 2)));
+    vmax = _mm_max_epu8(vmax, _mm_shuffle_epi32(vmax, _MM_SHUFFLE(1, 0, 3, 2)));
+    vmin = _mm_min_epu8(vmin, _mm_shuffle_epi32(vmin, _MM_SHUFFLE(2, 3, 0, 1)));
+    vmax = _mm_max_epu8(vmax, _mm_shuffle_epi32(vmax, _MM_SHUFFLE(2, 3, 0, 1)));
+    uint32_t lo = static_cast<uint32_t>(_mm_cvtsi128_si32(vmin));
+    uint32_t hi = static_cast<uint32_t>(_mm_cvtsi128_si32(vmax));
+    memcpy(mn, &lo, 4);
+    memcpy(mx, &hi, 4);
+#else
+    memcpy(mn, px, 4);
+    memcpy(mx, px, 4);
+    for (int i = 1; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            uint8_t v = px[i * 4 + c];
+            if (v < mn[c]) mn[c] = v;
+            if (v > mx[c]) mx[c] = v;
+        }
+    }
+#endif
+}
+
+static inline uint16_t To565(const uint8_t* c) {
+    return static_cast<uint16_t>(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+}
+
+static inline void From565(uint16_t v, int* c) {
+    int r = (v >> 11) & 0x1F;
+    int g = (v >> 5) & 0x3F;
+    int b = v & 0x1F;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+static inline void PutLE16(uint8_t* out, uint16_t v) {
+    out[0] = static_cast<uint8_t>(v);
+    out[1] = static_cast<uint8_t>(v >> 8);
+}
+
+// Four-colour BC1 block from the inset RGB bounding box; each pixel takes the
+// nearest palette entry along the box diagonal.
+static void EncodeColorBlock(const uint8_t* px, uint8_t* out) {
+    uint8_t mn[4], mx[4];
+    BlockMinMax(px, mn, mx);
+    for (int c = 0; c < 3; c++) {
+        int inset = (mx[c] - mn[c]) >> 4;
+        mn[c] = static_cast<uint8_t>(mn[c] + inset);
+        mx[c] = static_cast<uint8_t>(mx[c] - inset);
+    }
+    uint16_t c0 = To565(mx);
+    uint16_t c1 = To565(mn);
+    PutLE16(out, c0);
+    PutLE16(out + 2, c1);
+    if (c0 == c1) {
+        memset(out + 4, 0, 4);
+        return;
+    }
+
+    int e0[3], e1[3];
+    From565(c0, e0);
+    From565(c1, e1);
+    int axis[3] = {e0[0] - e1[0], e0[1] - e1[1], e0[2] - e1[2]};
+    int len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    // Position 0..3 along c1 -> c0 mapped to BC1 palette indices
+    static const uint32_t remap[4] = {1, 3, 2, 0};
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; i++) {
+        const uint8_t* p = px + i * 4;
+        int d = (p[0] - e1[0]) * axis[0] + (p[1] - e1[1]) * axis[1] + (p[2] - e1[2]) * axis[2];
+        int t = d <= 0 ? 0 : (d * 3 + len2 / 2) / len2;
+        if (t > 3) t = 3;
+        indices |= remap[t] << (i * 2);
+    }
+    out[4] = static_cast<uint8_t>(indices);
+    out[5] = static_cast<uint8_t>(indices >> 8);
+    out[6] = static_cast<uint8_t>(indices >> 16);
+    out[7] = static_cast<uint8_t>(indices >> 24);
+}
+
+// Eight-value BC3 alpha block spanning the block's alpha range.
+static void EncodeAlphaBlock(const uint8_t* px, uint8_t* out) {
+    int amin = 255, amax = 0;
+    for (int i = 0; i < 16; i++) {
+        int a = px[i * 4 + 3];
+        if (a < amin) amin = a;
+        if (a > amax) amax = a;
+    }
+    out[0] = static_cast<uint8_t>(amax);
+    out[1] = static_cast<uint8_t>(amin);
+    if (amax == amin) {
+        memset(out + 2, 0, 6);
+        return;
+    }
+    int range = amax - amin;
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++) {
+        int s = ((px[i * 4 + 3] - amin) * 7 + range / 2) / range;
+        uint64_t idx = s == 7 ? 0 : s == 0 ? 1 : static_cast<uint64_t>(8 - s);
+        bits |= idx << (i * 3);
+    }
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+}
+
+static void CompressBlockRows(int format, const uint8_t* rgba, int width, int height,
+                              uint8_t* out, const uint8_t* dirty, int by0, int by1) {
+    int bw = FrameBlocksWide(width);
+    size_t blockBytes = format == FRAME_FORMAT_BC1 ? 8 : 16;
+    uint8_t px[64];
+    for (int by = by0; by < by1; by++) {
+        for (int bx = 0; bx < bw; bx++) {
+            size_t block = static_cast<size_t>(by) * bw + bx;
+            if (dirty && !dirty[block]) continue;
+            LoadBlock(rgba, width, height, bx, by, px);
+            uint8_t* dst = out + block * blockBytes;
+            if (format == FRAME_FORMAT_BC3) {
+                EncodeAlphaBlock(px, dst);
+                dst += 8;
+            }
+            EncodeColorBlock(px, dst);
+        }
+    }
+}
+
+void CompressFrame(int format, const uint8_t* rgba, int width, int height,
+                   uint8_t* out, const uint8_t* dirty, WorkerPool* pool) {
+    if (format != FRAME_FORMAT_BC1 && format != FRAME_FORMAT_BC3) return;
+    int bh = FrameBlocksHigh(height);
+    if (!pool) {
+        CompressBlockRows(format, rgba, width, height, out, dirty, 0, bh);
+        return;
+    }
+    pool->parallelFor(bh, 4, [&](int by0, int by1) {
+        CompressBlockRows(format, rgba, width, height, out, dirty, by0, by1);
+    });
+}
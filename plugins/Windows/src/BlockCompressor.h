@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class WorkerPool;
+
+// Pixel layout handed to Unity by _CWebViewPlugin_Render.
+// Values match the frameFormat field of WebViewObject.cs.
+enum FrameFormat {
+    FRAME_FORMAT_RGBA32 = 0,
+    FRAME_FORMAT_BC1 = 1,  // DXT1, opaque, 8 bytes per 4x4 block
+    FRAME_FORMAT_BC3 = 2,  // DXT5, with alpha, 16 bytes per 4x4 block
+};
+
+inline int FrameBlocksWide(int width) { return (width + 3) / 4; }
+inline int FrameBlocksHigh(int height) { return (height + 3) / 4; }
+
+// Byte size of a frame of the given format (block formats are padded to 4x4).
+size_t FrameDataSize(int format, int width, int height);
+
+// Marks every 4x4 block whose pixels differ between two RGBA frames of the
+// same size. dirty receives one byte per block; returns the dirty block count.
+// With a pool, bands of block rows are compared in parallel.
+size_t DiffFrameBlocks(const uint8_t* prev, const uint8_t* cur,
+                       int width, int height, std::vector<uint8_t>& dirty,
+                       WorkerPool* pool = nullptr);
+
+// Encodes an RGBA frame into BC1/BC3 blocks. When dirty is non-null only the
+// blocks flagged in it are re-encoded; the others are left untouched in out.
+// With a pool, bands of block rows are encoded in parallel.
+void CompressFrame(int format, const uint8_t* rgba, int width, int height,
+                   uint8_t* out, const uint8_t* dirty, WorkerPool* pool = nullptr);
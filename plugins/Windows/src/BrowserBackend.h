@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The browser engine behind a BrowserHost, reduced to what the plugin needs:
+// navigation, script execution, cookies, and BGRA frames. MockBrowserBackend
+// is the only implementation; WebViewInstance drives WebView2 directly.
+
+// Values match COREWEBVIEW2_COOKIE_SAME_SITE_KIND.
+enum CookieSameSite {
+    COOKIE_SAME_SITE_NONE = 0,
+    COOKIE_SAME_SITE_LAX = 1,
+    COOKIE_SAME_SITE_STRICT = 2,
+};
+
+struct BrowserCookie {
+    std::string name;
+    std::string value;
+    std::string domain;
+    std::string path;
+    double expires = -1;  // seconds since 1970; -1 for a session cookie
+    bool secure = false;
+    bool httpOnly = false;
+    int sameSite = COOKIE_SAME_SITE_LAX;
+};
+
+// Engine events. A backend raises them only on the thread that calls its
+// methods (the host thread), from inside those methods or pump.
+class BrowserBackendListener {
+public:
+    virtual ~BrowserBackendListener() {}
+
+    // Return false to cancel the navigation.
+    virtual bool onNavigationStarting(const std::string& url) = 0;
+    // The new document is committed and about to paint.
+    virtual void onContentLoading() = 0;
+    virtual void onNavigationCompleted(const std::string& url, bool success, int errorStatus) = 0;
+    virtual void onHttpError(int statusCode) = 0;
+    // A message posted by the page through window.Unity.call.
+    virtual void onWebMessage(const std::string& message) = 0;
+    virtual void onCookies(const std::vector<BrowserCookie>& cookies) = 0;
+    // A captured frame: height rows of width BGRA pixels, pitch bytes apart.
+    // The pixels are only valid during the call.
+    virtual void onFrame(const uint8_t* bgra, size_t pitch, int width, int height) = 0;
+};
+
+class BrowserBackend {
+public:
+    virtual ~BrowserBackend() {}
+
+    virtual bool create(BrowserBackendListener* listener, int width, int height) = 0;
+
+    virtual void navigate(const std::string& url) = 0;
+    virtual void loadHTML(const std::string& html, const std::string& baseUrl) = 0;
+    virtual void evaluateJS(const std::string& js) = 0;
+    virtual void goBack() = 0;
+    virtual void goForward() = 0;
+    virtual void reload() = 0;
+    virtual bool canGoBack() = 0;
+    virtual bool canGoForward() = 0;
+
+    virtual void resize(int width, int height) = 0;
+    virtual void setVisible(bool visible) = 0;
+
+    // Answered through onCookies; an empty url asks for every cookie.
+    virtual void getCookies(const std::string& url) = 0;
+    virtual void clearCookie(const std::string& url, const std::string& name) = 0;
+    virtual void clearAllCookies() = 0;
+    // Adds or replaces each cookie (matched by name, domain and path).
+    virtual void setCookies(const std::vector<BrowserCookie>& cookies) = 0;
+
+    // Asks for one frame through onFrame. Returns false if none will come.
+    virtual bool requestFrame() = 0;
+
+    // Runs whatever is due at nowMicros and returns when the backend next
+    // needs pumping (UINT64_MAX when idle until the next call).
+    virtual uint64_t pump(uint64_t nowMicros) = 0;
+};
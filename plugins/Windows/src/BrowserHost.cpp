@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "BrowserHost.h"
+#include "CookieSnapshot.h"
+#include "FrameBufferPool.h"
+#include "PixelConvert.h"
+#include "TextConvert.h"
+#include "Trace.h"
+#include "UrlParser.h"
+#include "WorkerPool.h"
+
+#include <chrono>
+
+BrowserHost::BrowserHost(std::unique_ptr<BrowserBackend> backend, int width, int height)
+    : m_backend(std::move(backend)) {
+    post(BROWSER_COMMAND_CREATE, [this, width, height] {
+        if (!m_backend->create(this, width, height))
+            addEvent(WEBVIEW_EVENT_ERROR, "Failed to create browser backend");
+    });
+    m_thread = std::thread(&BrowserHost::threadMain, this);
+}
+
+BrowserHost::~BrowserHost() {
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_quit = true;
+    }
+    m_commandReady.notify_one();
+    m_thread.join();
+}
+
+void BrowserHost::post(int command, std::function<void()> run) {
+    WEBVIEW_TRACE_INSTANT("PostCommand", command);
+    {
+        // Stamped under the lock so stamps stay in queue order
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_stats.commandPosted(InstanceStats::nowMicros());
+        m_commands.push_back(Command{command, std::move(run)});
+    }
+    m_commandReady.notify_one();
+}
+
+void BrowserHost::threadMain() {
+    TraceSetThreadName("WebView host");
+    for (;;) {
+        uint64_t next = m_backend->pump(InstanceStats::nowMicros());
+        Command command;
+        {
+            std::unique_lock<std::mutex> lock(m_commandMutex);
+            if (m_commands.empty() && !m_quit) {
+                if (next == UINT64_MAX) {
+                    m_commandReady.wait(lock);
+                } else {
+                    uint64_t now = InstanceStats::nowMicros();
+                    if (next > now)
+                        m_commandReady.wait_for(lock, std::chrono::microseconds(next - now));
+                }
+            }
+            if (m_quit) break;
+            if (m_commands.empty()) continue;
+            command = std::move(m_commands.front());
+            m_commands.pop_front();
+        }
+        m_stats.commandHandled();
+        WEBVIEW_TRACE_SCOPE_ARG("HandleCommand", command.command);
+        command.run();
+    }
+}
+
+void BrowserHost::loadURL(const std::string& url) {
+    m_navigations.requested(InstanceStats::nowMicros());
+    post(BROWSER_COMMAND_LOADURL, [this, url] { m_backend->navigate(url); });
+}
+
+void BrowserHost::loadHTML(const std::string& html, const std::string& baseUrl) {
+    m_navigations.requested(InstanceStats::nowMicros());
+    post(BROWSER_COMMAND_LOADHTML, [this, html, baseUrl] { m_backend->loadHTML(html, baseUrl); });
+}
+
+void BrowserHost::evaluateJS(const std::string& js) {
+    post(BROWSER_COMMAND_EVALUATEJS, [this, js] { m_backend->evaluateJS(js); });
+}
+
+void BrowserHost::goBack() {
+    post(BROWSER_COMMAND_GOBACK, [this] { m_backend->goBack(); });
+}
+
+void BrowserHost::goForward() {
+    post(BROWSER_COMMAND_GOFORWARD, [this] { m_backend->goForward(); });
+}
+
+void BrowserHost::reload() {
+    post(BROWSER_COMMAND_RELOAD, [this] { m_backend->reload(); });
+}
+
+void BrowserHost::setRect(int width, int height) {
+    post(BROWSER_COMMAND_SETRECT, [this, width, height] { m_backend->resize(width, height); });
+}
+
+void BrowserHost::setVisibility(bool visible) {
+    post(BROWSER_COMMAND_SETVISIBILITY, [this, visible] {
+        // Frames only arrive on this thread, so no writers need locking out
+        if (visible) {
+            m_frames.unpark();
+            m_stats.parkedBytesSaved.store(0);
+        }
+        m_backend->setVisible(visible);
+        if (!visible && !m_frames.parked()) m_stats.parkedBytesSaved.store(m_frames.park());
+    });
+}
+
+void BrowserHost::getCookies(const std::string& url) {
+    post(BROWSER_COMMAND_GETCOOKIES, [this, url] {
+        m_cookieRequests.push_back(CookieRequest{0, 0});
+        m_backend->getCookies(url);
+    });
+}
+
+int BrowserHost::getCookieSnapshot(const std::string& url) {
+    int id = m_nextCookieRequest.fetch_add(1, std::memory_order_relaxed);
+    uint64_t posted = InstanceStats::nowMicros();
+    post(BROWSER_COMMAND_GETCOOKIES, [this, url, id, posted] {
+        m_cookieRequests.push_back(CookieRequest{id, posted});
+        m_backend->getCookies(url);
+    });
+    return id;
+}
+
+int BrowserHost::setCookies(const char* json) {
+    if (!json) return -1;
+    std::vector<BrowserCookie> cookies;
+    if (!ParseCookiesJson(json, cookies)) return -1;
+    int count = static_cast<int>(cookies.size());
+    uint64_t posted = InstanceStats::nowMicros();
+    post(BROWSER_COMMAND_SETCOOKIES, [this, cookies = std::move(cookies), posted] {
+        m_backend->setCookies(cookies);
+        m_stats.cookieSetTime.record(InstanceStats::nowMicros() - posted);
+    });
+    return count;
+}
+
+void BrowserHost::clearCookie(const std::string& url, const std::string& name) {
+    post(BROWSER_COMMAND_CLEARCOOKIE, [this, url, name] { m_backend->clearCookie(url, name); });
+}
+
+void BrowserHost::clearAllCookies() {
+    post(BROWSER_COMMAND_CLEARALLCOOKIES, [this] { m_backend->clearAllCookies(); });
+}
+
+bool BrowserHost::setURLPattern(const char* allow, const char* deny, const char* hook) {
+    return m_urlFilter.setPatterns(allow, deny, hook);
+}
+
+void BrowserHost::update(bool refreshBitmap) {
+    NavigationTiming finished;
+    if (m_navigations.expire(InstanceStats::nowMicros(), kFirstFrameTimeoutMicros, finished))
+        addNavigationTiming(finished);
+    if (!refreshBitmap || m_frames.parked() || m_inRendering.exchange(true)) return;
+    post(BROWSER_COMMAND_CAPTURE, [this] {
+        InstanceStats::bump(m_stats.captureRequests);
+        m_captureRequested = InstanceStats::nowMicros();
+        if (!m_backend->requestFrame()) m_inRendering.store(false);
+    });
+}
+
+void BrowserHost::addEvent(int kind, std::string payload, int code) {
+    size_t depth = m_messages.push(WebViewEvent{kind, code, InstanceStats::nowMicros(), std::move(payload)});
+    m_stats.messageQueued(depth);
+    WEBVIEW_TRACE_INSTANT("QueueMessage", depth);
+}
+
+void BrowserHost::addNavigationTiming(const NavigationTiming& timing) {
+    uint64_t origin = timing.requested ? timing.requested : timing.started;
+    if (timing.success) m_stats.navigationTime.record(timing.completed - origin);
+    if (timing.firstFrame) m_stats.firstFrameTime.record(timing.firstFrame - origin);
+    std::string json;
+    AppendNavigationTimingJson(json, timing);
+    addEvent(WEBVIEW_EVENT_NAVIGATION_TIMING, std::move(json), static_cast<int>(timing.id));
+}
+
+bool BrowserHost::getEvent(WebViewEvent& event) {
+    size_t remaining;
+    if (!m_messages.pop(event, remaining) && !m_channels.pop(event, remaining)) return false;
+    m_stats.messageDequeued(remaining);
+    return true;
+}
+
+bool BrowserHost::getMessage(std::string& message) {
+    WebViewEvent event;
+    if (!getEvent(event)) return false;
+    message = FormatLegacyMessage(event);
+    return true;
+}
+
+size_t BrowserHost::getEvents(uint8_t* buffer, size_t capacity, size_t& needed) {
+    size_t remaining, channelRemaining;
+    size_t written = m_messages.popRecords(buffer, capacity, remaining, needed);
+    if (!written && needed) return 0;
+    written += m_channels.popRecords(buffer + written, capacity - written, m_messages.id(),
+                                     channelRemaining, needed);
+    if (written) m_stats.messageDequeued(remaining + channelRemaining);
+    return written;
+}
+
+void BrowserHost::getStats(WebViewStats& stats) {
+    m_stats.snapshot(stats);
+    FrameBufferPoolStats pool = FrameBufferPool::instance().stats();
+    stats.frameBufferBytesInUse = pool.bytesInUse;
+    stats.frameBufferBytesCached = pool.bytesCached;
+    stats.channelQueueDepth = m_channels.size();
+    stats.channelMessagesDropped = m_channels.dropped();
+}
+
+bool BrowserHost::onNavigationStarting(const std::string& url) {
+    WEBVIEW_TRACE_INSTANT("NavigationStarting", 0);
+    m_progress.store(10);
+    UrlParts parts;
+    if (ParseUrl(url, parts) && UrlSchemeIs(parts.scheme, "unity")) {
+        addEvent(WEBVIEW_EVENT_FROM_JS, url.substr(parts.scheme.size() + 1));
+        return false;
+    }
+    m_wideUrl.clear();
+    AppendUtf8ToWide(m_wideUrl, url.data(), url.size());
+    switch (m_urlFilter.check(m_wideUrl)) {
+    case URL_FILTER_HOOK:
+        m_navigations.cancelled();
+        addEvent(WEBVIEW_EVENT_HOOKED, url);
+        return false;
+    case URL_FILTER_DENY:
+        m_navigations.cancelled();
+        return false;
+    default:
+        break;
+    }
+    addEvent(WEBVIEW_EVENT_STARTED, url);
+    NavigationTiming superseded;
+    if (m_navigations.started(++m_navigationId, url, InstanceStats::nowMicros(), superseded))
+        addNavigationTiming(superseded);
+    return true;
+}
+
+void BrowserHost::onContentLoading() {
+    m_navigations.contentLoading(m_navigationId, InstanceStats::nowMicros());
+}
+
+void BrowserHost::onNavigationCompleted(const std::string& url, bool success, int errorStatus) {
+    WEBVIEW_TRACE_INSTANT("NavigationCompleted", success);
+    m_progress.store(100);
+    m_canGoBack.store(m_backend->canGoBack());
+    m_canGoForward.store(m_backend->canGoForward());
+    if (success) {
+        addEvent(WEBVIEW_EVENT_LOADED, url);
+    } else {
+        addEvent(WEBVIEW_EVENT_NAVIGATION_ERROR, url, errorStatus);
+    }
+    NavigationTiming finished;
+    if (m_navigations.completed(m_navigationId, success, errorStatus, InstanceStats::nowMicros(), finished))
+        addNavigationTiming(finished);
+}
+
+void BrowserHost::onHttpError(int statusCode) {
+    addEvent(WEBVIEW_EVENT_HTTP_ERROR, std::string(), statusCode);
+}
+
+void BrowserHost::onWebMessage(const std::string& message) {
+    std::string_view channel, payload;
+    if (!SplitChannelMessage(std::string_view(message), channel, payload)) {
+        addEvent(WEBVIEW_EVENT_FROM_JS, message);
+        return;
+    }
+    int id = m_channels.route(channel);
+    if (!id) return;
+    WebViewEvent event{WEBVIEW_EVENT_FROM_JS, id, InstanceStats::nowMicros(), std::string(payload)};
+    size_t depth = m_channels.push(id, std::move(event)) + m_messages.size();
+    m_stats.messageQueued(depth);
+    WEBVIEW_TRACE_INSTANT("QueueMessage", depth);
+}
+
+void BrowserHost::onCookies(const std::vector<BrowserCookie>& cookies) {
+    CookieRequest request{0, 0};
+    if (!m_cookieRequests.empty()) {
+        request = m_cookieRequests.front();
+        m_cookieRequests.pop_front();
+    }
+    std::string cookieStr;
+    if (request.id) {
+        AppendCookiesJson(cookieStr, cookies);
+        addEvent(WEBVIEW_EVENT_COOKIE_SNAPSHOT, std::move(cookieStr), request.id);
+        m_stats.cookieSnapshotTime.record(InstanceStats::nowMicros() - request.posted);
+        return;
+    }
+    for (const auto& cookie : cookies) AppendLegacyCookie(cookieStr, cookie);
+    addEvent(WEBVIEW_EVENT_COOKIES, std::move(cookieStr));
+}
+
+void BrowserHost::onFrame(const uint8_t* bgra, size_t pitch, int width, int height) {
+    WEBVIEW_TRACE_SCOPE("OnFrameArrived");
+    if (m_frames.parked()) {
+        InstanceStats::bump(m_stats.framesDropped);
+        m_inRendering.store(false);
+        return;
+    }
+    uint64_t convertStart = InstanceStats::nowMicros();
+    uint8_t* dst = m_frames.beginFrame(width, height);
+    if (!dst) {
+        m_inRendering.store(false);
+        return;
+    }
+    {
+        WEBVIEW_TRACE_SCOPE("Swizzle");
+        WorkerPool::instance().parallelFor(height, 64, [=](int rowBegin, int rowEnd) {
+            SwizzleBGRAToRGBA(bgra, pitch, dst, width, rowBegin, rowEnd);
+        });
+    }
+    bool changed = m_frames.commitFrame();
+    uint64_t ready = InstanceStats::nowMicros();
+    m_stats.conversionTime.record(ready - convertStart);
+    if (changed) {
+        if (m_captureRequested) m_stats.captureLatency.record(ready - m_captureRequested);
+        InstanceStats::bump(m_stats.framesCaptured);
+        NavigationTiming finished;
+        if (m_navigations.frameChanged(ready, finished)) addNavigationTiming(finished);
+    }
+    m_captureRequested = 0;
+    m_inRendering.store(false);
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include "BrowserBackend.h"
+#include "ChannelRouter.h"
+#include "FrameStore.h"
+#include "InstanceStats.h"
+#include "MessageQueue.h"
+#include "NavigationTracker.h"
+#include "UrlFilter.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Commands run on the host thread, reported as the HandleCommand trace arg.
+enum BrowserCommand {
+    BROWSER_COMMAND_CREATE,
+    BROWSER_COMMAND_LOADURL,
+    BROWSER_COMMAND_LOADHTML,
+    BROWSER_COMMAND_EVALUATEJS,
+    BROWSER_COMMAND_GOBACK,
+    BROWSER_COMMAND_GOFORWARD,
+    BROWSER_COMMAND_RELOAD,
+    BROWSER_COMMAND_SETRECT,
+    BROWSER_COMMAND_SETVISIBILITY,
+    BROWSER_COMMAND_CAPTURE,
+    BROWSER_COMMAND_GETCOOKIES,
+    BROWSER_COMMAND_CLEARCOOKIE,
+    BROWSER_COMMAND_CLEARALLCOOKIES,
+    BROWSER_COMMAND_SETCOOKIES,
+};
+
+// Mock-only harness for the benchmarks: a host thread that owns a
+// BrowserBackend (in practice MockBrowserBackend) and runs posted commands
+// against the components the plugin shares with it, FrameStore,
+// MessageQueue, ChannelRouter, NavigationTracker and UrlFilter. It is not
+// the plugin's pipeline. WebViewInstance does its own command handling and
+// event production on WebView2, and request blocking, the response cache,
+// lifecycle steps, user scripts, text input and prerendering have no
+// counterpart here. Results measured through it are labelled as mock
+// results and say nothing about those paths.
+class BrowserHost : private BrowserBackendListener {
+public:
+    BrowserHost(std::unique_ptr<BrowserBackend> backend, int width, int height);
+    ~BrowserHost();
+
+    void loadURL(const std::string& url);
+    void loadHTML(const std::string& html, const std::string& baseUrl);
+    void evaluateJS(const std::string& js);
+    void goBack();
+    void goForward();
+    void reload();
+    void setRect(int width, int height);
+    void setVisibility(bool visible);
+    void getCookies(const std::string& url);
+    void clearCookie(const std::string& url, const std::string& name);
+    void clearAllCookies();
+    // Answered by a WEBVIEW_EVENT_COOKIE_SNAPSHOT carrying the returned id
+    int getCookieSnapshot(const std::string& url);
+    // Returns the number of cookies in json, or -1 if it does not parse
+    int setCookies(const char* json);
+    bool setURLPattern(const char* allow, const char* deny, const char* hook);
+
+    // Requests a capture unless one is in flight or the view is hidden.
+    void update(bool refreshBitmap);
+
+    // One event as "CallOnX:..." text (_CWebViewPlugin_GetMessage)
+    bool getMessage(std::string& message);
+    bool getEvent(WebViewEvent& event);
+    // Packed records as _CWebViewPlugin_GetEvents writes them
+    size_t getEvents(uint8_t* buffer, size_t capacity, size_t& needed);
+    int subscribeChannel(const char* channel, size_t maxQueued) { return m_channels.subscribe(channel, maxQueued); }
+    void unsubscribeChannel(const char* channel) { m_channels.unsubscribe(channel); }
+    std::string channelStats() { return m_channels.statsJson(); }
+    int progress() { return m_progress.load(); }
+    bool canGoBack() { return m_canGoBack.load(); }
+    bool canGoForward() { return m_canGoForward.load(); }
+
+    int bitmapWidth() { return m_frames.width(); }
+    int bitmapHeight() { return m_frames.height(); }
+    void render(void* textureBuffer) { m_frames.render(textureBuffer); }
+    void setFrameFormat(int format) { m_frames.setFrameFormat(format); }
+    void setMipChain(bool enabled, bool gammaCorrect) { m_frames.setMipChain(enabled, gammaCorrect); }
+
+    void getStats(WebViewStats& stats);
+
+private:
+    void post(int command, std::function<void()> run);
+    void threadMain();
+    void addEvent(int kind, std::string payload, int code = 0);
+    void addNavigationTiming(const NavigationTiming& timing);
+
+    bool onNavigationStarting(const std::string& url) override;
+    void onContentLoading() override;
+    void onNavigationCompleted(const std::string& url, bool success, int errorStatus) override;
+    void onHttpError(int statusCode) override;
+    void onWebMessage(const std::string& message) override;
+    void onCookies(const std::vector<BrowserCookie>& cookies) override;
+    void onFrame(const uint8_t* bgra, size_t pitch, int width, int height) override;
+
+    struct Command {
+        int command;
+        std::function<void()> run;
+    };
+
+    std::unique_ptr<BrowserBackend> m_backend;
+    std::thread m_thread;
+    std::mutex m_commandMutex;
+    std::condition_variable m_commandReady;
+    std::deque<Command> m_commands;
+    bool m_quit = false;
+
+    std::atomic<int> m_progress{0};
+    std::atomic<bool> m_canGoBack{false};
+    std::atomic<bool> m_canGoForward{false};
+    std::atomic<bool> m_inRendering{false};
+    uint64_t m_captureRequested = 0;  // host thread only
+    struct CookieRequest {
+        int id;  // 0 for getCookies
+        uint64_t posted;
+    };
+    std::deque<CookieRequest> m_cookieRequests;  // host thread only, answered in order
+    std::atomic<int> m_nextCookieRequest{1};
+    NavigationTracker m_navigations;
+    uint64_t m_navigationId = 0;  // host thread only; ids of passed navigations
+    UrlFilter m_urlFilter;
+    std::wstring m_wideUrl;  // host thread only, reused by onNavigationStarting
+    MessageQueue m_messages;
+    ChannelRouter m_channels;
+
+    InstanceStats m_stats;
+    FrameStore m_frames{m_stats};
+};
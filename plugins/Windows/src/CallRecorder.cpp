@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "CallRecorder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+std::atomic<bool> g_callRecording{false};
+
+static const char* const kCallNames[CALL_ID_COUNT] = {
+    nullptr,
+    "Init",
+    "Destroy",
+    "SetRect",
+    "SetVisibility",
+    "SetURLPattern",
+    "LoadURL",
+    "LoadHTML",
+    "EvaluateJS",
+    "Progress",
+    "CanGoBack",
+    "CanGoForward",
+    "GoBack",
+    "GoForward",
+    "Reload",
+    "SendMouseEvent",
+    "SendKeyEvent",
+    "Update",
+    "BitmapWidth",
+    "BitmapHeight",
+    "Render",
+    "SetFrameFormat",
+    "SetMipChain",
+    "AddCustomHeader",
+    "RemoveCustomHeader",
+    "GetCustomHeaderValue",
+    "ClearCustomHeader",
+    "ClearCookie",
+    "ClearCookies",
+    "GetCookies",
+    "GetMessage",
+    "SetBasicAuthInfo",
+    "ClearCache",
+    "SetInteractionEnabled",
+    "SetScrollbarsVisibility",
+    "SetAlertDialogEnabled",
+    "Pause",
+    "Resume",
+    "SetWorkerThreadCount",
+    "ConfigureFrameBufferPool",
+    "ConfigureResponseCache",
+    "AddResponseCacheRule",
+    "ClearResponseCache",
+    "LoadBlockRules",
+    "LoadBlockRulesFile",
+    "GetBlockRuleHits",
+    "GetEvents",
+    "SubscribeChannel",
+    "UnsubscribeChannel",
+    "GetChannelStats",
+    "GetCookieSnapshot",
+    "SetCookies",
+    "SaveCookies",
+    "SetCookieJarPath",
+    "SaveCookieJar",
+    "LoadCookieJar",
+    "SetResourceTimingCapacity",
+    "GetResourceTimings",
+    "GetResourceTimingSummary",
+    "GetResourceHostStats",
+    "SetLifecyclePolicy",
+    "GetLifecycleState",
+    "GetLifecycleStats",
+    "Prerender",
+    "CommitPrerender",
+    "CancelPrerender",
+    "GetPrerenderStats",
+    "AddUserScript",
+    "RemoveUserScript",
+    "SendText",
+    "SetComposition",
+};
+
+const char* RecordedCallName(int call) {
+    return call > 0 && call < CALL_ID_COUNT ? kCallNames[call] : nullptr;
+}
+
+namespace {
+
+struct Recorder {
+    std::mutex mutex;
+    FILE* file = nullptr;
+    std::vector<uint8_t> record;
+    std::map<const void*, uint32_t> instances;
+    uint32_t nextInstance = 1;
+    uint64_t last = 0;
+    uint64_t lastFlush = 0;
+};
+
+Recorder& GetRecorder() {
+    // Never destroyed; exports may still run during DLL unload
+    static Recorder* recorder = new Recorder();
+    return *recorder;
+}
+
+uint64_t NowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) return false;
+        uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool StartCallRecording(const char* path) {
+    StopCallRecording();
+    if (!path) return false;
+    Recorder& r = GetRecorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.file = fopen(path, "wb");
+    if (!r.file) return false;
+    setvbuf(r.file, nullptr, _IOFBF, 64 * 1024);
+    fwrite(WEBVIEW_CALL_LOG_MAGIC, 1, 8, r.file);
+    r.instances.clear();
+    r.nextInstance = 1;
+    r.last = NowMicros();
+    r.lastFlush = r.last;
+    g_callRecording.store(true);
+    return true;
+}
+
+void StopCallRecording() {
+    Recorder& r = GetRecorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    g_callRecording.store(false);
+    if (r.file) {
+        fclose(r.file);
+        r.file = nullptr;
+    }
+}
+
+long long RecordedInstanceNumber(const void* instance) {
+    Recorder& r = GetRecorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (!r.file || !instance) return 0;
+    auto it = r.instances.find(instance);
+    if (it == r.instances.end()) it = r.instances.emplace(instance, r.nextInstance++).first;
+    return it->second;
+}
+
+void RecordCall(int call, const void* instance, std::initializer_list<CallArg> args) {
+    Recorder& r = GetRecorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (!r.file) return;
+    uint64_t now = NowMicros();
+    uint32_t number = 0;
+    if (instance) {
+        auto it = r.instances.find(instance);
+        if (it == r.instances.end()) it = r.instances.emplace(instance, r.nextInstance++).first;
+        number = it->second;
+        // A later instance may reuse the address
+        if (call == CALL_DESTROY) r.instances.erase(it);
+    }
+
+    std::vector<uint8_t>& out = r.record;
+    out.clear();
+    PutVarint(out, now - r.last);
+    out.push_back(static_cast<uint8_t>(call));
+    PutVarint(out, number);
+    out.push_back(static_cast<uint8_t>(args.size()));
+    for (const CallArg& arg : args) {
+        out.push_back(static_cast<uint8_t>(arg.type));
+        switch (arg.type) {
+        case CallArg::INT:
+            PutVarint(out, (static_cast<uint64_t>(arg.i) << 1) ^ static_cast<uint64_t>(arg.i >> 63));
+            break;
+        case CallArg::FLOAT: {
+            uint32_t bits;
+            memcpy(&bits, &arg.f, 4);
+            for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(bits >> (i * 8)));
+            break;
+        }
+        case CallArg::STRING:
+            PutVarint(out, arg.text.size());
+            out.insert(out.end(), arg.text.begin(), arg.text.end());
+            break;
+        case CallArg::NULL_STRING:
+            break;
+        }
+    }
+    fwrite(out.data(), 1, out.size(), r.file);
+    r.last = now;
+    // Keep at most a second of calls in the buffer should the process die
+    if (now - r.lastFlush > 1000000) {
+        fflush(r.file);
+        r.lastFlush = now;
+    }
+}
+
+bool ReadCallLog(const char* path, std::vector<RecordedCall>& calls) {
+    FILE* file = path ? fopen(path, "rb") : nullptr;
+    if (!file) return false;
+    std::vector<uint8_t> data;
+    uint8_t chunk[64 * 1024];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + n);
+    fclose(file);
+    if (data.size() < 8 || memcmp(data.data(), WEBVIEW_CALL_LOG_MAGIC, 8) != 0) return false;
+
+    const uint8_t* p = data.data() + 8;
+    const uint8_t* end = data.data() + data.size();
+    uint64_t micros = 0;
+    while (p < end) {
+        RecordedCall call;
+        uint64_t delta, number, v;
+        if (!GetVarint(p, end, delta) || p == end) return false;
+        call.call = *p++;
+        if (!GetVarint(p, end, number) || p == end) return false;
+        int argc = *p++;
+        for (int i = 0; i < argc; i++) {
+            if (p == end) return false;
+            CallArg arg(0);
+            arg.type = static_cast<CallArg::Type>(*p++);
+            switch (arg.type) {
+            case CallArg::INT:
+                if (!GetVarint(p, end, v)) return false;
+                arg.i = static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+                break;
+            case CallArg::FLOAT: {
+                if (end - p < 4) return false;
+                uint32_t bits = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+                memcpy(&arg.f, &bits, 4);
+                p += 4;
+                break;
+            }
+            case CallArg::STRING:
+                if (!GetVarint(p, end, v) || static_cast<uint64_t>(end - p) < v) return false;
+                arg.text.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(v));
+                p += v;
+                break;
+            case CallArg::NULL_STRING:
+                break;
+            default:
+                return false;
+            }
+            call.args.push_back(std::move(arg));
+        }
+        micros += delta;
+        call.micros = micros;
+        call.instance = static_cast<uint32_t>(number);
+        calls.push_back(std::move(call));
+    }
+    return true;
+}
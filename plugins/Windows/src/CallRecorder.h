@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Optional log of the calls Unity makes across the extern "C" boundary, so a
+// session can be replayed later (bench/webview_replay.cpp). Records are
+// appended to a compact binary file: the file starts with kCallLogMagic, then
+// per call
+//   varint   microseconds since the previous call
+//   u8       RecordedCallId
+//   varint   instance number (0 for process-wide calls, else in Init order)
+//   u8       argument count, then per argument a CallArg::Type byte and
+//            a zigzag varint, a little-endian float32, or a varint length
+//            and UTF-8 bytes
+// When recording is off a call costs one relaxed load.
+
+#define WEBVIEW_CALL_LOG_MAGIC "WVCALLS1"
+
+// Never renumbered; new calls go at the end.
+enum RecordedCallId {
+    CALL_INIT = 1,
+    CALL_DESTROY,
+    CALL_SETRECT,
+    CALL_SETVISIBILITY,
+    CALL_SETURLPATTERN,
+    CALL_LOADURL,
+    CALL_LOADHTML,
+    CALL_EVALUATEJS,
+    CALL_PROGRESS,
+    CALL_CANGOBACK,
+    CALL_CANGOFORWARD,
+    CALL_GOBACK,
+    CALL_GOFORWARD,
+    CALL_RELOAD,
+    CALL_SENDMOUSEEVENT,
+    CALL_SENDKEYEVENT,
+    CALL_UPDATE,
+    CALL_BITMAPWIDTH,
+    CALL_BITMAPHEIGHT,
+    CALL_RENDER,
+    CALL_SETFRAMEFORMAT,
+    CALL_SETMIPCHAIN,
+    CALL_ADDCUSTOMHEADER,
+    CALL_REMOVECUSTOMHEADER,
+    CALL_GETCUSTOMHEADERVALUE,
+    CALL_CLEARCUSTOMHEADER,
+    CALL_CLEARCOOKIE,
+    CALL_CLEARCOOKIES,
+    CALL_GETCOOKIES,
+    CALL_GETMESSAGE,
+    CALL_SETBASICAUTHINFO,
+    CALL_CLEARCACHE,
+    CALL_SETINTERACTIONENABLED,
+    CALL_SETSCROLLBARSVISIBILITY,
+    CALL_SETALERTDIALOGENABLED,
+    CALL_PAUSE,
+    CALL_RESUME,
+    CALL_SETWORKERTHREADCOUNT,
+    CALL_CONFIGUREFRAMEBUFFERPOOL,
+    CALL_CONFIGURERESPONSECACHE,
+    CALL_ADDRESPONSECACHERULE,
+    CALL_CLEARRESPONSECACHE,
+    CALL_LOADBLOCKRULES,
+    CALL_LOADBLOCKRULESFILE,
+    CALL_GETBLOCKRULEHITS,
+    CALL_GETEVENTS,
+    CALL_SUBSCRIBECHANNEL,
+    CALL_UNSUBSCRIBECHANNEL,
+    CALL_GETCHANNELSTATS,
+    CALL_GETCOOKIESNAPSHOT,
+    CALL_SETCOOKIES,
+    CALL_SAVECOOKIES,
+    CALL_SETCOOKIEJARPATH,
+    CALL_SAVECOOKIEJAR,
+    CALL_LOADCOOKIEJAR,
+    CALL_SETRESOURCETIMINGCAPACITY,
+    CALL_GETRESOURCETIMINGS,
+    CALL_GETRESOURCETIMINGSUMMARY,
+    CALL_GETRESOURCEHOSTSTATS,
+    CALL_SETLIFECYCLEPOLICY,
+    CALL_GETLIFECYCLESTATE,
+    CALL_GETLIFECYCLESTATS,
+    CALL_PRERENDER,
+    CALL_COMMITPRERENDER,
+    CALL_CANCELPRERENDER,
+    CALL_GETPRERENDERSTATS,
+    CALL_ADDUSERSCRIPT,
+    CALL_REMOVEUSERSCRIPT,
+    CALL_SENDTEXT,
+    CALL_SETCOMPOSITION,
+    CALL_ID_COUNT
+};
+
+// Export name without the _CWebViewPlugin_ prefix, or nullptr.
+const char* RecordedCallName(int call);
+
+struct CallArg {
+    enum Type { INT, FLOAT, STRING, NULL_STRING };
+
+    CallArg(int v) : type(INT), i(v) {}
+    CallArg(long long v) : type(INT), i(v) {}
+    CallArg(bool v) : type(INT), i(v ? 1 : 0) {}
+    CallArg(double v) : type(FLOAT), f(static_cast<float>(v)) {}
+    CallArg(const char* v) : type(v ? STRING : NULL_STRING), text(v ? v : "") {}
+
+    // The string as passed in: nullptr when it was null
+    const char* str() const { return type == STRING ? text.c_str() : nullptr; }
+
+    Type type;
+    int64_t i = 0;
+    float f = 0;
+    std::string text;
+};
+
+struct RecordedCall {
+    uint64_t micros;  // since recording started
+    int call;
+    uint32_t instance;
+    std::vector<CallArg> args;
+};
+
+extern std::atomic<bool> g_callRecording;
+
+inline bool CallRecordingEnabled() { return g_callRecording.load(std::memory_order_relaxed); }
+
+// Starts a new log at path, ending any previous one. Returns false if the
+// file cannot be created.
+bool StartCallRecording(const char* path);
+void StopCallRecording();
+
+void RecordCall(int call, const void* instance, std::initializer_list<CallArg> args);
+// The number the log knows instance by, numbering it now if it has not been
+// seen; for calls that hand out an instance other than through Init.
+long long RecordedInstanceNumber(const void* instance);
+
+// Reads a whole log; returns false on a missing or malformed file, keeping
+// the calls read up to the damage.
+bool ReadCallLog(const char* path, std::vector<RecordedCall>& calls);
+
+#define WEBVIEW_RECORD_CALL(call, instance, ...) \
+    do { \
+        if (CallRecordingEnabled()) RecordCall(call, instance, {__VA_ARGS__}); \
+    } while (0)
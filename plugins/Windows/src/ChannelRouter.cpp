@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "ChannelRouter.h"
+#include "JsonEscape.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const size_t kMaxChannelName = 64;
+
+static bool ValidChannelName(const char* name, size_t length) {
+    if (length == 0 || length > kMaxChannelName) return false;
+    for (size_t i = 0; i < length; i++) {
+        if (name[i] < 0x20 || name[i] > 0x7E) return false;
+    }
+    return true;
+}
+
+int ChannelRouter::subscribe(const char* name, size_t maxQueued) {
+    size_t length = name ? strlen(name) : 0;
+    if (!ValidChannelName(name, length)) return 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& channel : m_channels) {
+        if (channel.name.size() == length && channel.name.compare(0, length, name) == 0) {
+            channel.maxQueued = maxQueued;
+            return channel.id;
+        }
+    }
+    Channel channel;
+    channel.name.assign(name, length);
+    channel.id = m_nextId++;
+    channel.maxQueued = maxQueued;
+    m_channels.push_back(std::move(channel));
+    return m_channels.back().id;
+}
+
+bool ChannelRouter::unsubscribe(const char* name) {
+    if (!name) return false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_channels.size(); i++) {
+        if (m_channels[i].name != name) continue;
+        m_queued -= m_channels[i].events.size();
+        m_dropped += m_channels[i].events.size();
+        m_channels.erase(m_channels.begin() + i);
+        if (m_next > i) m_next--;
+        return true;
+    }
+    return false;
+}
+
+void ChannelRouter::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dropped += m_queued;
+    m_channels.clear();
+    m_next = 0;
+    m_queued = 0;
+}
+
+void ChannelRouter::copySubscriptionsFrom(ChannelRouter& other) {
+    if (&other == this) return;
+    std::vector<Channel> channels;
+    int nextId;
+    {
+        std::lock_guard<std::mutex> lock(other.m_mutex);
+        for (const auto& c : other.m_channels) {
+            Channel channel;
+            channel.name = c.name;
+            channel.id = c.id;
+            channel.maxQueued = c.maxQueued;
+            channels.push_back(std::move(channel));
+        }
+        nextId = other.m_nextId;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t queued = 0;
+    for (auto& channel : channels) {
+        for (auto& own : m_channels) {
+            if (own.name != channel.name) continue;
+            channel.received = own.received;
+            channel.dropped = own.dropped;
+            channel.events = std::move(own.events);
+            while (channel.maxQueued && channel.events.size() > channel.maxQueued) {
+                channel.events.pop_front();
+                channel.dropped++;
+            }
+            for (auto& event : channel.events) event.code = channel.id;
+            queued += channel.events.size();
+            break;
+        }
+    }
+    m_dropped += m_queued - queued;
+    m_queued = queued;
+    m_channels = std::move(channels);
+    m_next = 0;
+    if (nextId > m_nextId) m_nextId = nextId;
+}
+
+template<typename CharT>
+int ChannelRouter::routeLocked(std::basic_string_view<CharT> channel) {
+    for (const auto& c : m_channels) {
+        if (c.name.size() != channel.size()) continue;
+        size_t i = 0;
+        while (i < channel.size() && static_cast<CharT>(c.name[i]) == channel[i]) i++;
+        if (i == channel.size()) return c.id;
+    }
+    m_unrouted++;
+    m_dropped++;
+    return 0;
+}
+
+int ChannelRouter::route(std::string_view channel) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return routeLocked(channel);
+}
+
+int ChannelRouter::route(std::wstring_view channel) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return routeLocked(channel);
+}
+
+ChannelRouter::Channel* ChannelRouter::findLocked(int id) {
+    for (auto& channel : m_channels) {
+        if (channel.id == id) return &channel;
+    }
+    return nullptr;
+}
+
+size_t ChannelRouter::push(int id, WebViewEvent event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Channel* channel = findLocked(id);
+    if (!channel) {
+        // Unsubscribed since it was routed
+        m_dropped++;
+        return m_queued;
+    }
+    channel->received++;
+    if (channel->maxQueued && channel->events.size() >= channel->maxQueued) {
+        channel->events.pop_front();
+        channel->dropped++;
+        m_dropped++;
+        m_queued--;
+    }
+    event.code = id;
+    channel->events.push_back(std::move(event));
+    return ++m_queued;
+}
+
+ChannelRouter::Channel* ChannelRouter::nextNonEmptyLocked() {
+    if (!m_queued) return nullptr;
+    for (size_t n = 0; n < m_channels.size(); n++) {
+        if (m_next >= m_channels.size()) m_next = 0;
+        Channel& channel = m_channels[m_next++];
+        if (!channel.events.empty()) return &channel;
+    }
+    return nullptr;
+}
+
+bool ChannelRouter::pop(WebViewEvent& event, size_t& remaining) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Channel* channel = nextNonEmptyLocked();
+    if (!channel) return false;
+    event = std::move(channel->events.front());
+    channel->events.pop_front();
+    remaining = --m_queued;
+    return true;
+}
+
+size_t ChannelRouter::popRecords(uint8_t* out, size_t capacity, uint32_t instanceId,
+                                 size_t& remaining, size_t& needed) {
+    needed = 0;
+    size_t written = 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (Channel* channel = nextNonEmptyLocked()) {
+        const WebViewEvent& event = channel->events.front();
+        size_t record = WebViewEventRecordSize(event.payload.size());
+        if (written + record > capacity) {
+            if (!written) needed = record;
+            // Start from this channel next time
+            m_next--;
+            break;
+        }
+        written += WriteEventRecord(out + written, event, instanceId);
+        channel->events.pop_front();
+        m_queued--;
+    }
+    remaining = m_queued;
+    return written;
+}
+
+size_t ChannelRouter::size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queued;
+}
+
+uint64_t ChannelRouter::dropped() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+std::string ChannelRouter::statsJson() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"unrouted\":%llu,\"channels\":[",
+             static_cast<unsigned long long>(m_unrouted));
+    std::string json = buf;
+    for (size_t i = 0; i < m_channels.size(); i++) {
+        const Channel& channel = m_channels[i];
+        json += i ? ",{\"name\":\"" : "{\"name\":\"";
+        AppendJsonEscaped(json, channel.name);
+        snprintf(buf, sizeof(buf), "\",\"id\":%d,\"received\":%llu,\"dropped\":%llu,\"queued\":%llu}",
+                 channel.id, static_cast<unsigned long long>(channel.received),
+                 static_cast<unsigned long long>(channel.dropped),
+                 static_cast<unsigned long long>(channel.events.size()));
+        json += buf;
+    }
+    json += "]}";
+    return json;
+}
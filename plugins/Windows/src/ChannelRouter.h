@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include "MessageQueue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Separator of a channel message posted by the bridge script's
+// Unity.call(channel, payload): "\x1f<channel>\x1f<payload>". The
+// one-argument Unity.call(message) posts message unchanged.
+const char kChannelSeparator = '\x1f';
+
+// Splits a posted message into channel and payload; false for a plain
+// Unity.call(message).
+template<typename CharT>
+bool SplitChannelMessage(std::basic_string_view<CharT> message,
+                         std::basic_string_view<CharT>& channel,
+                         std::basic_string_view<CharT>& payload) {
+    if (message.empty() || message[0] != static_cast<CharT>(kChannelSeparator)) return false;
+    size_t end = message.find(static_cast<CharT>(kChannelSeparator), 1);
+    if (end == std::basic_string_view<CharT>::npos) return false;
+    channel = message.substr(1, end - 1);
+    payload = message.substr(end + 1);
+    return true;
+}
+
+// Named channels for JS -> Unity messages. Unity subscribes to the channels
+// it handles; messages on other channels are counted and dropped where they
+// arrive, before their payload is converted or queued. Each channel has its
+// own queue, optionally bounded (dropping the oldest), and channels are
+// drained round-robin after the instance's main event queue, so a chatty
+// channel cannot hold back navigation events or other channels.
+//
+// Channel events are WEBVIEW_EVENT_FROM_JS with the channel id as the code.
+class ChannelRouter {
+public:
+    // Returns the channel id (from 1, never reused), or 0 if name is not 1-64
+    // printable ASCII characters. Subscribing again keeps the id and updates
+    // the bound; maxQueued 0 means unbounded.
+    int subscribe(const char* name, size_t maxQueued);
+    // Drops the channel and anything still queued on it.
+    bool unsubscribe(const char* name);
+    void clear();
+    // Takes over other's subscriptions with their ids and bounds, so ids
+    // handed out by other stay valid here. Messages already queued here on
+    // a channel other also has are kept; the rest are dropped.
+    void copySubscriptionsFrom(ChannelRouter& other);
+
+    // Id of the subscribed channel, or 0 after counting the message as
+    // dropped. Names compare code unit by code unit, so UTF-16 messages
+    // are routed without conversion.
+    int route(std::string_view channel);
+    int route(std::wstring_view channel);
+
+    // Queues an event on channel id; returns the depth of all channel
+    // queues after the push.
+    size_t push(int id, WebViewEvent event);
+    bool pop(WebViewEvent& event, size_t& remaining);
+    // As MessageQueue::popRecords, one event per channel in turn.
+    size_t popRecords(uint8_t* out, size_t capacity, uint32_t instanceId,
+                      size_t& remaining, size_t& needed);
+    size_t size();
+    // Every dropped message: unsubscribed, over a bound or unsubscribed
+    // while queued.
+    uint64_t dropped();
+
+    // {"unrouted":N,"channels":[{"name":"...","id":N,"received":N,
+    // "dropped":N,"queued":N},...]}; unrouted counts messages on channels
+    // nobody subscribed to.
+    std::string statsJson();
+
+private:
+    struct Channel {
+        std::string name;
+        int id;
+        size_t maxQueued;
+        uint64_t received = 0;
+        uint64_t dropped = 0;
+        std::deque<WebViewEvent> events;
+    };
+
+    template<typename CharT>
+    int routeLocked(std::basic_string_view<CharT> channel);
+    Channel* findLocked(int id);
+    Channel* nextNonEmptyLocked();
+
+    std::mutex m_mutex;
+    std::vector<Channel> m_channels;
+    int m_nextId = 1;
+    size_t m_next = 0;      // round-robin position
+    size_t m_queued = 0;
+    uint64_t m_unrouted = 0;
+    uint64_t m_dropped = 0;
+};
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "CookieJar.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+static const char kMagic[4] = {'W', 'V', 'C', 'J'};
+static const size_t kHeaderSize = 20;
+// Far more than any profile holds; guards allocations against bad files
+static const uint32_t kMaxCookies = 1 << 20;
+
+static uint32_t Fnv1a(const uint8_t* data, size_t size) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void PutLE(std::string& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) out += static_cast<char>(v >> (i * 8));
+}
+
+static uint64_t GetLE(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= static_cast<uint64_t>(p[i]) << (i * 8);
+    return v;
+}
+
+static void PutString(std::string& out, const std::string& s) {
+    size_t n = s.size();
+    while (n >= 0x80) {
+        out += static_cast<char>(0x80 | (n & 0x7F));
+        n >>= 7;
+    }
+    out += static_cast<char>(n);
+    out += s;
+}
+
+static bool GetString(const uint8_t*& p, const uint8_t* end, std::string& s) {
+    uint64_t n = 0;
+    for (int shift = 0;; shift += 7) {
+        if (p >= end || shift > 28) return false;
+        uint8_t b = *p++;
+        n |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    if (n > static_cast<uint64_t>(end - p)) return false;
+    s.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(n));
+    p += n;
+    return true;
+}
+
+void EncodeCookieJar(const std::vector<BrowserCookie>& cookies, std::string& out) {
+    size_t start = out.size();
+    out.append(kMagic, 4);
+    PutLE(out, WEBVIEW_COOKIE_JAR_VERSION, 2);
+    PutLE(out, 0, 2);
+    PutLE(out, cookies.size(), 4);
+    PutLE(out, 0, 8);  // body size and checksum, filled in below
+    size_t body = out.size();
+    for (const auto& c : cookies) {
+        PutString(out, c.name);
+        PutString(out, c.value);
+        PutString(out, c.domain);
+        PutString(out, c.path);
+        int64_t millis = c.expires >= 0 ? static_cast<int64_t>(std::llround(c.expires * 1000)) : -1;
+        PutLE(out, static_cast<uint64_t>(millis), 8);
+        out += static_cast<char>((c.secure ? 1 : 0) | (c.httpOnly ? 2 : 0));
+        out += static_cast<char>(c.sameSite);
+    }
+    size_t bodySize = out.size() - body;
+    uint32_t sum = Fnv1a(reinterpret_cast<const uint8_t*>(out.data()) + body, bodySize);
+    for (int i = 0; i < 4; i++) {
+        out[start + 12 + i] = static_cast<char>(bodySize >> (i * 8));
+        out[start + 16 + i] = static_cast<char>(sum >> (i * 8));
+    }
+}
+
+bool DecodeCookieJar(const uint8_t* data, size_t size, std::vector<BrowserCookie>& cookies) {
+    if (!data || size < kHeaderSize || memcmp(data, kMagic, 4) != 0) return false;
+    if (GetLE(data + 4, 2) != WEBVIEW_COOKIE_JAR_VERSION) return false;
+    uint32_t count = static_cast<uint32_t>(GetLE(data + 8, 4));
+    uint32_t bodySize = static_cast<uint32_t>(GetLE(data + 12, 4));
+    if (count > kMaxCookies || bodySize != size - kHeaderSize) return false;
+    const uint8_t* p = data + kHeaderSize;
+    const uint8_t* end = p + bodySize;
+    if (Fnv1a(p, bodySize) != static_cast<uint32_t>(GetLE(data + 16, 4))) return false;
+    size_t base = cookies.size();
+    cookies.resize(base + count);
+    for (uint32_t i = 0; i < count; i++) {
+        BrowserCookie& c = cookies[base + i];
+        if (!GetString(p, end, c.name) || !GetString(p, end, c.value) ||
+            !GetString(p, end, c.domain) || !GetString(p, end, c.path) || end - p < 10) {
+            cookies.resize(base);
+            return false;
+        }
+        int64_t millis = static_cast<int64_t>(GetLE(p, 8));
+        c.expires = millis >= 0 ? millis / 1000.0 : -1;
+        c.secure = (p[8] & 1) != 0;
+        c.httpOnly = (p[8] & 2) != 0;
+        c.sameSite = p[9] <= COOKIE_SAME_SITE_STRICT ? static_cast<int>(p[9])
+                                                     : static_cast<int>(COOKIE_SAME_SITE_LAX);
+        p += 10;
+    }
+    if (p != end) {
+        cookies.resize(base);
+        return false;
+    }
+    return true;
+}
+
+size_t PruneCookies(std::vector<BrowserCookie>& cookies, double nowSeconds, bool keepSession) {
+    size_t before = cookies.size();
+    cookies.erase(std::remove_if(cookies.begin(), cookies.end(), [&](const BrowserCookie& c) {
+        return c.expires < 0 ? !keepSession : c.expires <= nowSeconds;
+    }), cookies.end());
+    return before - cookies.size();
+}
+
+bool WriteCookieJarFile(const char* path, const std::vector<BrowserCookie>& cookies) {
+    if (!path || !*path) return false;
+    std::string data;
+    EncodeCookieJar(cookies, data);
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmp.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    ok = ok && rename(tmp.c_str(), path) == 0;
+#endif
+    if (!ok) remove(tmp.c_str());
+    return ok;
+}
+
+bool ReadCookieJarFile(const char* path, std::vector<BrowserCookie>& cookies) {
+    FILE* file = path ? fopen(path, "rb") : nullptr;
+    if (!file) return false;
+    std::string data;
+    char buf[16 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0) data.append(buf, n);
+    fclose(file);
+    return DecodeCookieJar(reinterpret_cast<const uint8_t*>(data.data()), data.size(), cookies);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include "BrowserBackend.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Saved cookie jar (_CWebViewPlugin_SaveCookieJar / LoadCookieJar), so warm
+// starts can restore a session without the profile in %TEMP% surviving.
+// Little-endian:
+//
+//   "WVCJ", uint16 version, uint16 reserved, uint32 count,
+//   uint32 body size, uint32 FNV-1a of the body, then count records:
+//   name, value, domain, path (varint length + UTF-8),
+//   int64 expires in milliseconds since 1970 (-1: session),
+//   uint8 flags (1 secure, 2 httpOnly), uint8 sameSite
+//
+// Readers reject other versions and bodies that fail the checksum.
+
+#define WEBVIEW_COOKIE_JAR_VERSION 1
+
+void EncodeCookieJar(const std::vector<BrowserCookie>& cookies, std::string& out);
+// Appends the jar's cookies; false (with cookies unchanged) if data is not
+// a valid jar.
+bool DecodeCookieJar(const uint8_t* data, size_t size, std::vector<BrowserCookie>& cookies);
+
+// Drops cookies that expired before nowSeconds and, unless keepSession,
+// session cookies. Returns how many were dropped.
+size_t PruneCookies(std::vector<BrowserCookie>& cookies, double nowSeconds, bool keepSession);
+
+// Writes through a temporary file renamed over path, so a crash never
+// leaves a half-written jar.
+bool WriteCookieJarFile(const char* path, const std::vector<BrowserCookie>& cookies);
+bool ReadCookieJarFile(const char* path, std::vector<BrowserCookie>& cookies);
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "CookieSnapshot.h"
+#include "JsonEscape.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char* const kSameSiteNames[] = {"None", "Lax", "Strict"};
+
+// Whole seconds, with milliseconds only when there are some
+static void AppendExpires(std::string& out, double expires) {
+    if (!(expires >= 0) || expires > 1e15) {
+        out += "-1";
+        return;
+    }
+    long long millis = static_cast<long long>(expires * 1000 + 0.5);
+    char buf[32];
+    char* end = std::to_chars(buf, buf + sizeof(buf), millis / 1000).ptr;
+    if (millis % 1000) {
+        int ms = static_cast<int>(millis % 1000);
+        *end++ = '.';
+        *end++ = static_cast<char>('0' + ms / 100);
+        *end++ = static_cast<char>('0' + ms / 10 % 10);
+        *end++ = static_cast<char>('0' + ms % 10);
+    }
+    out.append(buf, end - buf);
+}
+
+void AppendCookiesJson(std::string& out, const std::vector<BrowserCookie>& cookies) {
+    out += "{\"cookies\":[";
+    for (size_t i = 0; i < cookies.size(); i++) {
+        const BrowserCookie& cookie = cookies[i];
+        out += i ? ",{\"name\":\"" : "{\"name\":\"";
+        AppendJsonEscaped(out, cookie.name);
+        out += "\",\"value\":\"";
+        AppendJsonEscaped(out, cookie.value);
+        out += "\",\"domain\":\"";
+        AppendJsonEscaped(out, cookie.domain);
+        out += "\",\"path\":\"";
+        AppendJsonEscaped(out, cookie.path);
+        out += "\",\"expires\":";
+        AppendExpires(out, cookie.expires);
+        out += cookie.secure ? ",\"secure\":true" : ",\"secure\":false";
+        out += cookie.httpOnly ? ",\"httpOnly\":true,\"sameSite\":\"" : ",\"httpOnly\":false,\"sameSite\":\"";
+        int sameSite = cookie.sameSite >= COOKIE_SAME_SITE_NONE && cookie.sameSite <= COOKIE_SAME_SITE_STRICT
+            ? cookie.sameSite : COOKIE_SAME_SITE_LAX;
+        out += kSameSiteNames[sameSite];
+        out += "\"}";
+    }
+    out += "]}";
+}
+
+void AppendLegacyCookie(std::string& out, const BrowserCookie& cookie) {
+    out += cookie.name;
+    out += '=';
+    out += cookie.value;
+    if (!cookie.domain.empty()) {
+        out += "; Domain=";
+        out += cookie.domain;
+    }
+    if (!cookie.path.empty()) {
+        out += "; Path=";
+        out += cookie.path;
+    }
+    out += "; Version=0\n";
+}
+
+namespace {
+
+// Just enough JSON for cookie lists: objects of scalars, arrays of objects.
+struct JsonReader {
+    std::string_view s;
+    size_t pos = 0;
+
+    void skipSpace() {
+        while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n' || s[pos] == '\r')) pos++;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos >= s.size() || s[pos] != c) return false;
+        pos++;
+        return true;
+    }
+
+    bool peek(char c) {
+        skipSpace();
+        return pos < s.size() && s[pos] == c;
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool readHex4(unsigned& value) {
+        if (pos + 4 > s.size()) return false;
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            int h = hexValue(s[pos++]);
+            if (h < 0) return false;
+            value = value * 16 + h;
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool readString(std::string& out) {
+        out.clear();
+        if (!consume('"')) return false;
+        while (pos < s.size()) {
+            size_t run = pos;
+            while (pos < s.size() && s[pos] != '"' && s[pos] != '\\') pos++;
+            out.append(s.data() + run, pos - run);
+            if (pos >= s.size()) return false;
+            if (s[pos++] == '"') return true;
+            if (pos >= s.size()) return false;
+            char e = s[pos++];
+            switch (e) {
+            case '"': case '\\': case '/': out += e; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned cp;
+                if (!readHex4(cp)) return false;
+                if (cp >= 0xD800 && cp < 0xDC00 && pos + 6 <= s.size() && s[pos] == '\\' && s[pos + 1] == 'u') {
+                    size_t save = pos;
+                    pos += 2;
+                    unsigned lo;
+                    if (readHex4(lo) && lo >= 0xDC00 && lo < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    } else {
+                        pos = save;
+                    }
+                }
+                if (cp >= 0xD800 && cp < 0xE000) cp = 0xFFFD;
+                appendUtf8(out, cp);
+                break;
+            }
+            default: return false;
+            }
+        }
+        return false;
+    }
+
+    // The raw text of a number or literal
+    std::string_view readScalar() {
+        skipSpace();
+        size_t start = pos;
+        while (pos < s.size() && s[pos] != ',' && s[pos] != '}' && s[pos] != ']' &&
+               s[pos] != ' ' && s[pos] != '\t' && s[pos] != '\n' && s[pos] != '\r') pos++;
+        return s.substr(start, pos - start);
+    }
+
+    bool skipValue(int depth = 0) {
+        if (depth > 32) return false;
+        skipSpace();
+        if (pos >= s.size()) return false;
+        std::string scratch;
+        if (s[pos] == '"') return readString(scratch);
+        char open = s[pos];
+        if (open != '{' && open != '[') return !readScalar().empty();
+        char close = open == '{' ? '}' : ']';
+        pos++;
+        if (consume(close)) return true;
+        do {
+            if (open == '{' && (!readString(scratch) || !consume(':'))) return false;
+            if (!skipValue(depth + 1)) return false;
+        } while (consume(','));
+        return consume(close);
+    }
+};
+
+} // namespace
+
+static bool ParseNumber(std::string_view text, double& value) {
+    char buf[48];
+    if (text.empty() || text.size() >= sizeof(buf)) return false;
+    memcpy(buf, text.data(), text.size());
+    buf[text.size()] = 0;
+    char* end = nullptr;
+    value = strtod(buf, &end);
+    return end == buf + text.size();
+}
+
+static bool ParseBool(std::string_view text, bool& value) {
+    if (text == "true" || text == "1") value = true;
+    else if (text == "false" || text == "0") value = false;
+    else return false;
+    return true;
+}
+
+static int ParseSameSite(const std::string& name) {
+    for (int i = COOKIE_SAME_SITE_NONE; i <= COOKIE_SAME_SITE_STRICT; i++) {
+        const char* known = kSameSiteNames[i];
+        if (name.size() != strlen(known)) continue;
+        size_t j = 0;
+        while (j < name.size() && (name[j] | 0x20) == (known[j] | 0x20)) j++;
+        if (j == name.size()) return i;
+    }
+    return COOKIE_SAME_SITE_LAX;
+}
+
+static bool ReadCookie(JsonReader& r, BrowserCookie& cookie) {
+    if (!r.consume('{')) return false;
+    if (r.consume('}')) return true;
+    std::string key, text;
+    do {
+        if (!r.readString(key) || !r.consume(':')) return false;
+        bool ok = true;
+        if (r.peek('n')) ok = r.readScalar() == "null";  // keep the default
+        else if (key == "name") ok = r.readString(cookie.name);
+        else if (key == "value") ok = r.readString(cookie.value);
+        else if (key == "domain") ok = r.readString(cookie.domain);
+        else if (key == "path") ok = r.readString(cookie.path);
+        else if (key == "expires") ok = ParseNumber(r.readScalar(), cookie.expires);
+        else if (key == "secure") ok = ParseBool(r.readScalar(), cookie.secure);
+        else if (key == "httpOnly") ok = ParseBool(r.readScalar(), cookie.httpOnly);
+        else if (key == "sameSite") {
+            if (r.peek('"')) {
+                ok = r.readString(text);
+                cookie.sameSite = ParseSameSite(text);
+            } else {
+                double v = 0;
+                ok = ParseNumber(r.readScalar(), v) && v >= COOKIE_SAME_SITE_NONE && v <= COOKIE_SAME_SITE_STRICT;
+                cookie.sameSite = static_cast<int>(v);
+            }
+        } else {
+            ok = r.skipValue();
+        }
+        if (!ok) return false;
+    } while (r.consume(','));
+    return r.consume('}');
+}
+
+static bool ReadCookieArray(JsonReader& r, std::vector<BrowserCookie>& cookies) {
+    if (!r.consume('[')) return false;
+    if (r.consume(']')) return true;
+    do {
+        cookies.emplace_back();
+        if (!ReadCookie(r, cookies.back())) return false;
+    } while (r.consume(','));
+    return r.consume(']');
+}
+
+bool ParseCookiesJson(std::string_view json, std::vector<BrowserCookie>& cookies) {
+    JsonReader r{json};
+    if (r.peek('[')) {
+        if (!ReadCookieArray(r, cookies)) return false;
+    } else {
+        if (!r.consume('{')) return false;
+        if (!r.consume('}')) {
+            std::string key;
+            do {
+                if (!r.readString(key) || !r.consume(':')) return false;
+                if (!(key == "cookies" ? ReadCookieArray(r, cookies) : r.skipValue())) return false;
+            } while (r.consume(','));
+            if (!r.consume('}')) return false;
+        }
+    }
+    r.skipSpace();
+    return r.pos == json.size();
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include "BrowserBackend.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Cookie lists as exchanged with Unity by _CWebViewPlugin_GetCookieSnapshot
+// and _CWebViewPlugin_SetCookies:
+//
+//   {"cookies":[{"name":"sid","value":"abc","domain":".example.com",
+//     "path":"/","expires":1767225600,"secure":true,"httpOnly":true,
+//     "sameSite":"Lax"},...]}
+//
+// This is the shape JsonUtility reads and writes for WebViewObject.CookieList.
+// expires is seconds since 1970, -1 for a session cookie; sameSite is
+// "None", "Lax" or "Strict".
+
+void AppendCookiesJson(std::string& out, const std::vector<BrowserCookie>& cookies);
+
+// Reads the form above, or a bare array of cookies. Missing fields keep
+// their BrowserCookie defaults and unknown ones are skipped; returns false
+// for malformed JSON.
+bool ParseCookiesJson(std::string_view json, std::vector<BrowserCookie>& cookies);
+
+// One "name=value; Domain=...; Path=...; Version=0\n" line of the
+// CallOnCookies text.
+void AppendLegacyCookie(std::string& out, const BrowserCookie& cookie);
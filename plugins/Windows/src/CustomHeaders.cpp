@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "CustomHeaders.h"
+#include "TextConvert.h"
+
+void CustomHeaders::set(const char* key, const char* value) {
+    if (!key || !value) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_headers[key] = value;
+    rebuild();
+}
+
+void CustomHeaders::remove(const char* key) {
+    if (!key) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_headers.erase(key)) rebuild();
+}
+
+bool CustomHeaders::get(const char* key, std::string& value) {
+    if (!key) return false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_headers.find(key);
+    if (it == m_headers.end()) return false;
+    value = it->second;
+    return true;
+}
+
+void CustomHeaders::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_headers.clear();
+    m_wide.clear();
+}
+
+void CustomHeaders::copyFrom(CustomHeaders& other) {
+    if (&other == this) return;
+    std::map<std::string, std::string> headers;
+    std::vector<std::pair<std::wstring, std::wstring>> wide;
+    {
+        std::lock_guard<std::mutex> lock(other.m_mutex);
+        headers = other.m_headers;
+        wide = other.m_wide;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_headers = std::move(headers);
+    m_wide = std::move(wide);
+}
+
+void CustomHeaders::rebuild() {
+    m_wide.clear();
+    m_wide.reserve(m_headers.size());
+    for (const auto& pair : m_headers)
+        m_wide.emplace_back(Utf8ToWide(pair.first.c_str()), Utf8ToWide(pair.second.c_str()));
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Headers added to every request via _CWebViewPlugin_AddCustomHeader. The
+// UTF-16 forms WebView2 wants are converted once per change rather than on
+// every request.
+class CustomHeaders {
+public:
+    void set(const char* key, const char* value);
+    void remove(const char* key);
+    bool get(const char* key, std::string& value);
+    void clear();
+    // Replaces these headers with a copy of other's
+    void copyFrom(CustomHeaders& other);
+
+    // Calls apply(name, value) for each header, under the lock.
+    template <typename F>
+    void forEach(F&& apply) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& header : m_wide)
+            apply(header.first.c_str(), header.second.c_str());
+    }
+
+private:
+    void rebuild();
+
+    std::map<std::string, std::string> m_headers;
+    std::vector<std::pair<std::wstring, std::wstring>> m_wide;
+    std::mutex m_mutex;
+};
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "FrameBufferPool.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// Free buffers kept per size class before extra ones go back to the OS
+static const size_t kMaxCachedPerClass = 4;
+static const size_t kMinClass = 64 * 1024;
+
+FrameBufferPool& FrameBufferPool::instance() {
+    // Never destroyed; buffers may still be released during DLL unload
+    static FrameBufferPool* pool = new FrameBufferPool();
+    return *pool;
+}
+
+void FrameBufferPool::configure(size_t memoryCap, bool largePages) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memoryCap = memoryCap;
+    m_largePages = largePages;
+    if (m_memoryCap) trimLocked(m_memoryCap);
+}
+
+size_t FrameBufferPool::sizeClass(size_t size) {
+    size_t cls = kMinClass;
+    while (cls < size) {
+        size_t mid = cls + cls / 2;
+        if (mid >= size) return mid;
+        cls *= 2;
+    }
+    return cls;
+}
+
+// Size rounded up to whole large pages, or 0 when that would waste more
+// than an eighth of it (small classes stay on normal pages)
+static size_t LargePageSize(size_t size, size_t large) {
+    if (!large) return 0;
+    size_t rounded = (size + large - 1) / large * large;
+    return rounded - size <= size / 8 ? rounded : 0;
+}
+
+uint8_t* FrameBufferPool::systemAlloc(size_t size) {
+#ifdef _WIN32
+    if (m_largePages) {
+        if (size_t rounded = LargePageSize(size, GetLargePageMinimum())) {
+            void* p = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (p) {
+                m_stats.largePageAllocations++;
+                return static_cast<uint8_t*>(p);
+            }
+        }
+    }
+    return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+#ifdef __linux__
+    // madvise needs a page-aligned range; a huge-page aligned one lets the
+    // whole buffer be backed by transparent huge pages
+    const size_t kHugePage = 2 * 1024 * 1024;
+    if (m_largePages) {
+        if (size_t rounded = LargePageSize(size, kHugePage)) {
+            void* p = std::aligned_alloc(kHugePage, rounded);
+            if (p && madvise(p, rounded, MADV_HUGEPAGE) == 0) m_stats.largePageAllocations++;
+            if (p) return static_cast<uint8_t*>(p);
+        }
+    }
+#endif
+    return static_cast<uint8_t*>(std::aligned_alloc(64, size));
+#endif
+}
+
+void FrameBufferPool::systemFree(uint8_t* data, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(data, 0, MEM_RELEASE);
+#else
+    (void)size;
+    std::free(data);
+#endif
+}
+
+void FrameBufferPool::trimLocked(size_t target) {
+    for (auto it = m_free.rbegin(); it != m_free.rend(); ++it) {
+        auto& list = it->second;
+        while (!list.empty() && m_stats.bytesInUse + m_stats.bytesCached > target) {
+            systemFree(list.back(), it->first);
+            list.pop_back();
+            m_stats.bytesCached -= it->first;
+        }
+    }
+}
+
+uint8_t* FrameBufferPool::acquire(size_t size, size_t& capacity) {
+    size_t cls = sizeClass(size);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.acquires++;
+    auto it = m_free.find(cls);
+    if (it != m_free.end() && !it->second.empty()) {
+        uint8_t* data = it->second.back();
+        it->second.pop_back();
+        m_stats.bytesCached -= cls;
+        m_stats.bytesInUse += cls;
+        m_stats.reuses++;
+        capacity = cls;
+        return data;
+    }
+    if (m_memoryCap) {
+        if (m_stats.bytesInUse + m_stats.bytesCached + cls > m_memoryCap)
+            trimLocked(m_memoryCap > cls ? m_memoryCap - cls : 0);
+        if (m_stats.bytesInUse + m_stats.bytesCached + cls > m_memoryCap) {
+            m_stats.refusals++;
+            return nullptr;
+        }
+    }
+    uint8_t* data = systemAlloc(cls);
+    if (!data) {
+        m_stats.refusals++;
+        return nullptr;
+    }
+    m_stats.systemAllocations++;
+    m_stats.bytesInUse += cls;
+    uint64_t total = m_stats.bytesInUse + m_stats.bytesCached;
+    if (total > m_stats.peakBytes) m_stats.peakBytes = total;
+    capacity = cls;
+    return data;
+}
+
+void FrameBufferPool::release(uint8_t* data, size_t capacity) {
+    if (!data) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.bytesInUse -= capacity;
+    auto& list = m_free[capacity];
+    if (list.size() >= kMaxCachedPerClass) {
+        systemFree(data, capacity);
+        return;
+    }
+    list.push_back(data);
+    m_stats.bytesCached += capacity;
+}
+
+void FrameBufferPool::trim() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    trimLocked(0);
+}
+
+FrameBufferPoolStats FrameBufferPool::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+bool FrameBuffer::resize(size_t size) {
+    if (size <= m_capacity) {
+        m_size = size;
+        return true;
+    }
+    size_t capacity = 0;
+    uint8_t* data = FrameBufferPool::instance().acquire(size, capacity);
+    if (!data) return false;
+    if (m_size) memcpy(data, m_data, m_size);
+    FrameBufferPool::instance().release(m_data, m_capacity);
+    m_data = data;
+    m_capacity = capacity;
+    m_size = size;
+    return true;
+}
+
+bool FrameBuffer::assign(const FrameBuffer& other) {
+    if (this == &other) return true;
+    m_size = 0;
+    if (!resize(other.m_size)) return false;
+    if (m_size) memcpy(m_data, other.m_data, m_size);
+    return true;
+}
+
+void FrameBuffer::release() {
+    FrameBufferPool::instance().release(m_data, m_capacity);
+    m_data = nullptr;
+    m_size = 0;
+    m_capacity = 0;
+}
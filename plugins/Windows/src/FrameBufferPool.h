@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+struct FrameBufferPoolStats {
+    uint64_t acquires;           // buffers handed out
+    uint64_t reuses;             // ...of which came from the free lists
+    uint64_t systemAllocations;  // fresh allocations from the OS
+    uint64_t largePageAllocations;
+    uint64_t refusals;           // requests over the memory cap
+    uint64_t bytesInUse;
+    uint64_t bytesCached;        // held in the free lists
+    uint64_t peakBytes;          // high-water mark of in use + cached
+};
+
+// Process-wide pool of 64-byte aligned frame buffers, bucketed by size class
+// (powers of two and the midpoints between them, 64KB and up) and recycled
+// across instances so that resizes do not fragment the heap.
+class FrameBufferPool {
+public:
+    static FrameBufferPool& instance();
+
+    // memoryCap limits in use + cached bytes (0: unlimited). largePages
+    // backs new buffers with large pages where the OS allows it.
+    void configure(size_t memoryCap, bool largePages);
+
+    // Returns nullptr when the cap would be exceeded even after dropping the
+    // free lists. capacity receives the size class actually reserved.
+    uint8_t* acquire(size_t size, size_t& capacity);
+    void release(uint8_t* data, size_t capacity);
+
+    // Returns every cached buffer to the OS.
+    void trim();
+
+    FrameBufferPoolStats stats();
+
+private:
+    FrameBufferPool() = default;
+    static size_t sizeClass(size_t size);
+    uint8_t* systemAlloc(size_t size);
+    static void systemFree(uint8_t* data, size_t size);
+    void trimLocked(size_t target);
+
+    std::mutex m_mutex;
+    std::map<size_t, std::vector<uint8_t*>> m_free;
+    size_t m_memoryCap = 0;
+    bool m_largePages = false;
+    FrameBufferPoolStats m_stats = {};
+};
+
+// Pooled replacement for std::vector<uint8_t> frame storage. Growing keeps
+// the existing contents; bytes past them are left uninitialised.
+class FrameBuffer {
+public:
+    FrameBuffer() = default;
+    ~FrameBuffer() { release(); }
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    uint8_t* data() { return m_data; }
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    // Returns false (leaving the buffer unchanged) when the pool refuses.
+    bool resize(size_t size);
+    bool assign(const FrameBuffer& other);
+    void clear() { m_size = 0; }
+    // Hands the memory back to the pool.
+    void release();
+
+private:
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+};
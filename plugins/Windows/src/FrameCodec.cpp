@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "FrameCodec.h"
+
+#include <cstring>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static const size_t kMinMatch = 4;
+static const size_t kLastLiterals = 8;  // the tail is always stored as literals
+static const size_t kMaxOffset = 65535;
+static const int kHashBits = 14;
+static const uint32_t kNoEntry = 0xFFFFFFFFu;
+
+static inline uint32_t Read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t Read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint32_t HashSequence(uint32_t v) {
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+static inline size_t TrailingZeroBytes(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return index / 8;
+#else
+    return static_cast<size_t>(__builtin_ctzll(v)) / 8;
+#endif
+}
+
+// Length of the common prefix of a and b, at most limit bytes. Assumes a
+// little-endian target, as everything this plugin runs on is.
+static size_t MatchLength(const uint8_t* a, const uint8_t* b, size_t limit) {
+    size_t n = 0;
+    while (n + 8 <= limit) {
+        uint64_t diff = Read64(a + n) ^ Read64(b + n);
+        if (diff) return n + TrailingZeroBytes(diff);
+        n += 8;
+    }
+    while (n < limit && a[n] == b[n]) n++;
+    return n;
+}
+
+static uint8_t* WriteLength(uint8_t* op, size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+// Emits one sequence: literals followed by a match (matchLength 0 for the
+// final, literal-only sequence).
+static uint8_t* WriteSequence(uint8_t* op, const uint8_t* literals, size_t literalLength,
+                              size_t offset, size_t matchLength) {
+    uint8_t* token = op++;
+    size_t matchCode = matchLength ? matchLength - kMinMatch : 0;
+    *token = static_cast<uint8_t>(((literalLength < 15 ? literalLength : 15) << 4) |
+                                  (matchCode < 15 ? matchCode : 15));
+    if (literalLength >= 15) op = WriteLength(op, literalLength - 15);
+    if (literalLength) memcpy(op, literals, literalLength);
+    op += literalLength;
+    if (!matchLength) return op;
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    if (matchCode >= 15) op = WriteLength(op, matchCode - 15);
+    return op;
+}
+
+size_t PackedFrameBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t PackFrameData(const uint8_t* src, size_t size, uint8_t* dst) {
+    uint8_t* op = dst;
+    size_t anchor = 0;
+    if (size > kMinMatch + kLastLiterals) {
+        std::vector<uint32_t> table(static_cast<size_t>(1) << kHashBits, kNoEntry);
+        size_t matchLimit = size - kLastLiterals;
+        size_t ip = 0;
+        size_t misses = 0;
+        while (ip + kMinMatch <= matchLimit) {
+            uint32_t sequence = Read32(src + ip);
+            uint32_t& slot = table[HashSequence(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(ip);
+            if (candidate == kNoEntry || ip - candidate > kMaxOffset ||
+                Read32(src + candidate) != sequence) {
+                // Skip ahead faster through incompressible data
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            // Extend the match backwards over pending literals, then forwards
+            while (ip > anchor && candidate > 0 && src[ip - 1] == src[candidate - 1]) {
+                ip--;
+                candidate--;
+            }
+            size_t length = MatchLength(src + ip, src + candidate, matchLimit - ip);
+            op = WriteSequence(op, src + anchor, ip - anchor, ip - candidate, length);
+            ip += length;
+            anchor = ip;
+            if (ip - 2 + kMinMatch <= matchLimit)
+                table[HashSequence(Read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2);
+        }
+    }
+    return WriteSequence(op, src + anchor, size - anchor, 0, 0) - dst;
+}
+
+static bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+    uint8_t b;
+    do {
+        if (ip >= end) return false;
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+bool UnpackFrameData(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+    const uint8_t* ip = src;
+    const uint8_t* end = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* dstEnd = dst + dstSize;
+    for (;;) {
+        if (ip >= end) return false;
+        uint8_t token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(ip, end, literalLength)) return false;
+        if (literalLength > static_cast<size_t>(end - ip) ||
+            literalLength > static_cast<size_t>(dstEnd - op))
+            return false;
+        if (literalLength) memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+        if (ip == end) return op == dstEnd;
+
+        if (end - ip < 2) return false;
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) return false;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(ip, end, matchLength)) return false;
+        matchLength += kMinMatch;
+        if (matchLength > static_cast<size_t>(dstEnd - op)) return false;
+
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+        } else {
+            // Overlapping match repeats the last offset bytes; copy whole
+            // periods, doubling the chunk each time
+            size_t done = 0;
+            while (done < matchLength) {
+                size_t n = done + offset;
+                if (n > matchLength - done) n = matchLength - done;
+                memcpy(op + done, match, n);
+                done += n;
+            }
+        }
+        op += matchLength;
+    }
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Byte-oriented LZ77 codec (LZ4-style token/literal/match sequences) for
+// parking the frames of hidden instances. It favours speed over ratio:
+// flat and repeated areas, common on web pages, shrink by orders of
+// magnitude while photographic content stays close to its raw size.
+
+// Upper bound of PackFrameData's output for size input bytes.
+size_t PackedFrameBound(size_t size);
+
+// Compresses size bytes of src into dst, which must hold at least
+// PackedFrameBound(size) bytes. Returns the number of bytes written.
+size_t PackFrameData(const uint8_t* src, size_t size, uint8_t* dst);
+
+// Restores exactly dstSize bytes; returns false on malformed or truncated
+// input without writing past dst + dstSize.
+bool UnpackFrameData(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
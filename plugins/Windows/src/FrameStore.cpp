@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "FrameStore.h"
+#include "FrameCodec.h"
+#include "InstanceStats.h"
+#include "MipChain.h"
+#include "Trace.h"
+#include "WorkerPool.h"
+
+#include <cstring>
+
+void FrameStore::setFrameFormat(int format) {
+    if (format != FRAME_FORMAT_BC1 && format != FRAME_FORMAT_BC3)
+        format = FRAME_FORMAT_RGBA32;
+    m_frameFormat.store(format);
+}
+
+void FrameStore::setMipChain(bool enabled, bool gammaCorrect) {
+    m_mipSrgb.store(gammaCorrect);
+    m_mipChain.store(enabled);
+}
+
+// Bytes a frame of the given layout occupies in the texture Unity allocated
+static size_t LayoutSize(int layout, int w, int h) {
+    return (layout & FRAME_LAYOUT_MIPS) ? MipChainSize(w, h) : FrameDataSize(layout & 0xFF, w, h);
+}
+
+int FrameStore::requestedLayout() const {
+    int format = m_frameFormat.load();
+    if (format != FRAME_FORMAT_RGBA32 || !m_mipChain.load()) return format;
+    return format | FRAME_LAYOUT_MIPS | (m_mipSrgb.load() ? FRAME_LAYOUT_MIPS_SRGB : 0);
+}
+
+uint8_t* FrameStore::beginFrame(int width, int height) {
+    if (width <= 0 || height <= 0) return nullptr;
+    int target;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        target = 1 - m_current;
+    }
+    // Latched so that a layout change while the frame is written cannot
+    // give it a size that does not match the layout it is tagged with
+    int layout = requestedLayout();
+    size_t size = (layout & FRAME_LAYOUT_MIPS) ? MipChainSize(width, height)
+                                               : static_cast<size_t>(width) * height * 4;
+    if (!m_bitmaps[target].resize(size)) {
+        InstanceStats::bump(m_stats.framesRefused);
+        m_target = -1;
+        return nullptr;
+    }
+    m_target = target;
+    m_targetWidth = width;
+    m_targetHeight = height;
+    m_targetLayout = layout;
+    return m_bitmaps[target].data();
+}
+
+bool FrameStore::commitFrame() {
+    if (m_target < 0) return false;
+    int target = m_target;
+    m_target = -1;
+    if (!processFrame(target, m_targetWidth, m_targetHeight, m_targetLayout)) return false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_width = m_targetWidth;
+    m_height = m_targetHeight;
+    m_current = target;
+    m_needsDisplay = true;
+    return true;
+}
+
+bool FrameStore::relayout() {
+    if (m_parked.load()) return false;
+    int current, w, h;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        current = m_current;
+        w = m_width;
+        h = m_height;
+    }
+    if (w <= 0 || h <= 0 || m_layouts[current] == requestedLayout()) return false;
+    // beginFrame only touches the back buffer, so level 0 of the displayed
+    // frame stays put while it is copied
+    uint8_t* dst = beginFrame(w, h);
+    if (!dst) return false;
+    memcpy(dst, m_bitmaps[current].data(), static_cast<size_t>(w) * h * 4);
+    return commitFrame();
+}
+
+// Completes m_bitmaps[target], whose level 0 is already written, for the
+// layout latched by beginFrame: appends the mip chain or encodes
+// m_blocks[target]. Regions unchanged since the displayed frame are copied
+// from it instead of being processed again. Returns false if the frame is
+// identical to the displayed one and need not be uploaded again.
+bool FrameStore::processFrame(int target, int w, int h, int layout) {
+    WEBVIEW_TRACE_SCOPE_ARG("ProcessFrame", layout);
+    m_layouts[target] = layout;
+    if (layout == FRAME_FORMAT_RGBA32) {
+        m_bitmaps[target].resize(static_cast<size_t>(w) * h * 4);
+        m_blocks[target].release();
+        return true;
+    }
+    if (layout & FRAME_LAYOUT_MIPS) {
+        if (!m_bitmaps[target].resize(MipChainSize(w, h))) {
+            InstanceStats::bump(m_stats.framesRefused);
+            return false;
+        }
+        m_blocks[target].release();
+    }
+
+    int current, curW, curH;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        current = m_current;
+        curW = m_width;
+        curH = m_height;
+    }
+    WorkerPool* pool = &WorkerPool::instance();
+    const uint8_t* dirty = nullptr;
+    if (current != target && curW == w && curH == h && m_layouts[current] == layout) {
+        if (DiffFrameBlocks(m_bitmaps[current].data(), m_bitmaps[target].data(),
+                            w, h, m_dirtyBlocks, pool) == 0) {
+            InstanceStats::bump(m_stats.framesUnchanged);
+            return false;
+        }
+        dirty = m_dirtyBlocks.data();
+    }
+
+    if (layout & FRAME_LAYOUT_MIPS) {
+        MipRect rect;
+        bool partial = dirty && DirtyBlocksToRect(m_dirtyBlocks, w, h, rect);
+        BuildMipChain(m_bitmaps[target].data(), w, h, (layout & FRAME_LAYOUT_MIPS_SRGB) != 0,
+                      partial ? m_bitmaps[current].data() : nullptr,
+                      partial ? &rect : nullptr, pool);
+        return true;
+    }
+
+    bool ok = dirty ? m_blocks[target].assign(m_blocks[current])
+                    : m_blocks[target].resize(FrameDataSize(layout, w, h));
+    if (!ok) {
+        InstanceStats::bump(m_stats.framesRefused);
+        return false;
+    }
+    CompressFrame(layout, m_bitmaps[target].data(), w, h, m_blocks[target].data(), dirty, pool);
+    return true;
+}
+
+int FrameStore::width() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_width;
+}
+
+int FrameStore::height() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_height;
+}
+
+void FrameStore::render(void* textureBuffer) {
+    WEBVIEW_TRACE_SCOPE("Render");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_needsDisplay) return;
+    // The caller sized textureBuffer for the layout it requested; skip
+    // frames produced before a format or mip chain change
+    int layout = m_layouts[m_current];
+    if (layout != requestedLayout()) return;
+    const FrameBuffer& frame = (layout & 0xFF) != FRAME_FORMAT_RGBA32
+        ? m_blocks[m_current] : m_bitmaps[m_current];
+    size_t size = LayoutSize(layout, m_width, m_height);
+    if (size == 0 || frame.size() < size) return;
+    m_needsDisplay = false;
+    uint64_t start = InstanceStats::nowMicros();
+    memcpy(textureBuffer, frame.data(), size);
+    m_stats.renderTime.record(InstanceStats::nowMicros() - start);
+    InstanceStats::bump(m_stats.framesRendered);
+    InstanceStats::bump(m_stats.bytesRendered, size);
+}
+
+long long FrameStore::park() {
+    if (m_parked.exchange(true)) return 0;
+    WEBVIEW_TRACE_SCOPE("ParkFrame");
+    // Producers are out and render only reads, so no lock is needed while
+    // compressing
+    int current = m_current;
+    const FrameBuffer& bitmap = m_bitmaps[current];
+    const FrameBuffer& blocks = m_blocks[current];
+    m_parkedBitmapSize = bitmap.size();
+    m_parkedBlocksSize = blocks.size();
+    m_parkedFrame.resize(PackedFrameBound(bitmap.size()) + PackedFrameBound(blocks.size()));
+    m_parkedBitmapPacked = PackFrameData(bitmap.data(), bitmap.size(), m_parkedFrame.data());
+    size_t packed = m_parkedBitmapPacked +
+        PackFrameData(blocks.data(), blocks.size(), m_parkedFrame.data() + m_parkedBitmapPacked);
+    m_parkedFrame.resize(packed);
+    m_parkedFrame.shrink_to_fit();
+
+    long long released = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_needsDisplay = false;
+        for (int i = 0; i < 2; i++) {
+            released += m_bitmaps[i].size() + m_blocks[i].size();
+            m_bitmaps[i].release();
+            m_blocks[i].release();
+        }
+    }
+    released += m_dirtyBlocks.capacity();
+    std::vector<uint8_t>().swap(m_dirtyBlocks);
+    // Let the released buffers go back to the OS instead of the free lists
+    FrameBufferPool::instance().trim();
+    return released - static_cast<long long>(packed);
+}
+
+void FrameStore::unpark() {
+    if (!m_parked.load()) return;
+    WEBVIEW_TRACE_SCOPE("UnparkFrame");
+    int current = m_current;
+    const uint8_t* packed = m_parkedFrame.data();
+    bool restored = m_bitmaps[current].resize(m_parkedBitmapSize) &&
+        m_blocks[current].resize(m_parkedBlocksSize) &&
+        UnpackFrameData(packed, m_parkedBitmapPacked,
+                        m_bitmaps[current].data(), m_parkedBitmapSize) &&
+        UnpackFrameData(packed + m_parkedBitmapPacked, m_parkedFrame.size() - m_parkedBitmapPacked,
+                        m_blocks[current].data(), m_parkedBlocksSize);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (restored) {
+            m_needsDisplay = m_parkedBitmapSize > 0;
+        } else {
+            // Out of frame memory; start over from the next frame
+            m_bitmaps[current].release();
+            m_blocks[current].release();
+            m_width = 0;
+            m_height = 0;
+        }
+    }
+    std::vector<uint8_t>().swap(m_parkedFrame);
+    m_parked.store(false);
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include "BlockCompressor.h"
+#include "FrameBufferPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class InstanceStats;
+
+// Layout of a produced frame: a FrameFormat in the low byte plus these flags
+enum {
+    FRAME_LAYOUT_MIPS = 0x100,
+    FRAME_LAYOUT_MIPS_SRGB = 0x200,
+};
+
+// Double-buffered frames handed from a capture backend to Unity. Producers
+// write RGBA level 0 into the back buffer; commitFrame then builds the
+// requested layout (BC blocks or a mip chain), processing only what changed
+// since the displayed frame, and swaps it in for render.
+//
+// One producer at a time: callers serialise beginFrame/commitFrame and
+// park/unpark among themselves. render may run concurrently on any thread.
+class FrameStore {
+public:
+    explicit FrameStore(InstanceStats& stats) : m_stats(stats) {}
+
+    void setFrameFormat(int format);
+    void setMipChain(bool enabled, bool gammaCorrect);
+    int requestedLayout() const;
+
+    // Returns the back buffer sized for a width x height frame, to be filled
+    // with tightly packed RGBA rows, or nullptr when the frame buffer pool
+    // refuses the memory.
+    uint8_t* beginFrame(int width, int height);
+    // Completes and publishes the frame begun last. Returns false if it was
+    // identical to the displayed one or could not be processed.
+    bool commitFrame();
+    // Rebuilds the displayed frame from its level 0 for the layout requested
+    // now, so a format or mip chain change shows without waiting for the page
+    // to repaint. Same rules as a producer; false if nothing was rebuilt.
+    bool relayout();
+
+    int width();
+    int height();
+    // Copies the latest frame into textureBuffer if it has not been copied
+    // yet and matches the layout currently requested.
+    void render(void* textureBuffer);
+
+    // Parking keeps only a compressed copy of the displayed frame and
+    // returns all frame memory. Producers must check parked() and stay out
+    // while parked. park returns the bytes saved.
+    bool parked() const { return m_parked.load(); }
+    long long park();
+    // Restores the parked frame and marks it for display.
+    void unpark();
+
+private:
+    bool processFrame(int target, int w, int h, int layout);
+
+    InstanceStats& m_stats;
+    std::mutex m_mutex;
+    FrameBuffer m_bitmaps[2];
+    int m_current = 0;
+    int m_width = 0;
+    int m_height = 0;
+    bool m_needsDisplay = false;
+
+    // Optional BC1/BC3 output encoded from the RGBA frames above, or an RGBA
+    // mip chain appended to them; between frames of the same size only the
+    // changed 4x4 blocks (and the mip areas above them) are processed again
+    std::atomic<int> m_frameFormat{FRAME_FORMAT_RGBA32};
+    std::atomic<bool> m_mipChain{false};
+    std::atomic<bool> m_mipSrgb{false};
+    FrameBuffer m_blocks[2];
+    int m_layouts[2] = {FRAME_FORMAT_RGBA32, FRAME_FORMAT_RGBA32};
+    std::vector<uint8_t> m_dirtyBlocks;
+
+    int m_target = -1;
+    int m_targetWidth = 0;
+    int m_targetHeight = 0;
+    int m_targetLayout = FRAME_FORMAT_RGBA32;
+
+    std::atomic<bool> m_parked{false};
+    std::vector<uint8_t> m_parkedFrame;
+    size_t m_parkedBitmapPacked = 0;
+    size_t m_parkedBitmapSize = 0;
+    size_t m_parkedBlocksSize = 0;
+};
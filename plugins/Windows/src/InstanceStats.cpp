@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "InstanceStats.h"
+
+#include <chrono>
+#include <cstdio>
+
+static int BucketOf(uint64_t micros) {
+    int bucket = 0;
+    while (micros && bucket < WEBVIEW_HISTOGRAM_BUCKETS - 1) {
+        micros >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void InstanceStats::Histogram::record(uint64_t micros) {
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_totalMicros.fetch_add(micros, std::memory_order_relaxed);
+    m_buckets[BucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    raise(m_maxMicros, micros);
+}
+
+void InstanceStats::Histogram::snapshot(WebViewHistogram& out) const {
+    out.count = m_count.load(std::memory_order_relaxed);
+    out.totalMicros = m_totalMicros.load(std::memory_order_relaxed);
+    out.maxMicros = m_maxMicros.load(std::memory_order_relaxed);
+    for (int i = 0; i < WEBVIEW_HISTOGRAM_BUCKETS; i++)
+        out.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+}
+
+uint64_t InstanceStats::nowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void InstanceStats::raise(std::atomic<uint64_t>& peak, uint64_t value) {
+    uint64_t seen = peak.load(std::memory_order_relaxed);
+    while (value > seen &&
+           !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void InstanceStats::messageQueued(size_t depth) {
+    m_messagesQueued.fetch_add(1, std::memory_order_relaxed);
+    m_messageQueueDepth.store(depth, std::memory_order_relaxed);
+    raise(m_messageQueuePeak, depth);
+}
+
+void InstanceStats::messageDequeued(size_t depth) {
+    m_messageQueueDepth.store(depth, std::memory_order_relaxed);
+}
+
+void InstanceStats::commandPosted(uint64_t postedMicros) {
+    uint64_t n = m_commandsPosted.fetch_add(1, std::memory_order_relaxed);
+    size_t slot = n % kPostRing;
+    m_postTimes[slot].store(postedMicros, std::memory_order_relaxed);
+    m_postTags[slot].store(n + 1, std::memory_order_release);
+    uint64_t handled = m_commandsHandled.load(std::memory_order_relaxed);
+    if (n + 1 > handled) raise(m_commandQueuePeak, n + 1 - handled);
+}
+
+void InstanceStats::commandHandled() {
+    uint64_t n = m_commandsHandled.fetch_add(1, std::memory_order_relaxed);
+    size_t slot = n % kPostRing;
+    // A mismatched tag means the stamp was not written yet or was overrun;
+    // the sample is skipped rather than attributed to the wrong command
+    if (m_postTags[slot].load(std::memory_order_acquire) != n + 1) return;
+    uint64_t posted = m_postTimes[slot].load(std::memory_order_relaxed);
+    uint64_t now = nowMicros();
+    commandLatency.record(now > posted ? now - posted : 0);
+}
+
+void InstanceStats::snapshot(WebViewStats& out) const {
+    out = {};
+    out.version = WEBVIEW_STATS_VERSION;
+    out.size = sizeof(WebViewStats);
+    out.framesCaptured = framesCaptured.load(std::memory_order_relaxed);
+    out.framesUnchanged = framesUnchanged.load(std::memory_order_relaxed);
+    out.framesDropped = framesDropped.load(std::memory_order_relaxed);
+    out.framesRefused = framesRefused.load(std::memory_order_relaxed);
+    out.framesRendered = framesRendered.load(std::memory_order_relaxed);
+    out.bytesRendered = bytesRendered.load(std::memory_order_relaxed);
+    out.captureRequests = captureRequests.load(std::memory_order_relaxed);
+    out.messagesQueued = m_messagesQueued.load(std::memory_order_relaxed);
+    out.messageQueueDepth = m_messageQueueDepth.load(std::memory_order_relaxed);
+    out.messageQueuePeak = m_messageQueuePeak.load(std::memory_order_relaxed);
+    out.commandsPosted = m_commandsPosted.load(std::memory_order_relaxed);
+    out.commandsHandled = m_commandsHandled.load(std::memory_order_relaxed);
+    out.commandQueuePeak = m_commandQueuePeak.load(std::memory_order_relaxed);
+    out.parkedBytesSaved = parkedBytesSaved.load(std::memory_order_relaxed);
+    out.requestsBlocked = requestsBlocked.load(std::memory_order_relaxed);
+    out.keyEvents = keyEvents.load(std::memory_order_relaxed);
+    out.textInputs = textInputs.load(std::memory_order_relaxed);
+    out.textUnits = textUnits.load(std::memory_order_relaxed);
+    out.compositionUpdates = compositionUpdates.load(std::memory_order_relaxed);
+    captureLatency.snapshot(out.captureLatency);
+    conversionTime.snapshot(out.conversionTime);
+    commandLatency.snapshot(out.commandLatency);
+    renderTime.snapshot(out.renderTime);
+    cookieSnapshotTime.snapshot(out.cookieSnapshotTime);
+    cookieSetTime.snapshot(out.cookieSetTime);
+    navigationTime.snapshot(out.navigationTime);
+    firstFrameTime.snapshot(out.firstFrameTime);
+    inputLatency.snapshot(out.inputLatency);
+}
+
+static void AppendField(std::string& json, const char* name, unsigned long long value) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\"%s\":%llu,", name, value);
+    json += buf;
+}
+
+static void AppendHistogram(std::string& json, const char* name, const WebViewHistogram& h) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "\"%s\":{\"count\":%llu,\"totalMicros\":%llu,\"maxMicros\":%llu,\"buckets\":[",
+             name, static_cast<unsigned long long>(h.count),
+             static_cast<unsigned long long>(h.totalMicros),
+             static_cast<unsigned long long>(h.maxMicros));
+    json += buf;
+    for (int i = 0; i < WEBVIEW_HISTOGRAM_BUCKETS; i++) {
+        snprintf(buf, sizeof(buf), i ? ",%llu" : "%llu", static_cast<unsigned long long>(h.buckets[i]));
+        json += buf;
+    }
+    json += "]},";
+}
+
+std::string WebViewStatsToJson(const WebViewStats& s) {
+    std::string json = "{";
+    AppendField(json, "version", s.version);
+    AppendField(json, "framesCaptured", s.framesCaptured);
+    AppendField(json, "framesUnchanged", s.framesUnchanged);
+    AppendField(json, "framesDropped", s.framesDropped);
+    AppendField(json, "framesRefused", s.framesRefused);
+    AppendField(json, "framesRendered", s.framesRendered);
+    AppendField(json, "bytesRendered", s.bytesRendered);
+    AppendField(json, "captureRequests", s.captureRequests);
+    AppendField(json, "messagesQueued", s.messagesQueued);
+    AppendField(json, "messageQueueDepth", s.messageQueueDepth);
+    AppendField(json, "messageQueuePeak", s.messageQueuePeak);
+    AppendField(json, "commandsPosted", s.commandsPosted);
+    AppendField(json, "commandsHandled", s.commandsHandled);
+    AppendField(json, "commandQueuePeak", s.commandQueuePeak);
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\"parkedBytesSaved\":%lld,", static_cast<long long>(s.parkedBytesSaved));
+    json += buf;
+    AppendField(json, "frameBufferBytesInUse", s.frameBufferBytesInUse);
+    AppendField(json, "frameBufferBytesCached", s.frameBufferBytesCached);
+    AppendHistogram(json, "captureLatency", s.captureLatency);
+    AppendHistogram(json, "conversionTime", s.conversionTime);
+    AppendHistogram(json, "commandLatency", s.commandLatency);
+    AppendHistogram(json, "renderTime", s.renderTime);
+    AppendField(json, "responseCacheHits", s.responseCacheHits);
+    AppendField(json, "responseCacheMisses", s.responseCacheMisses);
+    AppendField(json, "responseCacheEvictions", s.responseCacheEvictions);
+    AppendField(json, "responseCacheBytes", s.responseCacheBytes);
+    AppendField(json, "responseCacheEntries", s.responseCacheEntries);
+    AppendField(json, "requestsBlocked", s.requestsBlocked);
+    AppendField(json, "channelQueueDepth", s.channelQueueDepth);
+    AppendField(json, "channelMessagesDropped", s.channelMessagesDropped);
+    AppendHistogram(json, "cookieSnapshotTime", s.cookieSnapshotTime);
+    AppendHistogram(json, "cookieSetTime", s.cookieSetTime);
+    AppendHistogram(json, "navigationTime", s.navigationTime);
+    AppendHistogram(json, "firstFrameTime", s.firstFrameTime);
+    AppendField(json, "keyEvents", s.keyEvents);
+    AppendField(json, "textInputs", s.textInputs);
+    AppendField(json, "textUnits", s.textUnits);
+    AppendField(json, "compositionUpdates", s.compositionUpdates);
+    AppendHistogram(json, "inputLatency", s.inputLatency);
+    json.back() = '}';
+    return json;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define WEBVIEW_STATS_VERSION 7
+
+// Log2 latency buckets: bucket i counts samples below 2^i microseconds
+// (bucket 0: under 1us); the last bucket is open-ended (262ms and up).
+enum { WEBVIEW_HISTOGRAM_BUCKETS = 20 };
+
+struct WebViewHistogram {
+    uint64_t count;
+    uint64_t totalMicros;
+    uint64_t maxMicros;
+    uint64_t buckets[WEBVIEW_HISTOGRAM_BUCKETS];
+};
+
+// Fixed-layout snapshot returned by _CWebViewPlugin_GetStats. Only ever
+// extended at the end; size lets callers detect older layouts.
+struct WebViewStats {
+    uint32_t version;
+    uint32_t size;
+    uint64_t framesCaptured;     // frames made ready for display
+    uint64_t framesUnchanged;    // identical to the displayed frame, skipped
+    uint64_t framesDropped;      // arrived while busy or hidden
+    uint64_t framesRefused;      // frame buffer pool at its memory cap
+    uint64_t framesRendered;     // frames copied out by render
+    uint64_t bytesRendered;
+    uint64_t captureRequests;    // CapturePreview fallback requests
+    uint64_t messagesQueued;     // messages for Unity
+    uint64_t messageQueueDepth;
+    uint64_t messageQueuePeak;
+    uint64_t commandsPosted;     // commands to the host thread
+    uint64_t commandsHandled;
+    uint64_t commandQueuePeak;
+    int64_t parkedBytesSaved;
+    uint64_t frameBufferBytesInUse;   // process-wide, see FrameBufferPool
+    uint64_t frameBufferBytesCached;
+    WebViewHistogram captureLatency;   // composition or request to frame ready
+    WebViewHistogram conversionTime;   // pixel conversion and frame processing
+    WebViewHistogram commandLatency;   // post to handling on the host thread
+    WebViewHistogram renderTime;       // copy into Unity's buffer
+    // Version 2: see ResponseCache
+    uint64_t responseCacheHits;
+    uint64_t responseCacheMisses;
+    uint64_t responseCacheEvictions;
+    uint64_t responseCacheBytes;
+    uint64_t responseCacheEntries;
+    // Version 3
+    uint64_t requestsBlocked;    // answered empty by RequestBlocker
+    // Version 4: see ChannelRouter
+    uint64_t channelQueueDepth;
+    uint64_t channelMessagesDropped;
+    // Version 5
+    WebViewHistogram cookieSnapshotTime;  // GetCookieSnapshot call to result queued
+    WebViewHistogram cookieSetTime;       // SetCookies call to batch applied
+    // Version 6: see NavigationTracker; from loadURL, or NavigationStarting
+    // when the page navigated itself
+    WebViewHistogram navigationTime;      // to NavigationCompleted (successful ones)
+    WebViewHistogram firstFrameTime;      // to the first frame of the new page
+    // Version 7: keyboard input
+    uint64_t keyEvents;           // SendKeyEvent messages delivered
+    uint64_t textInputs;          // SendText calls
+    uint64_t textUnits;           // UTF-16 code units they carried
+    uint64_t compositionUpdates;  // SetComposition calls
+    WebViewHistogram inputLatency;  // call to delivery to the browser window or DevTools
+};
+
+// Live counters behind WebViewStats. Every update is a relaxed atomic, so
+// hot paths never lock and snapshots may be torn across fields (but never
+// within one).
+class InstanceStats {
+public:
+    class Histogram {
+    public:
+        void record(uint64_t micros);
+        void snapshot(WebViewHistogram& out) const;
+
+    private:
+        std::atomic<uint64_t> m_count{0};
+        std::atomic<uint64_t> m_totalMicros{0};
+        std::atomic<uint64_t> m_maxMicros{0};
+        std::atomic<uint64_t> m_buckets[WEBVIEW_HISTOGRAM_BUCKETS] = {};
+    };
+
+    static uint64_t nowMicros();
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void messageQueued(size_t depth);
+    void messageDequeued(size_t depth);
+
+    // Commands are matched to their post time by sequence number, which
+    // holds because a thread's posted messages are delivered in order.
+    void commandPosted(uint64_t postedMicros);
+    void commandHandled();
+
+    void snapshot(WebViewStats& out) const;
+
+    std::atomic<uint64_t> framesCaptured{0};
+    std::atomic<uint64_t> framesUnchanged{0};
+    std::atomic<uint64_t> framesDropped{0};
+    std::atomic<uint64_t> framesRefused{0};
+    std::atomic<uint64_t> framesRendered{0};
+    std::atomic<uint64_t> bytesRendered{0};
+    std::atomic<uint64_t> captureRequests{0};
+    std::atomic<int64_t> parkedBytesSaved{0};
+    std::atomic<uint64_t> requestsBlocked{0};
+    std::atomic<uint64_t> keyEvents{0};
+    std::atomic<uint64_t> textInputs{0};
+    std::atomic<uint64_t> textUnits{0};
+    std::atomic<uint64_t> compositionUpdates{0};
+
+    Histogram captureLatency;
+    Histogram conversionTime;
+    Histogram commandLatency;
+    Histogram renderTime;
+    Histogram cookieSnapshotTime;
+    Histogram cookieSetTime;
+    Histogram navigationTime;
+    Histogram firstFrameTime;
+    Histogram inputLatency;
+
+private:
+    static void raise(std::atomic<uint64_t>& peak, uint64_t value);
+
+    enum { kPostRing = 256 };
+
+    std::atomic<uint64_t> m_messagesQueued{0};
+    std::atomic<uint64_t> m_messageQueueDepth{0};
+    std::atomic<uint64_t> m_messageQueuePeak{0};
+    std::atomic<uint64_t> m_commandsPosted{0};
+    std::atomic<uint64_t> m_commandsHandled{0};
+    std::atomic<uint64_t> m_commandQueuePeak{0};
+    // Post time of command n in slot n % kPostRing, tagged with n + 1
+    std::atomic<uint64_t> m_postTags[kPostRing] = {};
+    std::atomic<uint64_t> m_postTimes[kPostRing] = {};
+};
+
+// Renders a snapshot as a JSON object (histograms as bucket arrays).
+std::string WebViewStatsToJson(const WebViewStats& stats);
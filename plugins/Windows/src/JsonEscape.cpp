@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "JsonEscape.h"
+
+#include <cstdint>
+
+template <typename Char>
+static void AppendEscaped(std::basic_string<Char>& out, std::basic_string_view<Char> s) {
+    static const char kHex[] = "0123456789abcdef";
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); i++) {
+        // Bytes of multi-byte sequences are negative as char; only the
+        // ASCII values below matter
+        uint32_t c = static_cast<uint32_t>(s[i]);
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+        out.append(s.data() + run, i - run);
+        run = i + 1;
+        out += static_cast<Char>('\\');
+        if (c < 0x20) {
+            out += static_cast<Char>('u');
+            out += static_cast<Char>('0');
+            out += static_cast<Char>('0');
+            out += static_cast<Char>(kHex[c >> 4]);
+            out += static_cast<Char>(kHex[c & 15]);
+        } else {
+            out += s[i];
+        }
+    }
+    out.append(s.data() + run, s.size() - run);
+}
+
+void AppendJsonEscaped(std::string& out, std::string_view s) {
+    AppendEscaped(out, s);
+}
+
+void AppendJsonEscaped(std::wstring& out, std::wstring_view s) {
+    AppendEscaped(out, s);
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Appends s as the inside of a JSON string: '"', '\\' and control
+// characters are escaped, everything else (including UTF-8 or UTF-16
+// sequences) is copied as is. Runs that need no escaping go in one append.
+void AppendJsonEscaped(std::string& out, std::string_view s);
+void AppendJsonEscaped(std::wstring& out, std::wstring_view s);
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "LifecycleManager.h"
+
+#include <cstdio>
+
+static const char* const kStateNames[LIFECYCLE_STATE_COUNT] = {
+    "visible", "hidden", "parked", "lowMemory", "suspended",
+};
+
+LifecycleManager& LifecycleManager::instance() {
+    // Never destroyed; instances may still unregister during DLL unload
+    static LifecycleManager* manager = new LifecycleManager();
+    return *manager;
+}
+
+void LifecycleManager::setPolicy(const LifecyclePolicy& policy) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_policy = policy;
+    if (!m_policy.memoryBudget) m_stats.memoryBytes = 0;
+}
+
+LifecyclePolicy LifecycleManager::policy() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_policy;
+}
+
+bool LifecycleManager::hasBudget() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_policy.memoryBudget != 0;
+}
+
+LifecycleManager::Entry* LifecycleManager::findLocked(void* key) {
+    for (Entry& entry : m_entries) {
+        if (entry.key == key) return &entry;
+    }
+    return nullptr;
+}
+
+void LifecycleManager::add(void* key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!findLocked(key)) m_entries.push_back(Entry{key, LIFECYCLE_VISIBLE, true, 0, LIFECYCLE_SUSPENDED});
+}
+
+void LifecycleManager::remove(void* key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        if (m_entries[i].key != key) continue;
+        m_entries.erase(m_entries.begin() + i);
+        return;
+    }
+}
+
+// A step whose delay is negative is never taken on its own, only as part of
+// a later one
+int LifecycleManager::timedStateLocked(const Entry& entry, uint64_t nowMicros) const {
+    if (entry.visible) return LIFECYCLE_VISIBLE;
+    int64_t hidden = static_cast<int64_t>(nowMicros - entry.hiddenSince);
+    int64_t delays[] = {m_policy.parkAfterMicros, m_policy.lowMemoryAfterMicros,
+                        m_policy.suspendAfterMicros};
+    int state = LIFECYCLE_HIDDEN;
+    for (int i = 0; i < 3; i++) {
+        if (delays[i] >= 0 && hidden >= delays[i]) state = LIFECYCLE_PARKED + i;
+    }
+    return state < entry.ceiling ? state : entry.ceiling;
+}
+
+int LifecycleManager::nextStepLocked(const Entry& entry) const {
+    int64_t delays[] = {m_policy.parkAfterMicros, m_policy.lowMemoryAfterMicros,
+                        m_policy.suspendAfterMicros};
+    for (int next = entry.state + 1; next <= entry.ceiling; next++) {
+        if (next >= LIFECYCLE_PARKED && delays[next - LIFECYCLE_PARKED] >= 0) return next;
+    }
+    return -1;
+}
+
+void LifecycleManager::enterLocked(Entry& entry, int state, std::vector<Transition>* out) {
+    if (out) out->push_back(Transition{entry.key, entry.state, state});
+    m_stats.entered[state]++;
+    entry.state = state;
+}
+
+int LifecycleManager::setVisible(void* key, bool visible, uint64_t nowMicros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* entry = findLocked(key);
+    if (!entry) return visible ? LIFECYCLE_VISIBLE : LIFECYCLE_HIDDEN;
+    if (visible) {
+        entry->visible = true;
+        entry->ceiling = LIFECYCLE_SUSPENDED;
+        if (entry->state != LIFECYCLE_VISIBLE) enterLocked(*entry, LIFECYCLE_VISIBLE, nullptr);
+        return LIFECYCLE_VISIBLE;
+    }
+    if (entry->visible) {
+        entry->visible = false;
+        entry->hiddenSince = nowMicros;
+    }
+    int state = timedStateLocked(*entry, nowMicros);
+    if (state > entry->state) enterLocked(*entry, state, nullptr);
+    return entry->state;
+}
+
+void LifecycleManager::revert(void* key, int from, int state) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* entry = findLocked(key);
+    if (from == LIFECYCLE_SUSPENDED) m_stats.suspendFailures++;
+    if (!entry || entry->state != from) return;
+    entry->state = state;
+    entry->ceiling = state;
+}
+
+int LifecycleManager::state(void* key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* entry = findLocked(key);
+    return entry ? entry->state : LIFECYCLE_VISIBLE;
+}
+
+bool LifecycleManager::due(uint64_t nowMicros, uint64_t intervalMicros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_lastEvaluation && nowMicros - m_lastEvaluation < intervalMicros) return false;
+    m_lastEvaluation = nowMicros;
+    return true;
+}
+
+void LifecycleManager::evaluate(uint64_t nowMicros, uint64_t memoryBytes, std::vector<Transition>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t first = out.size();
+    if (memoryBytes) {
+        if (m_reclaimBaseline > memoryBytes) m_stats.memoryReclaimed += m_reclaimBaseline - memoryBytes;
+        m_reclaimBaseline = 0;
+        m_stats.memoryBytes = memoryBytes;
+    }
+
+    Entry* longest = nullptr;
+    for (Entry& entry : m_entries) {
+        if (entry.visible) continue;
+        int state = timedStateLocked(entry, nowMicros);
+        if (state > entry.state) enterLocked(entry, state, &out);
+        if (nextStepLocked(entry) >= 0 && (!longest || entry.hiddenSince < longest->hiddenSince))
+            longest = &entry;
+    }
+    if (m_policy.memoryBudget && memoryBytes > m_policy.memoryBudget && longest) {
+        enterLocked(*longest, nextStepLocked(*longest), &out);
+        m_stats.budgetSteps++;
+    }
+
+    // Renderer steps take effect over the next interval; what they gave back
+    // shows in the next sample
+    for (size_t i = first; i < out.size(); i++) {
+        if (memoryBytes && out[i].to >= LIFECYCLE_LOW_MEMORY) m_reclaimBaseline = memoryBytes;
+    }
+}
+
+LifecycleStats LifecycleManager::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::string LifecycleManager::statsJson() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t current[LIFECYCLE_STATE_COUNT] = {};
+    for (const Entry& entry : m_entries) current[entry.state]++;
+
+    std::string json = "{\"entered\":{";
+    char buf[96];
+    for (int i = 0; i < LIFECYCLE_STATE_COUNT; i++) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":%llu", i ? "," : "", kStateNames[i],
+                 static_cast<unsigned long long>(m_stats.entered[i]));
+        json += buf;
+    }
+    json += "},\"current\":{";
+    for (int i = 0; i < LIFECYCLE_STATE_COUNT; i++) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":%llu", i ? "," : "", kStateNames[i],
+                 static_cast<unsigned long long>(current[i]));
+        json += buf;
+    }
+    snprintf(buf, sizeof(buf), "},\"budgetSteps\":%llu,\"suspendFailures\":%llu,",
+             static_cast<unsigned long long>(m_stats.budgetSteps),
+             static_cast<unsigned long long>(m_stats.suspendFailures));
+    json += buf;
+    snprintf(buf, sizeof(buf), "\"memoryBytes\":%llu,\"memoryReclaimed\":%llu}",
+             static_cast<unsigned long long>(m_stats.memoryBytes),
+             static_cast<unsigned long long>(m_stats.memoryReclaimed));
+    json += buf;
+    return json;
+}
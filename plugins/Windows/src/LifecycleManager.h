@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Steps a hidden instance goes through, each including the ones before it.
+// Values are shared with WebViewObject.cs.
+enum LifecycleState {
+    LIFECYCLE_VISIBLE = 0,
+    LIFECYCLE_HIDDEN,      // IsVisible off; the renderer keeps running
+    LIFECYCLE_PARKED,      // the displayed frame packed, capture memory released
+    LIFECYCLE_LOW_MEMORY,  // renderer asked to keep its memory low
+    LIFECYCLE_SUSPENDED,   // renderer suspended (TrySuspend)
+    LIFECYCLE_STATE_COUNT
+};
+
+// Hidden time before each step is taken; a negative delay never takes a step
+// on its own, only together with a later one. The defaults park at once and
+// leave the renderer alone, as hiding always did.
+struct LifecyclePolicy {
+    int64_t parkAfterMicros = 0;
+    int64_t lowMemoryAfterMicros = -1;
+    int64_t suspendAfterMicros = -1;
+    // Memory of the WebView2 processes across all instances; while over it,
+    // the longest hidden instance is moved one enabled step further at each
+    // evaluation, ahead of its delays. 0 for no budget.
+    uint64_t memoryBudget = 0;
+};
+
+struct LifecycleStats {
+    uint64_t entered[LIFECYCLE_STATE_COUNT];  // transitions into each state
+    uint64_t budgetSteps;      // steps taken early to meet the memory budget
+    uint64_t suspendFailures;  // TrySuspend refused
+    uint64_t memoryBytes;      // last sample; 0 when there is no budget
+    uint64_t memoryReclaimed;  // drops in memoryBytes after renderer steps
+};
+
+// Decides the lifecycle state of every instance in the process. It only
+// keeps the books; callers apply the states it hands out on their own
+// threads. Instances are identified by an opaque key. Thread-safe.
+class LifecycleManager {
+public:
+    struct Transition {
+        void* key;
+        int from;
+        int to;
+    };
+
+    static LifecycleManager& instance();
+
+    void setPolicy(const LifecyclePolicy& policy);
+    LifecyclePolicy policy();
+    bool hasBudget();
+
+    void add(void* key);
+    void remove(void* key);
+    // Returns the state to apply right away: VISIBLE, or the steps a hidden
+    // instance takes without delay.
+    int setVisible(void* key, bool visible, uint64_t nowMicros);
+    // A step that did not take (a refused suspension) leaves key at state,
+    // unless it has moved on since, and holds it there until it is shown.
+    void revert(void* key, int from, int state);
+    int state(void* key);
+
+    // True at most once per intervalMicros, for rate-limiting evaluate.
+    bool due(uint64_t nowMicros, uint64_t intervalMicros);
+    // Moves hidden instances along by hidden time, then by the budget given
+    // memoryBytes (0 when unknown). Appends the steps to take to out.
+    void evaluate(uint64_t nowMicros, uint64_t memoryBytes, std::vector<Transition>& out);
+
+    LifecycleStats stats();
+    std::string statsJson();
+
+private:
+    struct Entry {
+        void* key;
+        int state;
+        bool visible;
+        uint64_t hiddenSince;
+        int ceiling;  // deepest state allowed until shown again
+    };
+
+    LifecycleManager() = default;
+    Entry* findLocked(void* key);
+    int timedStateLocked(const Entry& entry, uint64_t nowMicros) const;
+    int nextStepLocked(const Entry& entry) const;
+    void enterLocked(Entry& entry, int state, std::vector<Transition>* out);
+
+    std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    LifecyclePolicy m_policy;
+    LifecycleStats m_stats = {};
+    uint64_t m_lastEvaluation = 0;
+    uint64_t m_reclaimBaseline = 0;  // memory sample before renderer steps
+};
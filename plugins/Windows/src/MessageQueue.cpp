@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "MessageQueue.h"
+
+#include <atomic>
+#include <cstring>
+
+std::string FormatLegacyMessage(const WebViewEvent& event) {
+    switch (event.kind) {
+    case WEBVIEW_EVENT_FROM_JS: return "CallFromJS:" + event.payload;
+    case WEBVIEW_EVENT_ERROR: return "CallOnError:" + event.payload;
+    case WEBVIEW_EVENT_HTTP_ERROR: return "CallOnHttpError:" + std::to_string(event.code);
+    case WEBVIEW_EVENT_LOADED: return "CallOnLoaded:" + event.payload;
+    case WEBVIEW_EVENT_STARTED: return "CallOnStarted:" + event.payload;
+    case WEBVIEW_EVENT_HOOKED: return "CallOnHooked:" + event.payload;
+    case WEBVIEW_EVENT_COOKIES: return "CallOnCookies:" + event.payload;
+    case WEBVIEW_EVENT_NAVIGATION_ERROR:
+        return "CallOnError:" + event.payload + " (error: " + std::to_string(event.code) + ")";
+    default: return std::string();
+    }
+}
+
+size_t WriteEventRecord(uint8_t* out, const WebViewEvent& event, uint32_t instanceId) {
+    WebViewEventHeader header;
+    header.kind = static_cast<uint16_t>(event.kind);
+    header.headerSize = sizeof(WebViewEventHeader);
+    header.instanceId = instanceId;
+    header.micros = event.micros;
+    header.code = event.code;
+    header.payloadSize = static_cast<uint32_t>(event.payload.size());
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), event.payload.data(), event.payload.size());
+    size_t used = sizeof(header) + event.payload.size();
+    size_t record = WebViewEventRecordSize(event.payload.size());
+    memset(out + used, 0, record - used);
+    return record;
+}
+
+static std::atomic<uint32_t> s_nextQueueId{1};
+
+MessageQueue::MessageQueue() : m_id(s_nextQueueId.fetch_add(1, std::memory_order_relaxed)) {}
+
+size_t MessageQueue::push(WebViewEvent event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.push(std::move(event));
+    return m_events.size();
+}
+
+bool MessageQueue::pop(WebViewEvent& event, size_t& remaining) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_events.empty()) return false;
+    event = std::move(m_events.front());
+    m_events.pop();
+    remaining = m_events.size();
+    return true;
+}
+
+size_t MessageQueue::popRecords(uint8_t* out, size_t capacity, size_t& remaining, size_t& needed) {
+    needed = 0;
+    size_t written = 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_events.empty()) {
+        const WebViewEvent& event = m_events.front();
+        size_t record = WebViewEventRecordSize(event.payload.size());
+        if (written + record > capacity) {
+            if (!written) needed = record;
+            break;
+        }
+        WriteEventRecord(out + written, event, m_id);
+        written += record;
+        m_events.pop();
+    }
+    remaining = m_events.size();
+    return written;
+}
+
+size_t MessageQueue::size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_events.size();
+}
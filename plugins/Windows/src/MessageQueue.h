@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <string>
+
+// Kinds of event sent to Unity. Values are shared with WebViewObject.cs
+// and never renumbered.
+enum WebViewEventKind {
+    WEBVIEW_EVENT_FROM_JS = 1,  // payload: the message
+    WEBVIEW_EVENT_ERROR,        // payload: description
+    WEBVIEW_EVENT_HTTP_ERROR,   // code: HTTP status; payload: URL when known
+    WEBVIEW_EVENT_LOADED,       // payload: URL
+    WEBVIEW_EVENT_STARTED,      // payload: URL
+    WEBVIEW_EVENT_HOOKED,       // payload: URL
+    WEBVIEW_EVENT_COOKIES,      // payload: one cookie per line
+    WEBVIEW_EVENT_NAVIGATION_ERROR,  // payload: URL; code: web error status
+    WEBVIEW_EVENT_COOKIE_SNAPSHOT,   // payload: JSON (CookieSnapshot.h); code: request id
+    WEBVIEW_EVENT_NAVIGATION_TIMING, // payload: JSON (NavigationTracker.h); code: low bits of the navigation id
+};
+
+struct WebViewEvent {
+    int kind;
+    int code;
+    uint64_t micros;  // InstanceStats::nowMicros() when queued
+    std::string payload;
+};
+
+// Record header of _CWebViewPlugin_GetEvents. Records are packed back to
+// back in little-endian order, each followed by payloadSize bytes of UTF-8
+// and padded to a multiple of 8 bytes.
+struct WebViewEventHeader {
+    uint16_t kind;
+    uint16_t headerSize;  // sizeof(WebViewEventHeader), for later extension
+    uint32_t instanceId;
+    uint64_t micros;
+    int32_t code;
+    uint32_t payloadSize;
+};
+
+inline size_t WebViewEventRecordSize(size_t payloadSize) {
+    return (sizeof(WebViewEventHeader) + payloadSize + 7) & ~static_cast<size_t>(7);
+}
+
+// Writes event as one record at out, which must hold
+// WebViewEventRecordSize(event.payload.size()) bytes; returns that size.
+size_t WriteEventRecord(uint8_t* out, const WebViewEvent& event, uint32_t instanceId);
+
+// The "CallOnLoaded:<url>" form of _CWebViewPlugin_GetMessage.
+std::string FormatLegacyMessage(const WebViewEvent& event);
+
+// Events from the host thread to Unity, drained by _CWebViewPlugin_GetEvents
+// (or one at a time as text by _CWebViewPlugin_GetMessage).
+class MessageQueue {
+public:
+    MessageQueue();
+
+    // Process-unique, from 1; stamped on records as the instance id.
+    uint32_t id() const { return m_id; }
+
+    // Returns the queue depth after the push.
+    size_t push(WebViewEvent event);
+    // remaining receives the depth after the pop.
+    bool pop(WebViewEvent& event, size_t& remaining);
+    // Moves as many whole events as fit into out as records; returns the
+    // bytes written. When the next event alone does not fit, returns 0 and
+    // sets needed to its record size.
+    size_t popRecords(uint8_t* out, size_t capacity, size_t& remaining, size_t& needed);
+    size_t size();
+
+private:
+    const uint32_t m_id;
+    std::queue<WebViewEvent> m_events;
+    std::mutex m_mutex;
+};
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "MipChain.h"
+#include "WorkerPool.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WEBVIEW_SSE2 1
+#endif
+
+int MipLevelCount(int width, int height) {
+    int size = width > height ? width : height;
+    int levels = 1;
+    while (size > 1) {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+size_t MipChainSize(int width, int height) {
+    if (width <= 0 || height <= 0) return 0;
+    size_t total = 0;
+    int levels = MipLevelCount(width, height);
+    for (int i = 0; i < levels; i++) {
+        total += static_cast<size_t>(width) * height * 4;
+        width = width > 1 ? width >> 1 : 1;
+        height = height > 1 ? height >> 1 : 1;
+    }
+    return total;
+}
+
+bool DirtyBlocksToRect(const std::vector<uint8_t>& dirty, int width, int height, MipRect& rect) {
+    int bw = (width + 3) / 4;
+    int bh = (height + 3) / 4;
+    int bx0 = bw, by0 = bh, bx1 = -1, by1 = -1;
+    for (int by = 0; by < bh; by++) {
+        const uint8_t* row = &dirty[static_cast<size_t>(by) * bw];
+        for (int bx = 0; bx < bw; bx++) {
+            if (!row[bx]) continue;
+            if (bx < bx0) bx0 = bx;
+            if (bx > bx1) bx1 = bx;
+            if (by < by0) by0 = by;
+            by1 = by;
+        }
+    }
+    if (bx1 < 0) return false;
+    rect.x0 = bx0 * 4;
+    rect.y0 = by0 * 4;
+    rect.x1 = (bx1 + 1) * 4 < width ? (bx1 + 1) * 4 : width;
+    rect.y1 = (by1 + 1) * 4 < height ? (by1 + 1) * 4 : height;
+    return true;
+}
+
+// sRGB <-> linear tables: 8-bit sRGB to linear [0, 1], and 12-bit linear
+// back to 8-bit sRGB.
+struct SrgbTables {
+    float toLinear[256];
+    uint8_t fromLinear[4096];
+
+    SrgbTables() {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < 4096; i++) {
+            float l = i / 4095.0f;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            fromLinear[i] = static_cast<uint8_t>(c * 255.0f + 0.5f);
+        }
+    }
+};
+
+static const SrgbTables& GetSrgbTables() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+static inline void AverageSrgb(const uint8_t* a, const uint8_t* b, const uint8_t* c, const uint8_t* d,
+                               uint8_t* out, const SrgbTables& t) {
+    for (int ch = 0; ch < 3; ch++) {
+        float l = (t.toLinear[a[ch]] + t.toLinear[b[ch]] + t.toLinear[c[ch]] + t.toLinear[d[ch]]) * 0.25f;
+        out[ch] = t.fromLinear[static_cast<int>(l * 4095.0f + 0.5f)];
+    }
+    out[3] = static_cast<uint8_t>((a[3] + b[3] + c[3] + d[3] + 2) >> 2);
+}
+
+// Filters output pixels [x0, x1) of one destination row from source rows r0
+// and r1 (equal for the last row of an odd-height level).
+static void DownsampleRow(const uint8_t* r0, const uint8_t* r1, int sw,
+                          uint8_t* out, int x0, int x1, bool srgb) {
+    int x = x0;
+    if (srgb) {
+        const SrgbTables& t = GetSrgbTables();
+        for (; x < x1; x++) {
+            int sx0 = x * 2;
+            int sx1 = sx0 + 1 < sw ? sx0 + 1 : sw - 1;
+            AverageSrgb(r0 + sx0 * 4, r0 + sx1 * 4, r1 + sx0 * 4, r1 + sx1 * 4, out + x * 4, t);
+        }
+        return;
+    }
+#ifdef WEBVIEW_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    // Two output pixels from four source pixels of each row
+    for (; x + 1 < x1 && x * 2 + 3 < sw; x += 2) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + x * 8));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + x * 8));
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+        hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+        __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(sum, zero));
+    }
+#endif
+    for (; x < x1; x++) {
+        int sx0 = x * 2;
+        int sx1 = sx0 + 1 < sw ? sx0 + 1 : sw - 1;
+        for (int ch = 0; ch < 4; ch++) {
+            out[x * 4 + ch] = static_cast<uint8_t>(
+                (r0[sx0 * 4 + ch] + r0[sx1 * 4 + ch] + r1[sx0 * 4 + ch] + r1[sx1 * 4 + ch] + 2) >> 2);
+        }
+    }
+}
+
+void BuildMipChain(uint8_t* chain, int width, int height, bool srgb,
+                   const uint8_t* prevChain, const MipRect* dirty,
+                   WorkerPool* pool) {
+    MipRect r = {0, 0, width, height};
+    if (prevChain && dirty) {
+        r = *dirty;
+    } else {
+        prevChain = nullptr;
+    }
+    uint8_t* src = chain;
+    const uint8_t* prev = prevChain;
+    int sw = width, sh = height;
+    int levels = MipLevelCount(width, height);
+    for (int level = 1; level < levels; level++) {
+        int dw = sw > 1 ? sw >> 1 : 1;
+        int dh = sh > 1 ? sh >> 1 : 1;
+        size_t srcSize = static_cast<size_t>(sw) * sh * 4;
+        uint8_t* dst = src + srcSize;
+        MipRect d;
+        d.x0 = r.x0 >> 1;
+        d.y0 = r.y0 >> 1;
+        d.x1 = (r.x1 + 1) >> 1 < dw ? (r.x1 + 1) >> 1 : dw;
+        d.y1 = (r.y1 + 1) >> 1 < dh ? (r.y1 + 1) >> 1 : dh;
+        if (prev) {
+            prev += srcSize;
+            memcpy(dst, prev, static_cast<size_t>(dw) * dh * 4);
+        }
+        auto filterRows = [&](int y0, int y1) {
+            for (int y = y0; y < y1; y++) {
+                int sy0 = y * 2;
+                int sy1 = sy0 + 1 < sh ? sy0 + 1 : sh - 1;
+                DownsampleRow(src + static_cast<size_t>(sy0) * sw * 4,
+                              src + static_cast<size_t>(sy1) * sw * 4,
+                              sw, dst + static_cast<size_t>(y) * dw * 4, d.x0, d.x1, srgb);
+            }
+        };
+        // Small levels are not worth a hand-off
+        if (pool && d.y1 - d.y0 >= 64) {
+            pool->parallelFor(d.y1 - d.y0, 32, [&](int b, int e) { filterRows(d.y0 + b, d.y0 + e); });
+        } else {
+            filterRows(d.y0, d.y1);
+        }
+        src = dst;
+        sw = dw;
+        sh = dh;
+        r = d;
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class WorkerPool;
+
+// Pixel rectangle [x0, x1) x [y0, y1).
+struct MipRect {
+    int x0, y0, x1, y1;
+};
+
+// Level count of a full chain down to 1x1, as Texture2D(mipChain: true) uses.
+int MipLevelCount(int width, int height);
+
+// Byte size of a contiguous RGBA32 mip chain (level 0 first, then each
+// smaller level), the layout Texture2D.LoadRawTextureData expects.
+size_t MipChainSize(int width, int height);
+
+// Bounding rectangle in pixels of the blocks flagged by DiffFrameBlocks.
+// Returns false when no block is dirty.
+bool DirtyBlocksToRect(const std::vector<uint8_t>& dirty, int width, int height, MipRect& rect);
+
+// Rebuilds levels 1..n of chain from level 0 with a 2x2 box filter, averaging
+// colour in linear light when srgb is set. When prevChain (same size) and
+// dirty are given, levels are copied from prevChain and only the area covered
+// by dirty is filtered again. With a pool, the rows of each level are split
+// across its workers.
+void BuildMipChain(uint8_t* chain, int width, int height, bool srgb,
+                   const uint8_t* prevChain, const MipRect* dirty,
+                   WorkerPool* pool = nullptr);
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "MockBrowserBackend.h"
+#include "ChannelRouter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// Error status reported for mock://fail
+static const int kMockConnectionFailed = 1;
+
+static std::string HostOf(const std::string& url) {
+    size_t begin = url.find("://");
+    begin = begin == std::string::npos ? 0 : begin + 3;
+    size_t end = url.find_first_of(":/?#", begin);
+    return url.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+static bool DomainMatches(const std::string& host, const std::string& domain) {
+    if (host == domain) return true;
+    return host.size() > domain.size() &&
+        host.compare(host.size() - domain.size(), domain.size(), domain) == 0 &&
+        host[host.size() - domain.size() - 1] == '.';
+}
+
+MockBrowserBackend::MockBrowserBackend(const MockBrowserConfig& config)
+    : m_config(config)
+    , m_rng(config.seed ? config.seed : 1) {
+    if (m_config.dirtyRows < 1) m_config.dirtyRows = 1;
+}
+
+bool MockBrowserBackend::create(BrowserBackendListener* listener, int width, int height) {
+    m_listener = listener;
+    resize(width, height);
+    return listener != nullptr;
+}
+
+void MockBrowserBackend::schedule(uint64_t delay, std::function<void()> run) {
+    uint64_t due = m_now + delay;
+    auto it = std::upper_bound(m_events.begin(), m_events.end(), due,
+                               [](uint64_t d, const Event& e) { return d < e.due; });
+    m_events.insert(it, Event{due, std::move(run)});
+}
+
+void MockBrowserBackend::navigate(const std::string& url) {
+    startNavigation(url, std::string(), -1);
+}
+
+void MockBrowserBackend::loadHTML(const std::string& html, const std::string& baseUrl) {
+    startNavigation(baseUrl.empty() ? "about:blank" : baseUrl, html, -1);
+}
+
+void MockBrowserBackend::startNavigation(const std::string& url, const std::string& html,
+                                         int historyIndex) {
+    unsigned id = ++m_navigationId;
+    schedule(0, [this, url, html, historyIndex, id] {
+        if (id != m_navigationId || !m_listener) return;
+        if (!m_listener->onNavigationStarting(url)) return;
+        schedule(m_config.navigationMicros, [this, url, html, historyIndex, id] {
+            if (id == m_navigationId) completeNavigation(url, html, historyIndex);
+        });
+    });
+}
+
+void MockBrowserBackend::completeNavigation(const std::string& url, const std::string& html,
+                                            int historyIndex) {
+    if (url == "mock://fail") {
+        m_listener->onNavigationCompleted(url, false, kMockConnectionFailed);
+        return;
+    }
+    if (historyIndex < 0) {
+        m_history.resize(m_historyIndex + 1);
+        m_history.push_back(url);
+        m_historyIndex = static_cast<int>(m_history.size()) - 1;
+    } else {
+        m_historyIndex = historyIndex;
+    }
+
+    std::string host = HostOf(url);
+    if (!host.empty()) {
+        auto it = std::find_if(m_cookies.begin(), m_cookies.end(), [&](const BrowserCookie& c) {
+            return c.name == "visited" && c.domain == host;
+        });
+        if (it == m_cookies.end()) {
+            m_cookies.push_back(BrowserCookie{"visited", "1", host, "/"});
+        } else {
+            it->value = std::to_string(atoi(it->value.c_str()) + 1);
+        }
+    }
+
+    size_t status = url.find("/status/");
+    if (status != std::string::npos) {
+        int code = atoi(url.c_str() + status + 8);
+        if (code >= 400) m_listener->onHttpError(code);
+    }
+
+    // A new page repaints the whole view
+    m_listener->onContentLoading();
+    paintRows(0, m_height);
+    m_listener->onNavigationCompleted(url, true, 0);
+    if (!html.empty()) postScriptMessages(html);
+}
+
+void MockBrowserBackend::evaluateJS(const std::string& js) {
+    schedule(m_config.scriptMicros, [this, js] { postScriptMessages(js); });
+}
+
+// Reads a '...' or "..." literal at pos into out; false if there is none.
+static bool ReadStringLiteral(const std::string& source, size_t& pos, std::string& out) {
+    while (pos < source.size() && source[pos] == ' ') pos++;
+    if (pos >= source.size() || (source[pos] != '\'' && source[pos] != '"')) return false;
+    char quote = source[pos++];
+    while (pos < source.size() && source[pos] != quote) {
+        if (source[pos] == '\\' && pos + 1 < source.size()) pos++;
+        out += source[pos++];
+    }
+    if (pos >= source.size()) return false;
+    pos++;
+    return true;
+}
+
+// Posts every Unity.call('...') with a literal argument, and every
+// Unity.call('channel', '...') as the bridge script would
+void MockBrowserBackend::postScriptMessages(const std::string& source) {
+    static const char kCall[] = "Unity.call(";
+    size_t pos = 0;
+    while ((pos = source.find(kCall, pos)) != std::string::npos) {
+        pos += sizeof(kCall) - 1;
+        std::string message;
+        if (!ReadStringLiteral(source, pos, message)) continue;
+        while (pos < source.size() && source[pos] == ' ') pos++;
+        std::string payload;
+        if (pos < source.size() && source[pos] == ',' && ReadStringLiteral(source, ++pos, payload)) {
+            message = kChannelSeparator + message + kChannelSeparator + payload;
+        }
+        if (m_listener) m_listener->onWebMessage(message);
+    }
+}
+
+void MockBrowserBackend::goBack() {
+    if (canGoBack()) startNavigation(m_history[m_historyIndex - 1], std::string(), m_historyIndex - 1);
+}
+
+void MockBrowserBackend::goForward() {
+    if (canGoForward()) startNavigation(m_history[m_historyIndex + 1], std::string(), m_historyIndex + 1);
+}
+
+void MockBrowserBackend::reload() {
+    if (m_historyIndex >= 0) startNavigation(m_history[m_historyIndex], std::string(), m_historyIndex);
+}
+
+bool MockBrowserBackend::canGoBack() {
+    return m_historyIndex > 0;
+}
+
+bool MockBrowserBackend::canGoForward() {
+    return m_historyIndex + 1 < static_cast<int>(m_history.size());
+}
+
+void MockBrowserBackend::resize(int width, int height) {
+    if (width < 0) width = 0;
+    if (height < 0) height = 0;
+    if (width == m_width && height == m_height) return;
+    m_width = width;
+    m_height = height;
+    m_pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+    m_band = 0;
+    paintRows(0, height);
+}
+
+void MockBrowserBackend::setVisible(bool visible) {
+    m_visible = visible;
+}
+
+void MockBrowserBackend::getCookies(const std::string& url) {
+    std::string host = HostOf(url);
+    schedule(0, [this, host] {
+        std::vector<BrowserCookie> cookies;
+        for (const auto& cookie : m_cookies) {
+            if (host.empty() || DomainMatches(host, cookie.domain)) cookies.push_back(cookie);
+        }
+        if (m_listener) m_listener->onCookies(cookies);
+    });
+}
+
+void MockBrowserBackend::clearCookie(const std::string& url, const std::string& name) {
+    std::string host = HostOf(url);
+    m_cookies.erase(std::remove_if(m_cookies.begin(), m_cookies.end(), [&](const BrowserCookie& c) {
+        return c.name == name && DomainMatches(host, c.domain);
+    }), m_cookies.end());
+}
+
+void MockBrowserBackend::clearAllCookies() {
+    m_cookies.clear();
+}
+
+void MockBrowserBackend::setCookies(const std::vector<BrowserCookie>& cookies) {
+    for (const auto& cookie : cookies) {
+        auto it = std::find_if(m_cookies.begin(), m_cookies.end(), [&](const BrowserCookie& c) {
+            return c.name == cookie.name && c.domain == cookie.domain && c.path == cookie.path;
+        });
+        if (it == m_cookies.end()) {
+            m_cookies.push_back(cookie);
+        } else {
+            *it = cookie;
+        }
+    }
+}
+
+bool MockBrowserBackend::requestFrame() {
+    if (!m_listener || m_pixels.empty()) return false;
+    schedule(m_config.captureMicros, [this] { deliverFrame(); });
+    return true;
+}
+
+// Fills rows [begin, end) with a per-row colour ramped across x
+void MockBrowserBackend::paintRows(int begin, int end) {
+    for (int y = begin; y < end; y++) {
+        // xorshift32
+        m_rng ^= m_rng << 13;
+        m_rng ^= m_rng >> 17;
+        m_rng ^= m_rng << 5;
+        uint32_t color = m_rng;
+        uint8_t* row = m_pixels.data() + static_cast<size_t>(y) * m_width * 4;
+        for (int x = 0; x < m_width; x++) {
+            row[x * 4 + 0] = static_cast<uint8_t>(color + x);
+            row[x * 4 + 1] = static_cast<uint8_t>((color >> 8) + (x >> 2));
+            row[x * 4 + 2] = static_cast<uint8_t>(color >> 16);
+            row[x * 4 + 3] = 0xFF;
+        }
+    }
+}
+
+void MockBrowserBackend::deliverFrame() {
+    if (m_pixels.empty()) return;
+    int end = std::min(m_band + m_config.dirtyRows, m_height);
+    paintRows(m_band, end);
+    m_band = end < m_height ? end : 0;
+    m_lastFrame = m_now;
+    m_listener->onFrame(m_pixels.data(), static_cast<size_t>(m_width) * 4, m_width, m_height);
+}
+
+uint64_t MockBrowserBackend::pump(uint64_t nowMicros) {
+    m_now = nowMicros;
+    while (!m_events.empty() && m_events.front().due <= m_now) {
+        std::function<void()> run = std::move(m_events.front().run);
+        m_events.pop_front();
+        run();
+    }
+    uint64_t next = m_events.empty() ? UINT64_MAX : m_events.front().due;
+    if (m_config.frameIntervalMicros && m_visible && m_listener && !m_pixels.empty()) {
+        if (m_now - m_lastFrame >= m_config.frameIntervalMicros) deliverFrame();
+        next = std::min(next, m_lastFrame + m_config.frameIntervalMicros);
+    }
+    return next;
+}
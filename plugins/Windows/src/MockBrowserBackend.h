@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include "BrowserBackend.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct MockBrowserConfig {
+    uint64_t navigationMicros = 20000;  // navigation start to completion
+    uint64_t scriptMicros = 500;        // evaluateJS to its web messages
+    uint64_t captureMicros = 2000;      // requestFrame to onFrame
+    uint64_t frameIntervalMicros = 0;   // unrequested frames while visible; 0 = off
+    int dirtyRows = 32;                 // rows repainted per frame
+    uint32_t seed = 1;
+};
+
+// Deterministic in-process stand-in for a browser engine, driven entirely by
+// the times passed to pump. It behaves like a well-mannered page:
+//  - every navigation completes after navigationMicros and sets a "visited"
+//    cookie for the URL's host; URLs containing "/status/NNN" report NNN as
+//    an HTTP error, and "mock://fail" fails to load;
+//  - each Unity.call('...') in evaluated script or loaded HTML becomes a web
+//    message;
+//  - each frame repaints a band of dirtyRows rows that moves down the view,
+//    leaving the rest unchanged.
+class MockBrowserBackend : public BrowserBackend {
+public:
+    explicit MockBrowserBackend(const MockBrowserConfig& config = MockBrowserConfig());
+
+    bool create(BrowserBackendListener* listener, int width, int height) override;
+
+    void navigate(const std::string& url) override;
+    void loadHTML(const std::string& html, const std::string& baseUrl) override;
+    void evaluateJS(const std::string& js) override;
+    void goBack() override;
+    void goForward() override;
+    void reload() override;
+    bool canGoBack() override;
+    bool canGoForward() override;
+
+    void resize(int width, int height) override;
+    void setVisible(bool visible) override;
+
+    void getCookies(const std::string& url) override;
+    void clearCookie(const std::string& url, const std::string& name) override;
+    void clearAllCookies() override;
+    void setCookies(const std::vector<BrowserCookie>& cookies) override;
+
+    bool requestFrame() override;
+    uint64_t pump(uint64_t nowMicros) override;
+
+private:
+    struct Event {
+        uint64_t due;
+        std::function<void()> run;
+    };
+
+    void schedule(uint64_t delay, std::function<void()> run);
+    // historyIndex < 0 pushes a new history entry on completion
+    void startNavigation(const std::string& url, const std::string& html, int historyIndex);
+    void completeNavigation(const std::string& url, const std::string& html, int historyIndex);
+    void postScriptMessages(const std::string& source);
+    void paintRows(int begin, int end);
+    void deliverFrame();
+
+    MockBrowserConfig m_config;
+    BrowserBackendListener* m_listener = nullptr;
+    uint64_t m_now = 0;
+    uint64_t m_lastFrame = 0;
+    std::deque<Event> m_events;  // in due order
+    uint32_t m_rng;
+
+    std::vector<std::string> m_history;
+    int m_historyIndex = -1;
+    unsigned m_navigationId = 0;  // a newer navigation cancels older ones
+    std::vector<BrowserCookie> m_cookies;
+
+    int m_width = 0;
+    int m_height = 0;
+    bool m_visible = true;
+    std::vector<uint8_t> m_pixels;  // BGRA
+    int m_band = 0;
+};
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "NavigationTracker.h"
+#include "JsonEscape.h"
+
+#include <cstdio>
+
+void NavigationTracker::requested(uint64_t nowMicros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requested = nowMicros;
+}
+
+void NavigationTracker::cancelled() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requested = 0;
+}
+
+bool NavigationTracker::finishLocked(NavigationTiming& finished) {
+    if (!m_active) return false;
+    m_active = false;
+    m_awaitingFrame.store(false, std::memory_order_relaxed);
+    finished = std::move(m_current);
+    m_current = NavigationTiming();
+    return true;
+}
+
+bool NavigationTracker::started(uint64_t id, const std::string& url, uint64_t nowMicros,
+                                NavigationTiming& finished) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_active && m_current.id == id) return false;
+    bool superseded = finishLocked(finished);
+    m_active = true;
+    m_current.id = id;
+    m_current.url = url;
+    m_current.requested = m_requested;
+    m_current.started = nowMicros;
+    m_requested = 0;
+    return superseded;
+}
+
+void NavigationTracker::contentLoading(uint64_t id, uint64_t nowMicros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_active || m_current.id != id || m_current.contentLoading) return;
+    m_current.contentLoading = nowMicros;
+    m_awaitingFrame.store(true, std::memory_order_relaxed);
+}
+
+void NavigationTracker::domContentLoaded(uint64_t id, uint64_t nowMicros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_active || m_current.id != id || m_current.domContentLoaded) return;
+    m_current.domContentLoaded = nowMicros;
+}
+
+bool NavigationTracker::completed(uint64_t id, bool success, int errorStatus, uint64_t nowMicros,
+                                  NavigationTiming& finished) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_active || m_current.id != id || m_current.completed) return false;
+    m_current.success = success;
+    m_current.errorStatus = errorStatus;
+    m_current.completed = nowMicros;
+    if (m_current.firstFrame) return finishLocked(finished);
+    // Error pages may never raise ContentLoading; their first frame counts
+    m_awaitingFrame.store(true, std::memory_order_relaxed);
+    return false;
+}
+
+bool NavigationTracker::frameChanged(uint64_t nowMicros, NavigationTiming& finished) {
+    if (!m_awaitingFrame.load(std::memory_order_relaxed)) return false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_active || m_current.firstFrame) return false;
+    m_current.firstFrame = nowMicros;
+    m_awaitingFrame.store(false, std::memory_order_relaxed);
+    return m_current.completed && finishLocked(finished);
+}
+
+bool NavigationTracker::expire(uint64_t nowMicros, uint64_t timeoutMicros, NavigationTiming& finished) {
+    if (!m_awaitingFrame.load(std::memory_order_relaxed)) return false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_active || !m_current.completed || nowMicros - m_current.completed < timeoutMicros) return false;
+    return finishLocked(finished);
+}
+
+static void AppendMilestone(std::string& out, const char* name, uint64_t micros, uint64_t origin) {
+    char buf[64];
+    if (micros) {
+        snprintf(buf, sizeof(buf), ",\"%s\":%.3f", name,
+                 (micros > origin ? micros - origin : 0) / 1000.0);
+    } else {
+        snprintf(buf, sizeof(buf), ",\"%s\":-1", name);
+    }
+    out += buf;
+}
+
+void AppendNavigationTimingJson(std::string& out, const NavigationTiming& timing) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "{\"id\":%llu,\"url\":\"", static_cast<unsigned long long>(timing.id));
+    out += buf;
+    AppendJsonEscaped(out, timing.url);
+    snprintf(buf, sizeof(buf), "\",\"success\":%s,\"errorStatus\":%d,\"fromRequest\":%s",
+             timing.success ? "true" : "false", timing.errorStatus, timing.requested ? "true" : "false");
+    out += buf;
+    uint64_t origin = timing.requested ? timing.requested : timing.started;
+    AppendMilestone(out, "navigationStarting", timing.started, origin);
+    AppendMilestone(out, "contentLoading", timing.contentLoading, origin);
+    AppendMilestone(out, "domContentLoaded", timing.domContentLoaded, origin);
+    AppendMilestone(out, "navigationCompleted", timing.completed, origin);
+    AppendMilestone(out, "firstFrame", timing.firstFrame, origin);
+    out += '}';
+}
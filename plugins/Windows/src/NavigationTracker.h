@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// How long a completed navigation waits for a new frame before it is
+// reported without one, e.g. while the view is hidden.
+const uint64_t kFirstFrameTimeoutMicros = 10000000;
+
+// Milestones of one top-level navigation, in InstanceStats::nowMicros(); 0
+// for one that was not reached.
+struct NavigationTiming {
+    uint64_t id = 0;
+    std::string url;
+    bool success = false;
+    int errorStatus = 0;
+    uint64_t requested = 0;         // loadURL/loadHTML; 0 if the page navigated itself
+    uint64_t started = 0;           // NavigationStarting
+    uint64_t contentLoading = 0;    // ContentLoading: the new document is committed
+    uint64_t domContentLoaded = 0;  // DOMContentLoaded
+    uint64_t completed = 0;         // NavigationCompleted
+    uint64_t firstFrame = 0;        // first changed frame of the new document
+};
+
+// Follows the navigation in progress from the call that asked for it to the
+// first captured frame that differs from the previous page. A navigation
+// finishes once it has completed and that frame has arrived, when a newer
+// navigation supersedes it, or when no new frame follows its completion in
+// time (a hidden view). Each method that can finish one returns true and
+// fills finished. Thread-safe; frameChanged is a single atomic load unless
+// a navigation is waiting for its frame.
+class NavigationTracker {
+public:
+    // Unity asked for a navigation; claimed by the next started().
+    void requested(uint64_t nowMicros);
+    // The pending request was cancelled (denied, hooked or a unity: URL).
+    void cancelled();
+
+    // A navigation that was let through. A new id finishes the one in
+    // progress as it stands; redirects repeat the id and are ignored.
+    bool started(uint64_t id, const std::string& url, uint64_t nowMicros, NavigationTiming& finished);
+    void contentLoading(uint64_t id, uint64_t nowMicros);
+    void domContentLoaded(uint64_t id, uint64_t nowMicros);
+    bool completed(uint64_t id, bool success, int errorStatus, uint64_t nowMicros,
+                   NavigationTiming& finished);
+    // A captured frame that differs from the one before it.
+    bool frameChanged(uint64_t nowMicros, NavigationTiming& finished);
+    // Finishes a completed navigation that has had no new frame for
+    // timeoutMicros.
+    bool expire(uint64_t nowMicros, uint64_t timeoutMicros, NavigationTiming& finished);
+
+private:
+    bool finishLocked(NavigationTiming& finished);
+
+    std::mutex m_mutex;
+    NavigationTiming m_current;
+    bool m_active = false;
+    uint64_t m_requested = 0;
+    std::atomic<bool> m_awaitingFrame{false};
+};
+
+// {"id":N,"url":"...","success":true,"errorStatus":0,"fromRequest":true,
+//  "navigationStarting":ms,"contentLoading":ms,"domContentLoaded":ms,
+//  "navigationCompleted":ms,"firstFrame":ms}
+// Times are milliseconds after the request (after NavigationStarting when
+// fromRequest is false); -1 for milestones that were not reached.
+void AppendNavigationTimingJson(std::string& out, const NavigationTiming& timing);
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "PixelConvert.h"
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WEBVIEW_SSE2 1
+#endif
+
+void SwizzleBGRAToRGBA(const uint8_t* src, size_t srcPitch, uint8_t* dst,
+                       int width, int rowBegin, int rowEnd) {
+#ifdef WEBVIEW_SSE2
+    const __m128i maskAG = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+    const __m128i maskRB = _mm_set1_epi32(0x00FF00FF);
+#endif
+    for (int row = rowBegin; row < rowEnd; row++) {
+        const uint8_t* srcRow = src + row * srcPitch;
+        uint8_t* dstRow = dst + static_cast<size_t>(row) * width * 4;
+        int col = 0;
+#ifdef WEBVIEW_SSE2
+        // Keep G and A, swap B and R within each 32-bit pixel
+        for (; col + 4 <= width; col += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow + col * 4));
+            __m128i rb = _mm_and_si128(v, maskRB);
+            rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dstRow + col * 4),
+                             _mm_or_si128(_mm_and_si128(v, maskAG), rb));
+        }
+#endif
+        for (; col < width; col++) {
+            dstRow[col * 4 + 0] = srcRow[col * 4 + 2]; // R <- B
+            dstRow[col * 4 + 1] = srcRow[col * 4 + 1]; // G
+            dstRow[col * 4 + 2] = srcRow[col * 4 + 0]; // B <- R
+            dstRow[col * 4 + 3] = srcRow[col * 4 + 3]; // A
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "Prerender.h"
+
+#include <cstdio>
+#include <cstring>
+
+static size_t WithoutFragment(const char* url, size_t length) {
+    const void* hash = memchr(url, '#', length);
+    return hash ? static_cast<size_t>(static_cast<const char*>(hash) - url) : length;
+}
+
+bool PrerenderUrlMatches(const std::string& prerendered, const char* requested) {
+    if (!requested || !*requested) return true;
+    size_t a = WithoutFragment(prerendered.data(), prerendered.size());
+    size_t b = WithoutFragment(requested, strlen(requested));
+    return a == b && memcmp(prerendered.data(), requested, a) == 0;
+}
+
+PrerenderLedger& PrerenderLedger::instance() {
+    // Never destroyed; instances may still drop prerenders during DLL unload
+    static PrerenderLedger* ledger = new PrerenderLedger();
+    return *ledger;
+}
+
+void PrerenderLedger::started() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.started++;
+}
+
+void PrerenderLedger::committed(uint64_t startedMicros, uint64_t readyMicros, uint64_t nowMicros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.hits++;
+    if (!readyMicros || readyMicros > nowMicros) {
+        m_stats.hitsNotReady++;
+        readyMicros = nowMicros;
+    }
+    if (readyMicros > startedMicros) m_stats.loadMicrosHidden += readyMicros - startedMicros;
+}
+
+void PrerenderLedger::discarded(uint64_t startedMicros, uint64_t nowMicros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.misses++;
+    if (nowMicros > startedMicros) m_stats.loadMicrosWasted += nowMicros - startedMicros;
+}
+
+void PrerenderLedger::mismatched() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.mismatches++;
+}
+
+PrerenderStats PrerenderLedger::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::string PrerenderLedger::statsJson() {
+    PrerenderStats s = stats();
+    uint64_t finished = s.hits + s.misses;
+    double hitRate = finished ? static_cast<double>(s.hits) / finished : 0.0;
+    char buf[320];
+    snprintf(buf, sizeof(buf),
+             "{\"started\":%llu,\"hits\":%llu,\"hitsNotReady\":%llu,\"misses\":%llu,"
+             "\"mismatches\":%llu,\"hitRate\":%.3f,\"loadMsHidden\":%.1f,\"loadMsWasted\":%.1f}",
+             static_cast<unsigned long long>(s.started), static_cast<unsigned long long>(s.hits),
+             static_cast<unsigned long long>(s.hitsNotReady), static_cast<unsigned long long>(s.misses),
+             static_cast<unsigned long long>(s.mismatches), hitRate,
+             s.loadMicrosHidden / 1000.0, s.loadMicrosWasted / 1000.0);
+    return buf;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// True when a commit for requested may use a page prerendered from
+// prerendered: requested is null or empty, or names the same URL ignoring
+// the fragment.
+bool PrerenderUrlMatches(const std::string& prerendered, const char* requested);
+
+struct PrerenderStats {
+    uint64_t started;
+    uint64_t hits;              // prerenders committed
+    uint64_t hitsNotReady;      // of those, committed before the page was loaded
+    uint64_t misses;            // prerenders dropped without being committed
+    uint64_t mismatches;        // commits refused for naming another URL
+    uint64_t loadMicrosHidden;  // loading time hits kept off screen
+    uint64_t loadMicrosWasted;  // time misses spent loading before being dropped
+};
+
+// Process-wide outcome counts of background prerenders
+// (_CWebViewPlugin_Prerender). Thread-safe.
+class PrerenderLedger {
+public:
+    static PrerenderLedger& instance();
+
+    void started();
+    // readyMicros is when the page finished loading, 0 if it has not
+    void committed(uint64_t startedMicros, uint64_t readyMicros, uint64_t nowMicros);
+    void discarded(uint64_t startedMicros, uint64_t nowMicros);
+    void mismatched();
+
+    PrerenderStats stats();
+    std::string statsJson();
+
+private:
+    PrerenderLedger() = default;
+
+    std::mutex m_mutex;
+    PrerenderStats m_stats = {};
+};
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "RequestBlocker.h"
+#include "JsonEscape.h"
+#include "UrlParser.h"
+
+#include <cstdio>
+
+static inline char Lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// FNV-1a over the ASCII-lowercased label
+static uint64_t HashLabel(std::string_view label) {
+    uint64_t h = 1469598103934665603ull;
+    for (char c : label) {
+        h ^= static_cast<unsigned char>(Lower(c));
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static inline uint64_t EdgeKey(uint32_t parent, uint64_t labelHash) {
+    return labelHash ^ (static_cast<uint64_t>(parent) + 1) * 0x9E3779B97F4A7C15ull;
+}
+
+static std::string_view Trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t' || s.front() == '\r')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+// IPv4 or IPv6 literal, as hosts files start their lines with
+static bool IsAddress(std::string_view s) {
+    bool digit = false, separator = false;
+    for (char c : s) {
+        if (c >= '0' && c <= '9') {
+            digit = true;
+        } else if (c == '.' || c == ':') {
+            separator = true;
+        } else if (!(c >= 'a' && c <= 'f')) {
+            return false;
+        }
+    }
+    return digit && separator;
+}
+
+static bool IsDomain(std::string_view s) {
+    if (s.empty() || s.front() == '.' || s.back() == '.') return false;
+    char prev = '.';
+    for (char c : s) {
+        c = Lower(c);
+        bool ok = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+        if (!ok || (c == '.' && prev == '.')) return false;
+        prev = c;
+    }
+    return true;
+}
+
+// Splits a rule line into domain and path, or returns false for comments,
+// unsupported syntax and malformed lines.
+static bool ParseRule(std::string_view line, bool& allow, std::string_view& domain, std::string_view& path) {
+    if (line.empty() || line[0] == '#' || line[0] == '!' || line[0] == '[') return false;
+    allow = line.compare(0, 2, "@@") == 0;
+    if (allow) line.remove_prefix(2);
+
+    // hosts file: "<address> <domain> [# comment]"
+    size_t space = line.find_first_of(" \t");
+    if (space != std::string_view::npos) {
+        if (allow || !IsAddress(line.substr(0, space))) return false;
+        std::string_view rest = Trim(line.substr(space));
+        rest = Trim(rest.substr(0, rest.find('#')));
+        if (rest.find_first_of(" \t") != std::string_view::npos) rest = rest.substr(0, rest.find_first_of(" \t"));
+        if (rest == "localhost" || rest == "localhost.localdomain" || rest == "local" ||
+            rest == "broadcasthost" || IsAddress(rest))
+            return false;
+        line = rest;
+    }
+
+    // Filter options and element hiding rules change what a line means
+    if (line.find('$') != std::string_view::npos || line.find('#') != std::string_view::npos) return false;
+    if (line.compare(0, 2, "||") == 0) {
+        line.remove_prefix(2);
+        if (!line.empty() && line.back() == '^') line.remove_suffix(1);
+    }
+    if (line.find_first_of("|^*") != std::string_view::npos && line.compare(0, 2, "*.") != 0) return false;
+    if (line.compare(0, 2, "*.") == 0) line.remove_prefix(2);
+    if (!line.empty() && line[0] == '.') line.remove_prefix(1);
+
+    size_t slash = line.find('/');
+    domain = line.substr(0, slash);
+    path = slash == std::string_view::npos ? std::string_view() : line.substr(slash);
+    if (domain.empty()) return path.size() > 1;
+    return IsDomain(domain);
+}
+
+std::shared_ptr<RequestBlocker::Ruleset> RequestBlocker::compile(std::string_view text) {
+    auto set = std::make_shared<Ruleset>();
+    set->nodes.emplace_back(0, 0);
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = Trim(text.substr(pos, end - pos));
+        pos = end + 1;
+
+        bool allow;
+        std::string_view domain, path;
+        if (!ParseRule(line, allow, domain, path)) continue;
+        int32_t index = static_cast<int32_t>(set->rules.size());
+
+        if (domain.empty()) {
+            set->rules.push_back(Rule{std::string(line), std::string(path), true, allow});
+            continue;
+        }
+
+        // Walk the labels from the top-level domain, adding missing nodes
+        uint32_t node = 0;
+        bool collided = false;
+        size_t labelEnd = domain.size();
+        while (!collided) {
+            size_t dot = domain.rfind('.', labelEnd - 1);
+            size_t labelStart = dot == std::string_view::npos ? 0 : dot + 1;
+            uint64_t hash = HashLabel(domain.substr(labelStart, labelEnd - labelStart));
+            auto inserted = set->edges.emplace(EdgeKey(node, hash), static_cast<uint32_t>(set->nodes.size()));
+            if (inserted.second) {
+                set->nodes.emplace_back(hash, node);
+            } else {
+                const Node& existing = set->nodes[inserted.first->second];
+                collided = existing.labelHash != hash || existing.parent != node;
+            }
+            node = inserted.first->second;
+            if (labelStart == 0) break;
+            labelEnd = labelStart - 1;
+        }
+        if (collided) continue;
+
+        Node& target = set->nodes[node];
+        if (!path.empty() && path != "/") {
+            target.pathRules.push_back(index);
+        } else if (allow) {
+            if (target.allowRule < 0) target.allowRule = index;
+        } else {
+            if (target.blockRule < 0) target.blockRule = index;
+        }
+        set->rules.push_back(Rule{std::string(line), std::string(path), false, allow});
+    }
+
+    // Host-less rules are indexed once rules stops growing
+    for (size_t i = 0; i < set->rules.size(); i++) {
+        const Rule& rule = set->rules[i];
+        if (!rule.anyHost) continue;
+        set->pathRules.emplace(rule.path, static_cast<int32_t>(i));
+        if (rule.path.size() > set->maxPathRuleLength) set->maxPathRuleLength = rule.path.size();
+    }
+    set->hits.reset(new std::atomic<uint64_t>[set->rules.size() ? set->rules.size() : 1]());
+    return set;
+}
+
+int RequestBlocker::matchRuleset(Ruleset& set, std::string_view url) {
+    UrlParts parts;
+    if (!ParseUrl(url, parts) || parts.host.empty()) return -1;
+    std::string_view host = parts.host;
+    if (host.back() == '.') host.remove_suffix(1);
+    std::string_view path = parts.path;
+
+    int32_t block = -1;
+    bool allowed = false;
+    auto consider = [&](int32_t rule) {
+        if (set.rules[rule].allow) {
+            allowed = true;
+        } else if (block < 0) {
+            block = rule;
+        }
+    };
+
+    // Domain rules, from the top-level domain down to the full host
+    uint32_t node = 0;
+    size_t labelEnd = host.size();
+    while (labelEnd > 0) {
+        size_t dot = host.rfind('.', labelEnd - 1);
+        size_t labelStart = dot == std::string_view::npos ? 0 : dot + 1;
+        uint64_t hash = HashLabel(host.substr(labelStart, labelEnd - labelStart));
+        auto it = set.edges.find(EdgeKey(node, hash));
+        if (it == set.edges.end()) break;
+        const Node& next = set.nodes[it->second];
+        if (next.labelHash != hash || next.parent != node) break;
+        node = it->second;
+        if (next.allowRule >= 0) allowed = true;
+        if (next.blockRule >= 0 && block < 0) block = next.blockRule;
+        for (int32_t rule : next.pathRules) {
+            const std::string& prefix = set.rules[rule].path;
+            if (path.compare(0, prefix.size(), prefix) == 0) consider(rule);
+        }
+        if (labelStart == 0) break;
+        labelEnd = labelStart - 1;
+    }
+
+    // Host-less rules match whole segments: every run from one '/' to the
+    // next '/' (with or without it) or to the end of the path
+    if (!set.pathRules.empty() && !allowed) {
+        for (size_t i = path.find('/'); i != std::string_view::npos; i = path.find('/', i + 1)) {
+            for (size_t j = path.find('/', i + 1);; j = path.find('/', j + 1)) {
+                size_t end = j == std::string_view::npos ? path.size() : j;
+                if (end - i > set.maxPathRuleLength) break;
+                auto it = set.pathRules.find(path.substr(i, end - i));
+                if (it != set.pathRules.end()) consider(it->second);
+                if (j == std::string_view::npos) break;
+                it = set.pathRules.find(path.substr(i, end + 1 - i));
+                if (it != set.pathRules.end()) consider(it->second);
+            }
+        }
+    }
+
+    if (allowed || block < 0) return -1;
+    set.hits[block].fetch_add(1, std::memory_order_relaxed);
+    set.blocked.fetch_add(1, std::memory_order_relaxed);
+    return block;
+}
+
+std::shared_ptr<RequestBlocker::Ruleset> RequestBlocker::current() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rules;
+}
+
+void RequestBlocker::install(std::shared_ptr<Ruleset> rules) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled.store(rules && !rules->rules.empty(), std::memory_order_relaxed);
+    m_rules = std::move(rules);
+}
+
+size_t RequestBlocker::load(const char* text) {
+    std::shared_ptr<Ruleset> rules = compile(text ? std::string_view(text) : std::string_view());
+    size_t count = rules->rules.size();
+    install(std::move(rules));
+    return count;
+}
+
+long long RequestBlocker::loadFile(const char* path) {
+    if (!path) return -1;
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    std::string text;
+    char buf[64 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0) text.append(buf, n);
+    fclose(file);
+    std::shared_ptr<Ruleset> rules = compile(text);
+    size_t count = rules->rules.size();
+    install(std::move(rules));
+    return static_cast<long long>(count);
+}
+
+void RequestBlocker::clear() {
+    install(nullptr);
+}
+
+void RequestBlocker::copyFrom(RequestBlocker& other) {
+    if (&other == this) return;
+    install(other.current());
+}
+
+size_t RequestBlocker::ruleCount() {
+    std::shared_ptr<Ruleset> rules = current();
+    return rules ? rules->rules.size() : 0;
+}
+
+int RequestBlocker::match(std::string_view url) {
+    if (!enabled()) return -1;
+    std::shared_ptr<Ruleset> rules = current();
+    return rules ? matchRuleset(*rules, url) : -1;
+}
+
+std::string RequestBlocker::hitsJson() {
+    std::shared_ptr<Ruleset> rules = current();
+    char buf[64];
+    snprintf(buf, sizeof(buf), "{\"blocked\":%llu,\"rules\":[",
+             static_cast<unsigned long long>(rules ? rules->blocked.load(std::memory_order_relaxed) : 0));
+    std::string json = buf;
+    bool first = true;
+    for (size_t i = 0; rules && i < rules->rules.size(); i++) {
+        uint64_t hits = rules->hits[i].load(std::memory_order_relaxed);
+        if (!hits) continue;
+        json += first ? "{\"rule\":\"" : ",{\"rule\":\"";
+        first = false;
+        AppendJsonEscaped(json, rules->rules[i].text);
+        snprintf(buf, sizeof(buf), "\",\"hits\":%llu}", static_cast<unsigned long long>(hits));
+        json += buf;
+    }
+    json += "]}";
+    return json;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Blocks subresource requests (trackers, ad scripts) before they reach the
+// network. Rules, one per line:
+//
+//   ads.example.com          the host and every subdomain
+//   example.com/ads/         paths starting with /ads/ on those hosts
+//   /pagead/                 whole path segments anywhere on any host
+//   @@cdn.example.com/ads/   exception: never block what this matches
+//   # or !                   comment
+//
+// "||example.com^" and hosts-file lines ("0.0.0.0 example.com") are read as
+// domain rules, so common block lists load unchanged. Domains are compiled
+// into a trie of hashed labels walked from the top-level domain, so a lookup
+// costs one hash probe per host label whatever the rule count.
+class RequestBlocker {
+public:
+    // Replaces the rules; returns how many were compiled (malformed lines
+    // are skipped).
+    size_t load(const char* text);
+    // As load, from a UTF-8 text file; -1 if it cannot be read.
+    long long loadFile(const char* path);
+    void clear();
+    // Uses other's compiled rules, shared with it (hit counts included)
+    // rather than compiled again
+    void copyFrom(RequestBlocker& other);
+
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    size_t ruleCount();
+
+    // Index of the rule blocking url, or -1. Counts a hit for that rule.
+    int match(std::string_view url);
+
+    // {"blocked":N,"rules":[{"rule":"...","hits":N},...]} for rules that
+    // have blocked something since they were loaded.
+    std::string hitsJson();
+
+private:
+    struct Node {
+        Node(uint64_t hash, uint32_t parentNode) : labelHash(hash), parent(parentNode) {}
+
+        uint64_t labelHash;
+        uint32_t parent;
+        int32_t blockRule = -1;
+        int32_t allowRule = -1;
+        std::vector<int32_t> pathRules;  // rules with a domain and path
+    };
+    struct Rule {
+        std::string text;
+        std::string path;  // prefix, or segments for host-less rules
+        bool anyHost;
+        bool allow;
+    };
+    struct Ruleset {
+        std::vector<Rule> rules;
+        std::vector<Node> nodes;  // nodes[0] is the root
+        std::unordered_map<uint64_t, uint32_t> edges;
+        std::unordered_map<std::string_view, int32_t> pathRules;  // host-less
+        size_t maxPathRuleLength = 0;
+        std::unique_ptr<std::atomic<uint64_t>[]> hits;
+        std::atomic<uint64_t> blocked{0};
+    };
+
+    static std::shared_ptr<Ruleset> compile(std::string_view text);
+    static int matchRuleset(Ruleset& rules, std::string_view url);
+    std::shared_ptr<Ruleset> current();
+    void install(std::shared_ptr<Ruleset> rules);
+
+    std::shared_ptr<Ruleset> m_rules;
+    std::atomic<bool> m_enabled{false};
+    std::mutex m_mutex;
+};
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "ResourceTimeline.h"
+#include "JsonEscape.h"
+#include "UrlParser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+static const char* const kContextNames[] = {
+    "other", "document", "stylesheet", "image", "media", "font", "script", "xhr",
+    "fetch", "texttrack", "eventsource", "websocket", "manifest", "signedexchange",
+    "ping", "cspviolationreport", "other",
+};
+
+static const char* ContextName(int context) {
+    if (context < 0 || context >= static_cast<int>(sizeof(kContextNames) / sizeof(kContextNames[0])))
+        return "other";
+    return kContextNames[context];
+}
+
+// ISO 8601 UTC with milliseconds, as HAR's startedDateTime wants. Days to
+// civil date after Howard Hinnant's days_from_civil inverse, so no gmtime
+// variant is needed.
+static void AppendIsoTime(std::string& out, int64_t unixMicros) {
+    int64_t millis = unixMicros / 1000;
+    int64_t days = millis / 86400000;
+    int64_t ms = millis % 86400000;
+    if (ms < 0) {
+        ms += 86400000;
+        days--;
+    }
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int64_t day = doy - (153 * mp + 2) / 5 + 1;
+    int64_t month = mp < 10 ? mp + 3 : mp - 9;
+    int64_t year = yoe + era * 400 + (month <= 2);
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%04lld-%02lld-%02lldT%02lld:%02lld:%02lld.%03lldZ",
+             static_cast<long long>(year), static_cast<long long>(month), static_cast<long long>(day),
+             static_cast<long long>(ms / 3600000), static_cast<long long>(ms / 60000 % 60),
+             static_cast<long long>(ms / 1000 % 60), static_cast<long long>(ms % 1000));
+    out += buf;
+}
+
+std::string ResourceTimeline::makeKey(const std::string& method, const std::string& url) {
+    std::string key;
+    key.reserve(method.size() + 1 + url.size());
+    key += method;
+    key += ' ';
+    key += url;
+    return key;
+}
+
+void ResourceTimeline::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ring.clear();
+    m_ring.shrink_to_fit();
+    m_ring.resize(capacity);
+    m_next = 0;
+    m_pending.clear();
+    m_enabled.store(capacity > 0, std::memory_order_relaxed);
+}
+
+size_t ResourceTimeline::capacity() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ring.size();
+}
+
+void ResourceTimeline::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (ResourceTiming& timing : m_ring) timing = ResourceTiming();
+    m_next = 0;
+    m_pending.clear();
+}
+
+size_t ResourceTimeline::size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<size_t>(std::min<uint64_t>(m_next, m_ring.size()));
+}
+
+void ResourceTimeline::dropStaleLocked() {
+    uint64_t oldest = m_next > m_ring.size() ? m_next - m_ring.size() : 0;
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        auto& seqs = it->second;
+        while (!seqs.empty() && seqs.front() < oldest) seqs.pop_front();
+        if (seqs.empty()) {
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ResourceTimeline::begin(const std::string& method, const std::string& url, int context,
+                             uint64_t nowMicros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ring.empty()) return;
+    uint64_t seq = m_next++;
+    ResourceTiming& timing = m_ring[seq % m_ring.size()];
+    timing.method = method;
+    timing.url = url;
+    timing.startMicros = nowMicros;
+    timing.responseMicros = 0;
+    timing.size = -1;
+    timing.status = 0;
+    timing.context = context;
+    m_pending[makeKey(method, url)].push_back(seq);
+    if (m_pending.size() > 2 * m_ring.size()) dropStaleLocked();
+}
+
+void ResourceTimeline::complete(const std::string& method, const std::string& url, int status,
+                                int64_t size, uint64_t nowMicros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ring.empty()) return;
+    uint64_t oldest = m_next > m_ring.size() ? m_next - m_ring.size() : 0;
+    auto it = m_pending.find(makeKey(method, url));
+    if (it != m_pending.end()) {
+        auto& seqs = it->second;
+        while (!seqs.empty() && seqs.front() < oldest) seqs.pop_front();
+        if (!seqs.empty()) {
+            ResourceTiming& timing = m_ring[seqs.front() % m_ring.size()];
+            seqs.pop_front();
+            if (seqs.empty()) m_pending.erase(it);
+            timing.responseMicros = nowMicros > timing.startMicros ? nowMicros : timing.startMicros;
+            timing.status = status;
+            timing.size = size;
+            return;
+        }
+        m_pending.erase(it);
+    }
+    ResourceTiming& timing = m_ring[m_next++ % m_ring.size()];
+    timing.method = method;
+    timing.url = url;
+    timing.startMicros = nowMicros;
+    timing.responseMicros = nowMicros;
+    timing.size = size;
+    timing.status = status;
+    timing.context = RESOURCE_CONTEXT_OTHER;
+}
+
+std::vector<ResourceTiming> ResourceTimeline::snapshot() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<ResourceTiming> timings;
+    if (m_ring.empty()) return timings;
+    uint64_t count = std::min<uint64_t>(m_next, m_ring.size());
+    timings.reserve(static_cast<size_t>(count));
+    for (uint64_t seq = m_next - count; seq < m_next; seq++)
+        timings.push_back(m_ring[seq % m_ring.size()]);
+    return timings;
+}
+
+std::string ResourceTimeline::harJson() {
+    std::vector<ResourceTiming> timings = snapshot();
+    using namespace std::chrono;
+    int64_t steadyNow = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    int64_t wallNow = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+
+    std::string json = "{\"log\":{\"version\":\"1.2\",\"creator\":{\"name\":\"unity-webview\",\"version\":\"1\"},\"entries\":[";
+    char buf[160];
+    for (size_t i = 0; i < timings.size(); i++) {
+        const ResourceTiming& timing = timings[i];
+        json += i ? ",{\"startedDateTime\":\"" : "{\"startedDateTime\":\"";
+        AppendIsoTime(json, wallNow - (steadyNow - static_cast<int64_t>(timing.startMicros)));
+        double wait = timing.status ? (timing.responseMicros - timing.startMicros) / 1000.0 : -1.0;
+        snprintf(buf, sizeof(buf), "\",\"time\":%.3f,\"request\":{\"method\":\"", wait);
+        json += buf;
+        AppendJsonEscaped(json, timing.method);
+        json += "\",\"url\":\"";
+        AppendJsonEscaped(json, timing.url);
+        snprintf(buf, sizeof(buf),
+                 "\"},\"response\":{\"status\":%d,\"bodySize\":%lld},\"timings\":{\"wait\":%.3f},"
+                 "\"_resourceType\":\"%s\"}",
+                 timing.status, static_cast<long long>(timing.size), wait, ContextName(timing.context));
+        json += buf;
+    }
+    json += "]}}";
+    return json;
+}
+
+static void PutLE(uint8_t* out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) out[i] = static_cast<uint8_t>(v >> (i * 8));
+}
+
+void ResourceTimeline::appendSummary(std::string& out) {
+    std::vector<ResourceTiming> timings = snapshot();
+    uint64_t origin = UINT64_MAX;
+    for (const ResourceTiming& timing : timings) origin = std::min(origin, timing.startMicros);
+
+    uint8_t header[16] = {'W', 'V', 'R', 'T'};
+    PutLE(header + 4, WEBVIEW_RESOURCE_SUMMARY_VERSION, 2);
+    PutLE(header + 6, sizeof(header), 2);
+    PutLE(header + 8, timings.size(), 4);
+    out.append(reinterpret_cast<const char*>(header), sizeof(header));
+    for (const ResourceTiming& timing : timings) {
+        size_t urlLength = std::min<size_t>(timing.url.size(), 0xFFFF - 32 - 7);
+        size_t recordSize = (32 + urlLength + 7) & ~static_cast<size_t>(7);
+        uint8_t record[32] = {};
+        PutLE(record, recordSize, 2);
+        record[2] = static_cast<uint8_t>(timing.context);
+        PutLE(record + 4, static_cast<uint32_t>(timing.status), 4);
+        PutLE(record + 8, timing.startMicros - origin, 8);
+        uint64_t wait = 0xFFFFFFFF;
+        if (timing.status) wait = std::min<uint64_t>(timing.responseMicros - timing.startMicros, 0xFFFFFFFE);
+        PutLE(record + 16, wait, 4);
+        PutLE(record + 20, urlLength, 4);
+        PutLE(record + 24, static_cast<uint64_t>(timing.size), 8);
+        out.append(reinterpret_cast<const char*>(record), sizeof(record));
+        out.append(timing.url, 0, urlLength);
+        out.append(recordSize - 32 - urlLength, '\0');
+    }
+}
+
+std::string ResourceTimeline::hostStatsJson() {
+    std::vector<ResourceTiming> timings = snapshot();
+    struct Host {
+        std::string name;
+        std::vector<uint64_t> waits;
+        uint64_t bytes = 0;
+        double p95 = 0;
+    };
+    std::vector<Host> hosts;
+    std::unordered_map<std::string, size_t> index;
+    for (const ResourceTiming& timing : timings) {
+        if (!timing.status) continue;
+        UrlParts parts;
+        if (!ParseUrl(timing.url, parts)) continue;
+        std::string name(parts.host);
+        auto found = index.emplace(name, hosts.size());
+        if (found.second) {
+            hosts.emplace_back();
+            hosts.back().name = std::move(name);
+        }
+        Host& host = hosts[found.first->second];
+        host.waits.push_back(timing.responseMicros - timing.startMicros);
+        if (timing.size > 0) host.bytes += static_cast<uint64_t>(timing.size);
+    }
+    // Nearest-rank percentile
+    auto percentile = [](const std::vector<uint64_t>& sorted, int p) {
+        size_t rank = (sorted.size() * p + 99) / 100;
+        return sorted[rank ? rank - 1 : 0] / 1000.0;
+    };
+    for (Host& host : hosts) {
+        std::sort(host.waits.begin(), host.waits.end());
+        host.p95 = percentile(host.waits, 95);
+    }
+    std::stable_sort(hosts.begin(), hosts.end(),
+                     [](const Host& a, const Host& b) { return a.p95 > b.p95; });
+
+    std::string json = "{\"hosts\":[";
+    char buf[160];
+    for (size_t i = 0; i < hosts.size(); i++) {
+        const Host& host = hosts[i];
+        json += i ? ",{\"host\":\"" : "{\"host\":\"";
+        AppendJsonEscaped(json, host.name);
+        snprintf(buf, sizeof(buf), "\",\"count\":%llu,\"bytes\":%llu,\"p50\":%.3f,\"p95\":%.3f,\"max\":%.3f}",
+                 static_cast<unsigned long long>(host.waits.size()),
+                 static_cast<unsigned long long>(host.bytes), percentile(host.waits, 50), host.p95,
+                 host.waits.back() / 1000.0);
+        json += buf;
+    }
+    json += "]}";
+    return json;
+}
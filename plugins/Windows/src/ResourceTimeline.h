@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define WEBVIEW_RESOURCE_SUMMARY_VERSION 1
+
+// Values match COREWEBVIEW2_WEB_RESOURCE_CONTEXT.
+enum ResourceContext {
+    RESOURCE_CONTEXT_ALL = 0,
+    RESOURCE_CONTEXT_DOCUMENT,
+    RESOURCE_CONTEXT_STYLESHEET,
+    RESOURCE_CONTEXT_IMAGE,
+    RESOURCE_CONTEXT_MEDIA,
+    RESOURCE_CONTEXT_FONT,
+    RESOURCE_CONTEXT_SCRIPT,
+    RESOURCE_CONTEXT_XML_HTTP_REQUEST,
+    RESOURCE_CONTEXT_FETCH,
+    RESOURCE_CONTEXT_TEXT_TRACK,
+    RESOURCE_CONTEXT_EVENT_SOURCE,
+    RESOURCE_CONTEXT_WEBSOCKET,
+    RESOURCE_CONTEXT_MANIFEST,
+    RESOURCE_CONTEXT_SIGNED_EXCHANGE,
+    RESOURCE_CONTEXT_PING,
+    RESOURCE_CONTEXT_CSP_VIOLATION_REPORT,
+    RESOURCE_CONTEXT_OTHER,
+};
+
+// One request as seen by the plugin. Times are InstanceStats::nowMicros().
+struct ResourceTiming {
+    std::string method;
+    std::string url;
+    uint64_t startMicros = 0;
+    uint64_t responseMicros = 0;  // 0 until the response headers arrive
+    int64_t size = -1;            // Content-Length; -1 when not sent
+    int status = 0;               // 0 until the response headers arrive
+    int context = RESOURCE_CONTEXT_OTHER;
+};
+
+// Opt-in per-request load telemetry: the last N requests of an instance in a
+// ring, each with its start time, time to response headers, status and
+// size. Responses are matched to the oldest unanswered request with the
+// same method and URL. Thread-safe.
+//
+// The binary summary is a 16-byte header
+//
+//   char magic[4] = "WVRT"; uint16_t version; uint16_t headerSize;
+//   uint32_t count; uint32_t reserved;
+//
+// followed by count records, each padded to a multiple of 8 bytes:
+//
+//   uint16_t recordSize; uint8_t context; uint8_t reserved; int32_t status;
+//   uint64_t startMicros; uint32_t waitMicros; uint32_t urlLength;
+//   int64_t size; char url[urlLength];
+//
+// startMicros is relative to the oldest request in the summary, and
+// waitMicros is 0xFFFFFFFF while the response is outstanding.
+class ResourceTimeline {
+public:
+    // Keeps the last capacity requests; 0 disables the timeline. Either way
+    // the recorded requests are dropped.
+    void setCapacity(size_t capacity);
+    size_t capacity();
+    void clear();
+
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    size_t size();
+
+    // A request leaving the page, overwriting the oldest one when full.
+    void begin(const std::string& method, const std::string& url, int context, uint64_t nowMicros);
+    // Its response headers. A response with no matching request (one the
+    // WebResourceRequested filter never saw) is recorded on its own.
+    void complete(const std::string& method, const std::string& url, int status,
+                  int64_t size, uint64_t nowMicros);
+
+    // Oldest first.
+    std::vector<ResourceTiming> snapshot();
+
+    // HAR 1.2 shaped JSON ({"log":{"entries":[...]}}); requests still waiting
+    // for a response have "time":-1.
+    std::string harJson();
+    // Appends the binary summary described above.
+    void appendSummary(std::string& out);
+    // {"hosts":[{"host":"...","count":N,"bytes":N,"p50":ms,"p95":ms,"max":ms}]}
+    // over answered requests, slowest p95 first.
+    std::string hostStatsJson();
+
+private:
+    static std::string makeKey(const std::string& method, const std::string& url);
+    void dropStaleLocked();
+
+    std::mutex m_mutex;
+    std::vector<ResourceTiming> m_ring;
+    uint64_t m_next = 0;  // sequence number of the next request
+    // Unanswered requests by key, oldest first; stale sequence numbers are
+    // skipped and swept once the map outgrows the ring
+    std::unordered_map<std::string, std::deque<uint64_t>> m_pending;
+    std::atomic<bool> m_enabled{false};
+};
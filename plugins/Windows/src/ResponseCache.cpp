@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "ResponseCache.h"
+
+// Bookkeeping charged per entry on top of its strings
+static const size_t kEntryOverhead = 128;
+
+static bool StartsWithNoCase(const std::string& s, size_t pos, const char* lower) {
+    for (size_t i = 0; lower[i]; i++, pos++) {
+        if (pos >= s.size()) return false;
+        char c = s[pos];
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c + ('a' - 'A'));
+        if (c != lower[i]) return false;
+    }
+    return true;
+}
+
+// Drops Set-Cookie lines; returns false if Cache-Control forbids storing.
+static bool FilterHeaders(std::string& headers) {
+    std::string kept;
+    kept.reserve(headers.size());
+    size_t pos = 0;
+    while (pos < headers.size()) {
+        size_t end = headers.find("\r\n", pos);
+        if (end == std::string::npos) end = headers.size();
+        if (StartsWithNoCase(headers, pos, "cache-control:")) {
+            std::string value = headers.substr(pos, end - pos);
+            for (auto& c : value) {
+                if (c >= 'A' && c <= 'Z') c = static_cast<char>(c + ('a' - 'A'));
+            }
+            if (value.find("no-store") != std::string::npos) return false;
+        }
+        if (!StartsWithNoCase(headers, pos, "set-cookie:")) {
+            if (!kept.empty()) kept += "\r\n";
+            kept.append(headers, pos, end - pos);
+        }
+        pos = end + 2;
+    }
+    headers.swap(kept);
+    return true;
+}
+
+std::string ResponseCache::makeKey(const std::string& method, const std::string& url) {
+    std::string key;
+    key.reserve(method.size() + 1 + url.size());
+    key += method;
+    key += ' ';
+    key += url;
+    return key;
+}
+
+void ResponseCache::updateEnabledLocked() {
+    m_enabled.store(m_budget && !m_rules.empty(), std::memory_order_relaxed);
+}
+
+void ResponseCache::eraseLocked(EntryIt it) {
+    m_stats.bytes -= it->bytes;
+    m_stats.entries--;
+    m_index.erase(it->key);
+    m_lru.erase(it);
+}
+
+void ResponseCache::trimLocked(size_t target) {
+    while (!m_lru.empty() && m_stats.bytes > target) {
+        eraseLocked(std::prev(m_lru.end()));
+        m_stats.evictions++;
+    }
+}
+
+void ResponseCache::setBudget(size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = maxBytes;
+    if (!m_budget) {
+        m_lru.clear();
+        m_index.clear();
+        m_stats.bytes = 0;
+        m_stats.entries = 0;
+    } else {
+        trimLocked(m_budget);
+    }
+    updateEnabledLocked();
+}
+
+bool ResponseCache::addRule(const char* pattern, int ttlSeconds) {
+    if (!pattern || !*pattern || ttlSeconds <= 0) return false;
+    Rule rule;
+    try {
+        rule.pattern = std::regex(pattern);
+    } catch (...) {
+        return false;
+    }
+    rule.ttlMicros = static_cast<uint64_t>(ttlSeconds) * 1000000;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_rules.push_back(std::move(rule));
+    updateEnabledLocked();
+    return true;
+}
+
+void ResponseCache::clearRules() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_rules.clear();
+    updateEnabledLocked();
+}
+
+void ResponseCache::copyRulesFrom(ResponseCache& other) {
+    if (&other == this) return;
+    std::vector<Rule> rules;
+    size_t budget;
+    {
+        std::lock_guard<std::mutex> lock(other.m_mutex);
+        rules = other.m_rules;
+        budget = other.m_budget;
+    }
+    setBudget(budget);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_rules = std::move(rules);
+    updateEnabledLocked();
+}
+
+void ResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lru.clear();
+    m_index.clear();
+    m_stats.bytes = 0;
+    m_stats.entries = 0;
+}
+
+uint64_t ResponseCache::ttlMicros(const std::string& method, const std::string& url) {
+    if (!enabled() || (method != "GET" && method != "HEAD")) return 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const Rule& rule : m_rules) {
+        try {
+            if (std::regex_search(url, rule.pattern)) return rule.ttlMicros;
+        } catch (...) {}
+    }
+    return 0;
+}
+
+bool ResponseCache::lookup(const std::string& method, const std::string& url,
+                           uint64_t nowMicros, CachedResponse& response) {
+    std::string key = makeKey(method, url);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it != m_index.end() && it->second->expiresMicros <= nowMicros) {
+        eraseLocked(it->second);
+        m_stats.expirations++;
+        it = m_index.end();
+    }
+    if (it == m_index.end()) {
+        m_stats.misses++;
+        return false;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    response = it->second->response;
+    m_stats.hits++;
+    return true;
+}
+
+bool ResponseCache::contains(const std::string& method, const std::string& url, uint64_t nowMicros) {
+    std::string key = makeKey(method, url);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    return it != m_index.end() && it->second->expiresMicros > nowMicros;
+}
+
+void ResponseCache::store(const std::string& method, const std::string& url, CachedResponse response,
+                          uint64_t ttlMicros, uint64_t nowMicros) {
+    if (response.status != 200 || !ttlMicros) return;
+    if (!FilterHeaders(response.headers)) return;
+    if (!response.body) response.body = std::make_shared<const std::string>();
+
+    Entry entry;
+    entry.key = makeKey(method, url);
+    entry.bytes = kEntryOverhead + entry.key.size() + response.reason.size() +
+                  response.headers.size() + response.body->size();
+    entry.expiresMicros = nowMicros + ttlMicros;
+    entry.response = std::move(response);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_budget || entry.bytes > m_budget) return;
+    auto it = m_index.find(entry.key);
+    if (it != m_index.end()) eraseLocked(it->second);
+    trimLocked(m_budget - entry.bytes);
+    m_lru.push_front(std::move(entry));
+    m_index[m_lru.front().key] = m_lru.begin();
+    m_stats.bytes += m_lru.front().bytes;
+    m_stats.entries++;
+    m_stats.stores++;
+}
+
+ResponseCacheStats ResponseCache::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A response as replayed by the cache. headers holds "Name: value" lines
+// separated by CRLF, the form CreateWebResourceResponse takes.
+struct CachedResponse {
+    int status = 0;
+    std::string reason;
+    std::string headers;
+    std::shared_ptr<const std::string> body;
+};
+
+struct ResponseCacheStats {
+    uint64_t hits;
+    uint64_t misses;       // cacheable requests that went to the network
+    uint64_t stores;
+    uint64_t evictions;    // dropped to stay within the byte budget
+    uint64_t expirations;  // found past their TTL
+    uint64_t bytes;
+    uint64_t entries;
+};
+
+// Opt-in LRU cache for GET/HEAD responses, keyed by method and URL. Only
+// URLs matching a rule are cached, each rule with its own TTL, and the
+// whole cache stays within a byte budget. Thread-safe; bodies are shared,
+// so a hit copies no payload under the lock.
+class ResponseCache {
+public:
+    // 0 disables the cache and drops its entries; rules are kept.
+    void setBudget(size_t maxBytes);
+
+    // Caches URLs matching pattern (regex, searched anywhere in the URL)
+    // for ttlSeconds. The first matching rule wins. Returns false for an
+    // invalid pattern or a non-positive TTL.
+    bool addRule(const char* pattern, int ttlSeconds);
+    void clearRules();
+    // Replaces the rules and budget with other's; cached responses are not
+    // copied
+    void copyRulesFrom(ResponseCache& other);
+    void clear();
+
+    // Cheap check for the request path: a budget and at least one rule.
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // TTL for a request, or 0 if it is not cacheable.
+    uint64_t ttlMicros(const std::string& method, const std::string& url);
+
+    // Finds a fresh entry, counting a hit or a miss.
+    bool lookup(const std::string& method, const std::string& url,
+                uint64_t nowMicros, CachedResponse& response);
+    // True if a fresh entry exists; not counted.
+    bool contains(const std::string& method, const std::string& url, uint64_t nowMicros);
+
+    // Keeps a 200 response unless it is marked no-store or exceeds the
+    // budget. Set-Cookie headers are stripped so hits never replay them.
+    void store(const std::string& method, const std::string& url, CachedResponse response,
+               uint64_t ttlMicros, uint64_t nowMicros);
+
+    ResponseCacheStats stats();
+
+private:
+    struct Entry {
+        std::string key;
+        CachedResponse response;
+        uint64_t expiresMicros;
+        size_t bytes;
+    };
+    struct Rule {
+        std::regex pattern;
+        uint64_t ttlMicros;
+    };
+    typedef std::list<Entry>::iterator EntryIt;
+
+    static std::string makeKey(const std::string& method, const std::string& url);
+    void eraseLocked(EntryIt it);
+    void trimLocked(size_t target);
+    void updateEnabledLocked();
+
+    std::mutex m_mutex;
+    std::list<Entry> m_lru;  // most recently used first
+    std::unordered_map<std::string, EntryIt> m_index;
+    std::vector<Rule> m_rules;
+    size_t m_budget = 0;
+    std::atomic<bool> m_enabled{false};
+    ResponseCacheStats m_stats = {};
+};
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "TextConvert.h"
+#include "UrlParser.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WEBVIEW_SSE2 1
+#endif
+
+static const uint32_t kReplacement = 0xFFFD;
+
+// Widens the leading ASCII bytes of s in blocks; returns how many were
+// converted (the caller finishes any shorter tail)
+static size_t AsciiToWide(const uint8_t* s, size_t length, wchar_t* out) {
+    size_t i = 0;
+#ifdef WEBVIEW_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        if (_mm_movemask_epi8(v)) break;
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i* dst = reinterpret_cast<__m128i*>(out + i);
+        if (sizeof(wchar_t) == 2) {
+            _mm_storeu_si128(dst, lo);
+            _mm_storeu_si128(dst + 1, hi);
+        } else {
+            _mm_storeu_si128(dst, _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(hi, zero));
+        }
+    }
+#else
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, s + i, 8);
+        if (word & 0x8080808080808080ull) break;
+        for (int k = 0; k < 8; k++) out[i + k] = static_cast<wchar_t>(s[i + k]);
+    }
+#endif
+    return i;
+}
+
+// Narrows the leading ASCII characters of w in blocks; returns how many
+// were converted
+static size_t AsciiToUtf8(const wchar_t* w, size_t length, char* out) {
+    size_t i = 0;
+#ifdef WEBVIEW_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16) {
+        const __m128i* src = reinterpret_cast<const __m128i*>(w + i);
+        __m128i packed;
+        if (sizeof(wchar_t) == 2) {
+            __m128i a = _mm_loadu_si128(src);
+            __m128i b = _mm_loadu_si128(src + 1);
+            __m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xFF80)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF) break;
+            packed = _mm_packus_epi16(a, b);
+        } else {
+            __m128i a = _mm_loadu_si128(src);
+            __m128i b = _mm_loadu_si128(src + 1);
+            __m128i c = _mm_loadu_si128(src + 2);
+            __m128i d = _mm_loadu_si128(src + 3);
+            __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+            __m128i high = _mm_and_si128(any, _mm_set1_epi32(static_cast<int>(0xFFFFFF80)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) != 0xFFFF) break;
+            packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+#else
+    (void)w;
+    (void)length;
+    (void)out;
+#endif
+    return i;
+}
+
+static inline size_t PutCodePoint(wchar_t* out, uint32_t cp) {
+    if (sizeof(wchar_t) == 2 && cp > 0xFFFF) {
+        cp -= 0x10000;
+        out[0] = static_cast<wchar_t>(0xD800 + (cp >> 10));
+        out[1] = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+        return 2;
+    }
+    out[0] = static_cast<wchar_t>(cp);
+    return 1;
+}
+
+static inline size_t PutUtf8(char* out, uint32_t cp) {
+    if (cp < 0x80) {
+        out[0] = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (cp >> 6));
+        out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (cp >> 12));
+        out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (cp >> 18));
+    out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+size_t Utf8ToWide(const char* utf8, size_t length, wchar_t* out) {
+    if (!utf8) return 0;
+    const uint8_t* s = reinterpret_cast<const uint8_t*>(utf8);
+    size_t i = 0;
+    size_t o = 0;
+    while (i < length) {
+        uint8_t c = s[i];
+        if (c < 0x80) {
+            size_t n = AsciiToWide(s + i, length - i, out + o);
+            i += n;
+            o += n;
+            while (i < length && s[i] < 0x80) out[o++] = static_cast<wchar_t>(s[i++]);
+            continue;
+        }
+        // Well-formed sequences per Unicode table 3-7; each maximal invalid
+        // subpart yields a single U+FFFD
+        int need;
+        uint32_t cp;
+        uint8_t lo = 0x80, hi = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            need = 1;
+            cp = c & 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            need = 2;
+            cp = c & 0x0F;
+            if (c == 0xE0) lo = 0xA0;
+            if (c == 0xED) hi = 0x9F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            need = 3;
+            cp = c & 0x07;
+            if (c == 0xF0) lo = 0x90;
+            if (c == 0xF4) hi = 0x8F;
+        } else {
+            out[o++] = static_cast<wchar_t>(kReplacement);
+            i++;
+            continue;
+        }
+        size_t j = i + 1;
+        int got = 0;
+        for (; got < need && j < length; got++, j++) {
+            uint8_t b = s[j];
+            if (b < lo || b > hi) break;
+            lo = 0x80;
+            hi = 0xBF;
+            cp = (cp << 6) | (b & 0x3F);
+        }
+        o += PutCodePoint(out + o, got == need ? cp : kReplacement);
+        i = j;
+    }
+    return o;
+}
+
+size_t WideToUtf8(const wchar_t* wide, size_t length, char* out) {
+    if (!wide) return 0;
+    size_t i = 0;
+    size_t o = 0;
+    while (i < length) {
+        uint32_t cp = static_cast<uint32_t>(wide[i]);
+        if (cp < 0x80) {
+            size_t n = AsciiToUtf8(wide + i, length - i, out + o);
+            i += n;
+            o += n;
+            while (i < length && static_cast<uint32_t>(wide[i]) < 0x80) out[o++] = static_cast<char>(wide[i++]);
+            continue;
+        }
+        i++;
+        if (cp >= 0xD800 && cp <= 0xDBFF && i < length &&
+            static_cast<uint32_t>(wide[i]) >= 0xDC00 && static_cast<uint32_t>(wide[i]) <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (static_cast<uint32_t>(wide[i]) - 0xDC00);
+            i++;
+        } else if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) {
+            cp = kReplacement;  // lone surrogate or out of range
+        }
+        o += PutUtf8(out + o, cp);
+    }
+    return o;
+}
+
+void AppendUtf8ToWide(std::wstring& out, const char* utf8, size_t length) {
+    if (!utf8 || !length) return;
+    size_t start = out.size();
+    out.resize(start + Utf8ToWideBound(length));
+    out.resize(start + Utf8ToWide(utf8, length, &out[start]));
+}
+
+void AppendWideToUtf8(std::string& out, const wchar_t* wide, size_t length) {
+    if (!wide || !length) return;
+    size_t start = out.size();
+    out.resize(start + WideToUtf8Bound(length));
+    out.resize(start + WideToUtf8(wide, length, &out[start]));
+}
+
+std::wstring Utf8ToWide(const char* utf8) {
+    if (!utf8 || !*utf8) return L"";
+    return Utf8ToWide(utf8, strlen(utf8));
+}
+
+std::wstring Utf8ToWide(const char* utf8, size_t length) {
+    std::wstring out;
+    AppendUtf8ToWide(out, utf8, length);
+    return out;
+}
+
+std::string WideToUtf8(const wchar_t* wide) {
+    if (!wide || !*wide) return "";
+    return WideToUtf8(wide, wcslen(wide));
+}
+
+std::string WideToUtf8(const wchar_t* wide, size_t length) {
+    std::string out;
+    AppendWideToUtf8(out, wide, length);
+    return out;
+}
+
+std::wstring PercentDecode(const std::wstring& s) {
+    // '%' and hex digits are ASCII, so escapes can be decoded on the UTF-8 form
+    std::string bytes;
+    AppendPercentDecoded(bytes, WideToUtf8(s.data(), s.size()));
+    return Utf8ToWide(bytes.data(), bytes.size());
+}
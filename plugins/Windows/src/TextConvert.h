@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// UTF-8 <-> wide string conversion without the Win32 code page APIs, so it
+// behaves the same on every platform (wchar_t is UTF-16 on Windows and
+// UTF-32 elsewhere). Malformed input becomes U+FFFD, as
+// MultiByteToWideChar/WideCharToMultiByte do.
+
+// Runs of ASCII, the bulk of URLs, scripts and messages, are converted
+// 16 characters at a time.
+
+std::wstring Utf8ToWide(const char* utf8);
+std::wstring Utf8ToWide(const char* utf8, size_t length);
+std::string WideToUtf8(const wchar_t* wide);
+std::string WideToUtf8(const wchar_t* wide, size_t length);
+
+// Conversion into caller-provided buffers, which must hold the bound for
+// the input length. Returns the number of units written (no terminator).
+inline size_t Utf8ToWideBound(size_t length) { return length; }
+inline size_t WideToUtf8Bound(size_t length) { return length * (sizeof(wchar_t) == 2 ? 3 : 4); }
+size_t Utf8ToWide(const char* utf8, size_t length, wchar_t* out);
+size_t WideToUtf8(const wchar_t* wide, size_t length, char* out);
+
+// Appends the conversion to out; clear() a long-lived string first to reuse
+// its capacity instead of allocating per call.
+void AppendUtf8ToWide(std::wstring& out, const char* utf8, size_t length);
+void AppendWideToUtf8(std::string& out, const wchar_t* wide, size_t length);
+
+// Decodes %XX escapes, treating the escaped bytes as UTF-8.
+std::wstring PercentDecode(const std::wstring& s);
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "TextInput.h"
+#include "JsonEscape.h"
+
+#include <cwchar>
+
+// VK_BACK, VK_TAB, VK_RETURN, VK_ESCAPE, VK_DELETE
+unsigned TypedKeyToVirtualKey(unsigned code) {
+    switch (code) {
+    case 0x08: return 0x08;
+    case 0x09: return 0x09;
+    case 0x0D: case 0x0A: return 0x0D;
+    case 0x1B: return 0x1B;
+    case 0x7F: return 0x2E;
+    default: return 0;
+    }
+}
+
+void AppendTypedInput(std::vector<TypedInput>& out, const wchar_t* text, size_t length) {
+    out.reserve(out.size() + length);
+    for (size_t i = 0; i < length; i++) {
+        unsigned c = static_cast<unsigned>(text[i]) & 0xFFFF;
+        if (c == 0x0D && i + 1 < length && text[i + 1] == 0x0A) i++;
+        if (unsigned vk = TypedKeyToVirtualKey(c)) {
+            out.push_back(TypedInput{true, static_cast<uint16_t>(vk)});
+        } else if (c >= 0x20) {
+            out.push_back(TypedInput{false, static_cast<uint16_t>(c)});
+        }
+    }
+}
+
+std::wstring InsertTextParams(const wchar_t* text, size_t length) {
+    std::wstring params = L"{\"text\":\"";
+    AppendJsonEscaped(params, std::wstring_view(text, length));
+    params += L"\"}";
+    return params;
+}
+
+std::wstring CompositionParams(const wchar_t* text, size_t length, int cursor) {
+    if (cursor < 0 || static_cast<size_t>(cursor) > length) cursor = static_cast<int>(length);
+    std::wstring params = L"{\"text\":\"";
+    AppendJsonEscaped(params, std::wstring_view(text, length));
+    params += L'"';
+    wchar_t range[64];
+    swprintf(range, 64, L",\"selectionStart\":%d,\"selectionEnd\":%d}", cursor, cursor);
+    params += range;
+    return params;
+}
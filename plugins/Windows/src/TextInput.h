@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Windows virtual key for a control character Unity reports as typed
+// (backspace, tab, enter, escape, delete), or 0 for ordinary text.
+unsigned TypedKeyToVirtualKey(unsigned code);
+
+// One window message of typed text: a key press (down and up) for a
+// control character, else a WM_CHAR code unit.
+struct TypedInput {
+    bool key;
+    uint16_t code;  // virtual key, or UTF-16 code unit
+};
+
+// Expands text into the messages that type it, as _CWebViewPlugin_SendText
+// posts them. CRLF counts as one enter; other control characters without a
+// key are dropped. Surrogate pairs go out as two WM_CHARs, as from a keyboard.
+void AppendTypedInput(std::vector<TypedInput>& out, const wchar_t* text, size_t length);
+
+// DevTools params for Input.insertText and Input.imeSetComposition; cursor is
+// the caret within the composition, clamped to it.
+std::wstring InsertTextParams(const wchar_t* text, size_t length);
+std::wstring CompositionParams(const wchar_t* text, size_t length, int cursor);
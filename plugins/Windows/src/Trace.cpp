@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "Trace.h"
+#include "JsonEscape.h"
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> g_traceEnabled{false};
+
+static const uint64_t kRingSize = 1 << 14;  // events kept per thread
+
+// Every field is atomic so the writer and a concurrent dump never race;
+// seq is a per-slot seqlock (odd while the owner thread writes it).
+struct TraceEvent {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> ts{0};
+    std::atomic<uint64_t> dur{0};
+    std::atomic<int64_t> arg{0};
+    std::atomic<uint32_t> tid{0};
+    std::atomic<char> phase{0};
+};
+
+struct TraceRing {
+    std::atomic<uint64_t> head{0};
+    TraceEvent events[kRingSize];
+};
+
+// Rings outlive their threads so a dump still shows what exited threads
+// did; a new thread reuses a released ring. Leaked on purpose, like the
+// other process-wide singletons, to stay out of DLL unload ordering.
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<TraceRing*> rings;
+    std::vector<TraceRing*> freeRings;
+    std::vector<const char*> threadNames;  // indexed by tid - 1
+};
+
+static TraceRegistry& Registry() {
+    static TraceRegistry* registry = new TraceRegistry();
+    return *registry;
+}
+
+struct TraceThread {
+    TraceRing* ring = nullptr;
+    uint32_t tid = 0;
+    const char* name = nullptr;
+
+    ~TraceThread() {
+        if (!ring) return;
+        TraceRegistry& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.freeRings.push_back(ring);
+    }
+};
+
+static thread_local TraceThread t_trace;
+
+static TraceThread& CurrentThread() {
+    if (!t_trace.ring) {
+        TraceRegistry& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (!registry.freeRings.empty()) {
+            t_trace.ring = registry.freeRings.back();
+            registry.freeRings.pop_back();
+        } else {
+            t_trace.ring = new TraceRing();
+            registry.rings.push_back(t_trace.ring);
+        }
+        registry.threadNames.push_back(t_trace.name);
+        t_trace.tid = static_cast<uint32_t>(registry.threadNames.size());
+    }
+    return t_trace;
+}
+
+void SetTraceEnabled(bool enabled) {
+    g_traceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t TraceNowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void TraceSetThreadName(const char* name) {
+    if (t_trace.name == name) return;
+    t_trace.name = name;
+    if (!t_trace.ring) return;
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threadNames[t_trace.tid - 1] = name;
+}
+
+static void Record(char phase, const char* name, uint64_t ts, uint64_t dur, int64_t arg) {
+    TraceThread& thread = CurrentThread();
+    TraceRing* ring = thread.ring;
+    uint64_t i = ring->head.load(std::memory_order_relaxed);
+    TraceEvent& e = ring->events[i % kRingSize];
+    e.seq.store(2 * i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.name.store(name, std::memory_order_relaxed);
+    e.ts.store(ts, std::memory_order_relaxed);
+    e.dur.store(dur, std::memory_order_relaxed);
+    e.arg.store(arg, std::memory_order_relaxed);
+    e.tid.store(thread.tid, std::memory_order_relaxed);
+    e.phase.store(phase, std::memory_order_relaxed);
+    e.seq.store(2 * i + 2, std::memory_order_release);
+    ring->head.store(i + 1, std::memory_order_release);
+}
+
+void TraceComplete(const char* name, uint64_t start, uint64_t duration, int64_t arg) {
+    Record('X', name, start, duration, arg);
+}
+
+void TraceInstant(const char* name, int64_t arg) {
+    Record('i', name, TraceNowMicros(), 0, arg);
+}
+
+void TraceClear() {
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (TraceRing* ring : registry.rings) {
+        // Invalidates the slots without moving head, which only the owner
+        // thread may write
+        for (uint64_t i = 0; i < kRingSize; i++)
+            ring->events[i].seq.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string TraceToJson() {
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    char buf[160];
+    for (size_t t = 0; t < registry.threadNames.size(); t++) {
+        if (!registry.threadNames[t]) continue;
+        snprintf(buf, sizeof(buf), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                 first ? "" : ",", static_cast<unsigned>(t + 1));
+        json += buf;
+        AppendJsonEscaped(json, registry.threadNames[t]);
+        json += "\"}}";
+        first = false;
+    }
+    for (TraceRing* ring : registry.rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = head > kRingSize ? head - kRingSize : 0;
+        for (uint64_t i = begin; i < head; i++) {
+            TraceEvent& e = ring->events[i % kRingSize];
+            uint64_t seq = e.seq.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2) continue;
+            const char* name = e.name.load(std::memory_order_relaxed);
+            uint64_t ts = e.ts.load(std::memory_order_relaxed);
+            uint64_t dur = e.dur.load(std::memory_order_relaxed);
+            long long arg = e.arg.load(std::memory_order_relaxed);
+            unsigned tid = e.tid.load(std::memory_order_relaxed);
+            char phase = e.phase.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (e.seq.load(std::memory_order_relaxed) != seq) continue;  // overwritten meanwhile
+
+            json += first ? "{\"name\":\"" : ",{\"name\":\"";
+            first = false;
+            AppendJsonEscaped(json, name ? name : "");
+            if (phase == 'X') {
+                snprintf(buf, sizeof(buf),
+                         "\",\"cat\":\"webview\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%lld}}",
+                         static_cast<unsigned long long>(ts), static_cast<unsigned long long>(dur), tid, arg);
+            } else {
+                snprintf(buf, sizeof(buf),
+                         "\",\"cat\":\"webview\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%lld}}",
+                         static_cast<unsigned long long>(ts), tid, arg);
+            }
+            json += buf;
+        }
+    }
+    json += "]}";
+    return json;
+}
+
+bool WriteTraceFile(const char* path) {
+    if (!path || !*path) return false;
+    std::string json = TraceToJson();
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(json.data(), 1, json.size(), f) == json.size();
+    return fclose(f) == 0 && ok;
+}
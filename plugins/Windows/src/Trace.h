@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Lightweight tracing of the native pipeline in Chrome trace_event format
+// (load the output in chrome://tracing or Perfetto). Each thread records
+// into its own lock-free ring of the most recent events; when tracing is
+// off a span costs one relaxed load.
+//
+// Event and thread names must be string literals (only the pointer is kept).
+
+extern std::atomic<bool> g_traceEnabled;
+
+inline bool TraceEnabled() { return g_traceEnabled.load(std::memory_order_relaxed); }
+void SetTraceEnabled(bool enabled);
+
+uint64_t TraceNowMicros();
+
+// Names the calling thread in the trace; cheap enough to call per event.
+void TraceSetThreadName(const char* name);
+
+void TraceComplete(const char* name, uint64_t start, uint64_t duration, int64_t arg);
+void TraceInstant(const char* name, int64_t arg);
+
+// Drops every recorded event.
+void TraceClear();
+
+// Formats the recorded events as a trace_event JSON document.
+std::string TraceToJson();
+bool WriteTraceFile(const char* path);
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, int64_t arg = 0)
+        : m_name(TraceEnabled() ? name : nullptr)
+        , m_arg(arg)
+        , m_start(m_name ? TraceNowMicros() : 0) {}
+    ~TraceScope() {
+        if (m_name) TraceComplete(m_name, m_start, TraceNowMicros() - m_start, m_arg);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_arg;
+    uint64_t m_start;
+};
+
+#define WEBVIEW_TRACE_CONCAT2(a, b) a##b
+#define WEBVIEW_TRACE_CONCAT(a, b) WEBVIEW_TRACE_CONCAT2(a, b)
+#define WEBVIEW_TRACE_SCOPE(name) \
+    TraceScope WEBVIEW_TRACE_CONCAT(traceScope, __LINE__)(name)
+#define WEBVIEW_TRACE_SCOPE_ARG(name, arg) \
+    TraceScope WEBVIEW_TRACE_CONCAT(traceScope, __LINE__)(name, static_cast<int64_t>(arg))
+#define WEBVIEW_TRACE_INSTANT(name, arg) \
+    do { if (TraceEnabled()) TraceInstant(name, static_cast<int64_t>(arg)); } while (0)
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "UrlFilter.h"
+#include "TextConvert.h"
+
+static std::unique_ptr<std::wregex> Compile(const char* pattern) {
+    if (!pattern || !*pattern) return nullptr;
+    return std::make_unique<std::wregex>(Utf8ToWide(pattern));
+}
+
+bool UrlFilter::setPatterns(const char* allow, const char* deny, const char* hook) {
+    std::unique_ptr<std::wregex> allowRegex, denyRegex, hookRegex;
+    try {
+        allowRegex = Compile(allow);
+        denyRegex = Compile(deny);
+        hookRegex = Compile(hook);
+    } catch (...) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_allow = std::move(allowRegex);
+    m_deny = std::move(denyRegex);
+    m_hook = std::move(hookRegex);
+    return true;
+}
+
+static std::unique_ptr<std::wregex> Copy(const std::unique_ptr<std::wregex>& regex) {
+    return regex ? std::make_unique<std::wregex>(*regex) : nullptr;
+}
+
+void UrlFilter::copyFrom(UrlFilter& other) {
+    if (&other == this) return;
+    std::unique_ptr<std::wregex> allowRegex, denyRegex, hookRegex;
+    {
+        std::lock_guard<std::mutex> lock(other.m_mutex);
+        allowRegex = Copy(other.m_allow);
+        denyRegex = Copy(other.m_deny);
+        hookRegex = Copy(other.m_hook);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_allow = std::move(allowRegex);
+    m_deny = std::move(denyRegex);
+    m_hook = std::move(hookRegex);
+}
+
+UrlFilterResult UrlFilter::check(std::wstring_view url) {
+    const wchar_t* begin = url.data();
+    const wchar_t* end = begin + url.size();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try {
+        if (m_hook && std::regex_search(begin, end, *m_hook)) return URL_FILTER_HOOK;
+    } catch (...) {}
+    try {
+        if (m_deny && std::regex_search(begin, end, *m_deny) &&
+            !(m_allow && std::regex_search(begin, end, *m_allow)))
+            return URL_FILTER_DENY;
+    } catch (...) {}
+    return URL_FILTER_PASS;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <string_view>
+
+enum UrlFilterResult {
+    URL_FILTER_PASS,
+    URL_FILTER_DENY,  // cancel the navigation
+    URL_FILTER_HOOK,  // cancel it and report CallOnHooked
+};
+
+// The allow/deny/hook patterns of _CWebViewPlugin_SetURLPattern.
+class UrlFilter {
+public:
+    // Empty or null patterns are disabled. Returns false, leaving the
+    // current patterns in place, if any pattern is not a valid regex.
+    bool setPatterns(const char* allow, const char* deny, const char* hook);
+    // Replaces these patterns with a copy of other's
+    void copyFrom(UrlFilter& other);
+
+    // Hook wins; otherwise a deny match blocks unless allow also matches.
+    UrlFilterResult check(std::wstring_view url);
+
+private:
+    std::unique_ptr<std::wregex> m_allow;
+    std::unique_ptr<std::wregex> m_deny;
+    std::unique_ptr<std::wregex> m_hook;
+    std::mutex m_mutex;
+};
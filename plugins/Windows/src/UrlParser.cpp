@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "UrlParser.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WEBVIEW_SSE2 1
+#endif
+
+static inline bool IsAlpha(unsigned c) { return (c | 0x20) >= 'a' && (c | 0x20) <= 'z'; }
+static inline bool IsDigit(unsigned c) { return c >= '0' && c <= '9'; }
+
+template <typename CharT>
+static bool ParseUrlImpl(std::basic_string_view<CharT> url, BasicUrlParts<CharT>& parts) {
+    typedef std::basic_string_view<CharT> View;
+    parts = BasicUrlParts<CharT>();
+    size_t n = url.size();
+
+    // scheme = ALPHA *( ALPHA / DIGIT / "+" / "-" / "." ) ":"
+    size_t i = 0;
+    if (n == 0 || !IsAlpha(static_cast<unsigned>(url[0]))) return false;
+    for (i = 1; i < n; i++) {
+        unsigned c = static_cast<unsigned>(url[i]);
+        if (!IsAlpha(c) && !IsDigit(c) && c != '+' && c != '-' && c != '.') break;
+    }
+    if (i == n || url[i] != ':') return false;
+    parts.scheme = url.substr(0, i);
+    i++;
+
+    if (i + 1 < n && url[i] == '/' && url[i + 1] == '/') {
+        i += 2;
+        size_t start = i;
+        size_t at = View::npos;
+        size_t colon = View::npos;
+        bool bracket = false;
+        for (; i < n; i++) {
+            CharT c = url[i];
+            if (c == '/' || c == '?' || c == '#') break;
+            if (c == '@') {
+                at = i;
+                colon = View::npos;
+            } else if (c == '[') {
+                bracket = true;
+            } else if (c == ']') {
+                bracket = false;
+            } else if (c == ':' && !bracket) {
+                colon = i;
+            }
+        }
+        parts.hasAuthority = true;
+        parts.authority = url.substr(start, i - start);
+        size_t hostStart = at == View::npos ? start : at + 1;
+        size_t hostEnd = colon == View::npos ? i : colon;
+        parts.host = url.substr(hostStart, hostEnd - hostStart);
+        if (colon != View::npos) parts.port = url.substr(colon + 1, i - colon - 1);
+    }
+
+    size_t pathStart = i;
+    while (i < n && url[i] != '?' && url[i] != '#') i++;
+    parts.path = url.substr(pathStart, i - pathStart);
+    if (i < n && url[i] == '?') {
+        size_t queryStart = ++i;
+        while (i < n && url[i] != '#') i++;
+        parts.query = View(url.data() + queryStart, i - queryStart);
+    }
+    if (i < n) parts.fragment = View(url.data() + i + 1, n - i - 1);
+    return true;
+}
+
+bool ParseUrl(std::string_view url, UrlParts& parts) {
+    return ParseUrlImpl(url, parts);
+}
+
+bool ParseUrl(std::wstring_view url, WideUrlParts& parts) {
+    return ParseUrlImpl(url, parts);
+}
+
+static inline int HexVal(unsigned c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Offset of the first '%' in s[from, n), or n.
+static size_t FindPercent(const char* s, size_t from, size_t n) {
+    size_t i = from;
+#ifdef WEBVIEW_SSE2
+    const __m128i percent = _mm_set1_epi8('%');
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, percent));
+        if (mask) {
+            unsigned bits = static_cast<unsigned>(mask);
+            while (!(bits & 1)) {
+                bits >>= 1;
+                i++;
+            }
+            return i;
+        }
+    }
+#endif
+    const void* hit = memchr(s + i, '%', n - i);
+    return hit ? static_cast<size_t>(static_cast<const char*>(hit) - s) : n;
+}
+
+void AppendPercentDecoded(std::string& out, std::string_view s) {
+    const char* p = s.data();
+    size_t n = s.size();
+    size_t base = out.size();
+    out.resize(base + n);  // decoding never grows the text
+    char* dst = &out[0] + base;
+    size_t i = 0;
+    while (i < n) {
+        size_t next = FindPercent(p, i, n);
+        memcpy(dst, p + i, next - i);
+        dst += next - i;
+        i = next;
+        if (i == n) break;
+        int hi = i + 2 < n ? HexVal(static_cast<unsigned char>(p[i + 1])) : -1;
+        int lo = hi >= 0 ? HexVal(static_cast<unsigned char>(p[i + 2])) : -1;
+        if (lo >= 0) {
+            *dst++ = static_cast<char>((hi << 4) | lo);
+            i += 3;
+        } else {
+            *dst++ = '%';
+            i++;
+        }
+    }
+    out.resize(static_cast<size_t>(dst - out.data()));
+}
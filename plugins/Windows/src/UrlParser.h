@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// One-pass split of an absolute URL into views of the original string, so
+// the navigation and load paths can inspect URLs without copying them.
+//
+//   scheme://authority/path?query#fragment
+//
+// query and fragment exclude their delimiters and have a null data() when
+// the URL has none. authority is empty (not null) for "file:///C:/x".
+template <typename CharT>
+struct BasicUrlParts {
+    std::basic_string_view<CharT> scheme;
+    std::basic_string_view<CharT> authority;
+    std::basic_string_view<CharT> host;  // authority without userinfo and port
+    std::basic_string_view<CharT> port;
+    std::basic_string_view<CharT> path;
+    std::basic_string_view<CharT> query;
+    std::basic_string_view<CharT> fragment;
+    bool hasAuthority = false;
+};
+
+typedef BasicUrlParts<char> UrlParts;
+typedef BasicUrlParts<wchar_t> WideUrlParts;
+
+// Returns false, leaving parts cleared, if url has no valid scheme.
+bool ParseUrl(std::string_view url, UrlParts& parts);
+bool ParseUrl(std::wstring_view url, WideUrlParts& parts);
+
+// ASCII case-insensitive comparison against a lowercase scheme name.
+template <typename CharT>
+bool UrlSchemeIs(std::basic_string_view<CharT> scheme, const char* lower) {
+    size_t i = 0;
+    for (; lower[i]; i++) {
+        if (i >= scheme.size()) return false;
+        CharT c = scheme[i];
+        if (c >= 'A' && c <= 'Z') c = static_cast<CharT>(c + ('a' - 'A'));
+        if (c != static_cast<CharT>(lower[i])) return false;
+    }
+    return i == scheme.size();
+}
+
+// Appends s with %XX escapes decoded; malformed escapes are copied as is.
+// Runs without a '%' are copied 16 bytes at a time.
+void AppendPercentDecoded(std::string& out, std::string_view s);
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "UserScripts.h"
+#include "TextConvert.h"
+
+#include <cstring>
+
+// FNV-1a; equal hashes are confirmed against the source
+static uint64_t HashSource(const char* source, size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<uint8_t>(source[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+UserScriptRegistry& UserScriptRegistry::instance() {
+    // Never destroyed; instances may still sync during DLL unload
+    static UserScriptRegistry* registry = new UserScriptRegistry();
+    return *registry;
+}
+
+int UserScriptRegistry::add(const char* source, bool* created) {
+    if (created) *created = false;
+    if (!source || !*source) return 0;
+    size_t length = strlen(source);
+    uint64_t hash = HashSource(source, length);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto range = m_byHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        Entry& entry = m_scripts[it->second];
+        if (entry.source.size() != length || memcmp(entry.source.data(), source, length) != 0) continue;
+        entry.refs++;
+        m_deduplicated++;
+        return it->second;
+    }
+    int id = m_nextId++;
+    Entry& entry = m_scripts[id];
+    entry.source.assign(source, length);
+    entry.wide = std::make_shared<const std::wstring>(Utf8ToWide(source));
+    entry.hash = hash;
+    entry.refs = 1;
+    m_byHash.emplace(hash, id);
+    if (created) *created = true;
+    return id;
+}
+
+bool UserScriptRegistry::remove(int id, bool* dropped) {
+    if (dropped) *dropped = false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_scripts.find(id);
+    if (it == m_scripts.end()) return false;
+    if (--it->second.refs > 0) return true;
+    auto range = m_byHash.equal_range(it->second.hash);
+    for (auto h = range.first; h != range.second; ++h) {
+        if (h->second != id) continue;
+        m_byHash.erase(h);
+        break;
+    }
+    m_scripts.erase(it);
+    if (dropped) *dropped = true;
+    return true;
+}
+
+void UserScriptRegistry::snapshot(std::vector<UserScript>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.reserve(out.size() + m_scripts.size());
+    for (const auto& script : m_scripts) out.push_back(UserScript{script.first, script.second.wide});
+}
+
+size_t UserScriptRegistry::size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_scripts.size();
+}
+
+uint64_t UserScriptRegistry::deduplicated() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_deduplicated;
+}
+
+void UserScriptSync::update(const std::vector<UserScript>& wanted, std::vector<UserScript>& adds,
+                            std::vector<std::wstring>& removes) {
+    std::map<int, std::wstring> kept;
+    for (const UserScript& script : wanted) {
+        auto it = m_scripts.find(script.id);
+        if (it != m_scripts.end()) {
+            kept.emplace(script.id, std::move(it->second));
+            m_scripts.erase(it);
+        } else if (kept.emplace(script.id, std::wstring()).second) {
+            adds.push_back(script);
+        }
+    }
+    // Pending ones left here are removed when their id arrives (see added)
+    for (auto& dropped : m_scripts) {
+        if (!dropped.second.empty()) removes.push_back(std::move(dropped.second));
+    }
+    m_scripts.swap(kept);
+}
+
+bool UserScriptSync::added(int id, const wchar_t* webviewId) {
+    auto it = m_scripts.find(id);
+    if (it == m_scripts.end() || !it->second.empty() || !webviewId || !*webviewId) return false;
+    it->second = webviewId;
+    return true;
+}
+
+void UserScriptSync::failed(int id) {
+    auto it = m_scripts.find(id);
+    if (it != m_scripts.end() && it->second.empty()) m_scripts.erase(it);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct UserScript {
+    int id;
+    std::shared_ptr<const std::wstring> source;  // UTF-16, as WebView2 takes it
+};
+
+// Scripts every instance runs at document creation
+// (_CWebViewPlugin_AddUserScript). Registering the same source again returns
+// the id it already has and takes another reference; ids are never reused.
+// Thread-safe.
+class UserScriptRegistry {
+public:
+    static UserScriptRegistry& instance();
+
+    // Returns the script's id, or 0 for a null or empty source. created
+    // tells whether the set of scripts changed.
+    int add(const char* source, bool* created = nullptr);
+    // Drops one reference; the script goes with the last, as dropped tells.
+    // False for an unknown id.
+    bool remove(int id, bool* dropped = nullptr);
+    void snapshot(std::vector<UserScript>& out);
+
+    size_t size();
+    uint64_t deduplicated();  // adds answered with an existing script
+
+private:
+    struct Entry {
+        std::string source;
+        std::shared_ptr<const std::wstring> wide;
+        uint64_t hash;
+        int refs;
+    };
+
+    UserScriptRegistry() = default;
+
+    std::mutex m_mutex;
+    std::map<int, Entry> m_scripts;
+    std::unordered_multimap<uint64_t, int> m_byHash;
+    int m_nextId = 1;
+    uint64_t m_deduplicated = 0;
+};
+
+// The document-created scripts one WebView2 instance holds, kept in step with
+// a wanted list. WebView2 hands out its id for an added script
+// asynchronously, so a script may be wanted, dropped and wanted again before
+// the id arrives. Not thread-safe; used on the instance's own thread.
+class UserScriptSync {
+public:
+    // Fills adds with the wanted scripts not held yet, marking them pending,
+    // and removes with the WebView2 ids of held scripts no longer wanted
+    void update(const std::vector<UserScript>& wanted, std::vector<UserScript>& adds,
+                std::vector<std::wstring>& removes);
+    // Records WebView2's id for a pending add. False when the script is not
+    // wanted any more or is already held; the caller then removes webviewId.
+    bool added(int id, const wchar_t* webviewId);
+    // A pending add failed; the next update tries again
+    void failed(int id);
+
+    size_t size() const { return m_scripts.size(); }
+
+private:
+    std::map<int, std::wstring> m_scripts;  // id -> WebView2 id, empty while pending
+};
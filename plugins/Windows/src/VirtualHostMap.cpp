@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "VirtualHostMap.h"
+#include "TextConvert.h"
+#include "UrlParser.h"
+
+bool VirtualHostMap::rewrite(std::string_view url, std::wstring& navigateUrl,
+                             std::wstring& folder, std::wstring& hostName, bool& newMapping) {
+    newMapping = false;
+    UrlParts parts;
+    if (!ParseUrl(url, parts) || !UrlSchemeIs(parts.scheme, "file") || !parts.hasAuthority)
+        return false;
+
+    // Everything after file:// up to the query or fragment is the path, so
+    // file://server/share/... keeps its host as the first component
+    const char* pathEnd = parts.path.data() + parts.path.size();
+    std::string_view local(parts.authority.data(), pathEnd - parts.authority.data());
+    std::string_view suffix = url.substr(pathEnd - url.data());
+    // Strip leading slash for Windows paths like /C:/...
+    if (local.size() > 2 && local[0] == '/' && local[2] == ':') local.remove_prefix(1);
+
+    // Percent-decode each segment, joining them with backslashes, so an
+    // escaped %2F stays part of its name (e.g. %20→space, %C3%A9→é)
+    m_path.clear();
+    for (size_t start = 0;;) {
+        size_t slash = local.find('/', start);
+        AppendPercentDecoded(m_path, local.substr(start, slash - start));
+        if (slash == std::string_view::npos) break;
+        m_path += '\\';
+        start = slash + 1;
+    }
+    m_widePath.clear();
+    AppendUtf8ToWide(m_widePath, m_path.data(), m_path.size());
+
+    // Extract directory and filename
+    auto lastSlash = m_widePath.rfind(L'\\');
+    if (lastSlash == std::wstring::npos) return false;
+    std::wstring_view folderView(m_widePath.data(), lastSlash);
+    std::wstring_view filename(m_widePath.data() + lastSlash + 1, m_widePath.size() - lastSlash - 1);
+
+    // Reuse existing host for this folder, or create a new one
+    const std::wstring* host;
+    auto it = m_hosts.find(folderView);
+    if (it != m_hosts.end()) {
+        host = &it->second;
+    } else {
+        folder.assign(folderView);
+        hostName = L"localapp" + std::to_wstring(m_counter++) + L".webview";
+        host = &m_hosts.emplace(folder, hostName).first->second;
+        newMapping = true;
+    }
+
+    navigateUrl.assign(L"https://");
+    navigateUrl += *host;
+    navigateUrl += L'/';
+    navigateUrl += filename;
+    AppendUtf8ToWide(navigateUrl, suffix.data(), suffix.size());
+    return true;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+
+// Serves file:// URLs through per-folder virtual hosts
+// (https://localappN.webview/), since WebView2 blocks JS modules and CORS
+// on file:// origins.
+class VirtualHostMap {
+public:
+    // Rewrites a file:// URL to https://<host>/<file>[?query][#fragment].
+    // Returns false for other URLs and paths without a folder. newMapping is
+    // set when a folder got a new host, which the caller then has to register
+    // with SetVirtualHostNameToFolderMapping; folder and hostName are only
+    // filled in that case. Reuses internal buffers, so a repeat load of a
+    // known folder allocates nothing beyond navigateUrl's growth.
+    bool rewrite(std::string_view url, std::wstring& navigateUrl,
+                 std::wstring& folder, std::wstring& hostName, bool& newMapping);
+
+private:
+    std::map<std::wstring, std::wstring, std::less<>> m_hosts;
+    int m_counter = 0;
+    std::string m_path;       // decoded UTF-8 path, reused across calls
+    std::wstring m_widePath;
+};
@@ -21,16 +21,19 @@
 
 #include <windows.h>
 #include <shlwapi.h>
+#include <psapi.h>
+#include <tlhelp32.h>
 #include <wincodec.h>
 #include <string>
-#include <queue>
 #include <mutex>
 #include <thread>
 #include <vector>
 #include <map>
+#include <deque>
+#include <algorithm>
 #include <atomic>
 #include <memory>
-#include <regex>
+#include <chrono>
 #include <wrl.h>
 #include <dcomp.h>
 #include <WebView2.h>
@@ -47,6 +50,31 @@
 #include <Windows.Graphics.Capture.Interop.h>
 #include <windows.graphics.directx.direct3d11.interop.h>
 
+#include "CallRecorder.h"
+#include "ChannelRouter.h"
+#include "CookieJar.h"
+#include "CookieSnapshot.h"
+#include "CustomHeaders.h"
+#include "FrameBufferPool.h"
+#include "FrameStore.h"
+#include "InstanceStats.h"
+#include "LifecycleManager.h"
+#include "MessageQueue.h"
+#include "NavigationTracker.h"
+#include "PixelConvert.h"
+#include "Prerender.h"
+#include "RequestBlocker.h"
+#include "ResourceTimeline.h"
+#include "ResponseCache.h"
+#include "TextConvert.h"
+#include "TextInput.h"
+#include "Trace.h"
+#include "UrlFilter.h"
+#include "UrlParser.h"
+#include "UserScripts.h"
+#include "VirtualHostMap.h"
+#include "WorkerPool.h"
+
 using Microsoft::WRL::ComPtr;
 using Microsoft::WRL::Callback;
 
@@ -72,6 +100,11 @@ enum {
     WM_WEBVIEW_GETCOOKIES,
     WM_WEBVIEW_CLEARCOOKIE,
     WM_WEBVIEW_CLEARALLCOOKIES,
+    WM_WEBVIEW_SETCOOKIES,
+    WM_WEBVIEW_SAVECOOKIEJAR,
+    WM_WEBVIEW_SYNCUSERSCRIPTS,
+    WM_WEBVIEW_INPUT,
+    WM_WEBVIEW_RELAYOUT,
 };
 
 struct MouseEventData {
@@ -81,65 +114,144 @@ struct MouseEventData {
     int mouseState;
 };
 
+// Keyboard input routed through the host thread (see queueInput)
+enum {
+    INPUT_KEY,          // a window message for the browser window
+    INPUT_TEXT,         // typed, or committed into the composition
+    INPUT_COMPOSITION,  // the IME composition string; empty ends it
+};
+
+struct InputItem {
+    int kind = INPUT_KEY;
+    UINT msg = 0;
+    WPARAM wParam = 0;
+    LPARAM lParam = 0;
+    std::wstring text;
+    int cursor = 0;
+    uint64_t posted = 0;
+};
+
 struct CookieOpData {
     std::wstring url;
     std::wstring name;
+    int request = 0;  // GetCookieSnapshot id, 0 for the CallOnCookies text
+    uint64_t posted = 0;
+};
+
+struct CookieBatch {
+    std::vector<BrowserCookie> cookies;
+    uint64_t posted;
+};
+
+// A synchronous _CWebViewPlugin_SaveCookieJar; shared with the host thread
+// so a caller that timed out leaves nothing dangling
+struct CookieJarSave {
+    std::string path;
+    bool includeSession;
+    HANDLE done = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    std::atomic<int> result{-1};
+    ~CookieJarSave() { if (done) CloseHandle(done); }
 };
 
+// Number of cookies written by a posted save, or -1 if it failed or the
+// host thread did not finish it within timeoutMs
+static int WaitCookieJarSave(const std::shared_ptr<CookieJarSave>& save, DWORD timeoutMs = 3000) {
+    if (!save || WaitForSingleObject(save->done, timeoutMs) != WAIT_OBJECT_0) return -1;
+    return save->result.load();
+}
+
+static double NowSeconds() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::string TakeCoTaskString(LPWSTR s) {
+    std::string out;
+    if (s) {
+        AppendWideToUtf8(out, s, wcslen(s));
+        CoTaskMemFree(s);
+    }
+    return out;
+}
+
+static void ReadCookieList(ICoreWebView2CookieList* list, std::vector<BrowserCookie>& cookies) {
+    UINT count = 0;
+    list->get_Count(&count);
+    cookies.reserve(count);
+    for (UINT i = 0; i < count; i++) {
+        ComPtr<ICoreWebView2Cookie> cookie;
+        list->GetValueAtIndex(i, &cookie);
+        if (!cookie) continue;
+        LPWSTR name = nullptr, value = nullptr, domain = nullptr, path = nullptr;
+        cookie->get_Name(&name);
+        cookie->get_Value(&value);
+        cookie->get_Domain(&domain);
+        cookie->get_Path(&path);
+        if (!name || !value) {
+            CoTaskMemFree(name);
+            CoTaskMemFree(value);
+            CoTaskMemFree(domain);
+            CoTaskMemFree(path);
+            continue;
+        }
+        BrowserCookie c;
+        c.name = TakeCoTaskString(name);
+        c.value = TakeCoTaskString(value);
+        c.domain = TakeCoTaskString(domain);
+        c.path = TakeCoTaskString(path);
+        BOOL flag = FALSE;
+        if (SUCCEEDED(cookie->get_IsSession(&flag)) && !flag) cookie->get_Expires(&c.expires);
+        flag = FALSE;
+        cookie->get_IsSecure(&flag);
+        c.secure = flag != FALSE;
+        flag = FALSE;
+        cookie->get_IsHttpOnly(&flag);
+        c.httpOnly = flag != FALSE;
+        COREWEBVIEW2_COOKIE_SAME_SITE_KIND sameSite = COREWEBVIEW2_COOKIE_SAME_SITE_KIND_LAX;
+        cookie->get_SameSite(&sameSite);
+        c.sameSite = static_cast<int>(sameSite);
+        cookies.push_back(std::move(c));
+    }
+}
+
 class WebViewInstance;
 
 static bool s_inEditor = false;
 static std::vector<WebViewInstance*> s_instances;
 static std::mutex s_instancesMutex;
 
-static std::wstring Utf8ToWide(const char* utf8) {
-    if (!utf8 || !*utf8) return L"";
-    int len = MultiByteToWideChar(CP_UTF8, 0, utf8, -1, nullptr, 0);
-    std::wstring result(len - 1, 0);
-    MultiByteToWideChar(CP_UTF8, 0, utf8, -1, &result[0], len);
-    return result;
-}
-
-static std::string WideToUtf8(const wchar_t* wide) {
-    if (!wide || !*wide) return "";
-    int len = WideCharToMultiByte(CP_UTF8, 0, wide, -1, nullptr, 0, nullptr, nullptr);
-    std::string result(len - 1, 0);
-    WideCharToMultiByte(CP_UTF8, 0, wide, -1, &result[0], len, nullptr, nullptr);
-    return result;
-}
-
-static int HexVal(wchar_t c) {
-    if (c >= L'0' && c <= L'9') return c - L'0';
-    if (c >= L'A' && c <= L'F') return c - L'A' + 10;
-    if (c >= L'a' && c <= L'f') return c - L'a' + 10;
-    return -1;
-}
-
-static std::wstring PercentDecode(const std::wstring& s) {
-    std::string bytes;
-    for (size_t i = 0; i < s.size(); i++) {
-        if (s[i] == L'%' && i + 2 < s.size()) {
-            int hi = HexVal(s[i + 1]);
-            int lo = HexVal(s[i + 2]);
-            if (hi >= 0 && lo >= 0) {
-                bytes += static_cast<char>((hi << 4) | lo);
-                i += 2;
-                continue;
-            }
-        }
-        // Non-percent characters: encode back to UTF-8
-        wchar_t wc = s[i];
-        char buf[4];
-        int len = WideCharToMultiByte(CP_UTF8, 0, &wc, 1, buf, sizeof(buf), nullptr, nullptr);
-        bytes.append(buf, len);
-    }
-    // Convert the complete UTF-8 byte sequence to wide string
-    if (bytes.empty()) return L"";
-    int len = MultiByteToWideChar(CP_UTF8, 0, bytes.c_str(), static_cast<int>(bytes.size()), nullptr, 0);
-    std::wstring result(len, 0);
-    MultiByteToWideChar(CP_UTF8, 0, bytes.c_str(), static_cast<int>(bytes.size()), &result[0], len);
-    return result;
-}
+// _CWebViewPlugin_SetCookieJarPath: loaded by the first instance to get a
+// cookie manager (the profile is shared), written by SaveCookies
+static std::mutex s_cookieJarMutex;
+static std::string s_cookieJarPath;
+static bool s_cookieJarSession = true;
+static bool s_cookieJarPending = false;
+
+// Hides scrollbars in offscreen mode; runs at document creation, when
+// neither the head nor the root element need exist yet, so the style is
+// added again (if still missing) once the document is parsed
+static const wchar_t kScrollbarHideScript[] =
+    L"(function() {"
+    L"  var s = document.createElement('style');"
+    L"  s.id = '__wv_no_scrollbar';"
+    L"  s.textContent = '"
+    L"    html::-webkit-scrollbar, body::-webkit-scrollbar, *::-webkit-scrollbar"
+    L"      { display: none !important; width: 0 !important; height: 0 !important; }"
+    L"    html, body, * { scrollbar-width: none !important; -ms-overflow-style: none !important; }"
+    L"  ';"
+    L"  function add() {"
+    L"    var parent = document.head || document.documentElement;"
+    L"    if (parent && !document.getElementById('__wv_no_scrollbar')) {"
+    L"      parent.appendChild(s.cloneNode(true));"
+    L"    }"
+    L"  }"
+    L"  add();"
+    L"  if (document.readyState === 'loading') {"
+    L"    document.addEventListener('DOMContentLoaded', add);"
+    L"  }"
+    L"})();";
+
+// UserScriptSync id of kScrollbarHideScript; registry ids start at 1
+static const int kScrollbarScriptId = -1;
 
 static std::wstring GetUserDataPath() {
     wchar_t tempPath[MAX_PATH];
@@ -187,36 +299,53 @@ class WebViewInstance {
     std::atomic<int> m_width{0};
     std::atomic<int> m_height{0};
     bool m_visible = true;
+    int m_appliedState = LIFECYCLE_VISIBLE;  // host thread only
+    std::atomic<DWORD> m_browserPid{0};
     std::string m_userAgent;
 
-    std::queue<std::string> m_messages;
-    std::mutex m_messageMutex;
+    MessageQueue m_messages;
+    ChannelRouter m_channels;  // Unity.call(channel, payload)
+    std::atomic<int> m_nextCookieRequest{1};
+    // SetCookies batches that arrived before the cookie manager existed
+    std::vector<BrowserCookie> m_pendingCookies;
+    uint64_t m_pendingCookiesPosted = 0;
 
     std::atomic<bool> m_initialized{false};
 
-    std::map<std::string, std::string> m_customHeaders;
-    std::mutex m_headerMutex;
+    CustomHeaders m_customHeaders;
+
+    UrlFilter m_urlFilter;
+    ResponseCache m_responseCache;
+    RequestBlocker m_requestBlocker;
+    ResourceTimeline m_resourceTimeline;
+    NavigationTracker m_navigations;
+    std::atomic<uint64_t> m_pageReadyMicros{0};  // last successful load showed its first frame
+
+    // Sibling loading a page in the background (see _CWebViewPlugin_Prerender)
+    std::mutex m_prerenderMutex;
+    std::unique_ptr<WebViewInstance> m_prerender;
+    std::string m_prerenderUrl;
+    uint64_t m_prerenderStarted = 0;
+
+    UserScriptSync m_userScripts;  // host thread only
 
-    std::unique_ptr<std::wregex> m_allowRegex;
-    std::unique_ptr<std::wregex> m_denyRegex;
-    std::unique_ptr<std::wregex> m_hookRegex;
-    std::mutex m_patternMutex;
+    // Items handed to the host thread and not yet delivered; while any are,
+    // key events queue behind them instead of going straight to the window
+    std::atomic<int> m_inputQueued{0};
+    std::deque<InputItem> m_input;  // host thread only
+    bool m_inputBusy = false;       // a DevTools input call is in flight
+    bool m_composing = false;
 
     std::string m_pendingUrl;
     std::atomic<int> m_devicePixelRatio{1};
 
     // Map folder paths to unique virtual host names for file:// URL serving
-    std::map<std::wstring, std::wstring> m_folderHostMap;
-    int m_hostCounter = 0;
-
-    // Double-buffered bitmap storage for offscreen capture
-    std::vector<uint8_t> m_bitmaps[2];
-    int m_currentBitmap = 0;
-    int m_bitmapWidth = 0;
-    int m_bitmapHeight = 0;
-    bool m_needsDisplay = false;
+    VirtualHostMap m_virtualHosts;
+    std::wstring m_navigateUrl;  // WM_WEBVIEW_LOADURL buffer, reused across loads
+
+    // Set while a capture is in flight; also keeps frame writers out while
+    // the frame is parked (see lockFrameWriters)
     std::atomic<bool> m_inRendering{false};
-    std::mutex m_bitmapMutex;
 
     std::string m_basicAuthUser;
     std::string m_basicAuthPass;
@@ -244,6 +373,11 @@ class WebViewInstance {
     ComPtr<ID3D11Texture2D> m_stagingTexture;
     std::atomic<bool> m_wgcNeedsResize{false};
 
+    InstanceStats m_stats;
+    // Double-buffered frames handed to Unity; while hidden only a compressed
+    // copy of the displayed frame is kept (see parkFrame)
+    FrameStore m_frames{m_stats};
+
 public:
     WebViewInstance(const char* gameObject, bool transparent, bool zoom,
                     int width, int height, const char* ua, bool separated)
@@ -263,8 +397,9 @@ public:
     }
 
     ~WebViewInstance() {
+        cancelPrerender();
         if (m_threadId != 0) {
-            PostThreadMessageW(m_threadId, WM_WEBVIEW_DESTROY, 0, 0);
+            postCommand(WM_WEBVIEW_DESTROY, 0, 0);
         }
         if (m_thread.joinable()) {
             auto handle = m_thread.native_handle();
@@ -290,16 +425,89 @@ public:
 
     bool isInitialized() { return m_initialized.load(); }
 
-    void addMessage(const std::string& msg) {
-        std::lock_guard<std::mutex> lock(m_messageMutex);
-        m_messages.push(msg);
+    // Posts a command to the host thread, stamped for the latency stats
+    BOOL postCommand(UINT message, WPARAM wParam, LPARAM lParam) {
+        WEBVIEW_TRACE_INSTANT("PostCommand", message - WM_USER);
+        uint64_t posted = InstanceStats::nowMicros();
+        if (!PostThreadMessageW(m_threadId, message, wParam, lParam)) return FALSE;
+        m_stats.commandPosted(posted);
+        return TRUE;
+    }
+
+    void getStats(WebViewStats& stats) {
+        m_stats.snapshot(stats);
+        FrameBufferPoolStats pool = FrameBufferPool::instance().stats();
+        stats.frameBufferBytesInUse = pool.bytesInUse;
+        stats.frameBufferBytesCached = pool.bytesCached;
+        ResponseCacheStats cache = m_responseCache.stats();
+        stats.responseCacheHits = cache.hits;
+        stats.responseCacheMisses = cache.misses;
+        stats.responseCacheEvictions = cache.evictions;
+        stats.responseCacheBytes = cache.bytes;
+        stats.responseCacheEntries = cache.entries;
+        stats.channelQueueDepth = m_channels.size();
+        stats.channelMessagesDropped = m_channels.dropped();
+    }
+
+    void addEvent(int kind, std::string payload, int code = 0) {
+        size_t depth = m_messages.push(WebViewEvent{kind, code, InstanceStats::nowMicros(), std::move(payload)});
+        m_stats.messageQueued(depth);
+        WEBVIEW_TRACE_INSTANT("QueueMessage", depth);
+    }
+
+    // Reports a navigation followed by m_navigations as a NAVIGATION_TIMING
+    // event and in the navigation histograms
+    void addNavigationTiming(const NavigationTiming& timing) {
+        uint64_t origin = timing.requested ? timing.requested : timing.started;
+        if (timing.success) m_stats.navigationTime.record(timing.completed - origin);
+        if (timing.firstFrame) m_stats.firstFrameTime.record(timing.firstFrame - origin);
+        if (timing.success) m_pageReadyMicros.store(timing.firstFrame ? timing.firstFrame : timing.completed);
+        std::string json;
+        AppendNavigationTimingJson(json, timing);
+        addEvent(WEBVIEW_EVENT_NAVIGATION_TIMING, std::move(json), static_cast<int>(timing.id));
+    }
+
+    void frameChanged() {
+        NavigationTiming finished;
+        if (m_navigations.frameChanged(InstanceStats::nowMicros(), finished)) addNavigationTiming(finished);
+    }
+
+    // Queues a Unity.call(channel, payload) message; called with the
+    // channel id from m_channels.route
+    void addChannelEvent(int channel, const wchar_t* payload, size_t length) {
+        WebViewEvent event{WEBVIEW_EVENT_FROM_JS, channel, InstanceStats::nowMicros(), std::string()};
+        AppendWideToUtf8(event.payload, payload, length);
+        size_t depth = m_channels.push(channel, std::move(event)) + m_messages.size();
+        m_stats.messageQueued(depth);
+        WEBVIEW_TRACE_INSTANT("QueueMessage", depth);
+    }
+
+    // Main queue first, then the channels; negative when the next event
+    // needs a bigger buffer
+    int getEvents(uint8_t* buffer, int capacity) {
+        size_t space = capacity > 0 ? capacity : 0;
+        size_t remaining, channelRemaining, needed;
+        size_t written = m_messages.popRecords(buffer, space, remaining, needed);
+        if (!written && needed) return -static_cast<int>(needed);
+        written += m_channels.popRecords(buffer + written, space - written, m_messages.id(),
+                                         channelRemaining, needed);
+        if (!written) return -static_cast<int>(needed);
+        m_stats.messageDequeued(remaining + channelRemaining);
+        return static_cast<int>(written);
     }
 
+    int subscribeChannel(const char* channel, int maxQueued) {
+        return m_channels.subscribe(channel, maxQueued > 0 ? maxQueued : 0);
+    }
+    void unsubscribeChannel(const char* channel) { m_channels.unsubscribe(channel); }
+    std::string getChannelStats() { return m_channels.statsJson(); }
+
     const char* getMessage() {
-        std::lock_guard<std::mutex> lock(m_messageMutex);
-        if (m_messages.empty()) return nullptr;
-        std::string msg = m_messages.front();
-        m_messages.pop();
+        WebViewEvent event;
+        size_t remaining;
+        if (!m_messages.pop(event, remaining) && !m_channels.pop(event, remaining)) return nullptr;
+        m_stats.messageDequeued(remaining);
+        std::string msg = FormatLegacyMessage(event);
         size_t len = msg.size() + 1;
         char* r = (char*)CoTaskMemAlloc(len);
         if (!r) return nullptr;
@@ -309,16 +517,18 @@ public:
 
     void loadURL(const char* url) {
         if (!url) return;
+        m_navigations.requested(InstanceStats::nowMicros());
         auto* copy = _strdup(url);
-        if (!PostThreadMessageW(m_threadId, WM_WEBVIEW_LOADURL, 0, reinterpret_cast<LPARAM>(copy))) {
+        if (!postCommand(WM_WEBVIEW_LOADURL, 0, reinterpret_cast<LPARAM>(copy))) {
             free(copy);
         }
     }
 
     void loadHTML(const char* html, const char* baseUrl) {
         if (!html) return;
+        m_navigations.requested(InstanceStats::nowMicros());
         auto* copy = _strdup(html);
-        if (!PostThreadMessageW(m_threadId, WM_WEBVIEW_LOADHTML, 0, reinterpret_cast<LPARAM>(copy))) {
+        if (!postCommand(WM_WEBVIEW_LOADHTML, 0, reinterpret_cast<LPARAM>(copy))) {
             free(copy);
         }
     }
@@ -326,62 +536,312 @@ public:
     void evaluateJS(const char* js) {
         if (!js) return;
         auto* copy = _strdup(js);
-        if (!PostThreadMessageW(m_threadId, WM_WEBVIEW_EVALUATEJS, 0, reinterpret_cast<LPARAM>(copy))) {
+        if (!postCommand(WM_WEBVIEW_EVALUATEJS, 0, reinterpret_cast<LPARAM>(copy))) {
             free(copy);
         }
     }
 
     void goBack() {
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_GOBACK, 0, 0);
+        postCommand(WM_WEBVIEW_GOBACK, 0, 0);
     }
 
     void goForward() {
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_GOFORWARD, 0, 0);
+        postCommand(WM_WEBVIEW_GOFORWARD, 0, 0);
     }
 
     void reload() {
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_RELOAD, 0, 0);
+        postCommand(WM_WEBVIEW_RELOAD, 0, 0);
     }
 
     void setRect(int width, int height) {
         m_width = width;
         m_height = height;
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_SETRECT, 0, 0);
+        postCommand(WM_WEBVIEW_SETRECT, 0, 0);
+        std::lock_guard<std::mutex> lock(m_prerenderMutex);
+        if (m_prerender) m_prerender->setRect(width, height);
+    }
+
+    // Loads url in a hidden sibling that shares this instance's user data
+    // folder, and so its browser process and profile. The sibling stays
+    // visible to WebView2 and keeps capturing, so a commit shows the loaded
+    // page on the next texture refresh. A previous prerender is dropped.
+    bool prerender(const char* url) {
+        if (m_separated || !url || !*url) return false;
+        auto sibling = std::make_unique<WebViewInstance>(
+            m_gameObject.c_str(), m_transparent, m_zoom, m_width.load(), m_height.load(),
+            m_userAgent.c_str(), false);
+        sibling->copySettingsFrom(*this);
+        sibling->loadURL(url);
+        uint64_t now = InstanceStats::nowMicros();
+        std::unique_ptr<WebViewInstance> previous;
+        uint64_t previousStarted = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_prerenderMutex);
+            previous = std::move(m_prerender);
+            previousStarted = m_prerenderStarted;
+            m_prerender = std::move(sibling);
+            m_prerenderUrl = url;
+            m_prerenderStarted = now;
+        }
+        PrerenderLedger::instance().started();
+        if (previous) PrerenderLedger::instance().discarded(previousStarted, now);
+        return true;
+    }
+
+    // Hands over the prerendered sibling if it was loaded from url (any URL
+    // when null); the caller owns it and retires this instance
+    WebViewInstance* commitPrerender(const char* url) {
+        std::unique_ptr<WebViewInstance> sibling;
+        uint64_t started = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_prerenderMutex);
+            if (!m_prerender) return nullptr;
+            if (!PrerenderUrlMatches(m_prerenderUrl, url)) {
+                PrerenderLedger::instance().mismatched();
+                return nullptr;
+            }
+            sibling = std::move(m_prerender);
+            started = m_prerenderStarted;
+        }
+        PrerenderLedger::instance().committed(started, sibling->m_pageReadyMicros.load(),
+                                              InstanceStats::nowMicros());
+        // Catch up with settings changed since the prerender started
+        sibling->copySettingsFrom(*this);
+        return sibling.release();
+    }
+
+    void cancelPrerender() {
+        std::unique_ptr<WebViewInstance> sibling;
+        uint64_t started = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_prerenderMutex);
+            sibling = std::move(m_prerender);
+            started = m_prerenderStarted;
+        }
+        if (sibling) PrerenderLedger::instance().discarded(started, InstanceStats::nowMicros());
+    }
+
+    // Settings made through the handle after Init that decide how a page
+    // loads and is handed to Unity, channel subscriptions (ids included)
+    // among them. Applied when a prerender starts and again when it is
+    // committed, so the committed handle behaves as the one it replaces.
+    // Virtual host mappings are made again as file:// URLs load.
+    void copySettingsFrom(WebViewInstance& other) {
+        m_customHeaders.copyFrom(other.m_customHeaders);
+        m_urlFilter.copyFrom(other.m_urlFilter);
+        m_requestBlocker.copyFrom(other.m_requestBlocker);
+        m_responseCache.copyRulesFrom(other.m_responseCache);
+        m_channels.copySubscriptionsFrom(other.m_channels);
+        size_t timings = other.m_resourceTimeline.capacity();
+        // Setting the capacity drops what the sibling recorded while loading
+        if (m_resourceTimeline.capacity() != timings) m_resourceTimeline.setCapacity(timings);
+        int layout = other.m_frames.requestedLayout();
+        setFrameFormat(layout & 0xFF);
+        setMipChain((layout & FRAME_LAYOUT_MIPS) != 0, (layout & FRAME_LAYOUT_MIPS_SRGB) != 0);
+        // Snapshot ids continue from other's, so callbacks still waiting on
+        // other's ids cannot be answered by this instance by mistake
+        int nextCookieRequest = other.m_nextCookieRequest.load();
+        if (m_nextCookieRequest.load() < nextCookieRequest) m_nextCookieRequest.store(nextCookieRequest);
+        m_interactionEnabled.store(other.m_interactionEnabled.load());
+        m_alertDialogEnabled.store(other.m_alertDialogEnabled.load());
+        std::lock_guard<std::mutex> lock(m_authMutex);
+        std::lock_guard<std::mutex> otherLock(other.m_authMutex);
+        m_basicAuthUser = other.m_basicAuthUser;
+        m_basicAuthPass = other.m_basicAuthPass;
     }
 
     void setVisibility(bool visible) {
         m_visible = visible;
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_SETVISIBILITY, static_cast<WPARAM>(visible), 0);
+        LifecycleManager::instance().setVisible(this, visible, InstanceStats::nowMicros());
+        postCommand(WM_WEBVIEW_SETVISIBILITY, 0, 0);
+    }
+
+    // The host thread applies whatever state the manager holds when the
+    // message arrives, so a stale step never outruns a later show
+    void syncLifecycle() {
+        postCommand(WM_WEBVIEW_SETVISIBILITY, 0, 0);
+    }
+
+    bool visible() const { return m_visible; }
+
+    int lifecycleState() {
+        return LifecycleManager::instance().state(this);
+    }
+
+    DWORD browserProcessId() {
+        return m_browserPid.load();
     }
 
     bool setURLPattern(const char* allow, const char* deny, const char* hook) {
-        std::lock_guard<std::mutex> lock(m_patternMutex);
-        try {
-            if (allow && *allow) {
-                m_allowRegex = std::make_unique<std::wregex>(Utf8ToWide(allow));
-            } else {
-                m_allowRegex.reset();
-            }
-            if (deny && *deny) {
-                m_denyRegex = std::make_unique<std::wregex>(Utf8ToWide(deny));
-            } else {
-                m_denyRegex.reset();
-            }
-            if (hook && *hook) {
-                m_hookRegex = std::make_unique<std::wregex>(Utf8ToWide(hook));
-            } else {
-                m_hookRegex.reset();
-            }
-            return true;
-        } catch (...) {
-            return false;
-        }
+        return m_urlFilter.setPatterns(allow, deny, hook);
+    }
+
+    void configureResponseCache(size_t maxBytes) { m_responseCache.setBudget(maxBytes); }
+    bool addResponseCacheRule(const char* pattern, int ttlSeconds) {
+        return m_responseCache.addRule(pattern, ttlSeconds);
+    }
+    void clearResponseCache(bool clearRules) {
+        m_responseCache.clear();
+        if (clearRules) m_responseCache.clearRules();
+    }
+
+    size_t loadBlockRules(const char* rules) { return m_requestBlocker.load(rules); }
+    long long loadBlockRulesFile(const char* path) { return m_requestBlocker.loadFile(path); }
+    std::string getBlockRuleHits() { return m_requestBlocker.hitsJson(); }
+
+    void setResourceTimingCapacity(size_t capacity) { m_resourceTimeline.setCapacity(capacity); }
+    std::string getResourceTimings() { return m_resourceTimeline.harJson(); }
+    std::string getResourceHostStats() { return m_resourceTimeline.hostStatsJson(); }
+    int getResourceTimingSummary(uint8_t* buffer, int capacity) {
+        std::string summary;
+        m_resourceTimeline.appendSummary(summary);
+        if (summary.size() > static_cast<size_t>(capacity > 0 ? capacity : 0))
+            return -static_cast<int>(summary.size());
+        memcpy(buffer, summary.data(), summary.size());
+        return static_cast<int>(summary.size());
     }
 
     int progress() { return m_progress.load(); }
     bool canGoBack() { return m_canGoBack.load(); }
     bool canGoForward() { return m_canGoForward.load(); }
 
+    static bool getRequestKey(ICoreWebView2WebResourceRequest* request, std::string& method, std::string& url) {
+        LPWSTR raw = nullptr;
+        if (FAILED(request->get_Method(&raw)) || !raw) return false;
+        AppendWideToUtf8(method, raw, wcslen(raw));
+        CoTaskMemFree(raw);
+        raw = nullptr;
+        if (FAILED(request->get_Uri(&raw)) || !raw) return false;
+        AppendWideToUtf8(url, raw, wcslen(raw));
+        CoTaskMemFree(raw);
+        return true;
+    }
+
+    // Answers a request matching a block rule with an empty response
+    bool blockRequest(const std::string& url, ICoreWebView2WebResourceRequestedEventArgs* args) {
+        if (!m_environment || m_requestBlocker.match(url) < 0) return false;
+        ComPtr<ICoreWebView2WebResourceResponse> response;
+        if (FAILED(m_environment->CreateWebResourceResponse(nullptr, 204, L"No Content", L"", &response)))
+            return false;
+        args->put_Response(response.Get());
+        InstanceStats::bump(m_stats.requestsBlocked);
+        WEBVIEW_TRACE_INSTANT("RequestBlocked", 0);
+        return true;
+    }
+
+    // Answers a request from m_responseCache without touching the network;
+    // returns false to let it through
+    bool serveCachedResponse(const std::string& method, const std::string& url,
+                             ICoreWebView2WebResourceRequestedEventArgs* args) {
+        if (!m_environment || !m_responseCache.ttlMicros(method, url)) return false;
+        CachedResponse cached;
+        if (!m_responseCache.lookup(method, url, InstanceStats::nowMicros(), cached)) return false;
+
+        ComPtr<IStream> content;
+        if (method != "HEAD") {
+            content.Attach(SHCreateMemStream(reinterpret_cast<const BYTE*>(cached.body->data()),
+                                             static_cast<UINT>(cached.body->size())));
+        }
+        ComPtr<ICoreWebView2WebResourceResponse> response;
+        if (FAILED(m_environment->CreateWebResourceResponse(
+                content.Get(), cached.status, Utf8ToWide(cached.reason.c_str()).c_str(),
+                Utf8ToWide(cached.headers.c_str()).c_str(), &response)))
+            return false;
+        args->put_Response(response.Get());
+        WEBVIEW_TRACE_INSTANT("ResponseCacheHit", cached.body->size());
+        return true;
+    }
+
+    // Copies a cacheable response into m_responseCache once its body arrives
+    void cacheResponse(ICoreWebView2WebResourceResponseReceivedEventArgs* args,
+                       ICoreWebView2WebResourceResponseView* response) {
+        ComPtr<ICoreWebView2WebResourceRequest> request;
+        args->get_Request(&request);
+        std::string method, url;
+        if (!request || !getRequestKey(request.Get(), method, url)) return;
+        uint64_t ttl = m_responseCache.ttlMicros(method, url);
+        // Hits served from the cache come back through here as well
+        if (!ttl || m_responseCache.contains(method, url, InstanceStats::nowMicros())) return;
+
+        auto cached = std::make_shared<CachedResponse>();
+        cached->status = 200;
+        LPWSTR reason = nullptr;
+        if (SUCCEEDED(response->get_ReasonPhrase(&reason)) && reason) {
+            AppendWideToUtf8(cached->reason, reason, wcslen(reason));
+            CoTaskMemFree(reason);
+        }
+        ComPtr<ICoreWebView2HttpResponseHeaders> headers;
+        ComPtr<ICoreWebView2HttpHeadersCollectionIterator> iterator;
+        response->get_Headers(&headers);
+        if (headers && SUCCEEDED(headers->GetIterator(&iterator))) {
+            BOOL hasHeader = FALSE;
+            while (SUCCEEDED(iterator->get_HasCurrentHeader(&hasHeader)) && hasHeader) {
+                LPWSTR name = nullptr;
+                LPWSTR value = nullptr;
+                if (SUCCEEDED(iterator->GetCurrentHeader(&name, &value)) && name && value) {
+                    if (!cached->headers.empty()) cached->headers += "\r\n";
+                    AppendWideToUtf8(cached->headers, name, wcslen(name));
+                    cached->headers += ": ";
+                    AppendWideToUtf8(cached->headers, value, wcslen(value));
+                }
+                CoTaskMemFree(name);
+                CoTaskMemFree(value);
+                BOOL more = FALSE;
+                if (FAILED(iterator->MoveNext(&more)) || !more) break;
+            }
+        }
+
+        response->GetContent(
+            Callback<ICoreWebView2WebResourceResponseViewGetContentCompletedHandler>(
+                [this, cached, method, url, ttl](HRESULT errorCode, IStream* content) -> HRESULT {
+                    if (FAILED(errorCode)) return S_OK;
+                    auto body = std::make_shared<std::string>();
+                    if (content) {
+                        char buf[16 * 1024];
+                        ULONG read = 0;
+                        while (SUCCEEDED(content->Read(buf, sizeof(buf), &read)) && read)
+                            body->append(buf, read);
+                    }
+                    cached->body = std::move(body);
+                    m_responseCache.store(method, url, std::move(*cached), ttl, InstanceStats::nowMicros());
+                    return S_OK;
+                }).Get());
+    }
+
+    static std::string getResponseUrl(ICoreWebView2WebResourceResponseReceivedEventArgs* args) {
+        std::string url;
+        ComPtr<ICoreWebView2WebResourceRequest> request;
+        args->get_Request(&request);
+        LPWSTR raw = nullptr;
+        if (request && SUCCEEDED(request->get_Uri(&raw)) && raw) {
+            AppendWideToUtf8(url, raw, wcslen(raw));
+            CoTaskMemFree(raw);
+        }
+        return url;
+    }
+
+    // Closes the m_resourceTimeline entry of a request; the size comes from
+    // Content-Length so the body is never read for it
+    void recordResponseTiming(ICoreWebView2WebResourceResponseReceivedEventArgs* args,
+                              ICoreWebView2WebResourceResponseView* response, int statusCode) {
+        uint64_t now = InstanceStats::nowMicros();
+        ComPtr<ICoreWebView2WebResourceRequest> request;
+        args->get_Request(&request);
+        std::string method, url;
+        if (!request || !getRequestKey(request.Get(), method, url)) return;
+        long long size = -1;
+        ComPtr<ICoreWebView2HttpResponseHeaders> headers;
+        LPWSTR length = nullptr;
+        response->get_Headers(&headers);
+        if (headers && SUCCEEDED(headers->GetHeader(L"Content-Length", &length)) && length) {
+            wchar_t* end = nullptr;
+            long long parsed = wcstoll(length, &end, 10);
+            if (end != length && parsed >= 0) size = parsed;
+            CoTaskMemFree(length);
+        }
+        m_resourceTimeline.complete(method, url, statusCode, size, now);
+    }
+
     // Find the actual WebView2 browser child HWND for input forwarding
     HWND getBrowserHwnd() {
         if (m_browserHwnd) return m_browserHwnd;
@@ -405,7 +865,7 @@ public:
         if (m_compositionController) {
             // Marshal to WebView2 thread — SendMouseInput is a COM call
             auto* data = new MouseEventData{x, y, deltaY, mouseState};
-            if (!PostThreadMessageW(m_threadId, WM_WEBVIEW_MOUSEEVENT, 0, reinterpret_cast<LPARAM>(data))) {
+            if (!postCommand(WM_WEBVIEW_MOUSEEVENT, 0, reinterpret_cast<LPARAM>(data))) {
                 delete data;
             }
         } else {
@@ -434,7 +894,7 @@ public:
                 snprintf(js, sizeof(js),
                     "window.scrollBy({top:%d,behavior:'smooth'})", scrollAmount);
                 auto* copy = _strdup(js);
-                PostThreadMessageW(m_threadId, WM_WEBVIEW_EVALUATEJS, 0, reinterpret_cast<LPARAM>(copy));
+                postCommand(WM_WEBVIEW_EVALUATEJS, 0, reinterpret_cast<LPARAM>(copy));
             }
         }
     }
@@ -442,17 +902,9 @@ public:
     void sendKeyEvent(int x, int y, const wchar_t* keyChars, unsigned short keyCode, int keyState) {
         if (!m_hwnd) return;
         if (!m_interactionEnabled.load()) return;
-        HWND target = getBrowserHwnd();
 
         // Map control character codes to virtual key codes for WM_KEYDOWN
-        UINT vk = 0;
-        switch (keyCode) {
-        case 0x08: vk = VK_BACK; break;
-        case 0x09: vk = VK_TAB; break;
-        case 0x0D: case 0x0A: vk = VK_RETURN; break;
-        case 0x1B: vk = VK_ESCAPE; break;
-        case 0x7F: vk = VK_DELETE; break;
-        }
+        UINT vk = TypedKeyToVirtualKey(keyCode);
 
         switch (keyState) {
         case 1: // key down
@@ -460,71 +912,134 @@ public:
         {
             LPARAM lp = keyState == 2 ? (1 << 30) : 0;
             if (vk) {
-                PostMessageW(target, WM_KEYDOWN, vk, lp);
+                postKey(WM_KEYDOWN, vk, lp);
             } else if (keyChars && keyChars[0]) {
-                PostMessageW(target, WM_CHAR, static_cast<WPARAM>(keyChars[0]), lp);
+                postKey(WM_CHAR, static_cast<WPARAM>(keyChars[0]), lp);
             }
             break;
         }
         case 3: // key up
             if (vk) {
-                PostMessageW(target, WM_KEYUP, vk, (1 << 30) | (1 << 31));
+                postKey(WM_KEYUP, vk, (1 << 30) | (1 << 31));
             }
             break;
         }
     }
 
+    // Types text in one host-thread step: WM_CHARs, with key presses for
+    // control characters, or a DevTools insertText committing an open
+    // composition
+    void sendText(const wchar_t* text) {
+        if (!m_hwnd || !text || !*text) return;
+        if (!m_interactionEnabled.load()) return;
+        InputItem item;
+        item.kind = INPUT_TEXT;
+        item.text = text;
+        InstanceStats::bump(m_stats.textInputs);
+        InstanceStats::bump(m_stats.textUnits, item.text.size());
+        queueInput(std::move(item));
+    }
+
+    // Shows text as the IME composition at the focused field with the caret
+    // at cursor; an empty text cancels it. sendText commits.
+    void setComposition(const wchar_t* text, int cursor) {
+        if (!m_hwnd) return;
+        if (!m_interactionEnabled.load()) return;
+        InputItem item;
+        item.kind = INPUT_COMPOSITION;
+        item.text = text ? text : L"";
+        item.cursor = cursor;
+        InstanceStats::bump(m_stats.compositionUpdates);
+        queueInput(std::move(item));
+    }
+
+    // Key messages go straight to the browser window unless text is still
+    // on its way there, which they must not overtake
+    void postKey(UINT msg, WPARAM wParam, LPARAM lParam) {
+        if (m_inputQueued.load() == 0) {
+            PostMessageW(getBrowserHwnd(), msg, wParam, lParam);
+            InstanceStats::bump(m_stats.keyEvents);
+            m_stats.inputLatency.record(0);
+            return;
+        }
+        InputItem item;
+        item.msg = msg;
+        item.wParam = wParam;
+        item.lParam = lParam;
+        queueInput(std::move(item));
+    }
+
+    void queueInput(InputItem item) {
+        item.posted = InstanceStats::nowMicros();
+        m_inputQueued.fetch_add(1);
+        auto* copy = new InputItem(std::move(item));
+        if (!postCommand(WM_WEBVIEW_INPUT, 0, reinterpret_cast<LPARAM>(copy))) {
+            m_inputQueued.fetch_sub(1);
+            delete copy;
+        }
+    }
+
     void update(bool refreshBitmap, int devicePixelRatio) {
+        {
+            std::lock_guard<std::mutex> lock(m_prerenderMutex);
+            if (m_prerender) m_prerender->update(refreshBitmap, devicePixelRatio);
+        }
+        NavigationTiming finished;
+        if (m_navigations.expire(InstanceStats::nowMicros(), kFirstFrameTimeoutMicros, finished))
+            addNavigationTiming(finished);
         if (devicePixelRatio < 1) devicePixelRatio = 1;
         if (devicePixelRatio != m_devicePixelRatio) {
             m_devicePixelRatio = devicePixelRatio;
             // Resize HWND to CSS pixel dimensions; WGC captures at this size
-            PostThreadMessageW(m_threadId, WM_WEBVIEW_SETRECT, 0, 0);
+            postCommand(WM_WEBVIEW_SETRECT, 0, 0);
         }
         if (m_useWGC) return;
-        if (refreshBitmap && !m_inRendering && m_webview) {
+        if (refreshBitmap && !m_frames.parked() && !m_inRendering && m_webview) {
             m_inRendering = true;
-            PostThreadMessageW(m_threadId, WM_WEBVIEW_CAPTURE, 0, 0);
+            postCommand(WM_WEBVIEW_CAPTURE, 0, 0);
         }
     }
 
     int bitmapWidth() {
-        std::lock_guard<std::mutex> lock(m_bitmapMutex);
-        return m_bitmapWidth;
+        return m_frames.width();
     }
 
     int bitmapHeight() {
-        std::lock_guard<std::mutex> lock(m_bitmapMutex);
-        return m_bitmapHeight;
+        return m_frames.height();
     }
 
     void render(void* textureBuffer) {
-        std::lock_guard<std::mutex> lock(m_bitmapMutex);
-        if (!m_needsDisplay) return;
-        if (m_bitmaps[m_currentBitmap].empty()) return;
-        m_needsDisplay = false;
-        memcpy(textureBuffer, m_bitmaps[m_currentBitmap].data(),
-               m_bitmapWidth * m_bitmapHeight * 4);
+        m_frames.render(textureBuffer);
+    }
+
+    long long parkedBytesSaved() {
+        return m_stats.parkedBytesSaved.load();
+    }
+
+    void setFrameFormat(int format) {
+        int layout = m_frames.requestedLayout();
+        m_frames.setFrameFormat(format);
+        if (m_frames.requestedLayout() != layout) postCommand(WM_WEBVIEW_RELAYOUT, 0, 0);
+    }
+
+    // Mip chains are produced for RGBA32 output only
+    void setMipChain(bool enabled, bool gammaCorrect) {
+        int layout = m_frames.requestedLayout();
+        m_frames.setMipChain(enabled, gammaCorrect);
+        if (m_frames.requestedLayout() != layout) postCommand(WM_WEBVIEW_RELAYOUT, 0, 0);
     }
 
     void addCustomHeader(const char* key, const char* value) {
-        if (!key || !value) return;
-        std::lock_guard<std::mutex> lock(m_headerMutex);
-        m_customHeaders[key] = value;
+        m_customHeaders.set(key, value);
     }
 
     void removeCustomHeader(const char* key) {
-        if (!key) return;
-        std::lock_guard<std::mutex> lock(m_headerMutex);
-        m_customHeaders.erase(key);
+        m_customHeaders.remove(key);
     }
 
     const char* getCustomHeaderValue(const char* key) {
-        if (!key) return nullptr;
-        std::lock_guard<std::mutex> lock(m_headerMutex);
-        auto it = m_customHeaders.find(key);
-        if (it == m_customHeaders.end()) return nullptr;
-        const std::string& val = it->second;
+        std::string val;
+        if (!m_customHeaders.get(key, val)) return nullptr;
         size_t len = val.size() + 1;
         char* r = (char*)CoTaskMemAlloc(len);
         if (!r) return nullptr;
@@ -533,16 +1048,133 @@ public:
     }
 
     void clearCustomHeader() {
-        std::lock_guard<std::mutex> lock(m_headerMutex);
         m_customHeaders.clear();
     }
 
     void getCookies(const char* url) {
         if (!url) return;
         auto* data = new CookieOpData{Utf8ToWide(url), L""};
-        if (!PostThreadMessageW(m_threadId, WM_WEBVIEW_GETCOOKIES, 0, reinterpret_cast<LPARAM>(data))) {
+        if (!postCommand(WM_WEBVIEW_GETCOOKIES, 0, reinterpret_cast<LPARAM>(data))) {
+            delete data;
+        }
+    }
+
+    // Host thread: adds or replaces each cookie through the cookie manager
+    void applyCookies(const std::vector<BrowserCookie>& cookies, uint64_t posted) {
+        for (const auto& c : cookies) {
+            ComPtr<ICoreWebView2Cookie> cookie;
+            if (FAILED(m_cookieManager->CreateCookie(
+                    Utf8ToWide(c.name.c_str()).c_str(), Utf8ToWide(c.value.c_str()).c_str(),
+                    Utf8ToWide(c.domain.c_str()).c_str(), Utf8ToWide(c.path.c_str()).c_str(),
+                    &cookie)) || !cookie) continue;
+            if (c.expires >= 0) cookie->put_Expires(c.expires);
+            cookie->put_IsSecure(c.secure);
+            cookie->put_IsHttpOnly(c.httpOnly);
+            cookie->put_SameSite(static_cast<COREWEBVIEW2_COOKIE_SAME_SITE_KIND>(c.sameSite));
+            m_cookieManager->AddOrUpdateCookie(cookie.Get());
+        }
+        m_stats.cookieSetTime.record(InstanceStats::nowMicros() - posted);
+    }
+
+    // Host thread, once the cookie manager exists: the configured jar (first
+    // instance only), then SetCookies batches that were waiting for it
+    void applyPendingCookies() {
+        if (!m_cookieManager) return;
+        std::vector<BrowserCookie> cookies;
+        uint64_t posted = InstanceStats::nowMicros();
+        {
+            std::lock_guard<std::mutex> lock(s_cookieJarMutex);
+            if (s_cookieJarPending) {
+                s_cookieJarPending = false;
+                if (ReadCookieJarFile(s_cookieJarPath.c_str(), cookies))
+                    PruneCookies(cookies, NowSeconds(), true);
+            }
+        }
+        if (!m_pendingCookies.empty()) {
+            cookies.insert(cookies.end(), m_pendingCookies.begin(), m_pendingCookies.end());
+            posted = m_pendingCookiesPosted;
+            m_pendingCookies.clear();
+            m_pendingCookies.shrink_to_fit();
+        }
+        if (!cookies.empty()) applyCookies(cookies, posted);
+    }
+
+    // Host thread: the answer to getCookies or getCookieSnapshot
+    void deliverCookies(const std::vector<BrowserCookie>& cookies, int request, uint64_t posted) {
+        std::string text;
+        if (request) {
+            AppendCookiesJson(text, cookies);
+            addEvent(WEBVIEW_EVENT_COOKIE_SNAPSHOT, std::move(text), request);
+            m_stats.cookieSnapshotTime.record(InstanceStats::nowMicros() - posted);
+            return;
+        }
+        for (const auto& cookie : cookies) AppendLegacyCookie(text, cookie);
+        addEvent(WEBVIEW_EVENT_COOKIES, std::move(text));
+    }
+
+    int getCookieSnapshot(const char* url) {
+        int id = m_nextCookieRequest.fetch_add(1, std::memory_order_relaxed);
+        auto* data = new CookieOpData{url ? Utf8ToWide(url) : std::wstring(), L"", id, InstanceStats::nowMicros()};
+        if (!postCommand(WM_WEBVIEW_GETCOOKIES, 0, reinterpret_cast<LPARAM>(data))) {
             delete data;
+            return 0;
         }
+        return id;
+    }
+
+    // Parsed here so the host thread only applies the batch
+    int setCookies(const char* json) {
+        if (!json) return -1;
+        auto* batch = new CookieBatch{{}, InstanceStats::nowMicros()};
+        if (!ParseCookiesJson(json, batch->cookies)) {
+            delete batch;
+            return -1;
+        }
+        int count = static_cast<int>(batch->cookies.size());
+        if (!postCommand(WM_WEBVIEW_SETCOOKIES, 0, reinterpret_cast<LPARAM>(batch))) {
+            delete batch;
+            return -1;
+        }
+        return count;
+    }
+
+    // Cookies of a saved jar, applied like setCookies; -1 if the file is
+    // missing or not a valid jar
+    int loadCookieJar(const char* path) {
+        auto* batch = new CookieBatch{{}, InstanceStats::nowMicros()};
+        if (!ReadCookieJarFile(path, batch->cookies)) {
+            delete batch;
+            return -1;
+        }
+        PruneCookies(batch->cookies, NowSeconds(), true);
+        int count = static_cast<int>(batch->cookies.size());
+        if (!postCommand(WM_WEBVIEW_SETCOOKIES, 0, reinterpret_cast<LPARAM>(batch))) {
+            delete batch;
+            return -1;
+        }
+        return count;
+    }
+
+    // Asks the host thread to write the jar; null if it could not be posted.
+    // The save outlives the instance, so it can be waited on without it.
+    std::shared_ptr<CookieJarSave> postCookieJarSave(const char* path, bool includeSession) {
+        if (!path || !*path) return nullptr;
+        auto save = std::make_shared<CookieJarSave>();
+        save->path = path;
+        save->includeSession = includeSession;
+        if (!save->done) return nullptr;
+        auto* ref = new std::shared_ptr<CookieJarSave>(save);
+        if (!postCommand(WM_WEBVIEW_SAVECOOKIEJAR, 0, reinterpret_cast<LPARAM>(ref))) {
+            delete ref;
+            return nullptr;
+        }
+        return save;
+    }
+
+    // Blocks until the host thread has written the jar; returns the number
+    // of cookies saved, or -1
+    int saveCookieJar(const char* path, bool includeSession) {
+        return WaitCookieJarSave(postCookieJarSave(path, includeSession));
     }
 
     bool hasCookieManager() { return m_cookieManager != nullptr; }
@@ -554,7 +1186,8 @@ public:
     }
 
     void clearCache(bool includeDiskFiles) {
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_CLEARCACHE, static_cast<WPARAM>(includeDiskFiles), 0);
+        m_responseCache.clear();
+        postCommand(WM_WEBVIEW_CLEARCACHE, static_cast<WPARAM>(includeDiskFiles), 0);
     }
 
     void setInteractionEnabled(bool enabled) {
@@ -562,7 +1195,7 @@ public:
     }
 
     void setScrollbarsVisibility(bool visible) {
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_SETSCROLLBARSVISIBILITY, static_cast<WPARAM>(visible), 0);
+        postCommand(WM_WEBVIEW_SETSCROLLBARSVISIBILITY, static_cast<WPARAM>(visible), 0);
     }
 
     void setAlertDialogEnabled(bool enabled) {
@@ -570,82 +1203,69 @@ public:
     }
 
     void pause() {
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_PAUSE, 0, 0);
+        postCommand(WM_WEBVIEW_PAUSE, 0, 0);
     }
 
     void resume() {
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_RESUME, 0, 0);
+        postCommand(WM_WEBVIEW_RESUME, 0, 0);
     }
 
     void clearAllCookies() {
-        PostThreadMessageW(m_threadId, WM_WEBVIEW_CLEARALLCOOKIES, 0, 0);
+        postCommand(WM_WEBVIEW_CLEARALLCOOKIES, 0, 0);
     }
 
     void clearCookie(const char* url, const char* name) {
         if (!url || !name) return;
         auto* data = new CookieOpData{Utf8ToWide(url), Utf8ToWide(name)};
-        if (!PostThreadMessageW(m_threadId, WM_WEBVIEW_CLEARCOOKIE, 0, reinterpret_cast<LPARAM>(data))) {
+        if (!postCommand(WM_WEBVIEW_CLEARCOOKIE, 0, reinterpret_cast<LPARAM>(data))) {
             delete data;
         }
     }
 
-    static std::wstring getScrollbarHideScript() {
-        return
-            L"(function() {"
-            L"  if (document.getElementById('__wv_no_scrollbar')) return;"
-            L"  var s = document.createElement('style');"
-            L"  s.id = '__wv_no_scrollbar';"
-            L"  s.textContent = '"
-            L"    html::-webkit-scrollbar, body::-webkit-scrollbar, *::-webkit-scrollbar"
-            L"      { display: none !important; width: 0 !important; height: 0 !important; }"
-            L"    html, body, * { scrollbar-width: none !important; -ms-overflow-style: none !important; }"
-            L"  ';"
-            L"  (document.head || document.documentElement).appendChild(s);"
-            L"  if (document.readyState === 'loading') {"
-            L"    document.addEventListener('DOMContentLoaded', function() {"
-            L"      if (!document.getElementById('__wv_no_scrollbar')) {"
-            L"        document.head.appendChild(s.cloneNode(true));"
-            L"      }"
-            L"    });"
-            L"  }"
-            L"})();";
+    // Re-applies the registry's scripts on the host thread
+    void syncUserScripts() {
+        postCommand(WM_WEBVIEW_SYNCUSERSCRIPTS, 0, 0);
+        std::lock_guard<std::mutex> lock(m_prerenderMutex);
+        if (m_prerender) m_prerender->syncUserScripts();
     }
 
 private:
-    void decodePngFromStream(IStream* stream, std::vector<uint8_t>& buffer, int& width, int& height) {
+    // Decodes straight into the frame store's back buffer; returns true when a
+    // frame was begun and is ready to commit
+    bool decodePngFromStream(IStream* stream) {
+        WEBVIEW_TRACE_SCOPE("DecodePng");
         if (!m_wicFactory) {
             if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
                                         IID_PPV_ARGS(&m_wicFactory))))
-                return;
+                return false;
         }
         auto& factory = m_wicFactory;
 
         ComPtr<IWICBitmapDecoder> decoder;
         HRESULT hr = factory->CreateDecoderFromStream(stream, nullptr,
                                                WICDecodeMetadataCacheOnLoad, &decoder);
-        if (FAILED(hr)) return;
+        if (FAILED(hr)) return false;
 
         ComPtr<IWICBitmapFrameDecode> frame;
         hr = decoder->GetFrame(0, &frame);
-        if (FAILED(hr)) return;
+        if (FAILED(hr)) return false;
 
         UINT w, h;
         hr = frame->GetSize(&w, &h);
-        if (FAILED(hr)) return;
+        if (FAILED(hr)) return false;
 
         ComPtr<IWICFormatConverter> converter;
         hr = factory->CreateFormatConverter(&converter);
-        if (FAILED(hr)) return;
+        if (FAILED(hr)) return false;
 
         hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA,
                                    WICBitmapDitherTypeNone, nullptr, 0.0,
                                    WICBitmapPaletteTypeCustom);
-        if (FAILED(hr)) return;
+        if (FAILED(hr)) return false;
 
-        width = static_cast<int>(w);
-        height = static_cast<int>(h);
-        buffer.resize(w * h * 4);
-        converter->CopyPixels(nullptr, w * 4, static_cast<UINT>(buffer.size()), buffer.data());
+        uint8_t* dst = m_frames.beginFrame(static_cast<int>(w), static_cast<int>(h));
+        if (!dst) return false;
+        return SUCCEEDED(converter->CopyPixels(nullptr, w * 4, w * h * 4, dst));
     }
 
     bool initD3D11Device() {
@@ -717,7 +1337,12 @@ private:
     }
 
     void onFrameArrived(winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool const& sender) {
-        if (m_inRendering.exchange(true)) return;
+        TraceSetThreadName("WGC capture");
+        WEBVIEW_TRACE_SCOPE("OnFrameArrived");
+        if (m_inRendering.exchange(true)) {
+            InstanceStats::bump(m_stats.framesDropped);
+            return;
+        }
 
         auto frame = sender.TryGetNextFrame();
         if (!frame) {
@@ -736,6 +1361,12 @@ private:
             return;
         }
 
+        if (m_frames.parked()) {
+            InstanceStats::bump(m_stats.framesDropped);
+            m_inRendering.store(false);
+            return;
+        }
+
         auto surface = frame.Surface();
         auto access = surface.as<::Windows::Graphics::DirectX::Direct3D11::IDirect3DDxgiInterfaceAccess>();
         ComPtr<ID3D11Texture2D> frameTexture;
@@ -760,7 +1391,10 @@ private:
             return;
         }
 
-        m_d3dContext->CopyResource(m_stagingTexture.Get(), frameTexture.Get());
+        // The staging texture may be larger than the frame; copy just the frame
+        D3D11_BOX box = {0, 0, 0, static_cast<UINT>(w), static_cast<UINT>(h), 1};
+        m_d3dContext->CopySubresourceRegion(m_stagingTexture.Get(), 0, 0, 0, 0,
+                                            frameTexture.Get(), 0, &box);
 
         D3D11_MAPPED_SUBRESOURCE mapped;
         hr = m_d3dContext->Map(m_stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mapped);
@@ -769,53 +1403,66 @@ private:
             return;
         }
 
-        int backBuffer;
-        {
-            std::lock_guard<std::mutex> lock(m_bitmapMutex);
-            backBuffer = 1 - m_currentBitmap;
+        uint8_t* dst = m_frames.beginFrame(w, h);
+        if (!dst) {
+            // Frame buffer pool is at its memory cap; drop this frame
+            m_d3dContext->Unmap(m_stagingTexture.Get(), 0);
+            m_inRendering.store(false);
+            return;
         }
-        size_t bufSize = static_cast<size_t>(w) * h * 4;
-        m_bitmaps[backBuffer].resize(bufSize);
 
-        // BGRA -> RGBA swizzle
-        uint8_t* dst = m_bitmaps[backBuffer].data();
+        // BGRA -> RGBA swizzle, in row bands on the shared worker pool
+        uint64_t convertStart = InstanceStats::nowMicros();
         const uint8_t* src = static_cast<const uint8_t*>(mapped.pData);
-        for (int row = 0; row < h; row++) {
-            const uint8_t* srcRow = src + row * mapped.RowPitch;
-            uint8_t* dstRow = dst + row * w * 4;
-            for (int col = 0; col < w; col++) {
-                dstRow[col * 4 + 0] = srcRow[col * 4 + 2]; // R <- B
-                dstRow[col * 4 + 1] = srcRow[col * 4 + 1]; // G
-                dstRow[col * 4 + 2] = srcRow[col * 4 + 0]; // B <- R
-                dstRow[col * 4 + 3] = srcRow[col * 4 + 3]; // A
-            }
+        size_t pitch = mapped.RowPitch;
+        {
+            WEBVIEW_TRACE_SCOPE("Swizzle");
+            WorkerPool::instance().parallelFor(h, 64, [=](int rowBegin, int rowEnd) {
+                SwizzleBGRAToRGBA(src, pitch, dst, w, rowBegin, rowEnd);
+            });
         }
 
         m_d3dContext->Unmap(m_stagingTexture.Get(), 0);
 
-        {
-            std::lock_guard<std::mutex> lock(m_bitmapMutex);
-            m_bitmapWidth = w;
-            m_bitmapHeight = h;
-            m_currentBitmap = backBuffer;
-            m_needsDisplay = true;
+        bool changed = m_frames.commitFrame();
+        m_stats.conversionTime.record(InstanceStats::nowMicros() - convertStart);
+        if (!changed) {
+            m_inRendering.store(false);
+            return;
         }
 
+        // SystemRelativeTime is in QPC time, in 100ns units
+        LARGE_INTEGER qpc, qpf;
+        QueryPerformanceCounter(&qpc);
+        QueryPerformanceFrequency(&qpf);
+        long long composed = frame.SystemRelativeTime().count() / 10;
+        long long now = static_cast<long long>(qpc.QuadPart / qpf.QuadPart * 1000000 +
+                                               qpc.QuadPart % qpf.QuadPart * 1000000 / qpf.QuadPart);
+        m_stats.captureLatency.record(now > composed ? static_cast<uint64_t>(now - composed) : 0);
+        InstanceStats::bump(m_stats.framesCaptured);
+        frameChanged();
+
         m_inRendering.store(false);
     }
 
+    // Grows in 256-pixel steps and never shrinks, so window resizes and DPR
+    // changes rarely need a new texture
     void ensureStagingTexture(int width, int height) {
+        UINT newWidth = (static_cast<UINT>(width) + 255) & ~255u;
+        UINT newHeight = (static_cast<UINT>(height) + 255) & ~255u;
         if (m_stagingTexture) {
             D3D11_TEXTURE2D_DESC existing;
             m_stagingTexture->GetDesc(&existing);
-            if (existing.Width == static_cast<UINT>(width) &&
-                existing.Height == static_cast<UINT>(height))
+            if (existing.Width >= static_cast<UINT>(width) &&
+                existing.Height >= static_cast<UINT>(height))
                 return;
+            if (existing.Width > newWidth) newWidth = existing.Width;
+            if (existing.Height > newHeight) newHeight = existing.Height;
         }
         m_stagingTexture = nullptr;
         D3D11_TEXTURE2D_DESC desc = {};
-        desc.Width = width;
-        desc.Height = height;
+        desc.Width = newWidth;
+        desc.Height = newHeight;
         desc.MipLevels = 1;
         desc.ArraySize = 1;
         desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
@@ -825,6 +1472,196 @@ private:
         m_d3dDevice->CreateTexture2D(&desc, nullptr, &m_stagingTexture);
     }
 
+    // Keeps frame writers out while the frame buffers are swapped out. Capture
+    // callbacks run on this thread; WGC frames arrive on another one.
+    void lockFrameWriters() {
+        if (!m_useWGC.load()) return;
+        while (m_inRendering.exchange(true)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void unlockFrameWriters() {
+        if (m_useWGC.load()) m_inRendering.store(false);
+    }
+
+    // Compresses the displayed frame and hands all frame memory back, so a
+    // hidden view holds only its packed frame. Frames arriving meanwhile are
+    // dropped.
+    void parkFrame() {
+        if (m_frames.parked()) return;
+        lockFrameWriters();
+        long long saved = m_frames.park();
+        if (m_stagingTexture) {
+            D3D11_TEXTURE2D_DESC desc;
+            m_stagingTexture->GetDesc(&desc);
+            saved += static_cast<long long>(desc.Width) * desc.Height * 4;
+            m_stagingTexture = nullptr;
+        }
+        unlockFrameWriters();
+        m_stats.parkedBytesSaved.store(saved);
+    }
+
+    // Restores the parked frame so the view shows it again at once, without
+    // waiting for a new capture.
+    void unparkFrame() {
+        if (!m_frames.parked()) return;
+        lockFrameWriters();
+        m_frames.unpark();
+        m_stats.parkedBytesSaved.store(0);
+        unlockFrameWriters();
+    }
+
+    // Walks from the applied lifecycle state to state. Going back towards
+    // visible undoes the deeper steps first; IsVisible is turned on last and
+    // off first, as suspension requires.
+    void applyLifecycle(int state) {
+        int from = m_appliedState;
+        if (state == from) return;
+        m_appliedState = state;
+        if (state < from) {
+            if (from >= LIFECYCLE_SUSPENDED) resumeRenderer();
+            if (from >= LIFECYCLE_LOW_MEMORY && state < LIFECYCLE_LOW_MEMORY) setMemoryTarget(false);
+            if (from >= LIFECYCLE_PARKED && state < LIFECYCLE_PARKED) unparkFrame();
+            if (state == LIFECYCLE_VISIBLE && m_controller) m_controller->put_IsVisible(TRUE);
+            return;
+        }
+        if (from == LIFECYCLE_VISIBLE && m_controller) m_controller->put_IsVisible(FALSE);
+        if (state >= LIFECYCLE_PARKED && from < LIFECYCLE_PARKED) parkFrame();
+        if (state >= LIFECYCLE_LOW_MEMORY && from < LIFECYCLE_LOW_MEMORY) setMemoryTarget(true);
+        if (state >= LIFECYCLE_SUSPENDED) suspendRenderer();
+    }
+
+    void setMemoryTarget(bool low) {
+        if (!m_webview) return;
+        ComPtr<ICoreWebView2_19> webview19;
+        if (SUCCEEDED(m_webview.As(&webview19)) && webview19) {
+            webview19->put_MemoryUsageTargetLevel(low ? COREWEBVIEW2_MEMORY_USAGE_TARGET_LEVEL_LOW
+                                                      : COREWEBVIEW2_MEMORY_USAGE_TARGET_LEVEL_NORMAL);
+        }
+    }
+
+    // A refused suspension (media playing, for one) falls back to the low
+    // memory target; the manager keeps the view there until it is shown
+    void suspendRenderer() {
+        ComPtr<ICoreWebView2_3> webview3;
+        if (!m_webview || FAILED(m_webview.As(&webview3)) || !webview3) {
+            suspendRefused();
+            return;
+        }
+        webview3->TrySuspend(
+            Callback<ICoreWebView2TrySuspendCompletedHandler>(
+                [this](HRESULT errorCode, BOOL isSuccessful) -> HRESULT {
+                    if (FAILED(errorCode) || !isSuccessful) suspendRefused();
+                    return S_OK;
+                }).Get());
+    }
+
+    void suspendRefused() {
+        if (m_appliedState == LIFECYCLE_SUSPENDED) m_appliedState = LIFECYCLE_LOW_MEMORY;
+        LifecycleManager::instance().revert(this, LIFECYCLE_SUSPENDED, LIFECYCLE_LOW_MEMORY);
+    }
+
+    void resumeRenderer() {
+        ComPtr<ICoreWebView2_3> webview3;
+        if (m_webview && SUCCEEDED(m_webview.As(&webview3)) && webview3) {
+            webview3->Resume();
+        }
+    }
+
+    // Brings WebView2's document-created scripts in line with the registry
+    // and the scrollbar setting; they apply from the next document on
+    void applyUserScripts() {
+        if (!m_webview) return;
+        static const auto scrollbarScript = std::make_shared<const std::wstring>(kScrollbarHideScript);
+        std::vector<UserScript> wanted;
+        if (!m_separated && !m_scrollbarsVisible.load())
+            wanted.push_back(UserScript{kScrollbarScriptId, scrollbarScript});
+        UserScriptRegistry::instance().snapshot(wanted);
+        std::vector<UserScript> adds;
+        std::vector<std::wstring> removes;
+        m_userScripts.update(wanted, adds, removes);
+        for (const auto& id : removes) m_webview->RemoveScriptToExecuteOnDocumentCreated(id.c_str());
+        for (const auto& script : adds) {
+            int id = script.id;
+            HRESULT hr = m_webview->AddScriptToExecuteOnDocumentCreated(
+                script.source->c_str(),
+                Callback<ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler>(
+                    [this, id](HRESULT errorCode, LPCWSTR webviewId) -> HRESULT {
+                        if (FAILED(errorCode)) {
+                            m_userScripts.failed(id);
+                        } else if (!m_userScripts.added(id, webviewId) && m_webview && webviewId) {
+                            m_webview->RemoveScriptToExecuteOnDocumentCreated(webviewId);
+                        }
+                        return S_OK;
+                    }).Get());
+            if (FAILED(hr)) m_userScripts.failed(id);
+        }
+    }
+
+    void inputDelivered(const InputItem& item) {
+        if (item.kind == INPUT_KEY) InstanceStats::bump(m_stats.keyEvents);
+        uint64_t now = InstanceStats::nowMicros();
+        m_stats.inputLatency.record(now > item.posted ? now - item.posted : 0);
+        m_inputQueued.fetch_sub(1);
+    }
+
+    // Delivers queued input in order. Composition updates, and text that
+    // commits a composition, wait for their DevTools call to complete
+    // before anything after them goes out.
+    void pumpInput() {
+        while (!m_inputBusy && !m_input.empty()) {
+            InputItem item = std::move(m_input.front());
+            m_input.pop_front();
+            HWND target = getBrowserHwnd();
+            if (item.kind == INPUT_KEY) {
+                if (target) PostMessageW(target, item.msg, item.wParam, item.lParam);
+                inputDelivered(item);
+                continue;
+            }
+            if (item.kind == INPUT_TEXT && !m_composing) {
+                std::vector<TypedInput> typed;
+                AppendTypedInput(typed, item.text.c_str(), item.text.size());
+                for (const TypedInput& input : typed) {
+                    if (!target) break;
+                    if (input.key) {
+                        PostMessageW(target, WM_KEYDOWN, input.code, 0);
+                        PostMessageW(target, WM_KEYUP, input.code, (1 << 30) | (1 << 31));
+                    } else {
+                        PostMessageW(target, WM_CHAR, input.code, 0);
+                    }
+                }
+                inputDelivered(item);
+                continue;
+            }
+            // Nothing to cancel, or no DevTools to do it with
+            if (!m_webview || (item.kind == INPUT_COMPOSITION && item.text.empty() && !m_composing)) {
+                inputDelivered(item);
+                continue;
+            }
+            std::wstring params = item.kind == INPUT_TEXT
+                ? InsertTextParams(item.text.c_str(), item.text.size())
+                : CompositionParams(item.text.c_str(), item.text.size(), item.cursor);
+            m_composing = item.kind == INPUT_COMPOSITION && !item.text.empty();
+            m_inputBusy = true;
+            auto done = std::make_shared<InputItem>(std::move(item));
+            HRESULT hr = m_webview->CallDevToolsProtocolMethod(
+                done->kind == INPUT_TEXT ? L"Input.insertText" : L"Input.imeSetComposition",
+                params.c_str(),
+                Callback<ICoreWebView2CallDevToolsProtocolMethodCompletedHandler>(
+                    [this, done](HRESULT errorCode, LPCWSTR result) -> HRESULT {
+                        m_inputBusy = false;
+                        inputDelivered(*done);
+                        pumpInput();
+                        return S_OK;
+                    }).Get());
+            if (FAILED(hr)) {
+                m_inputBusy = false;
+                inputDelivered(*done);
+            }
+        }
+    }
+
     void teardownWGC() {
         m_useWGC = false;
         m_frameArrivedRevoker.revoke();
@@ -849,6 +1686,7 @@ private:
 
     void threadProc() {
         m_threadId = GetCurrentThreadId();
+        TraceSetThreadName("WebView host");
 
         HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
         if (FAILED(hr)) {
@@ -941,11 +1779,53 @@ private:
             DestroyWindow(m_hwnd);
             m_hwnd = nullptr;
         }
+        discardPendingCommands();
 
         CoUninitialize();
     }
 
+    // Commands still queued when the loop ends are never handled; frees their
+    // payloads and wakes a SaveCookieJar caller instead of letting it time out
+    void discardPendingCommands() {
+        MSG msg;
+        // hwnd -1: thread messages only
+        while (PeekMessageW(&msg, reinterpret_cast<HWND>(-1), WM_WEBVIEW_LOADURL,
+                            WM_WEBVIEW_RELAYOUT, PM_REMOVE)) {
+            switch (msg.message) {
+            case WM_WEBVIEW_LOADURL:
+            case WM_WEBVIEW_LOADHTML:
+            case WM_WEBVIEW_EVALUATEJS:
+                free(reinterpret_cast<char*>(msg.lParam));
+                break;
+            case WM_WEBVIEW_MOUSEEVENT:
+                delete reinterpret_cast<MouseEventData*>(msg.lParam);
+                break;
+            case WM_WEBVIEW_GETCOOKIES:
+            case WM_WEBVIEW_CLEARCOOKIE:
+                delete reinterpret_cast<CookieOpData*>(msg.lParam);
+                break;
+            case WM_WEBVIEW_SETCOOKIES:
+                delete reinterpret_cast<CookieBatch*>(msg.lParam);
+                break;
+            case WM_WEBVIEW_SAVECOOKIEJAR: {
+                auto* ref = reinterpret_cast<std::shared_ptr<CookieJarSave>*>(msg.lParam);
+                if (ref) SetEvent((*ref)->done);
+                delete ref;
+                break;
+            }
+            case WM_WEBVIEW_INPUT:
+                if (msg.lParam) m_inputQueued.fetch_sub(1);
+                delete reinterpret_cast<InputItem*>(msg.lParam);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
     void handleThreadMessage(const MSG& msg) {
+        m_stats.commandHandled();
+        WEBVIEW_TRACE_SCOPE_ARG("HandleCommand", msg.message - WM_USER);
         switch (msg.message) {
         case WM_WEBVIEW_LOADURL: {
             auto* url = reinterpret_cast<char*>(msg.lParam);
@@ -955,65 +1835,34 @@ private:
                 break;
             }
             if (m_webview && url) {
-                std::wstring wurl = Utf8ToWide(url);
-                std::wstring navigateUrl = wurl;
+                std::string_view urlView(url);
+                UrlParts parts;
+                bool rewritten = false;
 
                 // Map file:// URLs to a virtual host so local content loads correctly.
                 // WebView2 blocks JS modules/CORS on file:// origins.
-                if (wurl.find(L"file://") == 0 || wurl.find(L"file:///") == 0) {
+                if (ParseUrl(urlView, parts) && UrlSchemeIs(parts.scheme, "file")) {
                     ComPtr<ICoreWebView2_3> webview3;
                     if (SUCCEEDED(m_webview.As(&webview3)) && webview3) {
-                        // Strip file:// prefix
-                        std::wstring path = wurl.substr(wurl.find(L"file://") + 7);
-                        // Strip leading slash for Windows paths like /C:/...
-                        if (path.size() > 2 && path[0] == L'/' && path[2] == L':') {
-                            path = path.substr(1);
-                        }
-
-                        // Split off fragment (#...) and query (?...) BEFORE slash conversion
-                        std::wstring suffix;
-                        auto hashPos = path.find(L'#');
-                        auto queryPos = path.find(L'?');
-                        auto splitPos = hashPos < queryPos ? hashPos : queryPos;
-                        if (splitPos != std::wstring::npos) {
-                            suffix = path.substr(splitPos);
-                            path = path.substr(0, splitPos);
-                        }
-
-                        // Replace forward slashes with backslashes for filesystem path
-                        for (auto& c : path) {
-                            if (c == L'/') c = L'\\';
-                        }
-
-                        // Percent-decode the filesystem path (e.g. %20→space, %C3%A9→é)
-                        path = PercentDecode(path);
-
-                        // Extract directory and filename
-                        auto lastSlash = path.rfind(L'\\');
-                        if (lastSlash != std::wstring::npos) {
-                            std::wstring folder = path.substr(0, lastSlash);
-                            std::wstring filename = path.substr(lastSlash + 1);
-
-                            // Reuse existing host for this folder, or create a new one
-                            auto it = m_folderHostMap.find(folder);
-                            std::wstring hostName;
-                            if (it != m_folderHostMap.end()) {
-                                hostName = it->second;
-                            } else {
-                                hostName = L"localapp" + std::to_wstring(m_hostCounter++) + L".webview";
-                                m_folderHostMap[folder] = hostName;
+                        std::wstring folder, hostName;
+                        bool newMapping;
+                        if (m_virtualHosts.rewrite(urlView, m_navigateUrl, folder, hostName, newMapping)) {
+                            if (newMapping) {
                                 webview3->SetVirtualHostNameToFolderMapping(
                                     hostName.c_str(),
                                     folder.c_str(),
                                     COREWEBVIEW2_HOST_RESOURCE_ACCESS_KIND_ALLOW);
                             }
-
-                            navigateUrl = L"https://" + hostName + L"/" + filename + suffix;
+                            rewritten = true;
                         }
                     }
                 }
+                if (!rewritten) {
+                    m_navigateUrl.clear();
+                    AppendUtf8ToWide(m_navigateUrl, urlView.data(), urlView.size());
+                }
 
-                m_webview->Navigate(navigateUrl.c_str());
+                m_webview->Navigate(m_navigateUrl.c_str());
             }
             free(url);
             break;
@@ -1046,9 +1895,7 @@ private:
             if (m_webview) m_webview->Reload();
             break;
         case WM_WEBVIEW_SETVISIBILITY:
-            if (m_controller) {
-                m_controller->put_IsVisible(static_cast<BOOL>(msg.wParam));
-            }
+            applyLifecycle(LifecycleManager::instance().state(this));
             break;
         case WM_WEBVIEW_SETRECT:
             if (m_controller && m_hwnd) {
@@ -1080,31 +1927,29 @@ private:
                 m_inRendering = false;
                 break;
             }
+            InstanceStats::bump(m_stats.captureRequests);
+            WEBVIEW_TRACE_INSTANT("CapturePreview", 0);
+            uint64_t requested = InstanceStats::nowMicros();
             ComPtr<IStream> stream;
             CreateStreamOnHGlobal(nullptr, TRUE, &stream);
             m_webview->CapturePreview(
                 COREWEBVIEW2_CAPTURE_PREVIEW_IMAGE_FORMAT_PNG,
                 stream.Get(),
                 Callback<ICoreWebView2CapturePreviewCompletedHandler>(
-                    [this, stream](HRESULT errorCode) -> HRESULT {
-                        if (SUCCEEDED(errorCode)) {
+                    [this, stream, requested](HRESULT errorCode) -> HRESULT {
+                        WEBVIEW_TRACE_SCOPE("CapturePreviewCompleted");
+                        if (SUCCEEDED(errorCode) && !m_frames.parked()) {
                             LARGE_INTEGER li = {};
                             stream->Seek(li, STREAM_SEEK_SET, nullptr);
 
-                            int newBitmap;
-                            {
-                                std::lock_guard<std::mutex> lock(m_bitmapMutex);
-                                newBitmap = 1 - m_currentBitmap;
-                            }
-                            int w = 0, h = 0;
-                            decodePngFromStream(stream.Get(), m_bitmaps[newBitmap], w, h);
-
-                            if (w > 0 && h > 0) {
-                                std::lock_guard<std::mutex> lock(m_bitmapMutex);
-                                m_bitmapWidth = w;
-                                m_bitmapHeight = h;
-                                m_currentBitmap = newBitmap;
-                                m_needsDisplay = true;
+                            uint64_t convertStart = InstanceStats::nowMicros();
+                            bool changed = decodePngFromStream(stream.Get()) && m_frames.commitFrame();
+                            uint64_t ready = InstanceStats::nowMicros();
+                            m_stats.conversionTime.record(ready - convertStart);
+                            if (changed) {
+                                m_stats.captureLatency.record(ready - requested);
+                                InstanceStats::bump(m_stats.framesCaptured);
+                                frameChanged();
                             }
                         }
                         m_inRendering = false;
@@ -1189,9 +2034,27 @@ private:
                     L"})()",
                     nullptr);
             } else {
-                auto script = getScrollbarHideScript();
-                m_webview->ExecuteScript(script.c_str(), nullptr);
+                m_webview->ExecuteScript(kScrollbarHideScript, nullptr);
             }
+            // Later documents get it, or not, at creation
+            applyUserScripts();
+            break;
+        }
+        case WM_WEBVIEW_SYNCUSERSCRIPTS:
+            applyUserScripts();
+            break;
+        case WM_WEBVIEW_RELAYOUT:
+            // WGC delivers nothing new until the page repaints, so the
+            // displayed frame is rebuilt for the texture Unity recreates
+            lockFrameWriters();
+            m_frames.relayout();
+            unlockFrameWriters();
+            break;
+        case WM_WEBVIEW_INPUT: {
+            std::unique_ptr<InputItem> item(reinterpret_cast<InputItem*>(msg.lParam));
+            if (!item) break;
+            m_input.push_back(std::move(*item));
+            pumpInput();
             break;
         }
         case WM_WEBVIEW_PAUSE: {
@@ -1220,34 +2083,19 @@ private:
                 m_cookieManager->GetCookies(
                     data->url.c_str(),
                     Callback<ICoreWebView2GetCookiesCompletedHandler>(
-                        [this](HRESULT result, ICoreWebView2CookieList* cookieList) -> HRESULT {
-                            if (FAILED(result) || !cookieList) return S_OK;
-                            UINT count = 0;
-                            cookieList->get_Count(&count);
-                            std::string cookieStr;
-                            for (UINT i = 0; i < count; i++) {
-                                ComPtr<ICoreWebView2Cookie> cookie;
-                                cookieList->GetValueAtIndex(i, &cookie);
-                                if (!cookie) continue;
-                                LPWSTR name = nullptr, value = nullptr, domain = nullptr, path = nullptr;
-                                cookie->get_Name(&name);
-                                cookie->get_Value(&value);
-                                cookie->get_Domain(&domain);
-                                cookie->get_Path(&path);
-                                if (name && value) {
-                                    cookieStr += WideToUtf8(name) + "=" + WideToUtf8(value);
-                                    if (domain) cookieStr += "; Domain=" + WideToUtf8(domain);
-                                    if (path) cookieStr += "; Path=" + WideToUtf8(path);
-                                    cookieStr += "; Version=0\n";
-                                }
-                                CoTaskMemFree(name);
-                                CoTaskMemFree(value);
-                                CoTaskMemFree(domain);
-                                CoTaskMemFree(path);
+                        [this, request = data->request, posted = data->posted](
+                            HRESULT result, ICoreWebView2CookieList* cookieList) -> HRESULT {
+                            std::vector<BrowserCookie> cookies;
+                            if (SUCCEEDED(result) && cookieList) {
+                                ReadCookieList(cookieList, cookies);
+                            } else if (!request) {
+                                return S_OK;
                             }
-                            addMessage("CallOnCookies:" + cookieStr);
+                            deliverCookies(cookies, request, posted);
                             return S_OK;
                         }).Get());
+            } else if (data && data->request) {
+                deliverCookies(std::vector<BrowserCookie>(), data->request, data->posted);
             }
             delete data;
             break;
@@ -1285,6 +2133,41 @@ private:
             }
             break;
         }
+        case WM_WEBVIEW_SETCOOKIES: {
+            auto* batch = reinterpret_cast<CookieBatch*>(msg.lParam);
+            if (batch && m_cookieManager) {
+                applyCookies(batch->cookies, batch->posted);
+            } else if (batch && !m_webview) {
+                // Applied once the cookie manager exists, before any navigation
+                if (m_pendingCookies.empty()) m_pendingCookiesPosted = batch->posted;
+                m_pendingCookies.insert(m_pendingCookies.end(), batch->cookies.begin(), batch->cookies.end());
+            }
+            delete batch;
+            break;
+        }
+        case WM_WEBVIEW_SAVECOOKIEJAR: {
+            auto* ref = reinterpret_cast<std::shared_ptr<CookieJarSave>*>(msg.lParam);
+            std::shared_ptr<CookieJarSave> save = std::move(*ref);
+            delete ref;
+            if (!m_cookieManager ||
+                FAILED(m_cookieManager->GetCookies(
+                    L"",
+                    Callback<ICoreWebView2GetCookiesCompletedHandler>(
+                        [save](HRESULT result, ICoreWebView2CookieList* cookieList) -> HRESULT {
+                            if (SUCCEEDED(result) && cookieList) {
+                                std::vector<BrowserCookie> cookies;
+                                ReadCookieList(cookieList, cookies);
+                                PruneCookies(cookies, NowSeconds(), save->includeSession);
+                                if (WriteCookieJarFile(save->path.c_str(), cookies))
+                                    save->result.store(static_cast<int>(cookies.size()));
+                            }
+                            SetEvent(save->done);
+                            return S_OK;
+                        }).Get()))) {
+                SetEvent(save->done);
+            }
+            break;
+        }
         }
     }
 
@@ -1296,7 +2179,7 @@ private:
             Callback<ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandler>(
                 [this](HRESULT result, ICoreWebView2Environment* env) -> HRESULT {
                     if (FAILED(result) || !env) {
-                        addMessage("CallOnError:Failed to create WebView2 environment");
+                        addEvent(WEBVIEW_EVENT_ERROR, "Failed to create WebView2 environment");
                         return S_OK;
                     }
                     m_environment = env;
@@ -1327,7 +2210,7 @@ private:
                 }).Get());
 
         if (FAILED(hr)) {
-            addMessage("CallOnError:WebView2 runtime not found");
+            addEvent(WEBVIEW_EVENT_ERROR, "WebView2 runtime not found");
         }
     }
 
@@ -1337,7 +2220,7 @@ private:
             Callback<ICoreWebView2CreateCoreWebView2ControllerCompletedHandler>(
                 [this](HRESULT result, ICoreWebView2Controller* controller) -> HRESULT {
                     if (FAILED(result) || !controller) {
-                        addMessage("CallOnError:Failed to create WebView2 controller");
+                        addEvent(WEBVIEW_EVENT_ERROR, "Failed to create WebView2 controller");
                         return S_OK;
                     }
                     onWebView2Created(controller);
@@ -1391,7 +2274,7 @@ private:
         m_controller = controller;
         controller->get_CoreWebView2(&m_webview);
         if (!m_webview) {
-            addMessage("CallOnError:Failed to get CoreWebView2");
+            addEvent(WEBVIEW_EVENT_ERROR, "Failed to get CoreWebView2");
             return;
         }
 
@@ -1400,6 +2283,9 @@ private:
         if (SUCCEEDED(m_webview.As(&webview2)) && webview2) {
             webview2->get_CookieManager(&m_cookieManager);
         }
+        applyPendingCookies();
+        UINT32 browserPid = 0;
+        if (SUCCEEDED(m_webview->get_BrowserProcessId(&browserPid))) m_browserPid.store(browserPid);
 
         RECT rc;
         GetClientRect(m_hwnd, &rc);
@@ -1441,18 +2327,16 @@ private:
             }
         }
 
-        // Inject Unity.call JS bridge and scrollbar hiding for offscreen mode
-        std::wstring bridgeScript =
-            L"window.Unity = { call: function(msg) { window.chrome.webview.postMessage(msg); } };";
-        if (!m_separated && !m_scrollbarsVisible) {
-            bridgeScript += L"\n" + getScrollbarHideScript();
-        }
+        // Inject the Unity.call JS bridge ahead of the user scripts, which
+        // may use it; scrollbar hiding for offscreen mode is one of those
         m_webview->AddScriptToExecuteOnDocumentCreated(
-            bridgeScript.c_str(),
+            L"window.Unity = { call: function(msg, payload) { window.chrome.webview.postMessage("
+            L"arguments.length > 1 ? '\\x1f' + msg + '\\x1f' + payload : msg); } };",
             Callback<ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler>(
                 [](HRESULT errorCode, LPCWSTR id) -> HRESULT {
                     return S_OK;
                 }).Get());
+        applyUserScripts();
 
         // WebMessageReceived handler
         EventRegistrationToken token;
@@ -1462,8 +2346,17 @@ private:
                     LPWSTR messageRaw = nullptr;
                     HRESULT hr = args->TryGetWebMessageAsString(&messageRaw);
                     if (SUCCEEDED(hr) && messageRaw) {
-                        std::string msg = WideToUtf8(messageRaw);
-                        addMessage("CallFromJS:" + msg);
+                        std::wstring_view message(messageRaw);
+                        std::wstring_view channel, payload;
+                        if (SplitChannelMessage(message, channel, payload)) {
+                            // Unsubscribed channels stop here, unconverted
+                            int id = m_channels.route(channel);
+                            if (id) addChannelEvent(id, payload.data(), payload.size());
+                        } else {
+                            std::string msg;
+                            AppendWideToUtf8(msg, message.data(), message.size());
+                            addEvent(WEBVIEW_EVENT_FROM_JS, std::move(msg));
+                        }
                         CoTaskMemFree(messageRaw);
                     }
                     return S_OK;
@@ -1473,60 +2366,45 @@ private:
         m_webview->add_NavigationStarting(
             Callback<ICoreWebView2NavigationStartingEventHandler>(
                 [this](ICoreWebView2* sender, ICoreWebView2NavigationStartingEventArgs* args) -> HRESULT {
+                    WEBVIEW_TRACE_INSTANT("NavigationStarting", 0);
                     LPWSTR uriRaw = nullptr;
                     args->get_Uri(&uriRaw);
                     if (!uriRaw) return S_OK;
 
-                    std::wstring wurl(uriRaw);
-                    std::string url = WideToUtf8(uriRaw);
+                    // Classify the URI in place; it is converted to UTF-8
+                    // once, straight into the event that reports it
+                    std::wstring_view uri(uriRaw);
+                    WideUrlParts parts;
+                    bool isUnity = ParseUrl(uri, parts) && UrlSchemeIs(parts.scheme, "unity");
+                    UrlFilterResult filter = isUnity ? URL_FILTER_PASS : m_urlFilter.check(uri);
+                    std::string payload;
+                    if (filter != URL_FILTER_DENY) {
+                        // "unity:" URLs carry a message from JS after the scheme
+                        size_t skip = isUnity ? parts.scheme.size() + 1 : 0;
+                        AppendWideToUtf8(payload, uri.data() + skip, uri.size() - skip);
+                    }
                     CoTaskMemFree(uriRaw);
 
                     m_progress.store(10);
 
-                    // Check "unity:" scheme
-                    if (wurl.find(L"unity:") == 0) {
-                        std::string rest = url.substr(6);
-                        addMessage("CallFromJS:" + rest);
+                    if (filter == URL_FILTER_DENY) {
+                        m_navigations.cancelled();
                         args->put_Cancel(TRUE);
                         return S_OK;
                     }
-
-                    std::lock_guard<std::mutex> lock(m_patternMutex);
-
-                    // Check hook pattern
-                    if (m_hookRegex) {
-                        try {
-                            if (std::regex_search(wurl, *m_hookRegex)) {
-                                addMessage("CallOnHooked:" + url);
-                                args->put_Cancel(TRUE);
-                                return S_OK;
-                            }
-                        } catch (...) {}
-                    }
-
-                    // Check allow/deny patterns
-                    bool pass = true;
-                    if (m_denyRegex) {
-                        try {
-                            if (std::regex_search(wurl, *m_denyRegex)) {
-                                // Deny matched, check if allow overrides
-                                if (m_allowRegex) {
-                                    if (!std::regex_search(wurl, *m_allowRegex)) {
-                                        pass = false;
-                                    }
-                                } else {
-                                    pass = false;
-                                }
-                            }
-                        } catch (...) {}
-                    }
-
-                    if (!pass) {
-                        args->put_Cancel(TRUE);
-                        return S_OK;
+                    if (filter == URL_FILTER_HOOK) {
+                        m_navigations.cancelled();
+                    } else if (!isUnity) {
+                        UINT64 id = 0;
+                        args->get_NavigationId(&id);
+                        NavigationTiming superseded;
+                        if (m_navigations.started(id, payload, InstanceStats::nowMicros(), superseded))
+                            addNavigationTiming(superseded);
                     }
-
-                    addMessage("CallOnStarted:" + url);
+                    addEvent(isUnity ? WEBVIEW_EVENT_FROM_JS
+                             : filter == URL_FILTER_HOOK ? WEBVIEW_EVENT_HOOKED : WEBVIEW_EVENT_STARTED,
+                             std::move(payload));
+                    if (isUnity || filter == URL_FILTER_HOOK) args->put_Cancel(TRUE);
                     return S_OK;
                 }).Get(), &token);
 
@@ -1534,8 +2412,10 @@ private:
         m_webview->add_NavigationCompleted(
             Callback<ICoreWebView2NavigationCompletedEventHandler>(
                 [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT {
+                    uint64_t completedAt = InstanceStats::nowMicros();
                     BOOL isSuccess = FALSE;
                     args->get_IsSuccess(&isSuccess);
+                    WEBVIEW_TRACE_INSTANT("NavigationCompleted", isSuccess);
                     m_progress.store(100);
 
                     // Update navigation state
@@ -1547,23 +2427,50 @@ private:
 
                     LPWSTR uriRaw = nullptr;
                     sender->get_Source(&uriRaw);
-                    std::string url = uriRaw ? WideToUtf8(uriRaw) : "";
-                    if (uriRaw) CoTaskMemFree(uriRaw);
+                    std::string url;
+                    if (uriRaw) {
+                        AppendWideToUtf8(url, uriRaw, wcslen(uriRaw));
+                        CoTaskMemFree(uriRaw);
+                    }
 
                     if (isSuccess) {
-                        addMessage("CallOnLoaded:" + url);
-                        // Re-inject scrollbar hiding CSS after navigation
-                        if (!m_separated && !m_scrollbarsVisible.load()) {
-                            auto script = getScrollbarHideScript();
-                            sender->ExecuteScript(script.c_str(), nullptr);
-                        }
-                    } else {
-                        COREWEBVIEW2_WEB_ERROR_STATUS status;
+                        addEvent(WEBVIEW_EVENT_LOADED, std::move(url));
+                    }
+                    COREWEBVIEW2_WEB_ERROR_STATUS status = COREWEBVIEW2_WEB_ERROR_STATUS_UNKNOWN;
+                    if (!isSuccess) {
                         args->get_WebErrorStatus(&status);
-                        addMessage("CallOnError:" + url + " (error: " + std::to_string(static_cast<int>(status)) + ")");
+                        addEvent(WEBVIEW_EVENT_NAVIGATION_ERROR, std::move(url), static_cast<int>(status));
                     }
+
+                    UINT64 id = 0;
+                    args->get_NavigationId(&id);
+                    NavigationTiming finished;
+                    if (m_navigations.completed(id, isSuccess != FALSE, isSuccess ? 0 : static_cast<int>(status),
+                                                completedAt, finished))
+                        addNavigationTiming(finished);
+                    return S_OK;
+                }).Get(), &token);
+
+        // ContentLoading and DOMContentLoaded milestones for m_navigations
+        m_webview->add_ContentLoading(
+            Callback<ICoreWebView2ContentLoadingEventHandler>(
+                [this](ICoreWebView2* sender, ICoreWebView2ContentLoadingEventArgs* args) -> HRESULT {
+                    UINT64 id = 0;
+                    args->get_NavigationId(&id);
+                    m_navigations.contentLoading(id, InstanceStats::nowMicros());
                     return S_OK;
                 }).Get(), &token);
+        ComPtr<ICoreWebView2_2> webview2ForDom;
+        if (SUCCEEDED(m_webview.As(&webview2ForDom)) && webview2ForDom) {
+            webview2ForDom->add_DOMContentLoaded(
+                Callback<ICoreWebView2DOMContentLoadedEventHandler>(
+                    [this](ICoreWebView2* sender, ICoreWebView2DOMContentLoadedEventArgs* args) -> HRESULT {
+                        UINT64 id = 0;
+                        args->get_NavigationId(&id);
+                        m_navigations.domContentLoaded(id, InstanceStats::nowMicros());
+                        return S_OK;
+                    }).Get(), &token);
+        }
 
         // Handle target="_blank" links by navigating in the same webview
         m_webview->add_NewWindowRequested(
@@ -1588,20 +2495,34 @@ private:
                     args->get_Request(&request);
                     if (!request) return S_OK;
 
+                    bool blocking = m_requestBlocker.enabled();
+                    bool caching = m_responseCache.enabled();
+                    bool timing = m_resourceTimeline.enabled();
+                    if (blocking || caching || timing) {
+                        std::string method, url;
+                        if (getRequestKey(request.Get(), method, url)) {
+                            if (blocking && blockRequest(url, args)) return S_OK;
+                            if (timing) {
+                                COREWEBVIEW2_WEB_RESOURCE_CONTEXT context = COREWEBVIEW2_WEB_RESOURCE_CONTEXT_OTHER;
+                                args->get_ResourceContext(&context);
+                                m_resourceTimeline.begin(method, url, context, InstanceStats::nowMicros());
+                            }
+                            if (caching && serveCachedResponse(method, url, args)) return S_OK;
+                        }
+                    }
+
                     ComPtr<ICoreWebView2HttpRequestHeaders> headers;
                     request->get_Headers(&headers);
                     if (!headers) return S_OK;
 
-                    std::lock_guard<std::mutex> lock(m_headerMutex);
-                    for (const auto& pair : m_customHeaders) {
-                        std::wstring key = Utf8ToWide(pair.first.c_str());
-                        std::wstring value = Utf8ToWide(pair.second.c_str());
-                        headers->SetHeader(key.c_str(), value.c_str());
-                    }
+                    m_customHeaders.forEach([&](const wchar_t* key, const wchar_t* value) {
+                        headers->SetHeader(key, value);
+                    });
                     return S_OK;
                 }).Get(), &token);
 
-        // WebResourceResponseReceived handler for HTTP error codes
+        // WebResourceResponseReceived handler for HTTP error codes, cacheable
+        // responses and the resource timeline
         ComPtr<ICoreWebView2_2> webview2ForResponse;
         if (SUCCEEDED(m_webview.As(&webview2ForResponse)) && webview2ForResponse) {
             webview2ForResponse->add_WebResourceResponseReceived(
@@ -1613,8 +2534,11 @@ private:
 
                         int statusCode = 0;
                         response->get_StatusCode(&statusCode);
+                        if (m_resourceTimeline.enabled()) recordResponseTiming(args, response.Get(), statusCode);
                         if (statusCode >= 400) {
-                            addMessage("CallOnHttpError:" + std::to_string(statusCode));
+                            addEvent(WEBVIEW_EVENT_HTTP_ERROR, getResponseUrl(args), statusCode);
+                        } else if (statusCode == 200 && m_responseCache.enabled()) {
+                            cacheResponse(args, response.Get());
                         }
                         return S_OK;
                     }).Get(), &token);
@@ -1660,7 +2584,14 @@ private:
         if (!m_pendingUrl.empty()) {
             auto* copy = _strdup(m_pendingUrl.c_str());
             m_pendingUrl.clear();
-            PostThreadMessageW(GetCurrentThreadId(), WM_WEBVIEW_LOADURL, 0, reinterpret_cast<LPARAM>(copy));
+            postCommand(WM_WEBVIEW_LOADURL, 0, reinterpret_cast<LPARAM>(copy));
+        }
+
+        // Catch up with a hide that arrived before WebView2 was ready
+        if (m_appliedState != LIFECYCLE_VISIBLE) {
+            int state = m_appliedState;
+            m_appliedState = LIFECYCLE_VISIBLE;
+            applyLifecycle(state);
         }
     }
 
@@ -1694,7 +2625,7 @@ private:
             // User closed the separated window — trigger clean shutdown
             // instead of letting DefWindowProcW destroy the HWND prematurely
             if (self) {
-                PostThreadMessageW(self->m_threadId, WM_WEBVIEW_DESTROY, 0, 0);
+                self->postCommand(WM_WEBVIEW_DESTROY, 0, 0);
             }
             return 0;
         case WM_DESTROY:
@@ -1707,12 +2638,140 @@ private:
     }
 };
 
+// Lifecycle evaluation runs from _CWebViewPlugin_Update at most this often,
+// and the memory sample is refreshed at the same rate
+static const uint64_t kLifecycleIntervalMicros = 500000;
+
+// Working sets of the WebView2 browser processes and their direct children
+// (renderers, GPU, utility). WebView2 has no per-instance memory figure.
+static uint64_t SampleWebViewMemory(std::vector<DWORD> pids) {
+    size_t browsers = pids.size();
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (snapshot != INVALID_HANDLE_VALUE) {
+        PROCESSENTRY32W entry = {};
+        entry.dwSize = sizeof(entry);
+        for (BOOL ok = Process32FirstW(snapshot, &entry); ok; ok = Process32NextW(snapshot, &entry)) {
+            if (std::find(pids.begin(), pids.begin() + browsers, entry.th32ParentProcessID) !=
+                pids.begin() + browsers)
+                pids.push_back(entry.th32ProcessID);
+        }
+        CloseHandle(snapshot);
+    }
+    std::sort(pids.begin(), pids.end());
+    pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+    uint64_t total = 0;
+    for (DWORD pid : pids) {
+        HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        if (!process) continue;
+        PROCESS_MEMORY_COUNTERS counters = {};
+        if (GetProcessMemoryInfo(process, &counters, sizeof(counters))) total += counters.WorkingSetSize;
+        CloseHandle(process);
+    }
+    return total;
+}
+
+// Latest SampleWebViewMemory figure, 0 while no budget is set. The process
+// walk takes milliseconds, so it runs on its own thread rather than in
+// Unity's Update.
+static std::atomic<uint64_t> s_webViewMemory{0};
+
+static void MemorySamplerProc() {
+    for (;;) {
+        uint64_t memory = 0;
+        if (LifecycleManager::instance().hasBudget()) {
+            std::vector<DWORD> pids;
+            {
+                std::lock_guard<std::mutex> lock(s_instancesMutex);
+                for (auto* inst : s_instances) {
+                    DWORD pid = inst->browserProcessId();
+                    if (pid) pids.push_back(pid);
+                }
+            }
+            if (!pids.empty()) memory = SampleWebViewMemory(std::move(pids));
+        }
+        s_webViewMemory.store(memory);
+        std::this_thread::sleep_for(std::chrono::microseconds(kLifecycleIntervalMicros));
+    }
+}
+
+static void EvaluateLifecycle() {
+    LifecycleManager& manager = LifecycleManager::instance();
+    uint64_t now = InstanceStats::nowMicros();
+    if (!manager.due(now, kLifecycleIntervalMicros)) return;
+    uint64_t memory = 0;
+    if (manager.hasBudget()) {
+        // Started with the first budget and never stopped, like the other
+        // process-wide singletons; until its first sample the figure is 0
+        // (unknown) and only the delays apply
+        static std::once_flag samplerStarted;
+        std::call_once(samplerStarted, [] { std::thread(MemorySamplerProc).detach(); });
+        memory = s_webViewMemory.load();
+    }
+    std::vector<LifecycleManager::Transition> transitions;
+    manager.evaluate(now, memory, transitions);
+    if (transitions.empty()) return;
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    for (const auto& transition : transitions) {
+        auto* inst = static_cast<WebViewInstance*>(transition.key);
+        if (std::find(s_instances.begin(), s_instances.end(), inst) != s_instances.end())
+            inst->syncLifecycle();
+    }
+}
+
 extern "C" {
 
 EXPORT void _CWebViewPlugin_InitStatic(bool inEditor, bool useMetal) {
     s_inEditor = inEditor;
 }
 
+// Sizes the worker pool shared by all instances for frame conversion;
+// 0 restores the default (cores minus two, leaving Unity's main and render
+// threads alone)
+EXPORT void _CWebViewPlugin_SetWorkerThreadCount(int count) {
+    WEBVIEW_RECORD_CALL(CALL_SETWORKERTHREADCOUNT, nullptr, count);
+    WorkerPool::instance().setThreadCount(count);
+}
+
+EXPORT void _CWebViewPlugin_GetWorkerPoolStats(WorkerPoolStats* stats) {
+    if (!stats) return;
+    *stats = WorkerPool::instance().stats();
+}
+
+// Caps the memory held by the frame buffer pool shared by all instances
+// (0: unlimited); frames that would exceed it are dropped
+EXPORT void _CWebViewPlugin_ConfigureFrameBufferPool(long long memoryCap, bool largePages) {
+    WEBVIEW_RECORD_CALL(CALL_CONFIGUREFRAMEBUFFERPOOL, nullptr, memoryCap, largePages);
+    FrameBufferPool::instance().configure(memoryCap > 0 ? static_cast<size_t>(memoryCap) : 0, largePages);
+}
+
+EXPORT void _CWebViewPlugin_GetFrameBufferPoolStats(FrameBufferPoolStats* stats) {
+    if (!stats) return;
+    *stats = FrameBufferPool::instance().stats();
+}
+
+// Starts or stops recording the Chrome trace of the native pipeline;
+// starting discards what was recorded before
+EXPORT void _CWebViewPlugin_SetTracing(bool enabled) {
+    if (enabled && !TraceEnabled()) TraceClear();
+    SetTraceEnabled(enabled);
+}
+
+// Writes the recorded events (the most recent per thread) to path as
+// trace_event JSON; tracing may stay enabled meanwhile
+EXPORT bool _CWebViewPlugin_WriteTrace(const char* path) {
+    return WriteTraceFile(path);
+}
+
+// Logs every call Unity makes into the plugin to path, for replay with
+// webview_replay; returns false if the file cannot be created
+EXPORT bool _CWebViewPlugin_StartRecording(const char* path) {
+    return StartCallRecording(path);
+}
+
+EXPORT void _CWebViewPlugin_StopRecording() {
+    StopCallRecording();
+}
+
 EXPORT bool _CWebViewPlugin_IsInitialized(void* instance) {
     if (!instance) return false;
     return static_cast<WebViewInstance*>(instance)->isInitialized();
@@ -1722,31 +2781,37 @@ EXPORT void* _CWebViewPlugin_Init(
     const char* gameObject, bool transparent, bool zoom,
     int width, int height, const char* ua, bool separated) {
     auto* instance = new WebViewInstance(gameObject, transparent, zoom, width, height, ua, separated);
+    WEBVIEW_RECORD_CALL(CALL_INIT, instance, gameObject, transparent, zoom, width, height, ua, separated);
     {
         std::lock_guard<std::mutex> lock(s_instancesMutex);
         s_instances.push_back(instance);
     }
+    LifecycleManager::instance().add(instance);
     return instance;
 }
 
 EXPORT void _CWebViewPlugin_Destroy(void* instance) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_DESTROY, instance);
     auto* inst = static_cast<WebViewInstance*>(instance);
     {
         std::lock_guard<std::mutex> lock(s_instancesMutex);
         auto it = std::find(s_instances.begin(), s_instances.end(), inst);
         if (it != s_instances.end()) s_instances.erase(it);
     }
+    LifecycleManager::instance().remove(inst);
     delete inst;
 }
 
 EXPORT void _CWebViewPlugin_SetRect(void* instance, int width, int height) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SETRECT, instance, width, height);
     static_cast<WebViewInstance*>(instance)->setRect(width, height);
 }
 
 EXPORT void _CWebViewPlugin_SetVisibility(void* instance, bool visibility) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SETVISIBILITY, instance, visibility);
     static_cast<WebViewInstance*>(instance)->setVisibility(visibility);
 }
 
@@ -1754,57 +2819,101 @@ EXPORT bool _CWebViewPlugin_SetURLPattern(
     void* instance, const char* allowPattern,
     const char* denyPattern, const char* hookPattern) {
     if (!instance) return false;
+    WEBVIEW_RECORD_CALL(CALL_SETURLPATTERN, instance, allowPattern, denyPattern, hookPattern);
     return static_cast<WebViewInstance*>(instance)->setURLPattern(allowPattern, denyPattern, hookPattern);
 }
 
 EXPORT void _CWebViewPlugin_LoadURL(void* instance, const char* url) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_LOADURL, instance, url);
     static_cast<WebViewInstance*>(instance)->loadURL(url);
 }
 
 EXPORT void _CWebViewPlugin_LoadHTML(void* instance, const char* html, const char* baseUrl) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_LOADHTML, instance, html, baseUrl);
     static_cast<WebViewInstance*>(instance)->loadHTML(html, baseUrl);
 }
 
 EXPORT void _CWebViewPlugin_EvaluateJS(void* instance, const char* js) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_EVALUATEJS, instance, js);
     static_cast<WebViewInstance*>(instance)->evaluateJS(js);
 }
 
+// Copies the instance's counters into stats. The per-instance counters are
+// read from atomics; the frame buffer pool, response cache and channel
+// figures each take their own short-held mutex. The caller sets
+// stats->size to the size of its struct; callers built against an older,
+// shorter layout receive just that prefix.
+EXPORT bool _CWebViewPlugin_GetStats(void* instance, WebViewStats* stats) {
+    if (!instance || !stats || stats->size < offsetof(WebViewStats, framesCaptured)) return false;
+    WebViewStats snapshot;
+    static_cast<WebViewInstance*>(instance)->getStats(snapshot);
+    uint32_t size = stats->size < sizeof(snapshot) ? stats->size : static_cast<uint32_t>(sizeof(snapshot));
+    memcpy(stats, &snapshot, size);
+    stats->size = size;
+    return true;
+}
+
+EXPORT const char* _CWebViewPlugin_GetStatsJson(void* instance) {
+    if (!instance) return nullptr;
+    WebViewStats stats;
+    static_cast<WebViewInstance*>(instance)->getStats(stats);
+    std::string json = WebViewStatsToJson(stats);
+    char* r = (char*)CoTaskMemAlloc(json.size() + 1);
+    if (!r) return nullptr;
+    memcpy(r, json.c_str(), json.size() + 1);
+    return r;
+}
+
+// Bytes of frame memory released while the instance is hidden, net of its
+// compressed frame (0 while visible)
+EXPORT long long _CWebViewPlugin_GetParkedBytesSaved(void* instance) {
+    if (!instance) return 0;
+    return static_cast<WebViewInstance*>(instance)->parkedBytesSaved();
+}
+
 EXPORT int _CWebViewPlugin_Progress(void* instance) {
     if (!instance) return 0;
+    WEBVIEW_RECORD_CALL(CALL_PROGRESS, instance);
     return static_cast<WebViewInstance*>(instance)->progress();
 }
 
 EXPORT bool _CWebViewPlugin_CanGoBack(void* instance) {
     if (!instance) return false;
+    WEBVIEW_RECORD_CALL(CALL_CANGOBACK, instance);
     return static_cast<WebViewInstance*>(instance)->canGoBack();
 }
 
 EXPORT bool _CWebViewPlugin_CanGoForward(void* instance) {
     if (!instance) return false;
+    WEBVIEW_RECORD_CALL(CALL_CANGOFORWARD, instance);
     return static_cast<WebViewInstance*>(instance)->canGoForward();
 }
 
 EXPORT void _CWebViewPlugin_GoBack(void* instance) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_GOBACK, instance);
     static_cast<WebViewInstance*>(instance)->goBack();
 }
 
 EXPORT void _CWebViewPlugin_GoForward(void* instance) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_GOFORWARD, instance);
     static_cast<WebViewInstance*>(instance)->goForward();
 }
 
 EXPORT void _CWebViewPlugin_Reload(void* instance) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_RELOAD, instance);
     static_cast<WebViewInstance*>(instance)->reload();
 }
 
 EXPORT void _CWebViewPlugin_SendMouseEvent(
     void* instance, int x, int y, float deltaY, int mouseState) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SENDMOUSEEVENT, instance, x, y, deltaY, mouseState);
     static_cast<WebViewInstance*>(instance)->sendMouseEvent(x, y, deltaY, mouseState);
 }
 
@@ -1812,52 +2921,91 @@ EXPORT void _CWebViewPlugin_SendKeyEvent(
     void* instance, int x, int y,
     const wchar_t* keyChars, unsigned short keyCode, int keyState) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SENDKEYEVENT, instance, x, y,
+                        keyChars ? WideToUtf8(keyChars).c_str() : nullptr, keyCode, keyState);
     static_cast<WebViewInstance*>(instance)->sendKeyEvent(x, y, keyChars, keyCode, keyState);
 }
 
+// Types a whole UTF-16 string in one call, for pastes and IME commits
+EXPORT void _CWebViewPlugin_SendText(void* instance, const wchar_t* text) {
+    if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SENDTEXT, instance, text ? WideToUtf8(text).c_str() : nullptr);
+    static_cast<WebViewInstance*>(instance)->sendText(text);
+}
+
+// The IME composition string and caret position (UTF-16 units); empty or
+// null text ends the composition without committing it
+EXPORT void _CWebViewPlugin_SetComposition(void* instance, const wchar_t* text, int cursor) {
+    if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SETCOMPOSITION, instance, text ? WideToUtf8(text).c_str() : nullptr, cursor);
+    static_cast<WebViewInstance*>(instance)->setComposition(text, cursor);
+}
+
 EXPORT void _CWebViewPlugin_Update(void* instance, bool refreshBitmap, int devicePixelRatio) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_UPDATE, instance, refreshBitmap, devicePixelRatio);
     static_cast<WebViewInstance*>(instance)->update(refreshBitmap, devicePixelRatio);
+    EvaluateLifecycle();
 }
 
 EXPORT int _CWebViewPlugin_BitmapWidth(void* instance) {
     if (!instance) return 0;
+    WEBVIEW_RECORD_CALL(CALL_BITMAPWIDTH, instance);
     return static_cast<WebViewInstance*>(instance)->bitmapWidth();
 }
 
 EXPORT int _CWebViewPlugin_BitmapHeight(void* instance) {
     if (!instance) return 0;
+    WEBVIEW_RECORD_CALL(CALL_BITMAPHEIGHT, instance);
     return static_cast<WebViewInstance*>(instance)->bitmapHeight();
 }
 
 EXPORT void _CWebViewPlugin_Render(void* instance, void* textureBuffer) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_RENDER, instance);
     static_cast<WebViewInstance*>(instance)->render(textureBuffer);
 }
 
+EXPORT void _CWebViewPlugin_SetFrameFormat(void* instance, int format) {
+    if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SETFRAMEFORMAT, instance, format);
+    static_cast<WebViewInstance*>(instance)->setFrameFormat(format);
+}
+
+EXPORT void _CWebViewPlugin_SetMipChain(void* instance, bool enabled, bool gammaCorrect) {
+    if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SETMIPCHAIN, instance, enabled, gammaCorrect);
+    static_cast<WebViewInstance*>(instance)->setMipChain(enabled, gammaCorrect);
+}
+
 EXPORT void _CWebViewPlugin_AddCustomHeader(
     void* instance, const char* headerKey, const char* headerValue) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_ADDCUSTOMHEADER, instance, headerKey, headerValue);
     static_cast<WebViewInstance*>(instance)->addCustomHeader(headerKey, headerValue);
 }
 
 EXPORT void _CWebViewPlugin_RemoveCustomHeader(void* instance, const char* headerKey) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_REMOVECUSTOMHEADER, instance, headerKey);
     static_cast<WebViewInstance*>(instance)->removeCustomHeader(headerKey);
 }
 
 EXPORT const char* _CWebViewPlugin_GetCustomHeaderValue(
     void* instance, const char* headerKey) {
     if (!instance) return nullptr;
+    WEBVIEW_RECORD_CALL(CALL_GETCUSTOMHEADERVALUE, instance, headerKey);
     return static_cast<WebViewInstance*>(instance)->getCustomHeaderValue(headerKey);
 }
 
 EXPORT void _CWebViewPlugin_ClearCustomHeader(void* instance) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_CLEARCUSTOMHEADER, instance);
     static_cast<WebViewInstance*>(instance)->clearCustomHeader();
 }
 
 EXPORT void _CWebViewPlugin_ClearCookie(const char* url, const char* name) {
+    WEBVIEW_RECORD_CALL(CALL_CLEARCOOKIE, nullptr, url, name);
     std::lock_guard<std::mutex> lock(s_instancesMutex);
     for (auto* inst : s_instances) {
         if (inst && inst->hasCookieManager()) {
@@ -1868,6 +3016,7 @@ EXPORT void _CWebViewPlugin_ClearCookie(const char* url, const char* name) {
 }
 
 EXPORT void _CWebViewPlugin_ClearCookies() {
+    WEBVIEW_RECORD_CALL(CALL_CLEARCOOKIES, nullptr);
     std::lock_guard<std::mutex> lock(s_instancesMutex);
     for (auto* inst : s_instances) {
         if (inst && inst->hasCookieManager()) {
@@ -1877,53 +3026,355 @@ EXPORT void _CWebViewPlugin_ClearCookies() {
     }
 }
 
+// WebView2 keeps cookies in the profile under %TEMP%; with a jar path set
+// they are also written there (see _CWebViewPlugin_SetCookieJarPath)
 EXPORT void _CWebViewPlugin_SaveCookies() {
-    // WebView2 auto-persists cookies, nothing to do
+    WEBVIEW_RECORD_CALL(CALL_SAVECOOKIES, nullptr);
+    std::string path;
+    bool includeSession;
+    {
+        std::lock_guard<std::mutex> lock(s_cookieJarMutex);
+        path = s_cookieJarPath;
+        includeSession = s_cookieJarSession;
+    }
+    if (path.empty()) return;
+    // Only the post needs the instance; the wait must not hold the list
+    // lock, or Init/Destroy and the other cookie calls stall behind it
+    std::shared_ptr<CookieJarSave> save;
+    {
+        std::lock_guard<std::mutex> lock(s_instancesMutex);
+        for (auto* inst : s_instances) {
+            if (inst && inst->hasCookieManager()) {
+                save = inst->postCookieJarSave(path.c_str(), includeSession);
+                break;
+            }
+        }
+    }
+    WaitCookieJarSave(save);
 }
 
 EXPORT void _CWebViewPlugin_GetCookies(void* instance, const char* url) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_GETCOOKIES, instance, url);
     static_cast<WebViewInstance*>(instance)->getCookies(url);
 }
 
 EXPORT const char* _CWebViewPlugin_GetMessage(void* instance) {
     if (!instance) return nullptr;
+    WEBVIEW_RECORD_CALL(CALL_GETMESSAGE, instance);
     return static_cast<WebViewInstance*>(instance)->getMessage();
 }
 
+// Drains queued events into buffer as packed WebViewEventHeader records
+// (see MessageQueue.h), avoiding a string per event. Returns the bytes
+// written, 0 when the queue is empty, or minus the capacity needed when
+// the next event does not fit.
+EXPORT int _CWebViewPlugin_GetEvents(void* instance, uint8_t* buffer, int capacity) {
+    if (!instance || !buffer) return 0;
+    WEBVIEW_RECORD_CALL(CALL_GETEVENTS, instance, capacity);
+    return static_cast<WebViewInstance*>(instance)->getEvents(buffer, capacity);
+}
+
 EXPORT void _CWebViewPlugin_SetBasicAuthInfo(void* instance, const char* userName, const char* password) {
     if (!instance) return;
+    // Credentials are never written to the log
+    WEBVIEW_RECORD_CALL(CALL_SETBASICAUTHINFO, instance);
     static_cast<WebViewInstance*>(instance)->setBasicAuthInfo(userName, password);
 }
 
 EXPORT void _CWebViewPlugin_ClearCache(void* instance, bool includeDiskFiles) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_CLEARCACHE, instance, includeDiskFiles);
     static_cast<WebViewInstance*>(instance)->clearCache(includeDiskFiles);
 }
 
 EXPORT void _CWebViewPlugin_SetInteractionEnabled(void* instance, bool enabled) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SETINTERACTIONENABLED, instance, enabled);
     static_cast<WebViewInstance*>(instance)->setInteractionEnabled(enabled);
 }
 
 EXPORT void _CWebViewPlugin_SetScrollbarsVisibility(void* instance, bool visibility) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SETSCROLLBARSVISIBILITY, instance, visibility);
     static_cast<WebViewInstance*>(instance)->setScrollbarsVisibility(visibility);
 }
 
 EXPORT void _CWebViewPlugin_SetAlertDialogEnabled(void* instance, bool enabled) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SETALERTDIALOGENABLED, instance, enabled);
     static_cast<WebViewInstance*>(instance)->setAlertDialogEnabled(enabled);
 }
 
 EXPORT void _CWebViewPlugin_Pause(void* instance) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_PAUSE, instance);
     static_cast<WebViewInstance*>(instance)->pause();
 }
 
 EXPORT void _CWebViewPlugin_Resume(void* instance) {
     if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_RESUME, instance);
     static_cast<WebViewInstance*>(instance)->resume();
 }
 
+// In-memory cache for responses to intercepted GET/HEAD requests, off until
+// it has a byte budget and at least one rule
+EXPORT void _CWebViewPlugin_ConfigureResponseCache(void* instance, long long maxBytes) {
+    if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_CONFIGURERESPONSECACHE, instance, maxBytes);
+    static_cast<WebViewInstance*>(instance)->configureResponseCache(maxBytes > 0 ? static_cast<size_t>(maxBytes) : 0);
+}
+
+// Caches responses for URLs matching pattern (regex) for ttlSeconds
+EXPORT bool _CWebViewPlugin_AddResponseCacheRule(void* instance, const char* pattern, int ttlSeconds) {
+    if (!instance) return false;
+    WEBVIEW_RECORD_CALL(CALL_ADDRESPONSECACHERULE, instance, pattern, ttlSeconds);
+    return static_cast<WebViewInstance*>(instance)->addResponseCacheRule(pattern, ttlSeconds);
+}
+
+EXPORT void _CWebViewPlugin_ClearResponseCache(void* instance, bool clearRules) {
+    if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_CLEARRESPONSECACHE, instance, clearRules);
+    static_cast<WebViewInstance*>(instance)->clearResponseCache(clearRules);
+}
+
+// Replaces the request blocking rules (see RequestBlocker.h for the
+// syntax); returns the number of rules compiled
+EXPORT int _CWebViewPlugin_LoadBlockRules(void* instance, const char* rules) {
+    if (!instance) return 0;
+    WEBVIEW_RECORD_CALL(CALL_LOADBLOCKRULES, instance, rules);
+    return static_cast<int>(static_cast<WebViewInstance*>(instance)->loadBlockRules(rules));
+}
+
+// As LoadBlockRules, from a UTF-8 text file; -1 if it cannot be read
+EXPORT int _CWebViewPlugin_LoadBlockRulesFile(void* instance, const char* path) {
+    if (!instance) return -1;
+    WEBVIEW_RECORD_CALL(CALL_LOADBLOCKRULESFILE, instance, path);
+    return static_cast<int>(static_cast<WebViewInstance*>(instance)->loadBlockRulesFile(path));
+}
+
+// Per-rule counts of blocked requests as JSON
+EXPORT const char* _CWebViewPlugin_GetBlockRuleHits(void* instance) {
+    if (!instance) return nullptr;
+    WEBVIEW_RECORD_CALL(CALL_GETBLOCKRULEHITS, instance);
+    std::string json = static_cast<WebViewInstance*>(instance)->getBlockRuleHits();
+    char* r = (char*)CoTaskMemAlloc(json.size() + 1);
+    if (!r) return nullptr;
+    memcpy(r, json.c_str(), json.size() + 1);
+    return r;
+}
+
+// Subscribes to Unity.call(channel, payload) messages on channel, keeping at
+// most maxQueued of them (0: no limit). Returns the channel id carried as
+// the code of its FROM_JS events, or 0 for an invalid name. Messages on
+// channels nobody subscribed to are dropped unconverted.
+EXPORT int _CWebViewPlugin_SubscribeChannel(void* instance, const char* channel, int maxQueued) {
+    if (!instance) return 0;
+    WEBVIEW_RECORD_CALL(CALL_SUBSCRIBECHANNEL, instance, channel, maxQueued);
+    return static_cast<WebViewInstance*>(instance)->subscribeChannel(channel, maxQueued);
+}
+
+EXPORT void _CWebViewPlugin_UnsubscribeChannel(void* instance, const char* channel) {
+    if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_UNSUBSCRIBECHANNEL, instance, channel);
+    static_cast<WebViewInstance*>(instance)->unsubscribeChannel(channel);
+}
+
+// Per-channel message counts as JSON
+EXPORT const char* _CWebViewPlugin_GetChannelStats(void* instance) {
+    if (!instance) return nullptr;
+    WEBVIEW_RECORD_CALL(CALL_GETCHANNELSTATS, instance);
+    std::string json = static_cast<WebViewInstance*>(instance)->getChannelStats();
+    char* r = (char*)CoTaskMemAlloc(json.size() + 1);
+    if (!r) return nullptr;
+    memcpy(r, json.c_str(), json.size() + 1);
+    return r;
+}
+
+// Asks for every cookie set for url (all cookies when url is null or empty)
+// with their attributes. The answer is a COOKIE_SNAPSHOT event whose code is
+// the returned request id and whose payload is JSON (see CookieSnapshot.h).
+EXPORT int _CWebViewPlugin_GetCookieSnapshot(void* instance, const char* url) {
+    if (!instance) return 0;
+    WEBVIEW_RECORD_CALL(CALL_GETCOOKIESNAPSHOT, instance, url);
+    return static_cast<WebViewInstance*>(instance)->getCookieSnapshot(url);
+}
+
+// Adds or replaces a batch of cookies given as snapshot JSON, applied in one
+// host thread command. Returns the number of cookies, or -1 if json does
+// not parse.
+EXPORT int _CWebViewPlugin_SetCookies(void* instance, const char* json) {
+    if (!instance) return -1;
+    WEBVIEW_RECORD_CALL(CALL_SETCOOKIES, instance, json);
+    return static_cast<WebViewInstance*>(instance)->setCookies(json);
+}
+
+// Where SaveCookies writes the cookie jar, and which the first instance
+// created afterwards loads before its first navigation. Session cookies
+// are kept only with includeSession. Null or empty turns this off.
+EXPORT void _CWebViewPlugin_SetCookieJarPath(const char* path, bool includeSession) {
+    WEBVIEW_RECORD_CALL(CALL_SETCOOKIEJARPATH, nullptr, path, includeSession);
+    std::lock_guard<std::mutex> lock(s_cookieJarMutex);
+    s_cookieJarPath = path ? path : "";
+    s_cookieJarSession = includeSession;
+    s_cookieJarPending = !s_cookieJarPath.empty();
+}
+
+// Writes every cookie of the profile to path (see CookieJar.h), waiting for
+// the host thread. Returns the number saved, or -1.
+EXPORT int _CWebViewPlugin_SaveCookieJar(void* instance, const char* path, bool includeSession) {
+    if (!instance) return -1;
+    WEBVIEW_RECORD_CALL(CALL_SAVECOOKIEJAR, instance, path, includeSession);
+    return static_cast<WebViewInstance*>(instance)->saveCookieJar(path, includeSession);
+}
+
+// Adds the unexpired cookies saved in path in one batch, before the first
+// navigation if the instance is still starting. Returns the number of
+// cookies, or -1 if path is not a readable jar.
+EXPORT int _CWebViewPlugin_LoadCookieJar(void* instance, const char* path) {
+    if (!instance) return -1;
+    WEBVIEW_RECORD_CALL(CALL_LOADCOOKIEJAR, instance, path);
+    return static_cast<WebViewInstance*>(instance)->loadCookieJar(path);
+}
+
+// Records the last capacity resource requests with their timings (see
+// ResourceTimeline.h); 0 turns this off. Either way recorded ones are dropped.
+EXPORT void _CWebViewPlugin_SetResourceTimingCapacity(void* instance, int capacity) {
+    if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_SETRESOURCETIMINGCAPACITY, instance, capacity);
+    static_cast<WebViewInstance*>(instance)->setResourceTimingCapacity(capacity > 0 ? capacity : 0);
+}
+
+// The recorded requests as HAR-shaped JSON
+EXPORT const char* _CWebViewPlugin_GetResourceTimings(void* instance) {
+    if (!instance) return nullptr;
+    WEBVIEW_RECORD_CALL(CALL_GETRESOURCETIMINGS, instance);
+    std::string json = static_cast<WebViewInstance*>(instance)->getResourceTimings();
+    char* r = (char*)CoTaskMemAlloc(json.size() + 1);
+    if (!r) return nullptr;
+    memcpy(r, json.c_str(), json.size() + 1);
+    return r;
+}
+
+// The recorded requests as binary records; returns the bytes written, or
+// minus the size needed when capacity is too small
+EXPORT int _CWebViewPlugin_GetResourceTimingSummary(void* instance, uint8_t* buffer, int capacity) {
+    if (!instance || !buffer) return 0;
+    WEBVIEW_RECORD_CALL(CALL_GETRESOURCETIMINGSUMMARY, instance, capacity);
+    return static_cast<WebViewInstance*>(instance)->getResourceTimingSummary(buffer, capacity);
+}
+
+// Count, bytes and p50/p95/max time to response per host as JSON
+EXPORT const char* _CWebViewPlugin_GetResourceHostStats(void* instance) {
+    if (!instance) return nullptr;
+    WEBVIEW_RECORD_CALL(CALL_GETRESOURCEHOSTSTATS, instance);
+    std::string json = static_cast<WebViewInstance*>(instance)->getResourceHostStats();
+    char* r = (char*)CoTaskMemAlloc(json.size() + 1);
+    if (!r) return nullptr;
+    memcpy(r, json.c_str(), json.size() + 1);
+    return r;
+}
+
+// How long an instance stays hidden before it is parked, asked to keep its
+// memory low and suspended (negative: only along with a later step), and a
+// budget for the WebView2 processes' memory, 0 for none (see LifecycleManager.h)
+EXPORT void _CWebViewPlugin_SetLifecyclePolicy(
+    int parkAfterMs, int lowMemoryAfterMs, int suspendAfterMs, long long memoryBudget) {
+    WEBVIEW_RECORD_CALL(CALL_SETLIFECYCLEPOLICY, nullptr, parkAfterMs, lowMemoryAfterMs, suspendAfterMs,
+                        memoryBudget);
+    LifecyclePolicy policy;
+    policy.parkAfterMicros = parkAfterMs < 0 ? -1 : static_cast<int64_t>(parkAfterMs) * 1000;
+    policy.lowMemoryAfterMicros = lowMemoryAfterMs < 0 ? -1 : static_cast<int64_t>(lowMemoryAfterMs) * 1000;
+    policy.suspendAfterMicros = suspendAfterMs < 0 ? -1 : static_cast<int64_t>(suspendAfterMs) * 1000;
+    policy.memoryBudget = memoryBudget > 0 ? static_cast<uint64_t>(memoryBudget) : 0;
+    LifecycleManager::instance().setPolicy(policy);
+}
+
+EXPORT int _CWebViewPlugin_GetLifecycleState(void* instance) {
+    if (!instance) return LIFECYCLE_VISIBLE;
+    WEBVIEW_RECORD_CALL(CALL_GETLIFECYCLESTATE, instance);
+    return static_cast<WebViewInstance*>(instance)->lifecycleState();
+}
+
+// Transition counts, instances per state and memory reclaimed as JSON
+EXPORT const char* _CWebViewPlugin_GetLifecycleStats() {
+    WEBVIEW_RECORD_CALL(CALL_GETLIFECYCLESTATS, nullptr);
+    std::string json = LifecycleManager::instance().statsJson();
+    char* r = (char*)CoTaskMemAlloc(json.size() + 1);
+    if (!r) return nullptr;
+    memcpy(r, json.c_str(), json.size() + 1);
+    return r;
+}
+
+// Starts loading url in a hidden sibling of instance, replacing any earlier
+// prerender; false for separated-window instances
+EXPORT bool _CWebViewPlugin_Prerender(void* instance, const char* url) {
+    if (!instance) return false;
+    WEBVIEW_RECORD_CALL(CALL_PRERENDER, instance, url);
+    return static_cast<WebViewInstance*>(instance)->prerender(url);
+}
+
+// Returns the prerendered sibling as a new handle when it was loaded from url
+// (null: whatever was prerendered), else null. The caller switches to the
+// new handle and destroys the old one; the sibling's queued events, its
+// Started and Loaded included, come with it.
+EXPORT void* _CWebViewPlugin_CommitPrerender(void* instance, const char* url) {
+    if (!instance) return nullptr;
+    auto* inst = static_cast<WebViewInstance*>(instance);
+    WebViewInstance* sibling = inst->commitPrerender(url);
+    // Recorded after the fact so a replay can map the new handle
+    WEBVIEW_RECORD_CALL(CALL_COMMITPRERENDER, instance, url,
+                        sibling ? RecordedInstanceNumber(sibling) : 0LL);
+    if (!sibling) return nullptr;
+    {
+        std::lock_guard<std::mutex> lock(s_instancesMutex);
+        s_instances.push_back(sibling);
+    }
+    LifecycleManager::instance().add(sibling);
+    if (!inst->visible()) sibling->setVisibility(false);
+    return sibling;
+}
+
+EXPORT void _CWebViewPlugin_CancelPrerender(void* instance) {
+    if (!instance) return;
+    WEBVIEW_RECORD_CALL(CALL_CANCELPRERENDER, instance);
+    static_cast<WebViewInstance*>(instance)->cancelPrerender();
+}
+
+// Prerender hits, misses and the loading time they hid or wasted as JSON
+EXPORT const char* _CWebViewPlugin_GetPrerenderStats() {
+    WEBVIEW_RECORD_CALL(CALL_GETPRERENDERSTATS, nullptr);
+    std::string json = PrerenderLedger::instance().statsJson();
+    char* r = (char*)CoTaskMemAlloc(json.size() + 1);
+    if (!r) return nullptr;
+    memcpy(r, json.c_str(), json.size() + 1);
+    return r;
+}
+
+// Registers a script every instance runs at document creation, from the next
+// navigation on; the same source again returns its existing id. Returns 0
+// for an empty script.
+EXPORT int _CWebViewPlugin_AddUserScript(const char* script) {
+    WEBVIEW_RECORD_CALL(CALL_ADDUSERSCRIPT, nullptr, script);
+    bool created = false;
+    int id = UserScriptRegistry::instance().add(script, &created);
+    if (!created) return id;
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    for (auto* inst : s_instances) inst->syncUserScripts();
+    return id;
+}
+
+// Drops one registration of id; the script stops running once the last one
+// is gone. False for an unknown id.
+EXPORT bool _CWebViewPlugin_RemoveUserScript(int id) {
+    WEBVIEW_RECORD_CALL(CALL_REMOVEUSERSCRIPT, nullptr, id);
+    bool dropped = false;
+    if (!UserScriptRegistry::instance().remove(id, &dropped)) return false;
+    if (!dropped) return true;
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    for (auto* inst : s_instances) inst->syncUserScripts();
+    return true;
+}
+
 } // extern "C"
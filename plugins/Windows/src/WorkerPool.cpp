@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "WorkerPool.h"
+#include "Trace.h"
+
+#include <chrono>
+
+struct WorkerPool::Job {
+    const std::function<void(int, int)>* body;
+    std::atomic<int> remaining{0};
+    std::mutex mutex;
+    std::condition_variable done;
+};
+
+WorkerPool& WorkerPool::instance() {
+    // Never destroyed: joining threads from a static destructor would run
+    // under the loader lock when the DLL is unloaded.
+    static WorkerPool* pool = new WorkerPool();
+    return *pool;
+}
+
+static int DefaultThreadCount() {
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    int count = cores - 2;
+    if (count < 0) count = 0;
+    if (count > 8) count = 8;
+    return count;
+}
+
+void WorkerPool::setThreadCount(int count) {
+    std::unique_lock<std::shared_mutex> lock(m_configMutex);
+    stop();
+    start(count > 0 ? count : DefaultThreadCount());
+}
+
+int WorkerPool::threadCount() {
+    std::shared_lock<std::shared_mutex> lock(m_configMutex);
+    return static_cast<int>(m_threads.size());
+}
+
+void WorkerPool::start(int count) {
+    m_stopping = false;
+    m_queues.clear();
+    for (int i = 0; i < count; i++) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < count; i++) {
+        m_threads.emplace_back(&WorkerPool::workerProc, this, i);
+    }
+    m_started = true;
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& t : m_threads) {
+        if (t.joinable()) t.join();
+    }
+    m_threads.clear();
+    m_queues.clear();
+    m_pending.store(0);
+    m_started = false;
+}
+
+void WorkerPool::parallelFor(int count, int grain, const std::function<void(int, int)>& body) {
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+    m_jobs.fetch_add(1, std::memory_order_relaxed);
+
+    if (!m_started.load()) {
+        std::unique_lock<std::shared_mutex> lock(m_configMutex);
+        if (!m_started.load()) start(DefaultThreadCount());
+    }
+    std::shared_lock<std::shared_mutex> lock(m_configMutex);
+
+    Job job;
+    job.body = &body;
+    int chunks = (count + grain - 1) / grain;
+    int queues = static_cast<int>(m_queues.size());
+    if (queues == 0 || chunks == 1) {
+        job.remaining.store(chunks);
+        for (int begin = 0; begin < count; begin += grain) {
+            runTask(Task{&job, begin, begin + grain < count ? begin + grain : count}, false);
+        }
+        return;
+    }
+
+    job.remaining.store(chunks);
+    int first;
+    {
+        std::lock_guard<std::mutex> wakeLock(m_wakeMutex);
+        first = m_nextQueue;
+        m_nextQueue = (m_nextQueue + 1) % queues;
+    }
+    int chunk = 0;
+    for (int begin = 0; begin < count; begin += grain, chunk++) {
+        Queue& q = *m_queues[(first + chunk) % queues];
+        std::lock_guard<std::mutex> qLock(q.mutex);
+        q.tasks.push_back(Task{&job, begin, begin + grain < count ? begin + grain : count});
+    }
+    {
+        std::lock_guard<std::mutex> wakeLock(m_wakeMutex);
+        m_pending.fetch_add(chunks);
+    }
+    m_wake.notify_all();
+
+    // Help out instead of blocking, then wait for chunks taken by workers
+    Task task;
+    while (job.remaining.load() > 0 && trySteal(-1, task)) {
+        runTask(task, false);
+    }
+    std::unique_lock<std::mutex> doneLock(job.mutex);
+    job.done.wait(doneLock, [&]() { return job.remaining.load() == 0; });
+}
+
+bool WorkerPool::tryPop(int index, Task& task) {
+    Queue& q = *m_queues[index];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) return false;
+    task = q.tasks.back();
+    q.tasks.pop_back();
+    m_pending.fetch_sub(1);
+    return true;
+}
+
+bool WorkerPool::trySteal(int index, Task& task) {
+    int queues = static_cast<int>(m_queues.size());
+    for (int i = 1; i <= queues; i++) {
+        int victim = (index + i) % queues;
+        if (victim == index) continue;
+        Queue& q = *m_queues[victim];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) continue;
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        m_pending.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void WorkerPool::runTask(const Task& task, bool stolen) {
+    WEBVIEW_TRACE_SCOPE_ARG("WorkerTask", task.end - task.begin);
+    auto t0 = std::chrono::steady_clock::now();
+    (*task.job->body)(task.begin, task.end);
+    uint64_t us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0).count());
+
+    m_tasks.fetch_add(1, std::memory_order_relaxed);
+    if (stolen) m_stolenTasks.fetch_add(1, std::memory_order_relaxed);
+    m_taskMicros.fetch_add(us, std::memory_order_relaxed);
+    uint64_t prevMax = m_maxTaskMicros.load(std::memory_order_relaxed);
+    while (us > prevMax && !m_maxTaskMicros.compare_exchange_weak(prevMax, us, std::memory_order_relaxed)) {
+    }
+
+    Job* job = task.job;
+    std::lock_guard<std::mutex> lock(job->mutex);
+    if (job->remaining.fetch_sub(1) == 1) {
+        job->done.notify_all();
+    }
+}
+
+void WorkerPool::workerProc(int index) {
+    TraceSetThreadName("WebView worker");
+    for (;;) {
+        Task task;
+        if (tryPop(index, task)) {
+            runTask(task, false);
+            continue;
+        }
+        if (trySteal(index, task)) {
+            runTask(task, true);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this]() { return m_stopping || m_pending.load() > 0; });
+        if (m_stopping) return;
+    }
+}
+
+WorkerPoolStats WorkerPool::stats() {
+    WorkerPoolStats s;
+    s.threads = threadCount();
+    s.jobs = m_jobs.load(std::memory_order_relaxed);
+    s.tasks = m_tasks.load(std::memory_order_relaxed);
+    s.stolenTasks = m_stolenTasks.load(std::memory_order_relaxed);
+    s.taskMicros = m_taskMicros.load(std::memory_order_relaxed);
+    s.maxTaskMicros = m_maxTaskMicros.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+struct WorkerPoolStats {
+    int threads;
+    uint64_t jobs;          // parallelFor calls
+    uint64_t tasks;         // chunks executed
+    uint64_t stolenTasks;   // chunks run by a thread other than the one queued to
+    uint64_t taskMicros;    // total time spent inside chunks
+    uint64_t maxTaskMicros;
+};
+
+// Process-wide pool shared by all instances for post-capture frame work.
+// Each worker owns a deque of chunks; idle workers, and the thread calling
+// parallelFor, steal from the others. The default size leaves two cores for
+// Unity's main and render threads.
+class WorkerPool {
+public:
+    static WorkerPool& instance();
+
+    // 0 selects the default size. Must not be called from inside a task.
+    void setThreadCount(int count);
+    int threadCount();
+
+    // Runs body(begin, end) over [0, count) in chunks of at most grain items
+    // and returns once all have finished. The calling thread works too, so a
+    // pool without workers degrades to a plain loop.
+    void parallelFor(int count, int grain, const std::function<void(int, int)>& body);
+
+    WorkerPoolStats stats();
+
+private:
+    struct Job;
+    struct Task {
+        Job* job;
+        int begin;
+        int end;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    WorkerPool() = default;
+    void start(int count);
+    void stop();
+    void workerProc(int index);
+    bool tryPop(int index, Task& task);
+    bool trySteal(int index, Task& task);
+    void runTask(const Task& task, bool stolen);
+
+    std::shared_mutex m_configMutex;
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<int> m_pending{0};
+    std::atomic<bool> m_started{false};
+    bool m_stopping = false;
+    int m_nextQueue = 0;
+
+    std::atomic<uint64_t> m_jobs{0};
+    std::atomic<uint64_t> m_tasks{0};
+    std::atomic<uint64_t> m_stolenTasks{0};
+    std::atomic<uint64_t> m_taskMicros{0};
+    std::atomic<uint64_t> m_maxTaskMicros{0};
+};
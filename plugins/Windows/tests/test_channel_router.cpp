@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// ChannelRouter: channel names, per-channel bounds, round-robin draining
+// and subscriptions carried over to a replacement instance.
+
+#include "ChannelRouter.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+static WebViewEvent Message(const std::string& payload) {
+    return WebViewEvent{WEBVIEW_EVENT_FROM_JS, 0, 0, payload};
+}
+
+static void TestSplit() {
+    std::string_view channel, payload;
+    CHECK(SplitChannelMessage(std::string_view("\x1f" "chat\x1f" "hi\x1f" "there"), channel, payload));
+    CHECK(channel == "chat" && payload == "hi\x1f" "there");
+    CHECK(SplitChannelMessage(std::string_view("\x1f\x1f"), channel, payload));
+    CHECK(channel.empty() && payload.empty());
+    CHECK(!SplitChannelMessage(std::string_view("plain"), channel, payload));
+    CHECK(!SplitChannelMessage(std::string_view("\x1f" "unterminated"), channel, payload));
+    CHECK(!SplitChannelMessage(std::string_view(), channel, payload));
+
+    std::wstring_view wchannel, wpayload;
+    CHECK(SplitChannelMessage(std::wstring_view(L"\x1f" L"score\x1f" L"\x00e9"), wchannel, wpayload));
+    CHECK(wchannel == L"score" && wpayload == L"\x00e9");
+}
+
+static void TestSubscribe() {
+    ChannelRouter router;
+    CHECK(router.subscribe(nullptr, 0) == 0);
+    CHECK(router.subscribe("", 0) == 0);
+    CHECK(router.subscribe("tab\there", 0) == 0);
+    CHECK(router.subscribe(std::string(65, 'a').c_str(), 0) == 0);
+    int a = router.subscribe(std::string(64, 'a').c_str(), 0);
+    int b = router.subscribe("b", 0);
+    CHECK(a == 1 && b == 2);
+    CHECK(router.subscribe("b", 5) == b);
+
+    // Ids are never reused
+    CHECK(router.unsubscribe("b"));
+    CHECK(!router.unsubscribe("b"));
+    CHECK(!router.unsubscribe(nullptr));
+    CHECK(router.subscribe("b", 0) == 3);
+
+    // Unknown channels count as unrouted drops; wide names match too
+    CHECK(router.route(std::string_view("c")) == 0);
+    CHECK(router.route(std::wstring_view(L"b")) == 3);
+    CHECK(router.route(std::wstring_view(L"\x0162")) == 0);
+    CHECK(router.dropped() == 2);
+    CHECK(router.statsJson().compare(0, 14, "{\"unrouted\":2,") == 0);
+}
+
+static void TestRoundRobin() {
+    ChannelRouter router;
+    int a = router.subscribe("a", 0);
+    int b = router.subscribe("b", 0);
+    int c = router.subscribe("c", 0);
+    for (int i = 0; i < 4; i++) router.push(a, Message("a" + std::to_string(i)));
+    router.push(b, Message("b0"));
+    CHECK(router.push(c, Message("c0")) == 6);
+    router.push(c, Message("c1"));
+
+    // One per channel in turn, skipping the drained ones
+    const char* expected[] = {"a0", "b0", "c0", "a1", "c1", "a2", "a3"};
+    WebViewEvent event;
+    size_t remaining = 0;
+    for (size_t i = 0; i < 7; i++) {
+        CHECK(router.pop(event, remaining) && event.payload == expected[i]);
+        CHECK(event.kind == WEBVIEW_EVENT_FROM_JS && remaining == 6 - i);
+    }
+    CHECK(!router.pop(event, remaining));
+
+    // The turn passes on from where it stopped, and stays on the same
+    // channel when one before it is unsubscribed
+    router.push(a, Message("a4"));
+    router.push(b, Message("b1"));
+    router.push(c, Message("c2"));
+    CHECK(router.pop(event, remaining) && event.payload == "b1");
+    router.push(b, Message("b2"));
+    CHECK(router.unsubscribe("a"));
+    CHECK(router.dropped() == 1);
+    CHECK(router.pop(event, remaining) && event.payload == "c2");
+    CHECK(router.pop(event, remaining) && event.payload == "b2" && remaining == 0);
+}
+
+static void TestBounds() {
+    ChannelRouter router;
+    int chatty = router.subscribe("chatty", 3);
+    int quiet = router.subscribe("quiet", 0);
+    for (int i = 0; i < 10; i++) router.push(chatty, Message(std::to_string(i)));
+    router.push(quiet, Message("q"));
+    CHECK(router.size() == 4);
+    CHECK(router.dropped() == 7);
+
+    // The oldest are dropped; the quiet channel is not held back
+    WebViewEvent event;
+    size_t remaining = 0;
+    CHECK(router.pop(event, remaining) && event.code == chatty && event.payload == "7");
+    CHECK(router.pop(event, remaining) && event.code == quiet && event.payload == "q");
+    CHECK(router.pop(event, remaining) && event.payload == "8");
+
+    // Unsubscribing drops what is queued; later pushes to its id too
+    CHECK(router.unsubscribe("chatty"));
+    CHECK(router.size() == 0 && router.dropped() == 8);
+    CHECK(router.push(chatty, Message("late")) == 0);
+    CHECK(router.dropped() == 9);
+
+    std::string stats = router.statsJson();
+    CHECK(stats.find("\"name\":\"quiet\",\"id\":2,\"received\":1,\"dropped\":0,\"queued\":0") != std::string::npos);
+
+    router.push(quiet, Message("r"));
+    router.clear();
+    CHECK(router.size() == 0 && router.dropped() == 10);
+}
+
+static std::vector<std::string> Payloads(const uint8_t* records, size_t size) {
+    std::vector<std::string> payloads;
+    size_t offset = 0;
+    while (offset < size) {
+        WebViewEventHeader header;
+        memcpy(&header, records + offset, sizeof(header));
+        payloads.emplace_back(reinterpret_cast<const char*>(records + offset + sizeof(header)),
+                              header.payloadSize);
+        offset += WebViewEventRecordSize(header.payloadSize);
+    }
+    return payloads;
+}
+
+static void TestPopRecords() {
+    ChannelRouter router;
+    int a = router.subscribe("a", 0);
+    int b = router.subscribe("b", 0);
+    router.push(a, Message("a0"));
+    router.push(a, Message("a1"));
+    router.push(b, Message("b0-long-payload"));
+    router.push(b, Message("b1"));
+
+    // Room for one short record: a0 goes, and b is next in turn
+    uint8_t records[256];
+    size_t remaining = 0, needed = 0;
+    size_t written = router.popRecords(records, WebViewEventRecordSize(2), 7, remaining, needed);
+    CHECK(written == WebViewEventRecordSize(2) && remaining == 3 && needed == 0);
+    CHECK(Payloads(records, written) == std::vector<std::string>{"a0"});
+    WebViewEventHeader header;
+    memcpy(&header, records, sizeof(header));
+    CHECK(header.instanceId == 7 && header.code == a && header.kind == WEBVIEW_EVENT_FROM_JS);
+
+    // b's record does not fit at all: report its size, keep its turn
+    written = router.popRecords(records, WebViewEventRecordSize(2), 7, remaining, needed);
+    CHECK(written == 0 && remaining == 3 && needed == WebViewEventRecordSize(15));
+    written = router.popRecords(records, sizeof(records), 7, remaining, needed);
+    CHECK(Payloads(records, written) == (std::vector<std::string>{"b0-long-payload", "a1", "b1"}));
+    CHECK(remaining == 0 && needed == 0);
+}
+
+static void TestCopySubscriptions() {
+    ChannelRouter old;
+    int chat = old.subscribe("chat", 2);
+    int score = old.subscribe("score", 0);
+    old.subscribe("gone", 0);
+    old.unsubscribe("gone");
+
+    // The replacement already queued on "chat" and on a channel old no
+    // longer has, and holds an id old never handed out
+    ChannelRouter router;
+    int routerChat = router.subscribe("chat", 0);
+    router.subscribe("gone", 0);
+    for (int i = 0; i < 3; i++) router.push(routerChat, Message("c" + std::to_string(i)));
+    router.push(router.route(std::string_view("gone")), Message("g"));
+
+    router.copySubscriptionsFrom(old);
+    CHECK(router.route(std::string_view("chat")) == chat);
+    CHECK(router.route(std::wstring_view(L"score")) == score);
+    CHECK(router.route(std::string_view("gone")) == 0);
+    // "chat" is bounded to 2 now, keeping the newest, under old's id
+    CHECK(router.size() == 2);
+    WebViewEvent event;
+    size_t remaining = 0;
+    CHECK(router.pop(event, remaining) && event.code == chat && event.payload == "c1");
+    CHECK(router.pop(event, remaining) && event.code == chat && event.payload == "c2" && remaining == 0);
+    CHECK(!router.pop(event, remaining));
+    // one trimmed from "chat", one on "gone", one unrouted "gone" lookup
+    CHECK(router.dropped() == 3);
+
+    // New subscriptions do not reuse ids old handed out
+    int next = router.subscribe("next", 0);
+    CHECK(next != chat && next != score && next > score);
+    CHECK(router.subscribe("chat", 0) == chat);
+}
+
+int main() {
+    TestSplit();
+    TestSubscribe();
+    TestRoundRobin();
+    TestBounds();
+    TestPopRecords();
+    TestCopySubscriptions();
+    return TestExitCode();
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Cookie jar file format: round trips and rejection of damaged jars.
+
+#include "CookieJar.h"
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static const size_t kHeaderSize = 20;
+
+static BrowserCookie MakeCookie(const char* name, const std::string& value, double expires, int sameSite) {
+    BrowserCookie c;
+    c.name = name;
+    c.value = value;
+    c.domain = ".example.com";
+    c.path = "/";
+    c.expires = expires;
+    c.sameSite = sameSite;
+    return c;
+}
+
+static std::vector<BrowserCookie> SampleCookies() {
+    std::vector<BrowserCookie> cookies;
+    cookies.push_back(MakeCookie("sid", "31d4d96e407aad42", 1893456000.125, COOKIE_SAME_SITE_LAX));
+    cookies.back().secure = true;
+    cookies.back().httpOnly = true;
+    cookies.push_back(MakeCookie("session", "", -1, COOKIE_SAME_SITE_NONE));
+    cookies.back().secure = true;
+    // Long enough for a two-byte length, with UTF-8 and control bytes
+    cookies.push_back(MakeCookie("prefs", std::string(300, 'v') + "caf\xC3\xA9\x01", 1700000000, COOKIE_SAME_SITE_STRICT));
+    cookies.back().domain = "www.example.com";
+    cookies.back().path = "/games/lobby";
+    cookies.push_back(MakeCookie("", "", 0, COOKIE_SAME_SITE_LAX));
+    return cookies;
+}
+
+static bool SameCookie(const BrowserCookie& a, const BrowserCookie& b) {
+    return a.name == b.name && a.value == b.value && a.domain == b.domain && a.path == b.path &&
+           a.expires == b.expires && a.secure == b.secure && a.httpOnly == b.httpOnly && a.sameSite == b.sameSite;
+}
+
+static bool Decodes(const std::string& jar, std::vector<BrowserCookie>& cookies) {
+    return DecodeCookieJar(reinterpret_cast<const uint8_t*>(jar.data()), jar.size(), cookies);
+}
+
+static uint32_t Fnv1a(const std::string& s, size_t from) {
+    uint32_t h = 2166136261u;
+    for (size_t i = from; i < s.size(); i++) {
+        h ^= static_cast<uint8_t>(s[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Rewrites the body size and checksum after editing a jar's body, so only
+// the edit itself is left to reject
+static void Reseal(std::string& jar) {
+    uint32_t size = static_cast<uint32_t>(jar.size() - kHeaderSize);
+    uint32_t sum = Fnv1a(jar, kHeaderSize);
+    for (int i = 0; i < 4; i++) {
+        jar[12 + i] = static_cast<char>(size >> (i * 8));
+        jar[16 + i] = static_cast<char>(sum >> (i * 8));
+    }
+}
+
+static void TestRoundTrip() {
+    std::vector<BrowserCookie> cookies = SampleCookies();
+    std::string jar;
+    EncodeCookieJar(cookies, jar);
+    CHECK(jar.compare(0, 4, "WVCJ") == 0);
+    CHECK(static_cast<uint8_t>(jar[4]) == WEBVIEW_COOKIE_JAR_VERSION && jar[5] == 0);
+
+    // Decoding appends to what is already there
+    std::vector<BrowserCookie> decoded(1, MakeCookie("existing", "1", -1, COOKIE_SAME_SITE_LAX));
+    CHECK(Decodes(jar, decoded));
+    CHECK(decoded.size() == cookies.size() + 1);
+    CHECK(decoded[0].name == "existing");
+    bool same = decoded.size() == cookies.size() + 1;
+    for (size_t i = 0; same && i < cookies.size(); i++) same = SameCookie(decoded[i + 1], cookies[i]);
+    CHECK(same);
+
+    // Expiry keeps millisecond precision
+    std::vector<BrowserCookie> fractional(1, MakeCookie("f", "x", 1893456000.0004, COOKIE_SAME_SITE_LAX));
+    jar.clear();
+    EncodeCookieJar(fractional, jar);
+    decoded.clear();
+    CHECK(Decodes(jar, decoded) && decoded.size() == 1 && decoded[0].expires == 1893456000.0);
+
+    // An empty jar is valid
+    jar.clear();
+    EncodeCookieJar(std::vector<BrowserCookie>(), jar);
+    CHECK(jar.size() == kHeaderSize);
+    decoded.clear();
+    CHECK(Decodes(jar, decoded) && decoded.empty());
+
+    // Unknown sameSite values read as Lax
+    jar.clear();
+    EncodeCookieJar(std::vector<BrowserCookie>(1, MakeCookie("s", "x", -1, COOKIE_SAME_SITE_STRICT)), jar);
+    jar[jar.size() - 1] = 7;
+    Reseal(jar);
+    decoded.clear();
+    CHECK(Decodes(jar, decoded) && decoded.size() == 1 && decoded[0].sameSite == COOKIE_SAME_SITE_LAX);
+}
+
+static void TestRejected() {
+    std::vector<BrowserCookie> cookies = SampleCookies();
+    std::string jar;
+    EncodeCookieJar(cookies, jar);
+    const std::vector<BrowserCookie> before(1, MakeCookie("existing", "1", -1, COOKIE_SAME_SITE_LAX));
+
+    // Each rejection leaves the output as it was
+    auto rejected = [&](const std::string& data) {
+        std::vector<BrowserCookie> out = before;
+        return !Decodes(data, out) && out.size() == 1 && SameCookie(out[0], before[0]);
+    };
+
+    std::string bad = jar;
+    bad[0] = 'X';
+    CHECK(rejected(bad));
+
+    bad = jar;
+    bad[4] = static_cast<char>(WEBVIEW_COOKIE_JAR_VERSION + 1);
+    CHECK(rejected(bad));
+    bad = jar;
+    bad[5] = 1;
+    CHECK(rejected(bad));
+
+    // Any flipped body byte fails the checksum
+    bool allCaught = true;
+    for (size_t i = kHeaderSize; i < jar.size(); i += 7) {
+        bad = jar;
+        bad[i] = static_cast<char>(bad[i] ^ 0x10);
+        if (!rejected(bad)) allCaught = false;
+    }
+    CHECK(allCaught);
+    bad = jar;
+    bad[16] = static_cast<char>(bad[16] ^ 1);
+    CHECK(rejected(bad));
+
+    // Every truncation, header or body
+    bool truncationsCaught = true;
+    for (size_t n = 0; n < jar.size(); n++) {
+        if (!rejected(jar.substr(0, n))) truncationsCaught = false;
+    }
+    CHECK(truncationsCaught);
+
+    // Trailing bytes, whether or not the header accounts for them
+    CHECK(rejected(jar + "x"));
+    bad = jar + "x";
+    Reseal(bad);
+    CHECK(rejected(bad));
+
+    // More records promised than the body holds, and absurd counts
+    bad = jar;
+    bad[8] = static_cast<char>(cookies.size() + 1);
+    CHECK(rejected(bad));
+    bad = jar;
+    bad[8] = static_cast<char>(cookies.size() - 1);
+    CHECK(rejected(bad));
+    bad = jar;
+    bad[10] = 0x7F;
+    CHECK(rejected(bad));
+
+    // A string length running past the body
+    bad = jar.substr(0, kHeaderSize);
+    bad[8] = 1;
+    bad[9] = bad[10] = bad[11] = 0;
+    bad += static_cast<char>(0x7F);
+    bad += "short";
+    Reseal(bad);
+    CHECK(rejected(bad));
+
+    std::vector<BrowserCookie> out;
+    CHECK(!DecodeCookieJar(nullptr, 0, out));
+}
+
+static void TestPruneAndFiles() {
+    std::vector<BrowserCookie> cookies = SampleCookies();
+    std::vector<BrowserCookie> kept = cookies;
+    // sid expires in 2030, prefs in 2023, the unnamed one at 0
+    CHECK(PruneCookies(kept, 1800000000, true) == 2);
+    CHECK(kept.size() == 2 && kept[0].name == "sid" && kept[1].name == "session");
+    CHECK(PruneCookies(kept, 1800000000, false) == 1);
+    CHECK(kept.size() == 1 && kept[0].name == "sid");
+
+    const char* path = "test_cookie_jar.bin";
+    CHECK(WriteCookieJarFile(path, cookies));
+    std::vector<BrowserCookie> read;
+    CHECK(ReadCookieJarFile(path, read));
+    bool same = read.size() == cookies.size();
+    for (size_t i = 0; same && i < cookies.size(); i++) same = SameCookie(read[i], cookies[i]);
+    CHECK(same);
+    FILE* tmp = fopen("test_cookie_jar.bin.tmp", "rb");
+    CHECK(tmp == nullptr);
+    if (tmp) fclose(tmp);
+    remove(path);
+    CHECK(!ReadCookieJarFile(path, read));
+    CHECK(!WriteCookieJarFile("", cookies));
+}
+
+int main() {
+    TestRoundTrip();
+    TestRejected();
+    TestPruneAndFiles();
+    return TestExitCode();
+}
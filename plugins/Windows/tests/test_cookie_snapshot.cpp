@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Cookie lists in the JSON shape WebViewObject.CookieList uses: what
+// AppendCookiesJson writes reads back the same, and ParseCookiesJson takes
+// what JsonUtility or a hand-written list may send and rejects the rest.
+
+#include "CookieSnapshot.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static BrowserCookie Cookie(const char* name, const char* value) {
+    BrowserCookie cookie;
+    cookie.name = name;
+    cookie.value = value;
+    return cookie;
+}
+
+static bool Same(const BrowserCookie& a, const BrowserCookie& b) {
+    return a.name == b.name && a.value == b.value && a.domain == b.domain && a.path == b.path &&
+           a.expires == b.expires && a.secure == b.secure && a.httpOnly == b.httpOnly &&
+           a.sameSite == b.sameSite;
+}
+
+static std::vector<BrowserCookie> Parse(const char* json, bool expected = true) {
+    std::vector<BrowserCookie> cookies;
+    CHECK(ParseCookiesJson(json, cookies) == expected);
+    return cookies;
+}
+
+static void TestRoundTrip() {
+    std::vector<BrowserCookie> cookies;
+    BrowserCookie sid = Cookie("sid", "a\"b\\c\n\x01 \xc3\xa9 \xf0\x9f\x8d\xaa");
+    sid.domain = ".example.com";
+    sid.path = "/";
+    sid.expires = 1767225600.25;
+    sid.secure = true;
+    sid.httpOnly = true;
+    sid.sameSite = COOKIE_SAME_SITE_STRICT;
+    cookies.push_back(sid);
+    BrowserCookie session = Cookie("session", "");
+    session.sameSite = COOKIE_SAME_SITE_NONE;
+    cookies.push_back(session);
+
+    std::string json;
+    AppendCookiesJson(json, cookies);
+    CHECK(json.find("\"expires\":1767225600.250,") != std::string::npos);
+    CHECK(json.find("\"expires\":-1,") != std::string::npos);
+    std::vector<BrowserCookie> parsed;
+    CHECK(ParseCookiesJson(json, parsed));
+    CHECK(parsed.size() == 2 && Same(parsed[0], sid) && Same(parsed[1], session));
+
+    std::string empty;
+    AppendCookiesJson(empty, {});
+    CHECK(empty == "{\"cookies\":[]}");
+    CHECK(Parse(empty.c_str()).empty());
+}
+
+static void TestExpires() {
+    std::string json;
+    BrowserCookie cookie = Cookie("a", "b");
+    cookie.expires = 1700000000;
+    AppendCookiesJson(json, {cookie});
+    CHECK(json.find("\"expires\":1700000000,") != std::string::npos);
+    // Out of range or not a number reads as a session cookie
+    for (double expires : {-5.0, 1e16, std::nan("")}) {
+        json.clear();
+        cookie.expires = expires;
+        AppendCookiesJson(json, {cookie});
+        CHECK(json.find("\"expires\":-1,") != std::string::npos);
+    }
+}
+
+static void TestLenient() {
+    // A bare array, whitespace, unknown fields of any shape, null and
+    // numeric flags as JsonUtility may write them
+    std::vector<BrowserCookie> cookies = Parse(
+        " [ {\"name\" : \"a\", \"extra\": {\"x\": [1, {\"y\": null}], \"z\": \"}\"},"
+        "    \"secure\": 1, \"httpOnly\": 0, \"sameSite\": 2, \"expires\": 1.5e3},\n"
+        "   {\"value\": null, \"sameSite\": \"sTrIcT\"}, {} ]\r\n");
+    CHECK(cookies.size() == 3);
+    CHECK(cookies[0].name == "a" && cookies[0].secure && !cookies[0].httpOnly);
+    CHECK(cookies[0].sameSite == COOKIE_SAME_SITE_STRICT && cookies[0].expires == 1500);
+    CHECK(cookies[1].value.empty() && cookies[1].sameSite == COOKIE_SAME_SITE_STRICT);
+    CHECK(Same(cookies[2], BrowserCookie()));
+
+    // Other members around the list; an unknown sameSite name means Lax
+    cookies = Parse("{\"version\":2,\"cookies\":[{\"name\":\"b\",\"sameSite\":\"Other\"}],\"more\":[]}");
+    CHECK(cookies.size() == 1 && cookies[0].name == "b" && cookies[0].sameSite == COOKIE_SAME_SITE_LAX);
+    CHECK(Parse("{}").empty());
+    CHECK(Parse("{\"cookies\":[]}").empty());
+
+    // Escapes, surrogate pairs and lone surrogates
+    cookies = Parse("[{\"name\":\"\\u0041\\/\\t\",\"value\":\"\\ud83c\\udf6a|\\ud83c|\\udf6a\"}]");
+    CHECK(cookies.size() == 1 && cookies[0].name == "A/\t");
+    CHECK(cookies[0].value == "\xf0\x9f\x8d\xaa|\xef\xbf\xbd|\xef\xbf\xbd");
+}
+
+static void TestMalformed() {
+    const char* bad[] = {
+        "",
+        "   ",
+        "null",
+        "{\"cookies\":{}}",
+        "{\"cookies\":[}",
+        "{\"cookies\":[{\"name\":\"a\"}]",
+        "[{\"name\":\"a\"}] trailing",
+        "[{\"name\":\"a\",}]",
+        "[{name:\"a\"}]",
+        "[{\"name\":\"unterminated}]",
+        "[{\"name\":\"bad \\x escape\"}]",
+        "[{\"name\":\"\\u12\"}]",
+        "[{\"name\":42}]",
+        "[{\"expires\":\"soon\"}]",
+        "[{\"expires\":12abc}]",
+        "[{\"secure\":yes}]",
+        "[{\"sameSite\":3}]",
+        "[{\"sameSite\":-1}]",
+        "[{\"extra\":}]",
+        "[{\"extra\":[1,2}]",
+    };
+    for (const char* json : bad) {
+        std::vector<BrowserCookie> cookies;
+        if (ParseCookiesJson(json, cookies)) {
+            fprintf(stderr, "accepted: %s\n", json);
+            CHECK(false);
+        }
+    }
+
+    // Nesting is bounded
+    std::string deep = "[{\"extra\":";
+    for (int i = 0; i < 64; i++) deep += '[';
+    for (int i = 0; i < 64; i++) deep += ']';
+    deep += "}]";
+    std::vector<BrowserCookie> cookies;
+    CHECK(!ParseCookiesJson(deep, cookies));
+}
+
+static void TestLegacy() {
+    std::string out;
+    BrowserCookie cookie = Cookie("sid", "abc");
+    AppendLegacyCookie(out, cookie);
+    cookie.domain = ".example.com";
+    cookie.path = "/app";
+    AppendLegacyCookie(out, cookie);
+    CHECK(out == "sid=abc; Version=0\nsid=abc; Domain=.example.com; Path=/app; Version=0\n");
+}
+
+int main() {
+    TestRoundTrip();
+    TestExpires();
+    TestLenient();
+    TestMalformed();
+    TestLegacy();
+    return TestExitCode();
+}
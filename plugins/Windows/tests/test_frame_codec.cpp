@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Round trips and malformed-input handling of the frame codec.
+
+#include "FrameCodec.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <vector>
+
+static const uint8_t kCanary = 0xA5;
+
+static bool RoundTrips(const std::vector<uint8_t>& raw) {
+    std::vector<uint8_t> packed(PackedFrameBound(raw.size()));
+    size_t packedSize = PackFrameData(raw.data(), raw.size(), packed.data());
+    if (packedSize > packed.size()) return false;
+    std::vector<uint8_t> restored(raw.size() + 16, kCanary);
+    if (!UnpackFrameData(packed.data(), packedSize, restored.data(), raw.size())) return false;
+    for (size_t i = raw.size(); i < restored.size(); i++) {
+        if (restored[i] != kCanary) return false;
+    }
+    return raw.empty() || memcmp(restored.data(), raw.data(), raw.size()) == 0;
+}
+
+static std::vector<uint8_t> RandomBytes(size_t size, uint32_t seed) {
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& b : bytes) {
+        seed = seed * 1664525u + 1013904223u;
+        b = static_cast<uint8_t>(seed >> 24);
+    }
+    return bytes;
+}
+
+// RGBA page content: flat background, a header bar, rows of glyph-like
+// strokes and a gradient image
+static std::vector<uint8_t> PageFrame(int width, int height) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    uint32_t seed = 7;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+            uint8_t v = 250;
+            if (y < 40) {
+                p[0] = 45, p[1] = 108, p[2] = 223, p[3] = 255;
+                continue;
+            }
+            if (x >= width / 2 && y >= 60 && y < height - 20) {
+                p[0] = static_cast<uint8_t>(x * 2), p[1] = static_cast<uint8_t>(y * 3);
+                p[2] = static_cast<uint8_t>(x + y), p[3] = 255;
+                continue;
+            }
+            if (y % 20 < 12 && x > 20 && x < width / 2 - 20) {
+                seed = seed * 1664525u + 1013904223u;
+                if ((seed >> 28) < 9) v = 40;
+            }
+            p[0] = p[1] = p[2] = v;
+            p[3] = 255;
+        }
+    }
+    return rgba;
+}
+
+static void TestRoundTrips() {
+    const size_t sizes[] = {0, 1, 4, 12, 13, 100, 4096, 65536 + 7, 1 << 20};
+    for (size_t size : sizes) {
+        CHECK(RoundTrips(RandomBytes(size, static_cast<uint32_t>(size))));
+        CHECK(RoundTrips(std::vector<uint8_t>(size, 0)));
+        CHECK(RoundTrips(std::vector<uint8_t>(size, 0xFF)));
+    }
+
+    std::vector<uint8_t> page = PageFrame(640, 360);
+    CHECK(RoundTrips(page));
+    std::vector<uint8_t> packed(PackedFrameBound(page.size()));
+    CHECK(PackFrameData(page.data(), page.size(), packed.data()) < page.size() / 2);
+
+    std::vector<uint8_t> flat(1920 * 1080 * 4, 0x80);
+    packed.resize(PackedFrameBound(flat.size()));
+    CHECK(RoundTrips(flat));
+    CHECK(PackFrameData(flat.data(), flat.size(), packed.data()) < flat.size() / 200);
+
+    // Incompressible data must stay within the bound
+    std::vector<uint8_t> noise = RandomBytes(1 << 20, 99);
+    packed.resize(PackedFrameBound(noise.size()));
+    CHECK(PackFrameData(noise.data(), noise.size(), packed.data()) <= PackedFrameBound(noise.size()));
+}
+
+// One literal, then a match at offset 1 that repeats it 1000 times: the
+// overlapping copy path, with a multi-byte length
+static std::vector<uint8_t> OverlapStream() {
+    std::vector<uint8_t> stream = {0x1F, 'x', 0x01, 0x00};
+    size_t extra = 1000 - 4 - 15;
+    while (extra >= 255) {
+        stream.push_back(255);
+        extra -= 255;
+    }
+    stream.push_back(static_cast<uint8_t>(extra));
+    stream.push_back(0x00);  // closing sequence without literals
+    return stream;
+}
+
+static void TestOverlappingMatch() {
+    std::vector<uint8_t> stream = OverlapStream();
+    std::vector<uint8_t> out(1001 + 16, kCanary);
+    CHECK(UnpackFrameData(stream.data(), stream.size(), out.data(), 1001));
+    bool all = true;
+    for (size_t i = 0; i < 1001; i++) all = all && out[i] == 'x';
+    CHECK(all);
+    CHECK(out[1001] == kCanary);
+
+    // A short period repeated over a long run, as produced by the encoder
+    std::vector<uint8_t> pattern;
+    for (int i = 0; i < 300000; i++) pattern.push_back(static_cast<uint8_t>("abc"[i % 3]));
+    CHECK(RoundTrips(pattern));
+}
+
+static void TestMalformed() {
+    std::vector<uint8_t> raw = PageFrame(128, 64);
+    std::vector<uint8_t> packed(PackedFrameBound(raw.size()));
+    packed.resize(PackFrameData(raw.data(), raw.size(), packed.data()));
+    std::vector<uint8_t> out(raw.size() + 16, kCanary);
+
+    // Every truncation fails without writing past the output
+    bool truncatedRejected = true;
+    for (size_t n = 0; n < packed.size(); n++) {
+        if (UnpackFrameData(packed.data(), n, out.data(), raw.size())) truncatedRejected = false;
+    }
+    CHECK(truncatedRejected);
+    CHECK(out[raw.size()] == kCanary);
+
+    // The stream must produce exactly the expected size
+    CHECK(!UnpackFrameData(packed.data(), packed.size(), out.data(), raw.size() - 1));
+    CHECK(!UnpackFrameData(packed.data(), packed.size(), out.data(), raw.size() + 1));
+    CHECK(out[raw.size() + 1] == kCanary);
+
+    // Match longer than the remaining output
+    std::vector<uint8_t> overlap = OverlapStream();
+    CHECK(!UnpackFrameData(overlap.data(), overlap.size(), out.data(), 500));
+
+    // Literal length running past the end of the stream
+    const uint8_t longLiterals[] = {0xF0, 255, 255, 10, 'a', 'b'};
+    CHECK(!UnpackFrameData(longLiterals, sizeof(longLiterals), out.data(), 600));
+    // Length continuation bytes cut off
+    const uint8_t cutLength[] = {0xF0, 255, 255};
+    CHECK(!UnpackFrameData(cutLength, sizeof(cutLength), out.data(), 600));
+
+    // Offsets reaching before the start of the output, or zero
+    const uint8_t farOffset[] = {0x10, 'x', 0x02, 0x00, 0x00};
+    CHECK(!UnpackFrameData(farOffset, sizeof(farOffset), out.data(), 5));
+    const uint8_t zeroOffset[] = {0x10, 'x', 0x00, 0x00, 0x00};
+    CHECK(!UnpackFrameData(zeroOffset, sizeof(zeroOffset), out.data(), 5));
+    const uint8_t goodOffset[] = {0x10, 'x', 0x01, 0x00, 0x00};
+    CHECK(UnpackFrameData(goodOffset, sizeof(goodOffset), out.data(), 5));
+
+    // Offset split off the end
+    const uint8_t cutOffset[] = {0x10, 'x', 0x01};
+    CHECK(!UnpackFrameData(cutOffset, sizeof(cutOffset), out.data(), 5));
+    CHECK(!UnpackFrameData(nullptr, 0, out.data(), 0));
+}
+
+int main() {
+    TestRoundTrips();
+    TestOverlappingMatch();
+    TestMalformed();
+    return TestExitCode();
+}
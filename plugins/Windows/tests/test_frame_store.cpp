@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// FrameStore: frames keep the layout they were begun with, render never
+// copies more than the texture sized for the requested layout holds, and
+// relayout shows the displayed frame in a new layout.
+
+#include "FrameStore.h"
+#include "InstanceStats.h"
+#include "MipChain.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <vector>
+
+static const int kWidth = 96;
+static const int kHeight = 40;
+static const size_t kGuard = 256;
+static const uint8_t kCanary = 0xA5;
+
+// Texture memory as C# allocates it for a layout, followed by a guard area
+struct Texture {
+    explicit Texture(size_t size) : size(size), bytes(size + kGuard, 0) {
+        memset(bytes.data() + size, kCanary, kGuard);
+    }
+    bool guardIntact() const {
+        for (size_t i = size; i < bytes.size(); i++) {
+            if (bytes[i] != kCanary) return false;
+        }
+        return true;
+    }
+    size_t size;
+    std::vector<uint8_t> bytes;
+};
+
+static size_t RgbaSize() {
+    return static_cast<size_t>(kWidth) * kHeight * 4;
+}
+
+static void FillFrame(uint8_t* pixels, int seed) {
+    for (size_t i = 0; i < RgbaSize(); i++) pixels[i] = static_cast<uint8_t>(i * 7 + seed);
+}
+
+static bool WriteFrame(FrameStore& store, int seed) {
+    uint8_t* pixels = store.beginFrame(kWidth, kHeight);
+    if (!pixels) return false;
+    FillFrame(pixels, seed);
+    return store.commitFrame();
+}
+
+static void TestMipChainTurnedOffMidFrame() {
+    InstanceStats stats;
+    FrameStore store(stats);
+    store.setMipChain(true, false);
+    uint8_t* pixels = store.beginFrame(kWidth, kHeight);
+    CHECK(pixels != nullptr);
+    if (!pixels) return;
+    FillFrame(pixels, 1);
+    store.setMipChain(false, false);
+    CHECK(store.commitFrame());
+
+    // The frame was begun with a mip chain, so it is not shown as RGBA32
+    Texture texture(RgbaSize());
+    store.render(texture.bytes.data());
+    CHECK(texture.guardIntact());
+    CHECK(stats.framesRendered.load() == 0);
+
+    CHECK(WriteFrame(store, 2));
+    store.render(texture.bytes.data());
+    CHECK(texture.guardIntact());
+    CHECK(stats.framesRendered.load() == 1);
+    CHECK(stats.bytesRendered.load() == RgbaSize());
+    std::vector<uint8_t> expected(RgbaSize());
+    FillFrame(expected.data(), 2);
+    CHECK(memcmp(texture.bytes.data(), expected.data(), RgbaSize()) == 0);
+}
+
+static void TestMipChainTurnedOnMidFrame() {
+    InstanceStats stats;
+    FrameStore store(stats);
+    uint8_t* pixels = store.beginFrame(kWidth, kHeight);
+    CHECK(pixels != nullptr);
+    if (!pixels) return;
+    FillFrame(pixels, 3);
+    store.setMipChain(true, false);
+    CHECK(store.commitFrame());
+
+    Texture texture(MipChainSize(kWidth, kHeight));
+    store.render(texture.bytes.data());
+    CHECK(stats.framesRendered.load() == 0);
+
+    CHECK(WriteFrame(store, 4));
+    store.render(texture.bytes.data());
+    CHECK(texture.guardIntact());
+    CHECK(stats.framesRendered.load() == 1);
+    CHECK(stats.bytesRendered.load() == MipChainSize(kWidth, kHeight));
+
+    // Back to RGBA32 between frames and mid-frame again
+    store.setMipChain(false, false);
+    CHECK(WriteFrame(store, 5));
+    Texture rgba(RgbaSize());
+    store.render(rgba.bytes.data());
+    CHECK(rgba.guardIntact());
+    CHECK(stats.framesRendered.load() == 2);
+    CHECK(stats.bytesRendered.load() == MipChainSize(kWidth, kHeight) + RgbaSize());
+}
+
+static void TestFormatChangedMidFrame() {
+    InstanceStats stats;
+    FrameStore store(stats);
+    uint8_t* pixels = store.beginFrame(kWidth, kHeight);
+    CHECK(pixels != nullptr);
+    if (!pixels) return;
+    FillFrame(pixels, 6);
+    store.setFrameFormat(FRAME_FORMAT_BC1);
+    CHECK(store.commitFrame());
+
+    Texture texture(FrameDataSize(FRAME_FORMAT_BC1, kWidth, kHeight));
+    store.render(texture.bytes.data());
+    CHECK(stats.framesRendered.load() == 0);
+
+    CHECK(WriteFrame(store, 7));
+    store.render(texture.bytes.data());
+    CHECK(texture.guardIntact());
+    CHECK(stats.framesRendered.load() == 1);
+    CHECK(stats.bytesRendered.load() == texture.size);
+}
+
+static void TestRelayout() {
+    InstanceStats stats;
+    FrameStore store(stats);
+    CHECK(!store.relayout());
+    CHECK(WriteFrame(store, 8));
+    CHECK(!store.relayout());
+    Texture rgba(RgbaSize());
+    store.render(rgba.bytes.data());
+    CHECK(stats.framesRendered.load() == 1);
+
+    // The displayed frame is shown in the new layout without a new frame
+    store.setMipChain(true, true);
+    CHECK(store.relayout());
+    Texture mips(MipChainSize(kWidth, kHeight));
+    store.render(mips.bytes.data());
+    CHECK(mips.guardIntact());
+    CHECK(stats.framesRendered.load() == 2);
+    std::vector<uint8_t> expected(RgbaSize());
+    FillFrame(expected.data(), 8);
+    CHECK(memcmp(mips.bytes.data(), expected.data(), RgbaSize()) == 0);
+
+    store.setMipChain(false, false);
+    store.setFrameFormat(FRAME_FORMAT_BC3);
+    CHECK(store.relayout());
+    Texture blocks(FrameDataSize(FRAME_FORMAT_BC3, kWidth, kHeight));
+    store.render(blocks.bytes.data());
+    CHECK(blocks.guardIntact());
+    CHECK(stats.framesRendered.load() == 3);
+
+    // and back, starting from a frame whose bitmap holds only level 0
+    store.setFrameFormat(FRAME_FORMAT_RGBA32);
+    CHECK(store.relayout());
+    store.render(rgba.bytes.data());
+    CHECK(stats.framesRendered.load() == 4);
+    CHECK(memcmp(rgba.bytes.data(), expected.data(), RgbaSize()) == 0);
+
+    store.park();
+    store.setFrameFormat(FRAME_FORMAT_BC1);
+    CHECK(!store.relayout());
+    store.unpark();
+    CHECK(store.relayout());
+}
+
+int main() {
+    TestMipChainTurnedOffMidFrame();
+    TestMipChainTurnedOnMidFrame();
+    TestFormatChangedMidFrame();
+    TestRelayout();
+    return TestExitCode();
+}
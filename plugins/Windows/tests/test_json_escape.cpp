@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// AppendJsonEscaped, shared by every JSON writer in webview_core.
+
+#include "JsonEscape.h"
+#include "TestCheck.h"
+
+#include <string>
+
+struct EscapeCase {
+    std::string in;
+    const char* out;
+};
+
+static const EscapeCase kCases[] = {
+    {"", ""},
+    {"plain text", "plain text"},
+    {"say \"hi\"", "say \\\"hi\\\""},
+    {"C:\\temp\\", "C:\\\\temp\\\\"},
+    {"a\nb\tc\rd", "a\\u000ab\\u0009c\\u000dd"},
+    {std::string("nul\0end", 7), "nul\\u0000end"},
+    {"\x1f\x20\x7f", "\\u001f \x7f"},
+    // UTF-8 passes through, including bytes that are negative as char
+    {"caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80", "caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80"},
+};
+
+int main() {
+    for (const EscapeCase& c : kCases) {
+        std::string out = "[";
+        AppendJsonEscaped(out, c.in);
+        CHECK(out == std::string("[") + c.out);
+    }
+
+    std::wstring wide = L"{";
+    AppendJsonEscaped(wide, std::wstring(L"\"a\\b\"\n\x00e9\x20ac"));
+    CHECK(wide == L"{\\\"a\\\\b\\\"\\u000a\x00e9\x20ac");
+    // A code unit whose low bits look like '"' is not a quote
+    wide.clear();
+    AppendJsonEscaped(wide, std::wstring(1, static_cast<wchar_t>(0xFF22)));
+    CHECK(wide.size() == 1 && wide[0] == static_cast<wchar_t>(0xFF22));
+    return TestExitCode();
+}
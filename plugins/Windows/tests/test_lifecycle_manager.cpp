@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Drives the process-wide LifecycleManager through its delays, refused
+// suspensions and the memory budget. The manager is a singleton, so each
+// test sets its own policy, removes its keys and compares stats deltas.
+
+#include "LifecycleManager.h"
+#include "TestCheck.h"
+
+#include <vector>
+
+typedef std::vector<LifecycleManager::Transition> Transitions;
+
+static LifecyclePolicy Policy(int64_t park, int64_t lowMemory, int64_t suspend, uint64_t budget = 0) {
+    LifecyclePolicy policy;
+    policy.parkAfterMicros = park;
+    policy.lowMemoryAfterMicros = lowMemory;
+    policy.suspendAfterMicros = suspend;
+    policy.memoryBudget = budget;
+    return policy;
+}
+
+static bool Step(const Transitions& out, size_t i, void* key, int from, int to) {
+    return i < out.size() && out[i].key == key && out[i].from == from && out[i].to == to;
+}
+
+static void TestNegativeDelaySkipped() {
+    LifecycleManager& manager = LifecycleManager::instance();
+    manager.setPolicy(Policy(-1, 100, -1));
+    int a;
+    manager.add(&a);
+    CHECK(manager.setVisible(&a, false, 1000) == LIFECYCLE_HIDDEN);
+
+    Transitions out;
+    manager.evaluate(1050, 0, out);
+    CHECK(out.empty());
+    // Parking is never taken on its own; low memory jumps straight past it
+    manager.evaluate(1100, 0, out);
+    CHECK(out.size() == 1 && Step(out, 0, &a, LIFECYCLE_HIDDEN, LIFECYCLE_LOW_MEMORY));
+    out.clear();
+    manager.evaluate(1000000, 0, out);
+    CHECK(out.empty());
+    manager.remove(&a);
+}
+
+static void TestEqualDelaysOneStep() {
+    LifecycleManager& manager = LifecycleManager::instance();
+    manager.setPolicy(Policy(10, 10, 10));
+    int a;
+    manager.add(&a);
+    CHECK(manager.setVisible(&a, false, 0) == LIFECYCLE_HIDDEN);
+
+    Transitions out;
+    manager.evaluate(9, 0, out);
+    CHECK(out.empty());
+    manager.evaluate(10, 0, out);
+    CHECK(out.size() == 1 && Step(out, 0, &a, LIFECYCLE_HIDDEN, LIFECYCLE_SUSPENDED));
+
+    // All zero: hiding suspends at once
+    manager.setPolicy(Policy(0, 0, 0));
+    CHECK(manager.setVisible(&a, true, 20) == LIFECYCLE_VISIBLE);
+    CHECK(manager.setVisible(&a, false, 30) == LIFECYCLE_SUSPENDED);
+    manager.remove(&a);
+}
+
+static void TestRevertHoldsCeiling() {
+    LifecycleManager& manager = LifecycleManager::instance();
+    manager.setPolicy(Policy(0, -1, 10, 100));
+    uint64_t failures = manager.stats().suspendFailures;
+    int a;
+    manager.add(&a);
+    CHECK(manager.setVisible(&a, false, 0) == LIFECYCLE_PARKED);
+
+    Transitions out;
+    manager.evaluate(10, 0, out);
+    CHECK(out.size() == 1 && Step(out, 0, &a, LIFECYCLE_PARKED, LIFECYCLE_SUSPENDED));
+    manager.revert(&a, LIFECYCLE_SUSPENDED, LIFECYCLE_PARKED);
+    CHECK(manager.state(&a) == LIFECYCLE_PARKED);
+    CHECK(manager.stats().suspendFailures == failures + 1);
+
+    // Neither the delay nor the budget retries it while it stays hidden
+    uint64_t budgetSteps = manager.stats().budgetSteps;
+    out.clear();
+    manager.evaluate(1000, 0, out);
+    manager.evaluate(2000, 500, out);
+    CHECK(out.empty());
+    CHECK(manager.stats().budgetSteps == budgetSteps);
+    CHECK(manager.setVisible(&a, false, 3000) == LIFECYCLE_PARKED);
+
+    // A revert of a step the instance has since left is ignored
+    manager.revert(&a, LIFECYCLE_SUSPENDED, LIFECYCLE_HIDDEN);
+    CHECK(manager.state(&a) == LIFECYCLE_PARKED);
+
+    // Showing lifts the ceiling
+    manager.setVisible(&a, true, 4000);
+    CHECK(manager.setVisible(&a, false, 5000) == LIFECYCLE_PARKED);
+    manager.evaluate(5010, 0, out);
+    CHECK(out.size() == 1 && Step(out, 0, &a, LIFECYCLE_PARKED, LIFECYCLE_SUSPENDED));
+    manager.remove(&a);
+}
+
+static void TestBudgetPicksLongestHidden() {
+    LifecycleManager& manager = LifecycleManager::instance();
+    manager.setPolicy(Policy(0, 1000000, -1, 100));
+    uint64_t budgetSteps = manager.stats().budgetSteps;
+    int a, b, c;
+    manager.add(&a);
+    manager.add(&b);
+    manager.add(&c);
+    // b hidden first, a later; c stays visible and is never picked
+    CHECK(manager.setVisible(&b, false, 0) == LIFECYCLE_PARKED);
+    CHECK(manager.setVisible(&a, false, 5) == LIFECYCLE_PARKED);
+
+    Transitions out;
+    manager.evaluate(10, 100, out);
+    CHECK(out.empty());
+    manager.evaluate(20, 200, out);
+    CHECK(out.size() == 1 && Step(out, 0, &b, LIFECYCLE_PARKED, LIFECYCLE_LOW_MEMORY));
+    // b has no enabled step left, so the next one falls to a
+    out.clear();
+    manager.evaluate(30, 200, out);
+    CHECK(out.size() == 1 && Step(out, 0, &a, LIFECYCLE_PARKED, LIFECYCLE_LOW_MEMORY));
+    out.clear();
+    manager.evaluate(40, 200, out);
+    CHECK(out.empty());
+    CHECK(manager.stats().budgetSteps == budgetSteps + 2);
+    CHECK(manager.state(&c) == LIFECYCLE_VISIBLE);
+    manager.remove(&a);
+    manager.remove(&b);
+    manager.remove(&c);
+}
+
+static void TestMemoryReclaimed() {
+    LifecycleManager& manager = LifecycleManager::instance();
+    manager.setPolicy(Policy(0, 10, -1, 1000));
+    int a, b;
+    manager.add(&a);
+    manager.add(&b);
+    manager.setVisible(&a, false, 0);
+    manager.setVisible(&b, false, 0);
+
+    Transitions out;
+    manager.evaluate(1, 500, out);  // clears any baseline left by other tests
+    uint64_t reclaimed = manager.stats().memoryReclaimed;
+    CHECK(manager.stats().memoryBytes == 500);
+    manager.evaluate(2, 400, out);
+    CHECK(manager.stats().memoryReclaimed == reclaimed);
+
+    // a's timed low-memory step is measured against the next sample
+    manager.setVisible(&b, true, 5);
+    manager.setVisible(&b, false, 6);
+    out.clear();
+    manager.evaluate(10, 400, out);
+    CHECK(out.size() == 1 && Step(out, 0, &a, LIFECYCLE_PARKED, LIFECYCLE_LOW_MEMORY));
+    manager.evaluate(11, 300, out);
+    CHECK(manager.stats().memoryReclaimed == reclaimed + 100);
+    CHECK(manager.stats().memoryBytes == 300);
+    // Counted once per step
+    manager.evaluate(12, 250, out);
+    CHECK(manager.stats().memoryReclaimed == reclaimed + 100);
+
+    // An unknown sample keeps the baseline for the next known one
+    manager.evaluate(16, 250, out);  // b steps to low memory
+    manager.evaluate(17, 0, out);
+    CHECK(manager.stats().memoryBytes == 250);
+    manager.evaluate(18, 200, out);
+    CHECK(manager.stats().memoryReclaimed == reclaimed + 150);
+
+    // A rise after a step is not counted
+    manager.setVisible(&a, true, 20);
+    manager.setVisible(&a, false, 21);
+    manager.evaluate(31, 200, out);
+    CHECK(manager.state(&a) == LIFECYCLE_LOW_MEMORY);
+    manager.evaluate(32, 260, out);
+    CHECK(manager.stats().memoryReclaimed == reclaimed + 150);
+    manager.remove(&a);
+    manager.remove(&b);
+}
+
+int main() {
+    TestNegativeDelaySkipped();
+    TestEqualDelaysOneStep();
+    TestRevertHoldsCeiling();
+    TestBudgetPicksLongestHidden();
+    TestMemoryReclaimed();
+    return TestExitCode();
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Rule parsing and matching of RequestBlocker: domain, path, host-less
+// segment and exception rules, plus the block list dialects it accepts.
+
+#include "RequestBlocker.h"
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <string>
+
+static const char* kRules =
+    "# comment\n"
+    "! comment\n"
+    "[Adblock Plus 2.0]\n"
+    "ads.example.com\n"                                // 0
+    "example.com/ads/\n"                               // 1
+    "/pagead/\n"                                       // 2
+    "/beacon\n"                                        // 3
+    "@@cdn.example.com/ads/\n"                         // 4
+    "@@safe.ads.example.com\n"                         // 5
+    "||tracker.net^\n"                                 // 6
+    "||opts.net^$third-party\n"
+    "*.wild.net\n"                                     // 7
+    "0.0.0.0 hosts.example.org # from a hosts file\n"  // 8
+    "127.0.0.1 localhost\n"
+    "::1 ip6.example.net\n"                            // 9
+    "0.0.0.0 0.0.0.0\n"
+    "example.com##.banner\n"
+    "/ads/*.gif\n"
+    "not a rule\n"
+    "bad..domain\n"
+    "/\n"
+    "  spaced.example.net \r\n"                        // 10
+    "ads.example.com";                                 // 11, shadowed by 0
+
+struct MatchCase {
+    const char* url;
+    int rule;
+};
+
+static const MatchCase kMatchCases[] = {
+    // Domain rules cover the host and its subdomains, by whole labels
+    {"https://ads.example.com/x", 0},
+    {"https://eu.ads.example.com/x", 0},
+    {"https://ADS.Example.COM/", 0},
+    {"https://ads.example.com./", 0},
+    {"https://example.com/", -1},
+    {"https://badads.example.com/", -1},
+    {"https://ads.example.com.evil.net/", -1},
+    // Domain and path prefix
+    {"https://example.com/ads/banner.js", 1},
+    {"https://www.example.com/ads/", 1},
+    {"https://example.com/adsx", -1},
+    {"https://example.com/other/ads/", -1},
+    // Host-less rules match whole segments anywhere in the path
+    {"https://site.org/pagead/x.js", 2},
+    {"https://site.org/a/pagead/", 2},
+    {"https://site.org/xpagead/", -1},
+    {"https://site.org/pagead", -1},
+    {"https://x.com/beacon", 3},
+    {"https://x.com/a/beacon/1", 3},
+    {"https://x.com/beacon?x=1", 3},
+    {"https://x.com/beacons", -1},
+    {"https://x.com/q?u=/beacon", -1},
+    // Exceptions win over block rules on the same request
+    {"https://cdn.example.com/ads/a.js", -1},
+    {"https://cdn.example.com/ads/pagead/", -1},
+    {"https://cdn.example.com/other", -1},
+    {"https://safe.ads.example.com/", -1},
+    {"https://x.safe.ads.example.com/", -1},
+    // ||domain^, *.domain and hosts-file lines are domain rules
+    {"https://tracker.net/p", 6},
+    {"https://a.b.tracker.net/", 6},
+    {"https://opts.net/", -1},
+    {"https://wild.net/", 7},
+    {"https://a.wild.net/", 7},
+    {"http://hosts.example.org:8080/", 8},
+    {"https://user@ip6.example.net/", 9},
+    {"https://localhost/", -1},
+    {"https://spaced.example.net", 10},
+    // Nothing to match against
+    {"file:///C:/pagead/x.html", -1},
+    {"about:blank", -1},
+    {"not a url", -1},
+    {"", -1},
+};
+
+static void TestMatching() {
+    RequestBlocker blocker;
+    CHECK(!blocker.enabled());
+    CHECK(blocker.match("https://ads.example.com/") == -1);
+    CHECK(blocker.load(kRules) == 12);
+    CHECK(blocker.ruleCount() == 12);
+    CHECK(blocker.enabled());
+
+    int blocked = 0;
+    for (const MatchCase& c : kMatchCases) {
+        int rule = blocker.match(c.url);
+        if (rule != c.rule) fprintf(stderr, "match(\"%s\") = %d, expected %d\n", c.url, rule, c.rule);
+        CHECK(rule == c.rule);
+        if (c.rule >= 0) blocked++;
+    }
+
+    std::string json = blocker.hitsJson();
+    std::string total = "{\"blocked\":" + std::to_string(blocked) + ",";
+    CHECK(json.compare(0, total.size(), total) == 0);
+    CHECK(json.find("{\"rule\":\"ads.example.com\",\"hits\":4}") != std::string::npos);
+    CHECK(json.find("{\"rule\":\"||tracker.net^\",\"hits\":2}") != std::string::npos);
+    CHECK(json.find("{\"rule\":\"0.0.0.0 hosts.example.org # from a hosts file\",\"hits\":1}") != std::string::npos);
+    CHECK(json.find("@@") == std::string::npos);  // exceptions never count hits
+
+    // Loading replaces the rules and their counters
+    CHECK(blocker.load("other.net") == 1);
+    CHECK(blocker.match("https://ads.example.com/") == -1);
+    CHECK(blocker.match("https://other.net/") == 0);
+    CHECK(blocker.hitsJson() == "{\"blocked\":1,\"rules\":[{\"rule\":\"other.net\",\"hits\":1}]}");
+    blocker.clear();
+    CHECK(!blocker.enabled() && blocker.ruleCount() == 0);
+    CHECK(blocker.match("https://other.net/") == -1);
+    CHECK(blocker.hitsJson() == "{\"blocked\":0,\"rules\":[]}");
+    CHECK(blocker.load("# only comments\n\n") == 0);
+    CHECK(!blocker.enabled());
+    CHECK(blocker.load(nullptr) == 0);
+}
+
+static void TestLoadFile() {
+    RequestBlocker blocker;
+    const char* path = "test_request_blocker.txt";
+    FILE* f = fopen(path, "wb");
+    CHECK(f != nullptr);
+    if (!f) return;
+    fputs(kRules, f);
+    fclose(f);
+    CHECK(blocker.loadFile(path) == 12);
+    CHECK(blocker.match("https://eu.ads.example.com/") == 0);
+    remove(path);
+    CHECK(blocker.loadFile(path) == -1);
+    CHECK(blocker.loadFile(nullptr) == -1);
+    // A failed load keeps the previous rules
+    CHECK(blocker.ruleCount() == 12);
+}
+
+static void TestCopyFrom() {
+    RequestBlocker blocker;
+    blocker.load(kRules);
+    RequestBlocker copy;
+    copy.copyFrom(blocker);
+    CHECK(copy.enabled() && copy.ruleCount() == 12);
+    CHECK(copy.match("https://eu.ads.example.com/") == 0);
+    // The compiled rules, hit counts included, are shared
+    CHECK(blocker.hitsJson() == copy.hitsJson());
+    blocker.clear();
+    CHECK(copy.ruleCount() == 12);
+    copy.copyFrom(blocker);
+    CHECK(!copy.enabled() && copy.match("https://eu.ads.example.com/") == -1);
+}
+
+int main() {
+    TestMatching();
+    TestLoadFile();
+    TestCopyFrom();
+    return TestExitCode();
+}
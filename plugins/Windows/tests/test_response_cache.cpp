@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// ResponseCache eviction, expiry and header handling, then concurrent
+// lookups, stores and clears checked against the byte cap and counters.
+
+#include "ResponseCache.h"
+#include "TestCheck.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Matches kEntryOverhead in ResponseCache.cpp
+static const size_t kOverhead = 128;
+
+static std::string ApiUrl(int i) {
+    return "https://h/api/" + std::to_string(i);
+}
+
+static CachedResponse MakeResponse(const std::string& body, const char* headers = "") {
+    CachedResponse response;
+    response.status = 200;
+    response.headers = headers;
+    response.body = std::make_shared<const std::string>(body);
+    return response;
+}
+
+static size_t EntryBytes(const std::string& method, const std::string& url, size_t bodySize) {
+    return kOverhead + method.size() + 1 + url.size() + bodySize;
+}
+
+static void TestRules() {
+    ResponseCache cache;
+    CHECK(!cache.enabled());
+    CHECK(cache.addRule("/api/", 60));
+    CHECK(!cache.enabled());  // no budget yet
+    cache.setBudget(1 << 20);
+    CHECK(cache.enabled());
+    CHECK(cache.addRule("/api/slow", 600));  // shadowed by the first rule
+    CHECK(cache.addRule("/static/", 3600));
+    CHECK(!cache.addRule("(", 60));
+    CHECK(!cache.addRule("/x/", 0));
+    CHECK(cache.ttlMicros("GET", "https://h/api/slow") == 60ull * 1000000);
+    CHECK(cache.ttlMicros("HEAD", "https://h/static/a.js") == 3600ull * 1000000);
+    CHECK(cache.ttlMicros("POST", "https://h/api/1") == 0);
+    CHECK(cache.ttlMicros("GET", "https://h/other") == 0);
+    cache.clearRules();
+    CHECK(!cache.enabled());
+    CHECK(cache.ttlMicros("GET", "https://h/api/1") == 0);
+}
+
+static void TestCopyRules() {
+    ResponseCache cache;
+    cache.setBudget(1 << 20);
+    cache.addRule("/api/", 60);
+    cache.store("GET", "https://h/api/1", MakeResponse("body"), 100, 0);
+
+    ResponseCache copy;
+    copy.copyRulesFrom(cache);
+    CHECK(copy.enabled());
+    CHECK(copy.ttlMicros("GET", "https://h/api/2") == 60ull * 1000000);
+    // Rules and budget only, not the responses
+    CHECK(copy.stats().entries == 0 && cache.stats().entries == 1);
+    CachedResponse response;
+    CHECK(!copy.lookup("GET", "https://h/api/1", 0, response));
+
+    cache.clearRules();
+    CHECK(copy.ttlMicros("GET", "https://h/api/2") != 0);
+    copy.copyRulesFrom(cache);
+    CHECK(!copy.enabled());
+}
+
+static void TestEvictionAndExpiry() {
+    const std::string body(1000, 'b');
+    size_t entry = EntryBytes("GET", ApiUrl(0), body.size());
+    ResponseCache cache;
+    cache.setBudget(entry * 3);
+    for (int i = 0; i < 3; i++) cache.store("GET", ApiUrl(i), MakeResponse(body), 100, 0);
+    ResponseCacheStats stats = cache.stats();
+    CHECK(stats.entries == 3 && stats.bytes == entry * 3 && stats.stores == 3 && stats.evictions == 0);
+
+    // A hit makes 0 the most recent, so 1 is evicted next
+    CachedResponse response;
+    CHECK(cache.lookup("GET", ApiUrl(0), 10, response));
+    CHECK(response.body && *response.body == body);
+    cache.store("GET", ApiUrl(3), MakeResponse(body), 100, 10);
+    CHECK(!cache.contains("GET", ApiUrl(1), 10));
+    CHECK(cache.contains("GET", ApiUrl(0), 10));
+    CHECK(cache.contains("GET", ApiUrl(2), 10));
+    CHECK(cache.contains("GET", ApiUrl(3), 10));
+    stats = cache.stats();
+    CHECK(stats.evictions == 1 && stats.entries == 3 && stats.bytes == entry * 3);
+
+    // Replacing an entry is not an eviction
+    cache.store("GET", ApiUrl(3), MakeResponse(body), 100, 20);
+    stats = cache.stats();
+    CHECK(stats.evictions == 1 && stats.entries == 3 && stats.stores == 5);
+
+    // Entries expire once their TTL has passed; contains() does not count
+    CHECK(!cache.contains("GET", ApiUrl(0), 100));
+    CHECK(cache.stats().expirations == 0);
+    CHECK(!cache.lookup("GET", ApiUrl(0), 100, response));
+    CHECK(cache.lookup("GET", ApiUrl(3), 100, response));
+    stats = cache.stats();
+    CHECK(stats.hits == 2 && stats.misses == 1 && stats.expirations == 1);
+    CHECK(stats.entries == 2 && stats.bytes == entry * 2);
+
+    // Shrinking the budget evicts from the cold end; a zero budget empties
+    cache.setBudget(entry);
+    stats = cache.stats();
+    CHECK(stats.entries == 1 && stats.evictions == 2);
+    CHECK(cache.contains("GET", ApiUrl(3), 100));
+    cache.setBudget(0);
+    stats = cache.stats();
+    CHECK(stats.entries == 0 && stats.bytes == 0);
+}
+
+static void TestStoreFiltering() {
+    ResponseCache cache;
+    cache.setBudget(4096);
+    CachedResponse response;
+
+    cache.store("GET", ApiUrl(1), MakeResponse("x", "Set-Cookie: a=b\r\nContent-Type: text/plain\r\nset-cookie: c=d"), 100, 0);
+    CHECK(cache.lookup("GET", ApiUrl(1), 0, response));
+    CHECK(response.headers == "Content-Type: text/plain");
+
+    cache.store("GET", ApiUrl(2), MakeResponse("x", "Cache-Control: private, No-Store"), 100, 0);
+    CachedResponse notFound = MakeResponse("x");
+    notFound.status = 404;
+    cache.store("GET", ApiUrl(3), notFound, 100, 0);
+    cache.store("GET", ApiUrl(4), MakeResponse("x"), 0, 0);
+    cache.store("GET", ApiUrl(5), MakeResponse(std::string(4096, 'x')), 100, 0);
+    for (int i = 2; i <= 5; i++) CHECK(!cache.contains("GET", ApiUrl(i), 0));
+    CHECK(cache.stats().stores == 1);
+
+    // Method is part of the key
+    CHECK(!cache.contains("HEAD", ApiUrl(1), 0));
+    cache.clear();
+    CHECK(cache.stats().entries == 0 && cache.stats().bytes == 0);
+}
+
+static const int kWorkers = 4;
+static const int kOpsPerWorker = 20000;
+static const int kUrls = 64;
+
+struct WorkerCounts {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+    uint64_t corrupt = 0;
+};
+
+// Bodies name their URL so a hit returning another key's data shows up
+static std::string BodyFor(int i) {
+    return std::string(200 + (i % 7) * 300, static_cast<char>('a' + i % 26)) + ApiUrl(i);
+}
+
+static void TestConcurrent() {
+    // Room for about a third of the URLs, so eviction runs constantly
+    size_t budget = 0;
+    for (int i = 0; i < kUrls; i++) budget += EntryBytes("GET", ApiUrl(i), BodyFor(i).size());
+    budget /= 3;
+
+    ResponseCache cache;
+    cache.setBudget(budget);
+    CHECK(cache.addRule("/api/", 1));
+
+    // A logical clock the workers advance, so entries also expire
+    std::atomic<uint64_t> clock{0};
+    std::atomic<bool> done{false};
+    std::atomic<int> overBudget{0};
+    std::atomic<int> clears{0};
+    std::vector<WorkerCounts> counts(kWorkers);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < kWorkers; w++) {
+        threads.emplace_back([&, w]() {
+            WorkerCounts& mine = counts[w];
+            uint32_t seed = 17 + w;
+            for (int op = 0; op < kOpsPerWorker; op++) {
+                seed = seed * 1664525u + 1013904223u;
+                // Skewed towards low indices so some URLs stay hot
+                int i = static_cast<int>((seed >> 8) % kUrls);
+                if ((seed >> 20) & 1) i /= 16;
+                std::string url = ApiUrl(i);
+                uint64_t now = clock.fetch_add(1000);
+                uint64_t ttl = cache.ttlMicros("GET", url);
+                CachedResponse response;
+                if (cache.lookup("GET", url, now, response)) {
+                    mine.hits++;
+                    if (!response.body || *response.body != BodyFor(i)) mine.corrupt++;
+                } else {
+                    mine.misses++;
+                    cache.store("GET", url, MakeResponse(BodyFor(i)), ttl, now);
+                    mine.stores++;
+                }
+            }
+        });
+    }
+    // Checks the cap from outside, clearing every few TTLs of logical time
+    threads.emplace_back([&]() {
+        uint64_t lastClear = 0;
+        while (!done.load()) {
+            ResponseCacheStats stats = cache.stats();
+            if (stats.bytes > budget || stats.bytes < stats.entries * kOverhead) overBudget++;
+            uint64_t now = clock.load();
+            if (now - lastClear >= 5000000) {
+                cache.clear();
+                clears++;
+                lastClear = now;
+            }
+            std::this_thread::yield();
+        }
+    });
+    for (int w = 0; w < kWorkers; w++) threads[w].join();
+    done = true;
+    threads.back().join();
+
+    WorkerCounts total;
+    for (const WorkerCounts& c : counts) {
+        total.hits += c.hits;
+        total.misses += c.misses;
+        total.stores += c.stores;
+        total.corrupt += c.corrupt;
+    }
+    ResponseCacheStats stats = cache.stats();
+    CHECK(overBudget.load() == 0);
+    CHECK(total.corrupt == 0);
+    CHECK(stats.hits == total.hits);
+    CHECK(stats.misses == total.misses);
+    CHECK(stats.hits + stats.misses == static_cast<uint64_t>(kWorkers) * kOpsPerWorker);
+    CHECK(stats.stores == total.stores);
+    CHECK(stats.hits > 0);
+    CHECK(stats.evictions > 0);
+    CHECK(stats.expirations > 0);
+    CHECK(stats.bytes <= budget);
+    CHECK(clears.load() > 0);
+
+    // The byte count matches what is actually left, expired or not
+    size_t live = 0;
+    uint64_t liveEntries = 0;
+    for (int i = 0; i < kUrls; i++) {
+        if (cache.contains("GET", ApiUrl(i), 0)) {
+            live += EntryBytes("GET", ApiUrl(i), BodyFor(i).size());
+            liveEntries++;
+        }
+    }
+    CHECK(stats.entries == liveEntries);
+    CHECK(stats.bytes == live);
+    cache.clear();
+    stats = cache.stats();
+    CHECK(stats.entries == 0 && stats.bytes == 0);
+}
+
+int main() {
+    TestRules();
+    TestCopyRules();
+    TestEvictionAndExpiry();
+    TestStoreFiltering();
+    TestConcurrent();
+    return TestExitCode();
+}
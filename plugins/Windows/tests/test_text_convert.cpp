@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Differential test of the UTF-8/wide conversions against a plain
+// byte-at-a-time reference, on fixed edge cases and generated input.
+
+#include "TestCheck.h"
+#include "TextConvert.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const uint32_t kReplacement = 0xFFFD;
+
+static void PutWide(std::wstring& out, uint32_t cp) {
+    if (sizeof(wchar_t) == 2 && cp > 0xFFFF) {
+        cp -= 0x10000;
+        out += static_cast<wchar_t>(0xD800 + (cp >> 10));
+        out += static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+        return;
+    }
+    out += static_cast<wchar_t>(cp);
+}
+
+static void PutUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// The WHATWG UTF-8 decoder: one U+FFFD per maximal invalid subpart, the
+// byte that breaks a sequence is decoded again on its own
+static std::wstring ReferenceUtf8ToWide(const std::string& in) {
+    std::wstring out;
+    uint32_t cp = 0;
+    int needed = 0, seen = 0;
+    uint8_t lower = 0x80, upper = 0xBF;
+    for (size_t i = 0; i < in.size(); i++) {
+        uint8_t b = static_cast<uint8_t>(in[i]);
+        if (needed == 0) {
+            if (b <= 0x7F) {
+                out += static_cast<wchar_t>(b);
+            } else if (b >= 0xC2 && b <= 0xDF) {
+                needed = 1;
+                cp = b & 0x1F;
+            } else if (b >= 0xE0 && b <= 0xEF) {
+                if (b == 0xE0) lower = 0xA0;
+                if (b == 0xED) upper = 0x9F;
+                needed = 2;
+                cp = b & 0x0F;
+            } else if (b >= 0xF0 && b <= 0xF4) {
+                if (b == 0xF0) lower = 0x90;
+                if (b == 0xF4) upper = 0x8F;
+                needed = 3;
+                cp = b & 0x07;
+            } else {
+                PutWide(out, kReplacement);
+            }
+            continue;
+        }
+        if (b < lower || b > upper) {
+            cp = 0;
+            needed = seen = 0;
+            lower = 0x80;
+            upper = 0xBF;
+            PutWide(out, kReplacement);
+            i--;
+            continue;
+        }
+        lower = 0x80;
+        upper = 0xBF;
+        cp = (cp << 6) | (b & 0x3F);
+        if (++seen == needed) {
+            PutWide(out, cp);
+            cp = 0;
+            needed = seen = 0;
+        }
+    }
+    if (needed) PutWide(out, kReplacement);
+    return out;
+}
+
+static std::string ReferenceWideToUtf8(const std::wstring& in) {
+    std::string out;
+    for (size_t i = 0; i < in.size(); i++) {
+        uint32_t cp = static_cast<uint32_t>(in[i]);
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < in.size()) {
+            uint32_t next = static_cast<uint32_t>(in[i + 1]);
+            if (next >= 0xDC00 && next <= 0xDFFF) {
+                PutUtf8(out, 0x10000 + ((cp - 0xD800) << 10) + (next - 0xDC00));
+                i++;
+                continue;
+            }
+        }
+        if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) cp = kReplacement;
+        PutUtf8(out, cp);
+    }
+    return out;
+}
+
+static uint32_t s_seed = 2024;
+
+static uint32_t Random(uint32_t bound) {
+    s_seed = s_seed * 1664525u + 1013904223u;
+    return (s_seed >> 8) % bound;
+}
+
+// Checks every entry point on in, placed at each alignment of a buffer so
+// the block paths see unaligned loads
+static bool Utf8Matches(const std::string& in) {
+    std::wstring expected = ReferenceUtf8ToWide(in);
+    if (Utf8ToWide(in.data(), in.size()) != expected) return false;
+
+    std::vector<char> shifted(in.size() + 16);
+    std::vector<wchar_t> out(Utf8ToWideBound(in.size()) + 8);
+    for (size_t offset = 0; offset < 16; offset += 5) {
+        if (!in.empty()) memcpy(shifted.data() + offset, in.data(), in.size());
+        for (wchar_t& c : out) c = L'#';
+        size_t n = Utf8ToWide(shifted.data() + offset, in.size(), out.data());
+        if (n != expected.size() || n > Utf8ToWideBound(in.size())) return false;
+        if (std::wstring(out.data(), n) != expected) return false;
+        for (size_t i = Utf8ToWideBound(in.size()); i < out.size(); i++) {
+            if (out[i] != L'#') return false;
+        }
+    }
+
+    std::wstring appended = L"prefix";
+    AppendUtf8ToWide(appended, in.data(), in.size());
+    if (appended != L"prefix" + expected) return false;
+    if (in.find('\0') == std::string::npos && Utf8ToWide(in.c_str()) != expected) return false;
+    return true;
+}
+
+static bool WideMatches(const std::wstring& in) {
+    std::string expected = ReferenceWideToUtf8(in);
+    if (WideToUtf8(in.data(), in.size()) != expected) return false;
+
+    std::vector<wchar_t> shifted(in.size() + 8);
+    std::vector<char> out(WideToUtf8Bound(in.size()) + 8);
+    for (size_t offset = 0; offset < 8; offset += 3) {
+        if (!in.empty()) memcpy(shifted.data() + offset, in.data(), in.size() * sizeof(wchar_t));
+        for (char& c : out) c = '#';
+        size_t n = WideToUtf8(shifted.data() + offset, in.size(), out.data());
+        if (n != expected.size() || n > WideToUtf8Bound(in.size())) return false;
+        if (std::string(out.data(), n) != expected) return false;
+        for (size_t i = WideToUtf8Bound(in.size()); i < out.size(); i++) {
+            if (out[i] != '#') return false;
+        }
+    }
+
+    std::string appended = "prefix";
+    AppendWideToUtf8(appended, in.data(), in.size());
+    if (appended != "prefix" + expected) return false;
+    if (in.find(L'\0') == std::wstring::npos && WideToUtf8(in.c_str()) != expected) return false;
+    return true;
+}
+
+static void TestFixedCases() {
+    const char* utf8[] = {
+        "",
+        "plain ascii that is longer than one sixteen byte block, and then some more",
+        "caf\xC3\xA9 \xE3\x82\xA6\xE3\x82\xA7\xE3\x83\x96 \xF0\x9F\x98\x80",
+        // Invalid lead bytes and lone continuations
+        "\x80", "\xBF\x80", "\xC0\x80", "\xC1\xBF", "\xF5\x80\x80\x80", "\xFF\xFE",
+        // Overlong, surrogate and out-of-range encodings
+        "\xE0\x80\x80", "\xE0\x9F\xBF", "\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF",
+        "\xED\xA0\x80", "\xED\xBF\xBF", "\xF4\x90\x80\x80",
+        // Truncated sequences, at the end and before ASCII
+        "\xC3", "\xE3\x81", "\xF0\x9F\x98", "a\xE3\x81" "bcdefghijklmnopqrstuvwxyz",
+        "\xF0\x9F" "0123456789abcdef0123456789abcdef",
+        // Sequences broken by a new lead byte
+        "\xE3\xC3\xA9", "\xF0\x9F\xE3\x81\x82",
+        // Largest valid code points of each length
+        "\x7F\xDF\xBF\xEF\xBF\xBF\xF4\x8F\xBF\xBF",
+    };
+    for (const char* s : utf8) CHECK(Utf8Matches(s));
+    CHECK(Utf8Matches(std::string("nul\0inside a long enough ascii run", 34)));
+
+    std::wstring wide[] = {
+        L"",
+        L"plain ascii that is longer than one sixteen byte block, and then some more",
+        std::wstring(1, static_cast<wchar_t>(0xD800)),
+        std::wstring(1, static_cast<wchar_t>(0xDC00)),
+        std::wstring({static_cast<wchar_t>(0xDC00), static_cast<wchar_t>(0xD800)}),
+        std::wstring({static_cast<wchar_t>(0xD83D), static_cast<wchar_t>(0xDE00)}),
+        std::wstring({static_cast<wchar_t>(0xD83D), L'a', L'b'}),
+        std::wstring({L'x', static_cast<wchar_t>(0x7F), static_cast<wchar_t>(0x80),
+                      static_cast<wchar_t>(0x7FF), static_cast<wchar_t>(0x800), static_cast<wchar_t>(0xFFFF)}),
+    };
+    for (const std::wstring& s : wide) CHECK(WideMatches(s));
+    if (sizeof(wchar_t) == 4) {
+        CHECK(WideMatches(std::wstring({static_cast<wchar_t>(0x1F600), static_cast<wchar_t>(0x10FFFF)})));
+        CHECK(WideMatches(std::wstring({static_cast<wchar_t>(0x110000), L'a'})));
+    }
+}
+
+// Valid code points of every encoded length, corrupted now and then, with
+// ASCII runs long enough to take the block path
+static std::string GenerateUtf8() {
+    std::string s;
+    int pieces = static_cast<int>(Random(24));
+    for (int p = 0; p < pieces; p++) {
+        switch (Random(6)) {
+        case 0: {
+            size_t run = Random(70);
+            for (size_t i = 0; i < run; i++) s += static_cast<char>(0x20 + Random(0x5F));
+            break;
+        }
+        case 1: PutUtf8(s, 0x80 + Random(0x780)); break;
+        case 2: {
+            uint32_t cp = 0x800 + Random(0xF800);
+            PutUtf8(s, cp >= 0xD800 && cp <= 0xDFFF ? cp + 0x800 : cp);
+            break;
+        }
+        case 3: PutUtf8(s, 0x10000 + Random(0x100000)); break;
+        case 4: s += static_cast<char>(0x80 + Random(0x80)); break;  // any high byte
+        default: {
+            // Drop the tail of a multibyte sequence
+            std::string seq;
+            PutUtf8(seq, 0x800 + Random(0x10F800));
+            s += seq.substr(0, 1 + Random(static_cast<uint32_t>(seq.size() - 1)));
+            break;
+        }
+        }
+    }
+    if (!s.empty() && Random(4) == 0) s.resize(Random(static_cast<uint32_t>(s.size())));
+    return s;
+}
+
+static std::wstring GenerateWide() {
+    std::wstring s;
+    int pieces = static_cast<int>(Random(24));
+    for (int p = 0; p < pieces; p++) {
+        switch (Random(5)) {
+        case 0: {
+            size_t run = Random(70);
+            for (size_t i = 0; i < run; i++) s += static_cast<wchar_t>(0x20 + Random(0x5F));
+            break;
+        }
+        case 1: s += static_cast<wchar_t>(0x80 + Random(0xFF80)); break;  // includes lone surrogates
+        case 2: PutWide(s, 0x10000 + Random(0x100000)); break;
+        case 3: s += static_cast<wchar_t>(0xD800 + Random(0x800)); break;
+        default:
+            s += static_cast<wchar_t>(sizeof(wchar_t) == 4 ? 0x10FFF0 + Random(0x20) : 0xFFF0 + Random(0x10));
+            break;
+        }
+    }
+    return s;
+}
+
+static void TestGenerated() {
+    int utf8Mismatches = 0, wideMismatches = 0, roundTripMismatches = 0;
+    for (int i = 0; i < 20000; i++) {
+        std::string utf8 = GenerateUtf8();
+        if (!Utf8Matches(utf8)) utf8Mismatches++;
+        std::wstring wide = GenerateWide();
+        if (!WideMatches(wide)) wideMismatches++;
+        // Whatever decodes, re-encodes to UTF-8 that decodes the same way
+        std::wstring decoded = Utf8ToWide(utf8.data(), utf8.size());
+        std::string encoded = WideToUtf8(decoded.data(), decoded.size());
+        if (Utf8ToWide(encoded.data(), encoded.size()) != decoded) roundTripMismatches++;
+    }
+    CHECK(utf8Mismatches == 0);
+    CHECK(wideMismatches == 0);
+    CHECK(roundTripMismatches == 0);
+
+    // Arbitrary bytes
+    int byteMismatches = 0;
+    for (int i = 0; i < 20000; i++) {
+        std::string bytes(Random(80), '\0');
+        for (char& c : bytes) c = static_cast<char>(Random(256));
+        if (!Utf8Matches(bytes)) byteMismatches++;
+    }
+    CHECK(byteMismatches == 0);
+}
+
+int main() {
+    TestFixedCases();
+    TestGenerated();
+    return TestExitCode();
+}
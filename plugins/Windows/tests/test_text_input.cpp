@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Typed text as the window messages and DevTools calls SendText and the
+// IME composition path produce.
+
+#include "TestCheck.h"
+#include "TextInput.h"
+
+#include <string>
+#include <vector>
+
+static std::vector<TypedInput> Typed(const std::wstring& text) {
+    std::vector<TypedInput> out;
+    AppendTypedInput(out, text.data(), text.size());
+    return out;
+}
+
+static bool Is(const TypedInput& input, bool key, uint16_t code) {
+    return input.key == key && input.code == code;
+}
+
+static void TestTypedKeys() {
+    CHECK(TypedKeyToVirtualKey(0x08) == 0x08);
+    CHECK(TypedKeyToVirtualKey(0x09) == 0x09);
+    CHECK(TypedKeyToVirtualKey(0x0D) == 0x0D && TypedKeyToVirtualKey(0x0A) == 0x0D);
+    CHECK(TypedKeyToVirtualKey(0x1B) == 0x1B);
+    CHECK(TypedKeyToVirtualKey(0x7F) == 0x2E);
+    CHECK(TypedKeyToVirtualKey(0) == 0 && TypedKeyToVirtualKey('a') == 0 && TypedKeyToVirtualKey(0x0C) == 0);
+}
+
+static void TestTypedInput() {
+    std::vector<TypedInput> out = Typed(L"a\tb\x7F");
+    CHECK(out.size() == 4);
+    CHECK(Is(out[0], false, 'a') && Is(out[1], true, 0x09) && Is(out[2], false, 'b') && Is(out[3], true, 0x2E));
+
+    // CRLF is one enter; lone CR or LF each are one; LFCR is two
+    out = Typed(L"1\r\n2\r3\n4\n\r");
+    CHECK(out.size() == 9);
+    CHECK(Is(out[1], true, 0x0D) && Is(out[2], false, '2') && Is(out[3], true, 0x0D));
+    CHECK(Is(out[5], true, 0x0D) && Is(out[7], true, 0x0D) && Is(out[8], true, 0x0D));
+    // A trailing CR has nothing to pair with
+    out = Typed(L"\r");
+    CHECK(out.size() == 1 && Is(out[0], true, 0x0D));
+
+    // Other control characters are dropped; surrogates go out as they are
+    out = Typed(std::wstring(L"\x01\x0C\x1F" L"\xD83C\xDF6A\x00E9\0z", 9));
+    CHECK(out.size() == 4);
+    CHECK(Is(out[0], false, 0xD83C) && Is(out[1], false, 0xDF6A) && Is(out[2], false, 0x00E9));
+    CHECK(Is(out[3], false, 'z'));
+
+    // Appends to what is there
+    out.assign(1, TypedInput{true, 0x08});
+    AppendTypedInput(out, L"x", 1);
+    CHECK(out.size() == 2 && Is(out[0], true, 0x08) && Is(out[1], false, 'x'));
+    AppendTypedInput(out, L"", 0);
+    CHECK(out.size() == 2);
+}
+
+static void TestInsertText() {
+    CHECK(InsertTextParams(L"", 0) == L"{\"text\":\"\"}");
+    std::wstring text = L"say \"hi\"\\\n\x00E9\xD83C\xDF6A";
+    CHECK(InsertTextParams(text.data(), text.size()) ==
+          L"{\"text\":\"say \\\"hi\\\"\\\\\\u000a\x00E9\xD83C\xDF6A\"}");
+    // Only length code units are taken
+    CHECK(InsertTextParams(L"abc", 2) == L"{\"text\":\"ab\"}");
+}
+
+static void TestComposition() {
+    std::wstring text = L"\x304B\x3093\x3058";
+    CHECK(CompositionParams(text.data(), text.size(), 1) ==
+          L"{\"text\":\"\x304B\x3093\x3058\",\"selectionStart\":1,\"selectionEnd\":1}");
+    CHECK(CompositionParams(text.data(), text.size(), 0) ==
+          L"{\"text\":\"\x304B\x3093\x3058\",\"selectionStart\":0,\"selectionEnd\":0}");
+    // Out of range clamps to the end
+    CHECK(CompositionParams(text.data(), text.size(), 3) ==
+          L"{\"text\":\"\x304B\x3093\x3058\",\"selectionStart\":3,\"selectionEnd\":3}");
+    CHECK(CompositionParams(text.data(), text.size(), 4) ==
+          L"{\"text\":\"\x304B\x3093\x3058\",\"selectionStart\":3,\"selectionEnd\":3}");
+    CHECK(CompositionParams(text.data(), text.size(), -1) ==
+          L"{\"text\":\"\x304B\x3093\x3058\",\"selectionStart\":3,\"selectionEnd\":3}");
+    // Empty text puts the caret at 0
+    CHECK(CompositionParams(L"", 0, 5) == L"{\"text\":\"\",\"selectionStart\":0,\"selectionEnd\":0}");
+    CHECK(CompositionParams(L"\"\t", 2, 1) == L"{\"text\":\"\\\"\\u0009\",\"selectionStart\":1,\"selectionEnd\":1}");
+}
+
+int main() {
+    TestTypedKeys();
+    TestTypedInput();
+    TestInsertText();
+    TestComposition();
+    return TestExitCode();
+}
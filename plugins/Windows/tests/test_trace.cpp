@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// Records from several threads, wraps a ring, and checks that the trace
+// JSON parses with ordered timestamps and properly nested spans.
+
+#include "TestCheck.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int kThreads = 4;
+static const int kScopes = 1000;
+static const int kRingEvents = 1 << 14;  // Trace.cpp's per-thread ring
+static const int kWrapEvents = kRingEvents + 5000;
+
+// Just enough JSON to read a trace back: objects, arrays, strings and
+// numbers, plus the literals
+struct JsonValue {
+    enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT } type = NUL;
+    double number = 0;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::map<std::string, JsonValue> fields;
+
+    const JsonValue* field(const char* name) const {
+        auto it = fields.find(name);
+        return it == fields.end() ? nullptr : &it->second;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : m_p(text.c_str()), m_end(text.c_str() + text.size()) {}
+
+    bool parse(JsonValue& value) {
+        if (!parseValue(value)) return false;
+        skipSpace();
+        return m_p == m_end;
+    }
+
+private:
+    void skipSpace() {
+        while (m_p < m_end && (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t')) m_p++;
+    }
+
+    bool literal(const char* word) {
+        size_t n = strlen(word);
+        if (static_cast<size_t>(m_end - m_p) < n || memcmp(m_p, word, n) != 0) return false;
+        m_p += n;
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (m_p >= m_end || *m_p != '"') return false;
+        m_p++;
+        while (m_p < m_end && *m_p != '"') {
+            char c = *m_p++;
+            if (static_cast<unsigned char>(c) < 0x20) return false;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_p >= m_end) return false;
+            char e = *m_p++;
+            switch (e) {
+            case '"': case '\\': case '/': out += e; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                if (m_end - m_p < 4) return false;
+                unsigned code = 0;
+                for (int i = 0; i < 4; i++) {
+                    char h = *m_p++;
+                    code <<= 4;
+                    if (h >= '0' && h <= '9') code |= h - '0';
+                    else if (h >= 'a' && h <= 'f') code |= h - 'a' + 10;
+                    else if (h >= 'A' && h <= 'F') code |= h - 'A' + 10;
+                    else return false;
+                }
+                out += code < 0x80 ? static_cast<char>(code) : '?';
+                break;
+            }
+            default: return false;
+            }
+        }
+        if (m_p >= m_end) return false;
+        m_p++;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value) {
+        skipSpace();
+        if (m_p >= m_end) return false;
+        if (*m_p == '{') {
+            value.type = JsonValue::OBJECT;
+            m_p++;
+            skipSpace();
+            if (m_p < m_end && *m_p == '}') return ++m_p, true;
+            for (;;) {
+                std::string name;
+                skipSpace();
+                if (!parseString(name)) return false;
+                skipSpace();
+                if (m_p >= m_end || *m_p++ != ':') return false;
+                if (!parseValue(value.fields[name])) return false;
+                skipSpace();
+                if (m_p >= m_end) return false;
+                if (*m_p == '}') return ++m_p, true;
+                if (*m_p++ != ',') return false;
+            }
+        }
+        if (*m_p == '[') {
+            value.type = JsonValue::ARRAY;
+            m_p++;
+            skipSpace();
+            if (m_p < m_end && *m_p == ']') return ++m_p, true;
+            for (;;) {
+                value.items.emplace_back();
+                if (!parseValue(value.items.back())) return false;
+                skipSpace();
+                if (m_p >= m_end) return false;
+                if (*m_p == ']') return ++m_p, true;
+                if (*m_p++ != ',') return false;
+            }
+        }
+        if (*m_p == '"') {
+            value.type = JsonValue::STRING;
+            return parseString(value.text);
+        }
+        if (literal("true") || literal("false")) {
+            value.type = JsonValue::BOOL;
+            return true;
+        }
+        if (literal("null")) return true;
+        char* end = nullptr;
+        std::string rest(m_p, std::min<size_t>(m_end - m_p, 32));
+        value.number = strtod(rest.c_str(), &end);
+        if (end == rest.c_str()) return false;
+        value.type = JsonValue::NUMBER;
+        m_p += end - rest.c_str();
+        return true;
+    }
+
+    const char* m_p;
+    const char* m_end;
+};
+
+struct Span {
+    std::string name;
+    double start, end;
+    long long arg;
+};
+
+// Expands complete events into B/E pairs and checks that they balance:
+// each span begins after and ends before the span enclosing it
+static bool SpansNest(std::vector<Span> spans) {
+    std::stable_sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) {
+        return a.start != b.start ? a.start < b.start : a.end > b.end;
+    });
+    std::vector<const Span*> open;
+    size_t begins = 0, ends = 0;
+    for (const Span& span : spans) {
+        while (!open.empty() && open.back()->end <= span.start) {
+            open.pop_back();
+            ends++;
+        }
+        if (!open.empty() && span.end > open.back()->end) return false;
+        open.push_back(&span);
+        begins++;
+    }
+    ends += open.size();
+    return begins == spans.size() && ends == begins;
+}
+
+// A thread's ring is handed to the next new thread once it exits, so every
+// recorder stays alive until all have finished
+static std::atomic<int> s_finished{0};
+
+static void WaitForAll() {
+    s_finished.fetch_add(1);
+    while (s_finished.load() < kThreads + 1) std::this_thread::yield();
+}
+
+static void RecordScopes(const char* name) {
+    TraceSetThreadName(name);
+    for (int k = 0; k < kScopes; k++) {
+        TraceScope outer("outer", k);
+        {
+            TraceScope inner("inner", k);
+            TraceInstant("tick", k);
+        }
+    }
+    WaitForAll();
+}
+
+static void RecordWrap() {
+    TraceSetThreadName("wrap");
+    for (int k = 0; k < kWrapEvents; k++) TraceInstant("wrap", k);
+    WaitForAll();
+}
+
+static std::string ReadFile(const char* path) {
+    std::string text;
+    FILE* f = fopen(path, "rb");
+    if (!f) return text;
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+    return text;
+}
+
+int main() {
+    static const char* names[kThreads] = {"worker 0", "worker \"1\"", "worker 2", "worker 3"};
+    SetTraceEnabled(true);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; i++) threads.emplace_back(RecordScopes, names[i]);
+    threads.emplace_back(RecordWrap);
+    for (std::thread& t : threads) t.join();
+    SetTraceEnabled(false);
+
+    const char* path = "test_trace.json";
+    CHECK(WriteTraceFile(path));
+    std::string text = ReadFile(path);
+    remove(path);
+
+    JsonValue root;
+    CHECK(JsonParser(text).parse(root));
+    const JsonValue* events = root.field("traceEvents");
+    CHECK(events && events->type == JsonValue::ARRAY);
+    if (!events) return TestExitCode();
+
+    std::map<int, std::string> threadNames;
+    std::map<int, std::vector<const JsonValue*>> byThread;
+    for (const JsonValue& e : events->items) {
+        const JsonValue* ph = e.field("ph");
+        const JsonValue* tid = e.field("tid");
+        CHECK(ph && tid && e.field("name"));
+        if (!ph || !tid) continue;
+        if (ph->text == "M") {
+            const JsonValue* args = e.field("args");
+            if (args && args->field("name")) threadNames[static_cast<int>(tid->number)] = args->field("name")->text;
+            continue;
+        }
+        CHECK(e.field("ts") && e.field("args") && e.field("args")->field("arg"));
+        byThread[static_cast<int>(tid->number)].push_back(&e);
+    }
+    CHECK(byThread.size() == kThreads + 1);
+    CHECK(threadNames.size() == kThreads + 1);
+
+    int scopeThreads = 0, wrapThreads = 0;
+    for (const auto& entry : byThread) {
+        const std::vector<const JsonValue*>& list = entry.second;
+        const std::string& threadName = threadNames[entry.first];
+        double lastInstant = 0, lastEnd = 0;
+        bool ordered = true;
+        std::vector<Span> spans;
+        std::vector<long long> wrapArgs;
+        for (const JsonValue* e : list) {
+            double ts = e->field("ts")->number;
+            long long arg = static_cast<long long>(e->field("args")->field("arg")->number);
+            if (e->field("ph")->text == "X") {
+                CHECK(e->field("dur"));
+                double end = ts + (e->field("dur") ? e->field("dur")->number : 0);
+                // Spans are recorded as they close
+                if (end < lastEnd) ordered = false;
+                lastEnd = end;
+                spans.push_back({e->field("name")->text, ts, end, arg});
+            } else {
+                if (ts < lastInstant) ordered = false;
+                lastInstant = ts;
+                if (e->field("name")->text == "wrap") wrapArgs.push_back(arg);
+            }
+        }
+        CHECK(ordered);
+
+        if (threadName == "wrap") {
+            wrapThreads++;
+            // Only the newest ring's worth survives, oldest first
+            CHECK(list.size() == static_cast<size_t>(kRingEvents));
+            bool newest = wrapArgs.size() == static_cast<size_t>(kRingEvents);
+            for (size_t i = 0; newest && i < wrapArgs.size(); i++)
+                newest = wrapArgs[i] == kWrapEvents - kRingEvents + static_cast<long long>(i);
+            CHECK(newest);
+            continue;
+        }
+        scopeThreads++;
+        CHECK(std::find(names, names + kThreads, threadName) != names + kThreads);
+        CHECK(list.size() == static_cast<size_t>(kScopes * 3));
+        CHECK(spans.size() == static_cast<size_t>(kScopes * 2));
+        CHECK(SpansNest(spans));
+        // Each inner span lies inside the outer span with the same arg
+        std::map<long long, const Span*> outer;
+        for (const Span& s : spans) {
+            if (s.name == "outer") outer[s.arg] = &s;
+        }
+        bool contained = outer.size() == static_cast<size_t>(kScopes);
+        for (const Span& s : spans) {
+            if (s.name != "inner") continue;
+            auto it = outer.find(s.arg);
+            contained = contained && it != outer.end() &&
+                        it->second->start <= s.start && s.end <= it->second->end;
+        }
+        CHECK(contained);
+    }
+    CHECK(scopeThreads == kThreads);
+    CHECK(wrapThreads == 1);
+
+    // Clearing drops everything but the thread names
+    TraceClear();
+    JsonValue cleared;
+    CHECK(JsonParser(TraceToJson()).parse(cleared));
+    size_t remaining = 0;
+    if (const JsonValue* list = cleared.field("traceEvents")) {
+        for (const JsonValue& e : list->items) {
+            if (e.field("ph") && e.field("ph")->text != "M") remaining++;
+        }
+    }
+    CHECK(remaining == 0);
+    return TestExitCode();
+}
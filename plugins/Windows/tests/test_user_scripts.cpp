@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2011 Keijiro Takahashi
+ * Copyright (C) 2012 GREE, Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+// The shared user script registry, and UserScriptSync keeping one WebView2
+// instance in step with it while WebView2's ids arrive late: scripts added
+// and removed again before their id comes back, re-added meanwhile, or
+// failing to add.
+
+#include "TestCheck.h"
+#include "UserScripts.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+static UserScript Script(int id) {
+    return UserScript{id, std::make_shared<const std::wstring>(L"s" + std::to_wstring(id))};
+}
+
+struct Sync {
+    UserScriptSync sync;
+    std::vector<UserScript> adds;
+    std::vector<std::wstring> removes;
+
+    void update(std::initializer_list<int> ids) {
+        std::vector<UserScript> wanted;
+        for (int id : ids) wanted.push_back(Script(id));
+        adds.clear();
+        removes.clear();
+        sync.update(wanted, adds, removes);
+    }
+
+    std::vector<int> addedIds() const {
+        std::vector<int> ids;
+        for (const UserScript& script : adds) ids.push_back(script.id);
+        return ids;
+    }
+};
+
+static void TestRegistry() {
+    UserScriptRegistry& registry = UserScriptRegistry::instance();
+    size_t size = registry.size();
+    uint64_t deduplicated = registry.deduplicated();
+    bool created = true;
+    CHECK(registry.add(nullptr, &created) == 0 && !created);
+    CHECK(registry.add("", &created) == 0 && !created);
+
+    int a = registry.add("window.a = '\xc3\xa9';", &created);
+    CHECK(a > 0 && created);
+    CHECK(registry.add("window.a = '\xc3\xa9';", &created) == a && !created);
+    int b = registry.add("window.b = 1;", &created);
+    CHECK(b > a && created);
+    CHECK(registry.size() == size + 2 && registry.deduplicated() == deduplicated + 1);
+
+    std::vector<UserScript> scripts;
+    registry.snapshot(scripts);
+    auto it = std::find_if(scripts.begin(), scripts.end(), [&](const UserScript& s) { return s.id == a; });
+    CHECK(it != scripts.end() && *it->source == L"window.a = '\x00e9';");
+
+    // One reference each; the last remove drops it and its id is not reused
+    bool dropped = true;
+    CHECK(registry.remove(a, &dropped) && !dropped);
+    CHECK(registry.remove(a, &dropped) && dropped);
+    CHECK(!registry.remove(a, &dropped) && !dropped);
+    int again = registry.add("window.a = '\xc3\xa9';", &created);
+    CHECK(created && again != a && again > b);
+    CHECK(registry.remove(again) && registry.remove(b));
+    CHECK(registry.size() == size);
+}
+
+static void TestSyncSteady() {
+    Sync s;
+    s.update({1, 2});
+    CHECK(s.addedIds() == (std::vector<int>{1, 2}) && s.removes.empty());
+    CHECK(s.sync.added(1, L"wv-1") && s.sync.added(2, L"wv-2"));
+    // A second id for a held script is refused for the caller to remove
+    CHECK(!s.sync.added(1, L"wv-1b"));
+
+    s.update({1, 2});
+    CHECK(s.adds.empty() && s.removes.empty());
+    s.update({2, 3});
+    CHECK(s.addedIds() == std::vector<int>{3});
+    CHECK(s.removes == std::vector<std::wstring>{L"wv-1"});
+    CHECK(s.sync.size() == 2);
+
+    // Duplicates in the wanted list are added once
+    s.update({2, 3, 4, 4});
+    CHECK(s.addedIds() == std::vector<int>{4});
+}
+
+static void TestSyncRemovedWhilePending() {
+    Sync s;
+    s.update({1});
+    s.update({});
+    // Nothing to remove yet; the id is refused when it arrives
+    CHECK(s.removes.empty() && s.sync.size() == 0);
+    CHECK(!s.sync.added(1, L"wv-1"));
+
+    // Removed and wanted again before the first id arrives: the add is
+    // issued again, the first id to arrive is kept and the other refused
+    s.update({2});
+    s.update({});
+    s.update({2});
+    CHECK(s.addedIds() == std::vector<int>{2} && s.removes.empty());
+    CHECK(s.sync.added(2, L"wv-2a"));
+    CHECK(!s.sync.added(2, L"wv-2b"));
+    s.update({});
+    CHECK(s.removes == std::vector<std::wstring>{L"wv-2a"});
+}
+
+static void TestSyncFailed() {
+    Sync s;
+    s.update({1, 2});
+    s.sync.failed(1);
+    CHECK(s.sync.size() == 1);
+    // A late id for a failed add is refused; the next update retries it
+    CHECK(!s.sync.added(1, L"wv-late"));
+    s.update({1, 2});
+    CHECK(s.addedIds() == std::vector<int>{1});
+
+    // Failing a held script, or an unknown one, changes nothing
+    CHECK(s.sync.added(2, L"wv-2"));
+    s.sync.failed(2);
+    s.sync.failed(9);
+    s.update({1});
+    CHECK(s.adds.empty() && s.removes == std::vector<std::wstring>{L"wv-2"});
+
+    // Empty or null ids are not taken as held
+    CHECK(!s.sync.added(1, L""));
+    CHECK(!s.sync.added(1, nullptr));
+    CHECK(s.sync.added(1, L"wv-1"));
+}
+
+int main() {
+    TestRegistry();
+    TestSyncSteady();
+    TestSyncRemovedWhilePending();
+    TestSyncFailed();
+    return TestExitCode();
+}